@@ -0,0 +1,29 @@
+// Integer arithmetic and branches: the total number of
+// Collatz steps of 1..n (whose paths stay below 2^31).
+int steps (int n)
+{
+  int s = 0;
+
+  while (n-1){
+    if (n%2)
+      n = 3*n+1;
+    else
+      n = n/2;
+    s = s+1;
+  }
+  return s;
+}
+
+int dragon ()
+{
+  int n = 100000;
+  int total = 0;
+
+  while (n){
+    total = total + steps (n);
+    n = n-1;
+  }
+  printi (total);
+  prints ("\n");
+  return 0;
+}
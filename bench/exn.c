@@ -0,0 +1,29 @@
+// Exceptions (as in "regression/exn*.c"): throw from a
+// call on every seventh number, and catch around it.
+int check (int i)
+{
+  if (i%7==0)
+    throw;
+  return i%100;
+}
+
+int dragon ()
+{
+  int i;
+  int sum = 0;
+  int caught = 0;
+
+  for (i=1; i<=1000000; i=i+1){
+    try {
+      sum = sum + check (i);
+    }
+    catch {
+      caught = caught+1;
+    }
+  }
+  printi (sum);
+  prints (" ");
+  printi (caught);
+  prints ("\n");
+  return 0;
+}
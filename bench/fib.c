@@ -0,0 +1,17 @@
+// Function calls: naive recursive Fibonacci.
+int fib (int n)
+{
+  if (n){
+    if (n-1)
+      return fib (n-1) + fib (n-2);
+    return 1;
+  }
+  return 0;
+}
+
+int dragon ()
+{
+  printi (fib (35));
+  prints ("\n");
+  return 0;
+}
@@ -0,0 +1,57 @@
+// Linked lists (as in "regression/list.c"): build, reverse
+// in place and sum, several times.
+class list
+{
+  int data;
+  list next;
+}
+
+list build (int n)
+{
+  list l = null;
+
+  while (n){
+    l = new list (n, l);
+    n = n-1;
+  }
+  return l;
+}
+
+list reverse (list l)
+{
+  list r = null;
+  list next;
+
+  while (l!=null){
+    next = l.next;
+    l.next = r;
+    r = l;
+    l = next;
+  }
+  return r;
+}
+
+int sum (list l)
+{
+  int s = 0;
+  int i = 1;
+
+  while (l!=null){
+    s = (s + (l.data%1000)*(i%1000))%1000003;
+    i = i+1;
+    l = l.next;
+  }
+  return s;
+}
+
+int dragon ()
+{
+  int round;
+  int s = 0;
+
+  for (round=0; round<20; round=round+1)
+    s = (s + sum (reverse (build (100000))))%1000003;
+  printi (s);
+  prints ("\n");
+  return 0;
+}
@@ -0,0 +1,31 @@
+// Array kernel: multiply two n*n matrices, kept row by row
+// in flat arrays.
+int dragon ()
+{
+  int n = 160;
+  int[] a = new int[n*n];
+  int[] b = new int[n*n];
+  int[] c = new int[n*n];
+  int i;
+  int j;
+  int k;
+  int s;
+  int sum = 0;
+
+  for (i=0; i<n*n; i=i+1){
+    a[i] = i%17;
+    b[i] = i%13;
+  }
+  for (i=0; i<n; i=i+1)
+    for (j=0; j<n; j=j+1){
+      s = 0;
+      for (k=0; k<n; k=k+1)
+        s = s + a[i*n+k]*b[k*n+j];
+      c[i*n+j] = s;
+    }
+  for (i=0; i<n*n; i=i+1)
+    sum = (sum + c[i]*(i%7))%1000003;
+  printi (sum);
+  prints ("\n");
+  return 0;
+}
@@ -0,0 +1,34 @@
+// Allocation: build complete binary trees of short-lived
+// objects and count their nodes, many times over.
+class node
+{
+  int id;
+  node left;
+  node right;
+}
+
+node make (int d)
+{
+  if (d==0)
+    return new node (0, null, null);
+  return new node (d, make (d-1), make (d-1));
+}
+
+int check (node n)
+{
+  if (n.left==null)
+    return 1;
+  return 1 + check (n.left) + check (n.right);
+}
+
+int dragon ()
+{
+  int round;
+  int total = 0;
+
+  for (round=0; round<20; round=round+1)
+    total = total + check (make (16));
+  printi (total);
+  prints ("\n");
+  return 0;
+}
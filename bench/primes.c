@@ -0,0 +1,28 @@
+// Loops and division: count the primes below n by trial
+// division. "n/(d*d)" is 0 once d*d is greater than n.
+int isPrime (int n)
+{
+  int d = 2;
+
+  while (n/(d*d)){
+    if (n%d)
+      d = d+1;
+    else
+      return 0;
+  }
+  return 1;
+}
+
+int dragon ()
+{
+  int n = 400000;
+  int count = 0;
+
+  while (n-2){
+    n = n-1;
+    count = count + isPrime (n);
+  }
+  printi (count);
+  prints ("\n");
+  return 0;
+}
@@ -0,0 +1,60 @@
+// Sorting: quicksort (as in "regression/qsort.c") over
+// pseudo-random numbers, then a check of the order.
+int partition (int[] array, int left, int right)
+{
+  int pivot = array[left];
+  int i = left-1;
+  int j = right+1;
+  int temp;
+
+  while (1){
+    do {
+      j = j-1;
+    } while (array[j]>pivot);
+    do {
+      i = i+1;
+    } while (array[i]<pivot);
+    if (i<j){
+      temp = array[i];
+      array[i] = array[j];
+      array[j] = temp;
+    }
+    else return j;
+  }
+  return 0;
+}
+
+int qsort (int[] a, int left, int right)
+{
+  int index;
+
+  if (left>=right)
+    return 0;
+  index = partition (a, left, right);
+  qsort (a, left, index);
+  qsort (a, index+1, right);
+  return 0;
+}
+
+int dragon ()
+{
+  int size = 300000;
+  int[] array = new int[size];
+  int seed = 42;
+  int i;
+  int sum = 0;
+
+  for (i=0; i<size; i=i+1){
+    seed = (seed*75+74)%65537;
+    array[i] = seed;
+  }
+  qsort (array, 0, size-1);
+  for (i=1; i<size; i=i+1){
+    if (array[i-1]>array[i])
+      prints ("not sorted\n");
+    sum = (sum + array[i]*(i%100))%1000003;
+  }
+  printi (sum);
+  prints ("\n");
+  return 0;
+}
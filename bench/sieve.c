@@ -0,0 +1,32 @@
+// Array kernel: the sieve of Eratosthenes, several times.
+int sieve (int[] flags, int n)
+{
+  int i;
+  int j;
+  int count = 0;
+
+  for (i=0; i<n; i=i+1)
+    flags[i] = 1;
+  for (i=2; i<n; i=i+1){
+    if (flags[i]){
+      count = count+1;
+      for (j=i+i; j<n; j=j+i)
+        flags[j] = 0;
+    }
+  }
+  return count;
+}
+
+int dragon ()
+{
+  int n = 2000000;
+  int[] flags = new int[n];
+  int round;
+  int count = 0;
+
+  for (round=0; round<5; round=round+1)
+    count = count + sieve (flags, n);
+  printi (count);
+  prints ("\n");
+  return 0;
+}
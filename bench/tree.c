@@ -0,0 +1,59 @@
+// Trees (as in "regression/tree.c"): insert pseudo-random
+// keys into a binary search tree, then walk it.
+class tree
+{
+  int key;
+  tree left;
+  tree right;
+}
+
+tree insert (tree t, int key)
+{
+  if (t==null)
+    return new tree (key, null, null);
+  if (key<t.key)
+    t.left = insert (t.left, key);
+  else
+    t.right = insert (t.right, key);
+  return t;
+}
+
+int depth (tree t)
+{
+  int l;
+  int r;
+
+  if (t==null)
+    return 0;
+  l = depth (t.left);
+  r = depth (t.right);
+  if (l<r)
+    return r+1;
+  return l+1;
+}
+
+int walk (tree t, int s)
+{
+  if (t==null)
+    return s;
+  s = walk (t.left, s);
+  s = (s*31 + t.key)%1000003;
+  return walk (t.right, s);
+}
+
+int dragon ()
+{
+  tree t = null;
+  int seed = 7;
+  int i;
+
+  for (i=0; i<200000; i=i+1){
+    seed = (seed*75+74)%65537;
+    t = insert (t, seed);
+  }
+  printi (depth (t));
+  prints (" ");
+  printi (walk (t, 0));
+  prints ("\n");
+  return 0;
+}
@@ -21,6 +21,11 @@ T AstId_fromString(String_t s, Region_t r) {
     return AstId_new(Id_fromString(s), r);
 }
 
+T AstId_fromId(Id_t id, Region_t r) {
+    assert(id);
+    return AstId_new(id, r);
+}
+
 T AstId_bogus(void) {
     return AstId_new(Id_bogus(), Region_bogus());
 }
@@ -60,9 +65,9 @@ Region_t AstId_getRegion(T t) {
     return t->region;
 }
 
-Plist_t AstId_plist(T t) {
+long AstId_index(T t) {
     assert(t);
-    return Id_plist(t->id);
+    return Id_index(t->id);
 }
 
 void AstId_print(T t) {
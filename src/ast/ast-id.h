@@ -3,7 +3,6 @@
 
 #include "../atoms/id.h"
 #include "../control/region.h"
-#include "../lib/property-list.h"
 #include "../lib/string.h"
 
 #define T AstId_t
@@ -11,13 +10,15 @@
 typedef struct T *T;
 
 T AstId_fromString(String_t s, Region_t r);
+// "id" is already interned, e.g., by the lexer.
+T AstId_fromId(Id_t id, Region_t r);
 T AstId_bogus(void);
 long AstId_equals(T id1, T id2);
 long AstId_hashCode(T);
 T AstId_newNoName(void);
 String_t AstId_toString(T);
 Id_t AstId_toId(T);
-Plist_t AstId_plist(T);
+long AstId_index(T);
 Region_t AstId_dest(T);
 Region_t AstId_getRegion(T);
 void AstId_print(T);
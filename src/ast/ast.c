@@ -95,8 +95,8 @@ E Ast_Exp_new_assign(E left, E right, Type_t ty,
 
     Mem_NEW(e);
     e->kind = AST_EXP_ASSIGN;
-    e->u.bop.left = left;
-    e->u.bop.right = right;
+    e->u.assign.left = left;
+    e->u.assign.right = right;
     e->ty = ty;
     e->region = r;
     return e;
@@ -109,6 +109,7 @@ E Ast_Exp_new_bop(String_t bop,
                   Region_t r) {
     E e;
     Mem_NEW(e);
+    e->kind = AST_EXP_BOP;
     e->u.bop.bop = bop;
     e->u.bop.left = left;
     e->u.bop.right = right;
@@ -121,6 +122,7 @@ E Ast_Exp_new_unary(Ast_Exp_Kind_t kind, E x, Type_t ty, Region_t r) {
     E e;
     Mem_NEW(e);
     e->kind = kind;
+    e->u.unary.op = (kind == AST_EXP_NOT) ? "!" : "-";
     e->u.unary.e = x;
     e->ty = ty;
     e->region = r;
@@ -8,7 +8,7 @@
 T Atype_new_int(void) {
     T p;
 
-    Mem_NEW(p);
+    Mem_NEW_IN(p, MEM_ARENA_GLOBAL);
 
     p->kind = ATYPE_INT;
     return p;
@@ -17,7 +17,7 @@ T Atype_new_int(void) {
 T Atype_new_int_array(void) {
     T p;
 
-    Mem_NEW(p);
+    Mem_NEW_IN(p, MEM_ARENA_GLOBAL);
     p->kind = ATYPE_INT_ARRAY;
     return p;
 }
@@ -27,7 +27,7 @@ T Atype_new_string(String_t x) {
 
     T p;
 
-    Mem_NEW(p);
+    Mem_NEW_IN(p, MEM_ARENA_GLOBAL);
     p->kind = ATYPE_STRING;
     return p;
 }
@@ -35,7 +35,7 @@ T Atype_new_string(String_t x) {
 T Atype_new_string_array(void) {
     T p;
 
-    Mem_NEW(p);
+    Mem_NEW_IN(p, MEM_ARENA_GLOBAL);
     p->kind = ATYPE_STRING_ARRAY;
     return p;
 }
@@ -43,7 +43,7 @@ T Atype_new_string_array(void) {
 T Atype_new_class(Id_t id) {
     T p;
 
-    Mem_NEW(p);
+    Mem_NEW_IN(p, MEM_ARENA_GLOBAL);
 
     p->kind = ATYPE_CLASS;
     p->u.id = id;
@@ -53,7 +53,7 @@ T Atype_new_class(Id_t id) {
 T Atype_new_class_array(Id_t id) {
     T p;
 
-    Mem_NEW(p);
+    Mem_NEW_IN(p, MEM_ARENA_GLOBAL);
 
     p->kind = ATYPE_CLASS_ARRAY;
     p->u.id = id;
@@ -63,7 +63,7 @@ T Atype_new_class_array(Id_t id) {
 T Atype_new_fun(List_t from, T to) {
     T p;
 
-    Mem_NEW(p);
+    Mem_NEW_IN(p, MEM_ARENA_GLOBAL);
 
     p->kind = ATYPE_FUN;
     p->u.fun.from = from;
@@ -1,6 +1,7 @@
 #ifndef ATYPE_H
 #define ATYPE_H
 
+#include "../lib/list.h"
 #include "../lib/string.h"
 #include "id.h"
 
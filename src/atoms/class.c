@@ -8,7 +8,7 @@
 T Class_new(Id_t name, List_t decs) {
     T p;
 
-    Mem_NEW(p);
+    Mem_NEW_IN(p, MEM_ARENA_GLOBAL);
     p->name = name;
     p->decs = decs;
     return p;
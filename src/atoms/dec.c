@@ -7,7 +7,7 @@
 T Dec_new(Atype_t ty, Id_t id) {
     T p;
 
-    Mem_NEW(p);
+    Mem_NEW_IN(p, MEM_ARENA_GLOBAL);
     p->ty = ty;
     p->id = id;
     return p;
@@ -2,23 +2,32 @@
 #include "../lib/hash.h"
 #include "../lib/int.h"
 #include "../lib/mem.h"
-#include "../lib/property-list.h"
-#include "../lib/random.h"
+#include "../lib/thread.h"
 #include <assert.h>
+#include <pthread.h>
+#include <stdatomic.h>
 
 #define T Id_t
 
 /* table: String_t -> Id_t
  */
 static Hash_t table = 0;
+static pthread_mutex_t tableLock = PTHREAD_MUTEX_INITIALIZER;
 
-static int counter = 0;
+static atomic_long counter = 0;
+// the next index
+static atomic_long numIds = 0;
+
+static Thread_local T scope = 0;
 
 struct T {
     String_t name;
     String_t newName;
     long hashCode;
-    Plist_t plist;
+    long index;
+    // fresh ids and labels made in the scope of this one
+    long numFresh;
+    long numLabels;
 };
 
 
@@ -30,34 +39,80 @@ static T Id_create(String_t s) {
     x->name = s;
     x->newName = 0;
     x->hashCode = String_hashCode(s);
-    x->plist = Plist_new();
+    x->index = atomic_fetch_add(&numIds, 1);
+    x->numFresh = 0;
+    x->numLabels = 0;
     return x;
 }
 
+// Ids, their names, and the table interning them are
+// shared by every IR, so all of them live in the global
+// arena.
 T Id_bogus(void) {
-    return Id_create("<bogus>");
+    T x;
+    Mem_Arena_t old = Mem_Arena_enter(MEM_ARENA_GLOBAL);
+
+    x = Id_create("<bogus>");
+    Mem_Arena_enter(old);
+    return x;
 }
 
 T Id_fromString(String_t s) {
     T x;
+    Mem_Arena_t old;
 
     assert(s);
+    old = Mem_Arena_enter(MEM_ARENA_GLOBAL);
+    pthread_mutex_lock(&tableLock);
     x = Hash_lookupOrInsert(table, s, (tyKV) Id_create);
+    pthread_mutex_unlock(&tableLock);
+    Mem_Arena_enter(old);
     return x;
 }
 
 T Id_newNoName(void) {
     T x;
+    Mem_Arena_t old = Mem_Arena_enter(MEM_ARENA_GLOBAL);
+
     Mem_NEW(x);
     x->name = 0;
-    x->newName = String_concat("x_",
-                               Int_toString(counter++),
-                               0);
-    x->hashCode = Random_nextInt();
-    x->plist = Plist_new();
+    if (scope)
+        x->newName = String_concat("x_",
+                                   Int_toString(scope->index),
+                                   "_",
+                                   Int_toString(scope->numFresh++),
+                                   0);
+    else
+        x->newName = String_concat("x_",
+                                   Int_toString(atomic_fetch_add(&counter, 1)),
+                                   0);
+    x->hashCode = String_hashCode(x->newName);
+    // the indexes of ids made on different threads
+    // interleave, but within one scope they still follow
+    // the order the ids are made in.
+    x->index = atomic_fetch_add(&numIds, 1);
+    x->numFresh = 0;
+    x->numLabels = 0;
+    Mem_Arena_enter(old);
     return x;
 }
 
+T Id_enterScope(T s) {
+    T old = scope;
+
+    scope = s;
+    return old;
+}
+
+T Id_scope(void) {
+    return scope;
+}
+
+long Id_countLabel(T x) {
+    assert(x);
+    return x->numLabels++;
+}
+
 long Id_hashCode(T x) {
     assert(x);
     return x->hashCode;
@@ -65,15 +120,18 @@ long Id_hashCode(T x) {
 
 String_t Id_toString(T x) {
     assert(x);
-    assert(((x->name == 0) && (x->newName == 0)));
+    assert(x->name || x->newName);
     return (x->name) ? (x->name) : (x->newName);
 }
 
 void Id_init(void) {
+    Mem_Arena_t old = Mem_Arena_enter(MEM_ARENA_GLOBAL);
+
     table = Hash_new((tyHashCode) String_hashCode, (Poly_tyEquals) String_equals
                      // should never call this function.
                      ,
                      0);
+    Mem_Arena_enter(old);
 }
 
 long Id_equals(T x, T y) {
@@ -82,14 +140,19 @@ long Id_equals(T x, T y) {
     return x == y;
 }
 
-Plist_t Id_plist(T x) {
+int Id_isFresh(T x) {
+    assert(x);
+    return !x->name;
+}
+
+long Id_index(T x) {
     assert(x);
-    return x->plist;
+    return x->index;
 }
 
 void Id_print(T x) {
     assert(x);
-    assert((x->name == 0) && (x->newName == 0));
+    assert(x->name || x->newName);
     printf("%s", (x->name) ? (x->name) : (x->newName));
 }
 
@@ -1,7 +1,6 @@
 #ifndef ID_H
 #define ID_H
 
-#include "../lib/property-list.h"
 #include "../lib/string.h"
 
 #define T Id_t
@@ -15,9 +14,27 @@ long Id_hashCode(T x);
 void Id_init(void);
 String_t Id_toString(T x);
 long Id_equals(T, T);
-Plist_t Id_plist(T);
+// whether "x" is made by "Id_newNoName"
+int Id_isFresh(T x);
+// every id gets a sequential index, from 0
+long Id_index(T);
 void Id_print(T);
 
+// Fresh ids are named after a global counter, so their
+// names depend on the order they are made in, and that
+// order is not fixed when functions are compiled on many
+// threads. A pass working on a function hence makes the
+// function's name the scope of this thread: fresh ids are
+// then named after the scope, and counted per scope.
+// Return the old scope; 0 is the global one.
+T Id_enterScope(T scope);
+// the scope of this thread, or 0
+T Id_scope(void);
+// labels made in a scope are counted per scope too (see
+// "Label_new"); return the count of scope "x" before this
+// label.
+long Id_countLabel(T x);
+
 #undef T
 
 #endif
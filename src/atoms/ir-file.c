@@ -0,0 +1,494 @@
+#include "ir-file.h"
+#include "../lib/error.h"
+#include "../lib/hash.h"
+#include "../lib/mem.h"
+#include "../lib/property.h"
+#include <assert.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define I IrFile_In_t
+#define O IrFile_Out_t
+
+#define MAGIC "DRAGONIR"
+#define MAGIC_SIZE 8
+
+///////////////////////////////////////////////////////
+// a growable byte buffer
+typedef struct {
+    char *bytes;
+    long size;
+    long capacity;
+} Buffer_t;
+
+static void Buffer_init(Buffer_t *b) {
+    b->bytes = 0;
+    b->size = 0;
+    b->capacity = 0;
+}
+
+static void Buffer_put(Buffer_t *b, const char *s, long n) {
+    if (b->size + n > b->capacity) {
+        char *old = b->bytes;
+        long capacity = (b->capacity) ? (2 * b->capacity) : 4096;
+
+        while (capacity < b->size + n)
+            capacity *= 2;
+        Mem_NEW_SIZE(b->bytes, capacity);
+        if (old)
+            memcpy(b->bytes, old, (size_t) b->size);
+        b->capacity = capacity;
+    }
+    memcpy(b->bytes + b->size, s, (size_t) n);
+    b->size += n;
+}
+
+static void Buffer_putNat(Buffer_t *b, unsigned long n) {
+    char c;
+
+    while (n >= 0x80) {
+        c = (char) ((n & 0x7f) | 0x80);
+        Buffer_put(b, &c, 1);
+        n >>= 7;
+    }
+    c = (char) n;
+    Buffer_put(b, &c, 1);
+}
+
+///////////////////////////////////////////////////////
+// writer
+struct O {
+    // the program
+    Buffer_t body;
+
+    // String_t -> index + 1
+    Hash_t strings;
+    // List<String_t>, in the order of indexes
+    List_t stringList;
+    long numStrings;
+
+    // Id_t -> index + 1
+    Property_t ids;
+    List_t idList;
+    long numIds;
+
+    // Label_t -> index + 1
+    Property_t labels;
+    long numLabels;
+};
+
+static long labelIndex(Label_t l) {
+    return Label_index(l);
+}
+
+O IrFile_Out_new(void) {
+    O out;
+
+    Mem_NEW(out);
+    Buffer_init(&out->body);
+    out->strings = Hash_new((tyHashCode) String_hashCode,
+                            (Poly_tyEquals) String_equals,
+                            0);
+    out->stringList = List_new();
+    out->numStrings = 0;
+    out->ids = Property_new((Poly_tyIndex) Id_index);
+    out->idList = List_new();
+    out->numIds = 0;
+    out->labels = Property_new((Poly_tyIndex) labelIndex);
+    out->numLabels = 0;
+    return out;
+}
+
+void IrFile_putNat(O out, unsigned long n) {
+    Buffer_putNat(&out->body, n);
+}
+
+void IrFile_putInt(O out, long n) {
+    // zig-zag: small negative numbers stay short
+    IrFile_putNat(out, ((unsigned long) n << 1) ^ (unsigned long) (n >> 63));
+}
+
+static long stringIndex(O out, String_t s) {
+    long i = (long) Hash_lookup(out->strings, s);
+
+    if (!i) {
+        i = ++out->numStrings;
+        Hash_insert(out->strings, s, (Poly_t) i);
+        List_insertLast(out->stringList, s);
+    }
+    return i;
+}
+
+void IrFile_putString(O out, String_t s) {
+    assert(s);
+    IrFile_putNat(out, (unsigned long) stringIndex(out, s));
+}
+
+void IrFile_putId(O out, Id_t x) {
+    long i;
+
+    if (!x) {
+        IrFile_putNat(out, 0);
+        return;
+    }
+    i = (long) Property_get(out->ids, x);
+    if (!i) {
+        i = ++out->numIds;
+        Property_set(out->ids, x, (Poly_t) i);
+        List_insertLast(out->idList, x);
+        // the id table refers to the string table
+        if (!Id_isFresh(x))
+            stringIndex(out, Id_toString(x));
+    }
+    IrFile_putNat(out, (unsigned long) i);
+}
+
+void IrFile_putLabel(O out, Label_t l) {
+    long i;
+
+    if (!l) {
+        IrFile_putNat(out, 0);
+        return;
+    }
+    i = (long) Property_get(out->labels, l);
+    if (!i) {
+        i = ++out->numLabels;
+        Property_set(out->labels, l, (Poly_t) i);
+    }
+    IrFile_putNat(out, (unsigned long) i);
+}
+
+void IrFile_putAtype(O out, Atype_t ty) {
+    if (!ty) {
+        IrFile_putNat(out, 0);
+        return;
+    }
+    IrFile_putNat(out, ty->kind + 1);
+    switch (ty->kind) {
+        case ATYPE_INT:
+        case ATYPE_STRING:
+        case ATYPE_INT_ARRAY:
+        case ATYPE_STRING_ARRAY:
+            return;
+        case ATYPE_CLASS:
+        case ATYPE_CLASS_ARRAY:
+            IrFile_putId(out, ty->u.id);
+            return;
+        case ATYPE_FUN:
+            IrFile_putList(out, ty->u.fun.from, (void (*)(O, Poly_t)) IrFile_putAtype);
+            IrFile_putAtype(out, ty->u.fun.to);
+            return;
+        default:
+            Error_impossible();
+    }
+}
+
+void IrFile_putDec(O out, Dec_t dec) {
+    IrFile_putAtype(out, dec->ty);
+    IrFile_putId(out, dec->id);
+}
+
+void IrFile_putClass(O out, Class_t c) {
+    IrFile_putId(out, c->name);
+    IrFile_putList(out, c->decs, (void (*)(O, Poly_t)) IrFile_putDec);
+}
+
+void IrFile_putList(O out, List_t l, void (*f)(O, Poly_t)) {
+    List_t p;
+
+    IrFile_putNat(out, (unsigned long) List_size(l));
+    p = List_getFirst(l);
+    while (p) {
+        f(out, p->data);
+        p = p->next;
+    }
+}
+
+void IrFile_putLongs(O out, List_t l) {
+    List_t p;
+
+    IrFile_putNat(out, (unsigned long) List_size(l));
+    p = List_getFirst(l);
+    while (p) {
+        IrFile_putInt(out, (long) p->data);
+        p = p->next;
+    }
+}
+
+void IrFile_save(O out, String_t fname, long stage) {
+    Buffer_t head;
+    List_t p;
+    FILE *file;
+    int ok;
+
+    Buffer_init(&head);
+    Buffer_put(&head, MAGIC, MAGIC_SIZE);
+    Buffer_putNat(&head, IR_FILE_VERSION);
+    Buffer_putNat(&head, (unsigned long) stage);
+
+    Buffer_putNat(&head, (unsigned long) out->numStrings);
+    p = List_getFirst(out->stringList);
+    while (p) {
+        String_t s = p->data;
+        long n = (long) strlen(s);
+
+        Buffer_putNat(&head, (unsigned long) n);
+        Buffer_put(&head, s, n);
+        p = p->next;
+    }
+
+    Buffer_putNat(&head, (unsigned long) out->numIds);
+    p = List_getFirst(out->idList);
+    while (p) {
+        Id_t x = p->data;
+
+        Buffer_putNat(&head, Id_isFresh(x) ? 0 : (unsigned long) Hash_lookup(out->strings, Id_toString(x)));
+        p = p->next;
+    }
+
+    Buffer_putNat(&head, (unsigned long) out->numLabels);
+
+    file = fopen(fname, "wb");
+    if (!file)
+        Error_error2("fail to open file:", fname);
+    ok = fwrite(head.bytes, 1, (size_t) head.size, file) == (size_t) head.size;
+    if (out->body.size)
+        ok = ok && fwrite(out->body.bytes, 1, (size_t) out->body.size, file) == (size_t) out->body.size;
+    if (fclose(file) || !ok)
+        Error_error2("fail to write file:", fname);
+}
+
+///////////////////////////////////////////////////////
+// reader
+struct I {
+    String_t fname;
+    void *map;
+    size_t length;
+    const unsigned char *p;
+    const unsigned char *end;
+
+    long stage;
+    String_t *strings;
+    long numStrings;
+    Id_t *ids;
+    long numIds;
+    Label_t *labels;
+    long numLabels;
+};
+
+static void corrupt(I in) {
+    Error_error2("invalid IR file:", in->fname);
+}
+
+static int getByte(I in) {
+    if (in->p >= in->end)
+        corrupt(in);
+    return *in->p++;
+}
+
+unsigned long IrFile_getNat(I in) {
+    unsigned long n = 0;
+    int shift = 0, c;
+
+    do {
+        if (shift > 63)
+            corrupt(in);
+        c = getByte(in);
+        n |= (unsigned long) (c & 0x7f) << shift;
+        shift += 7;
+    } while (c & 0x80);
+    return n;
+}
+
+long IrFile_getInt(I in) {
+    unsigned long n = IrFile_getNat(in);
+
+    return (long) (n >> 1) ^ -(long) (n & 1);
+}
+
+// an index into a table of size "n", with 0 for none
+static long getIndex(I in, long n) {
+    unsigned long i = IrFile_getNat(in);
+
+    if (i > (unsigned long) n)
+        corrupt(in);
+    return (long) i;
+}
+
+I IrFile_open(String_t fname) {
+    I in;
+    struct stat st;
+    int fd;
+
+    Mem_NEW(in);
+    in->fname = fname;
+    fd = open(fname, O_RDONLY);
+    if (fd < 0)
+        Error_error2("can not open file:", fname);
+    if (fstat(fd, &st) || st.st_size < MAGIC_SIZE) {
+        close(fd);
+        corrupt(in);
+    }
+    in->length = (size_t) st.st_size;
+    in->map = mmap(0, in->length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (in->map == MAP_FAILED)
+        Error_error2("can not map file:", fname);
+    in->p = in->map;
+    in->end = in->p + in->length;
+
+    if (memcmp(in->p, MAGIC, MAGIC_SIZE))
+        corrupt(in);
+    in->p += MAGIC_SIZE;
+    if (IrFile_getNat(in) != IR_FILE_VERSION)
+        Error_error2("IR file of another version:", fname);
+    in->stage = (long) IrFile_getNat(in);
+
+    // names of ids are kept by the id table, which lives
+    // in the global arena
+    in->numStrings = (long) IrFile_getNat(in);
+    if (in->numStrings > (long) in->length)
+        corrupt(in);
+    Mem_NEW_SIZE(in->strings, in->numStrings + 1);
+    for (long i = 1; i <= in->numStrings; i++) {
+        unsigned long n = IrFile_getNat(in);
+        String_t s;
+
+        if (n > (unsigned long) (in->end - in->p))
+            corrupt(in);
+        s = Mem_allocIn(MEM_ARENA_GLOBAL, (long) n + 1);
+        memcpy(s, in->p, n);
+        s[n] = '\0';
+        in->p += n;
+        in->strings[i] = s;
+    }
+
+    // as the parser does for a source file
+    Id_init();
+    in->numIds = (long) IrFile_getNat(in);
+    if (in->numIds > (long) in->length)
+        corrupt(in);
+    Mem_NEW_SIZE(in->ids, in->numIds + 1);
+    for (long i = 1; i <= in->numIds; i++) {
+        long s = getIndex(in, in->numStrings);
+
+        in->ids[i] = (s) ? Id_fromString(in->strings[s]) : Id_newNoName();
+    }
+
+    // labels carry no names
+    in->numLabels = (long) IrFile_getNat(in);
+    if (in->numLabels > (long) in->length)
+        corrupt(in);
+    Mem_NEW_SIZE(in->labels, in->numLabels + 1);
+    for (long i = 1; i <= in->numLabels; i++)
+        in->labels[i] = Label_new();
+    return in;
+}
+
+long IrFile_stage(I in) {
+    return in->stage;
+}
+
+String_t IrFile_getString(I in) {
+    long i = getIndex(in, in->numStrings);
+
+    if (!i)
+        corrupt(in);
+    return in->strings[i];
+}
+
+Id_t IrFile_getId(I in) {
+    long i = getIndex(in, in->numIds);
+
+    return (i) ? in->ids[i] : 0;
+}
+
+Label_t IrFile_getLabel(I in) {
+    long i = getIndex(in, in->numLabels);
+
+    return (i) ? in->labels[i] : 0;
+}
+
+Atype_t IrFile_getAtype(I in) {
+    unsigned long kind = IrFile_getNat(in);
+
+    if (!kind)
+        return 0;
+    switch (kind - 1) {
+        case ATYPE_INT:
+            return Atype_new_int();
+        case ATYPE_STRING:
+            return Atype_new_string("");
+        case ATYPE_INT_ARRAY:
+            return Atype_new_int_array();
+        case ATYPE_STRING_ARRAY:
+            return Atype_new_string_array();
+        case ATYPE_CLASS:
+            return Atype_new_class(IrFile_getId(in));
+        case ATYPE_CLASS_ARRAY:
+            return Atype_new_class_array(IrFile_getId(in));
+        case ATYPE_FUN: {
+            List_t from = IrFile_getList(in, (Poly_t(*)(I)) IrFile_getAtype);
+
+            return Atype_new_fun(from, IrFile_getAtype(in));
+        }
+        default:
+            corrupt(in);
+    }
+    return 0;
+}
+
+Dec_t IrFile_getDec(I in) {
+    Atype_t ty = IrFile_getAtype(in);
+
+    return Dec_new(ty, IrFile_getId(in));
+}
+
+// Classes live in the global arena, as they outlive the IR
+// that names them (e.g., the SSA arena is released before
+// the layouts are made), so their fields must, too.
+Class_t IrFile_getClass(I in) {
+    Id_t name = IrFile_getId(in);
+    Mem_Arena_t old = Mem_Arena_enter(MEM_ARENA_GLOBAL);
+    List_t decs = IrFile_getList(in, (Poly_t(*)(I)) IrFile_getDec);
+
+    Mem_Arena_enter(old);
+    return Class_new(name, decs);
+}
+
+List_t IrFile_getList(I in, Poly_t (*f)(I)) {
+    List_t l = List_new();
+    unsigned long n = IrFile_getNat(in);
+
+    // every element takes a byte at least
+    if (n > (unsigned long) (in->end - in->p))
+        corrupt(in);
+    for (unsigned long i = 0; i < n; i++)
+        List_insertLast(l, f(in));
+    return l;
+}
+
+List_t IrFile_getLongs(I in) {
+    List_t l = List_new();
+    unsigned long n = IrFile_getNat(in);
+
+    if (n > (unsigned long) (in->end - in->p))
+        corrupt(in);
+    for (unsigned long i = 0; i < n; i++)
+        List_insertLast(l, (Poly_t) IrFile_getInt(in));
+    return l;
+}
+
+void IrFile_close(I in) {
+    if (in->p != in->end)
+        corrupt(in);
+    munmap(in->map, in->length);
+    in->map = 0;
+}
+
+#undef I
+#undef O
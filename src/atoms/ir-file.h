@@ -0,0 +1,85 @@
+#ifndef IR_FILE_H
+#define IR_FILE_H
+
+#include "../lib/list.h"
+#include "../lib/poly.h"
+#include "../lib/string.h"
+#include "atype.h"
+#include "class.h"
+#include "dec.h"
+#include "id.h"
+#include "label.h"
+
+// The binary encoding of an IR program, shared by the SSA
+// and the machine IR. A file is laid out as:
+//   "DRAGONIR", the format version, the stage
+//   the string table
+//   the id table
+//   the number of labels
+//   the program
+// Numbers are varints (LEB128), zig-zagged when signed.
+// Strings, ids and labels in the program are indexes into
+// the tables (plus 1, with 0 for none), so each of them
+// is written once. A fresh id is written without its name,
+// and is read back as another fresh id.
+//
+// An IR module writes its program by the "put" functions
+// below, and reads it back by the "get" ones, in the same
+// order.
+
+#define I IrFile_In_t
+#define O IrFile_Out_t
+
+typedef struct I *I;
+typedef struct O *O;
+
+// bump this on any change to the encoding
+#define IR_FILE_VERSION 1
+
+// where the program in a file is taken from: the input
+// to "Ssa_main", or to "Machine_main"
+enum {
+    IR_FILE_SSA = 1,
+    IR_FILE_MACHINE
+};
+
+///////////////////////////////////////////////////////
+// writer
+O IrFile_Out_new(void);
+void IrFile_putNat(O, unsigned long n);
+void IrFile_putInt(O, long n);
+void IrFile_putString(O, String_t s);
+// "x" may be 0
+void IrFile_putId(O, Id_t x);
+// "l" may be 0
+void IrFile_putLabel(O, Label_t l);
+void IrFile_putAtype(O, Atype_t ty);
+void IrFile_putDec(O, Dec_t dec);
+void IrFile_putClass(O, Class_t c);
+// the length, then "f" on each element
+void IrFile_putList(O, List_t l, void (*f)(O, Poly_t));
+// a list of "long"s
+void IrFile_putLongs(O, List_t l);
+void IrFile_save(O, String_t fname, long stage);
+
+///////////////////////////////////////////////////////
+// reader
+// map the file in, and read its tables
+I IrFile_open(String_t fname);
+long IrFile_stage(I);
+unsigned long IrFile_getNat(I);
+long IrFile_getInt(I);
+String_t IrFile_getString(I);
+Id_t IrFile_getId(I);
+Label_t IrFile_getLabel(I);
+Atype_t IrFile_getAtype(I);
+Dec_t IrFile_getDec(I);
+Class_t IrFile_getClass(I);
+List_t IrFile_getList(I, Poly_t (*f)(I));
+List_t IrFile_getLongs(I);
+void IrFile_close(I);
+
+#undef I
+#undef O
+
+#endif
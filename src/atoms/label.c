@@ -1,26 +1,48 @@
 #include "label.h"
+#include "id.h"
 #include "../lib/int.h"
 #include "../lib/mem.h"
-#include "../lib/random.h"
 #include <assert.h>
+#include <stdatomic.h>
 
 #define T Label_t
 
-static int counter = 0;
+// labels may be made on many threads
+static atomic_int counter = 0;
 
 struct T {
     int count;
     int hashCode;
-    Plist_t plist;
+    // made on the first "Label_toString", as most labels
+    // are never printed
+    _Atomic(String_t) name;
 };
 
+// labels are shared by all IRs after HIL, so they live
+// in the global arena.
 T Label_new(void) {
     T x;
+    Id_t scope = Id_scope();
+    Mem_Arena_t old = Mem_Arena_enter(MEM_ARENA_GLOBAL);
 
     Mem_NEW(x);
-    x->count = counter++;
-    x->hashCode = Random_nextInt();
-    x->plist = Plist_new();
+    x->count = atomic_fetch_add(&counter, 1);
+    // hash tables scramble their hash codes, so the
+    // sequential count does well.
+    x->hashCode = x->count;
+    atomic_init(&x->name, 0);
+    // the count depends on the scheduling when functions
+    // are compiled on many threads, so a label made in the
+    // scope of a function is named after it instead, as a
+    // fresh id is (see "Id_enterScope").
+    if (scope)
+        atomic_store(&x->name,
+                     String_concat("L_",
+                                   Int_toString(Id_index(scope)),
+                                   "_",
+                                   Int_toString(Id_countLabel(scope)),
+                                   0));
+    Mem_Arena_enter(old);
     return x;
 }
 
@@ -29,9 +51,23 @@ int Label_hashCode(T x) {
     return x->hashCode;
 }
 
+// The code generators print every label at least twice,
+// so the name is made once. Two threads printing a new
+// label at once both make it, and one of them is kept.
 String_t Label_toString(T x) {
+    String_t name, none = 0;
+    Mem_Arena_t old;
+
     assert(x);
-    return String_concat("L_", Int_toString(x->count), 0);
+    name = atomic_load(&x->name);
+    if (name)
+        return name;
+    old = Mem_Arena_enter(MEM_ARENA_GLOBAL);
+    name = String_concat("L_", Int_toString(x->count), 0);
+    Mem_Arena_enter(old);
+    if (!atomic_compare_exchange_strong(&x->name, &none, name))
+        name = none;
+    return name;
 }
 
 int Label_equals(T x, T y) {
@@ -40,14 +76,15 @@ int Label_equals(T x, T y) {
     return x == y;
 }
 
-Plist_t Label_plist(T x) {
+// "count" is sequential already
+long Label_index(T x) {
     assert(x);
-    return x->plist;
+    return x->count;
 }
 
 void Label_print(T x) {
     assert(x);
-    printf("%s_%d", "L", x->count);
+    printf("%s", Label_toString(x));
 }
 
 #undef T
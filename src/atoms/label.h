@@ -1,7 +1,6 @@
 #ifndef LABEL_H
 #define LABEL_H
 
-#include "../lib/property-list.h"
 #include "../lib/string.h"
 
 #define T Label_t
@@ -12,7 +11,8 @@ T Label_new(void);
 int Label_hashCode(T x);
 String_t Label_toString(T x);
 int Label_equals(T, T);
-Plist_t Label_plist(T);
+// every label gets a sequential index, from 0
+long Label_index(T);
 void Label_print(T);
 
 #undef T
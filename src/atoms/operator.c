@@ -57,6 +57,20 @@ Operator_t Operator_fromString(String_t op) {
         return OP_MODUS;
     if (strcmp(op, "&&") == 0)
         return OP_AND;
+    if (strcmp(op, "||") == 0)
+        return OP_OR;
+    if (strcmp(op, "==") == 0)
+        return OP_EQ;
+    if (strcmp(op, "!=") == 0)
+        return OP_NE;
+    if (strcmp(op, "<") == 0)
+        return OP_LT;
+    if (strcmp(op, "<=") == 0)
+        return OP_LE;
+    if (strcmp(op, ">") == 0)
+        return OP_GT;
+    if (strcmp(op, ">=") == 0)
+        return OP_GE;
     Error_impossible();
     return 0;
 }
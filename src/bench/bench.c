@@ -0,0 +1,268 @@
+#include "gen.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// dragon-bench [options] [generator options]
+// compiles generated programs of growing sizes with
+// "dragon -profile", and fits the time and the allocation
+// of each pass against the size of the program. A pass
+// growing faster than size^threshold is flagged, and the
+// exit code is 1 if any is. The programs are compiled by
+// the x86 back end, as the C one takes no objects yet; a
+// "-codegen" in "-flags" overrides it.
+//
+// Like dragon itself, this must run where the runtime is
+// found at "../src/runtime" (e.g., in "regression/"). The
+// files of each run are written to, and removed from, the
+// current directory.
+
+#define MAX_STEPS 16
+#define MAX_PASSES 64
+#define NAME_SIZE 64
+
+#define PROG "bench-prog.c"
+#define TRACE "bench-prog.json"
+#define OUT "bench-prog.out"
+
+static const char *dragon = "dragon";
+static const char *sweep = "all";
+static long steps = 4;
+static double threshold = 1.4;
+// in ms, and in bytes
+static double timeFloor = 5;
+static double allocFloor = 1 << 20;
+static const char *csv = 0;
+static const char *flags = "";
+
+// the measurements of the current sweep
+static long numPasses = 0;
+static char names[MAX_PASSES][NAME_SIZE];
+// the time in ms, and the bytes allocated
+static double times[MAX_STEPS][MAX_PASSES];
+static double allocs[MAX_STEPS][MAX_PASSES];
+static long maxRss[MAX_STEPS];
+static long values[MAX_STEPS];
+static long sizes[MAX_STEPS];
+
+static void usage(void) {
+    fprintf(stderr,
+            "Usage: dragon-bench [options] [generator options]\n"
+            "  -dragon <file>    the compiler (default \"dragon\")\n"
+            "  -sweep <dim>      the dimension to sweep, or \"all\" (default)\n"
+            "  -steps <n>        sizes per sweep, doubling (default 4)\n"
+            "  -threshold <x>    flag a pass growing faster than size^x (default 1.4)\n"
+            "  -floor <ms>       ignore the time of passes faster than this (default 5)\n"
+            "  -csv <file>       append all the measurements to file\n"
+            "  -flags <flags>    more flags for dragon\n"
+            "generator options (the sizes to start from):\n");
+    Gen_usage(stderr);
+    exit(1);
+}
+
+static long passIndex(const char *name) {
+    for (long i = 0; i < numPasses; i++)
+        if (strcmp(names[i], name) == 0)
+            return i;
+    if (numPasses == MAX_PASSES) {
+        fprintf(stderr, "too many passes\n");
+        exit(1);
+    }
+    snprintf(names[numPasses], NAME_SIZE, "%s", name);
+    return numPasses++;
+}
+
+static double field(const char *line, const char *key) {
+    const char *p = strstr(line, key);
+
+    return (p) ? strtod(p + strlen(key), 0) : 0;
+}
+
+// a pass run several times (e.g., by "-j") counts once,
+// with its times summed
+static void readTrace(long step) {
+    char line[1024], name[NAME_SIZE];
+    FILE *file = fopen(TRACE, "r");
+
+    if (!file) {
+        fprintf(stderr, "no profile in: %s\n", TRACE);
+        exit(1);
+    }
+    maxRss[step] = 0;
+    while (fgets(line, sizeof(line), file)) {
+        long i;
+        double rss;
+
+        if (sscanf(line, "{\"name\": \"%63[^\"]\"", name) != 1)
+            continue;
+        i = passIndex(name);
+        times[step][i] += field(line, "\"dur\": ") / 1e3;
+        allocs[step][i] += field(line, "\"alloc\": ");
+        rss = field(line, "\"maxRss\": ") / 1024;
+        if (rss > (double) maxRss[step])
+            maxRss[step] = (long) rss;
+    }
+    fclose(file);
+}
+
+static void run(Gen_t *g, long step) {
+    char cmd[4096];
+    FILE *file;
+
+    file = fopen(PROG, "w");
+    if (!file) {
+        fprintf(stderr, "fail to open file: %s\n", PROG);
+        exit(1);
+    }
+    Gen_program(file, g);
+    sizes[step] = ftell(file);
+    fclose(file);
+
+    snprintf(cmd, sizeof(cmd), "%s -codegen x86 %s -profile %s -o %s %s > /dev/null 2>&1",
+             dragon, flags, TRACE, OUT, PROG);
+    if (system(cmd) != 0) {
+        fprintf(stderr, "fail to compile: %s\n"
+                        "(kept for inspection)\n",
+                cmd);
+        exit(1);
+    }
+    for (long i = 0; i < MAX_PASSES; i++)
+        times[step][i] = allocs[step][i] = 0;
+    readTrace(step);
+    remove(PROG);
+    remove(TRACE);
+    remove(OUT);
+}
+
+// the least-squares slope of log(y) against log(size),
+// over the steps where y is not 0
+static double exponent(double y[MAX_STEPS][MAX_PASSES], long pass) {
+    double sx = 0, sy = 0, sxx = 0, sxy = 0, n = 0, d;
+
+    for (long i = 0; i < steps; i++) {
+        double x;
+
+        if (y[i][pass] <= 0)
+            continue;
+        x = log((double) sizes[i]);
+        sx += x;
+        sy += log(y[i][pass]);
+        sxx += x * x;
+        sxy += x * log(y[i][pass]);
+        n += 1;
+    }
+    d = n * sxx - sx * sx;
+    return (n < 2 || d <= 0) ? 0 : (n * sxy - sx * sy) / d;
+}
+
+static void saveCsv(const char *dim) {
+    FILE *file = fopen(csv, "a");
+
+    if (!file) {
+        fprintf(stderr, "fail to open file: %s\n", csv);
+        exit(1);
+    }
+    if (ftell(file) == 0)
+        fprintf(file, "dim,value,bytes,maxRss(K),pass,time(ms),alloc\n");
+    for (long i = 0; i < steps; i++)
+        for (long p = 0; p < numPasses; p++)
+            fprintf(file, "%s,%ld,%ld,%ld,%s,%.3f,%.0f\n",
+                    dim, values[i], sizes[i], maxRss[i], names[p], times[i][p], allocs[i][p]);
+    fclose(file);
+}
+
+// returns the number of passes flagged
+static long report(const char *dim) {
+    long flagged = 0, last = steps - 1;
+
+    printf("sweep -%s:", dim);
+    for (long i = 0; i < steps; i++)
+        printf(" %ld", values[i]);
+    printf("\n  %-26s", "source (KB)");
+    for (long i = 0; i < steps; i++)
+        printf(" %9.1f", (double) sizes[i] / 1024);
+    printf("\n  %-26s", "maxRss (KB)");
+    for (long i = 0; i < steps; i++)
+        printf(" %9ld", maxRss[i]);
+    printf("\n  %-26s", "pass: time (ms)");
+    for (long i = 0; i < steps; i++)
+        printf(" %9s", "");
+    printf(" %6s %6s\n", "time^", "alloc^");
+
+    for (long p = 0; p < numPasses; p++) {
+        double t = exponent(times, p), a = exponent(allocs, p);
+        int bad = (times[last][p] >= timeFloor && t > threshold) || (allocs[last][p] >= allocFloor && a > threshold);
+
+        printf("  %-26s", names[p]);
+        for (long i = 0; i < steps; i++)
+            printf(" %9.2f", times[i][p]);
+        printf(" %6.2f %6.2f%s\n", t, a, (bad) ? "  <- super-linear" : "");
+        flagged += bad;
+    }
+    printf("\n");
+    return flagged;
+}
+
+static long sweepDim(Gen_t *base, const char *dim) {
+    long start = *Gen_dim(base, dim);
+
+    if (start < 1)
+        start = 1;
+    numPasses = 0;
+    for (long i = 0; i < steps; i++) {
+        Gen_t g = *base;
+
+        values[i] = start << i;
+        *Gen_dim(&g, dim) = values[i];
+        fprintf(stderr, "dragon-bench: -%s %ld\n", dim, values[i]);
+        run(&g, i);
+    }
+    if (csv)
+        saveCsv(dim);
+    return report(dim);
+}
+
+int main(int argc, char **argv) {
+    Gen_t base;
+    long flagged = 0;
+
+    Gen_init(&base);
+    for (int i = 1; i < argc; i += 2) {
+        const char *arg = argv[i], *value = argv[i + 1];
+
+        if (Gen_option(&base, arg, value))
+            continue;
+        if (!value)
+            usage();
+        if (strcmp(arg, "-dragon") == 0)
+            dragon = value;
+        else if (strcmp(arg, "-sweep") == 0)
+            sweep = value;
+        else if (strcmp(arg, "-steps") == 0)
+            steps = atol(value);
+        else if (strcmp(arg, "-threshold") == 0)
+            threshold = atof(value);
+        else if (strcmp(arg, "-floor") == 0)
+            timeFloor = atof(value);
+        else if (strcmp(arg, "-csv") == 0)
+            csv = value;
+        else if (strcmp(arg, "-flags") == 0)
+            flags = value;
+        else
+            usage();
+    }
+    if (steps < 2 || steps > MAX_STEPS)
+        usage();
+
+    if (strcmp(sweep, "all") == 0) {
+        for (const char **dim = Gen_dims; *dim; dim++)
+            flagged += sweepDim(&base, *dim);
+    } else if (Gen_dim(&base, sweep)) {
+        flagged += sweepDim(&base, sweep);
+    } else
+        usage();
+    if (flagged)
+        printf("%ld pass(es) scale super-linearly\n", flagged);
+    return flagged != 0;
+}
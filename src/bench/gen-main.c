@@ -0,0 +1,20 @@
+#include "gen.h"
+#include <stdio.h>
+#include <string.h>
+
+// dragon-gen [options]
+// writes a generated dragon program to stdout.
+int main(int argc, char **argv) {
+    Gen_t g;
+
+    Gen_init(&g);
+    for (int i = 1; i < argc; i += 2) {
+        if (strcmp(argv[i], "-help") == 0 || !Gen_option(&g, argv[i], argv[i + 1])) {
+            fprintf(stderr, "Usage: dragon-gen [options]\n");
+            Gen_usage(stderr);
+            return 1;
+        }
+    }
+    Gen_program(stdout, &g);
+    return 0;
+}
@@ -0,0 +1,201 @@
+#include "gen.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define T Gen_t
+
+const char *Gen_dims[] = {"funcs", "blocks", "depth", "locals", "classes", "strings", 0};
+
+void Gen_init(T *g) {
+    g->funcs = 16;
+    g->blocks = 8;
+    g->depth = 2;
+    g->locals = 8;
+    g->classes = 2;
+    g->strings = 4;
+    g->seed = 1;
+}
+
+long *Gen_dim(T *g, const char *dim) {
+    if (strcmp(dim, "funcs") == 0)
+        return &g->funcs;
+    if (strcmp(dim, "blocks") == 0)
+        return &g->blocks;
+    if (strcmp(dim, "depth") == 0)
+        return &g->depth;
+    if (strcmp(dim, "locals") == 0)
+        return &g->locals;
+    if (strcmp(dim, "classes") == 0)
+        return &g->classes;
+    if (strcmp(dim, "strings") == 0)
+        return &g->strings;
+    return 0;
+}
+
+int Gen_option(T *g, const char *option, const char *value) {
+    long *dim;
+    char *end;
+    long n;
+
+    if (option[0] != '-')
+        return 0;
+    if (strcmp(option, "-seed") == 0)
+        dim = 0;
+    else if (!(dim = Gen_dim(g, option + 1)))
+        return 0;
+    if (!value)
+        n = -1;
+    else
+        n = strtol(value, &end, 10);
+    if (n < 0 || *end) {
+        fprintf(stderr, "%s expects a number, but got: %s\n", option, (value) ? value : "nothing");
+        exit(1);
+    }
+    if (dim)
+        *dim = n;
+    else
+        g->seed = (unsigned long) n;
+    return 1;
+}
+
+void Gen_usage(FILE *file) {
+    T g;
+
+    Gen_init(&g);
+    fprintf(file,
+            "  -funcs <n>    functions (default %ld)\n"
+            "  -blocks <n>   statement groups per function (default %ld)\n"
+            "  -depth <n>    nesting depth of a group (default %ld)\n"
+            "  -locals <n>   local variables per function (default %ld)\n"
+            "  -classes <n>  classes (default %ld)\n"
+            "  -strings <n>  string literals per function (default %ld)\n"
+            "  -seed <n>     random seed (default %lu)\n",
+            g.funcs, g.blocks, g.depth, g.locals, g.classes, g.strings, g.seed);
+}
+
+///////////////////////////////////////////////////////
+// the program
+
+// the generator being run, and the function in it
+static T *gen = 0;
+static FILE *out = 0;
+static long fun = 0;
+static long locals = 0;
+// the class of the object "o" of the function, or -1
+static long klass = -1;
+// the next string literal of the function
+static long string = 0;
+
+// a linear congruential generator, so the programs are
+// the same on every platform
+static long pick(long n) {
+    gen->seed = gen->seed * 6364136223846793005UL + 1442695040888963407UL;
+    return (long) ((gen->seed >> 33) % (unsigned long) n);
+}
+
+static void indent(long level) {
+    for (long i = 0; i < level; i++)
+        fprintf(out, "  ");
+}
+
+// the values stay small, so the programs compute the same
+// checksum everywhere
+static void straight(long level) {
+    long v = pick(locals);
+
+    indent(level);
+    fprintf(out, "v%ld = (v%ld + v%ld) %% 1000 + %ld;\n", v, pick(locals), pick(locals), pick(100));
+    indent(level);
+    fprintf(out, "v%ld = v%ld - v%ld;\n", pick(locals), v, pick(locals));
+    if (klass < 0)
+        return;
+    indent(level);
+    switch (pick(3)) {
+    case 0:
+        fprintf(out, "o.x = (o.y + v%ld) %% 1000;\n", pick(locals));
+        break;
+    case 1:
+        fprintf(out, "v%ld = (v%ld + o.x) %% 1000;\n", pick(locals), pick(locals));
+        break;
+    default:
+        fprintf(out, "o = new C%ld(v%ld %% 100, o.x, o);\n", klass, pick(locals));
+        break;
+    }
+}
+
+// the parser takes no relational operators yet, so the
+// conditions test for non-zero
+static void group(long level, long depth) {
+    straight(level);
+    if (depth == 0)
+        return;
+    indent(level);
+    if (depth % 2)
+        fprintf(out, "if (v%ld - v%ld) {\n", pick(locals), pick(locals));
+    else
+        fprintf(out, "for (t%ld = 2; t%ld; t%ld = t%ld - 1) {\n", depth, depth, depth, depth);
+    group(level + 1, depth - 1);
+    indent(level);
+    if (depth % 2) {
+        fprintf(out, "} else {\n");
+        straight(level + 1);
+        indent(level);
+    }
+    fprintf(out, "}\n");
+}
+
+static void printString(void) {
+    fprintf(out, "  prints(\"f%ld: string %ld\\n\");\n", fun, string++);
+}
+
+static void function(void) {
+    fprintf(out, "int f%ld(int a, int b)\n{\n", fun);
+    for (long i = 0; i < locals; i++)
+        fprintf(out, "  int v%ld = %s + %ld;\n", i, (i % 2) ? "b" : "a", i);
+    for (long i = 1; i <= gen->depth; i++)
+        fprintf(out, "  int t%ld;\n", i);
+    klass = (gen->classes > 0) ? fun % gen->classes : -1;
+    if (klass >= 0)
+        fprintf(out, "  C%ld o = new C%ld(a, b, null);\n", klass, klass);
+    fprintf(out, "\n");
+
+    string = 0;
+    for (long i = 0; i < gen->blocks; i++) {
+        if (string < gen->strings)
+            printString();
+        group(1, gen->depth);
+    }
+    while (string < gen->strings)
+        printString();
+    if (fun > 0)
+        fprintf(out, "  v0 = v0 + f%ld(v1 %% 10, v%ld %% 10);\n", fun - 1, locals - 1);
+    if (klass >= 0)
+        fprintf(out, "  return (v0 + v%ld + o.x) %% 1000;\n}\n\n", locals - 1);
+    else
+        fprintf(out, "  return (v0 + v%ld) %% 1000;\n}\n\n", locals - 1);
+}
+
+void Gen_program(FILE *file, T *g) {
+    gen = g;
+    out = file;
+    // "v0" and "v1" are used by every function
+    locals = (g->locals < 2) ? 2 : g->locals;
+
+    fprintf(out, "// Automatically generated by \"dragon-gen");
+    for (const char **dim = Gen_dims; *dim; dim++)
+        fprintf(out, " -%s %ld", *dim, *Gen_dim(g, *dim));
+    fprintf(out, " -seed %lu\". Don't modify.\n\n", g->seed);
+
+    for (long i = 0; i < g->classes; i++)
+        fprintf(out, "class C%ld\n{\n  int x;\n  int y;\n  C%ld next;\n}\n\n", i, i);
+    for (fun = 0; fun < ((g->funcs < 1) ? 1 : g->funcs); fun++)
+        function();
+    fprintf(out,
+            "int dragon()\n{\n"
+            "  printi(f%ld(1, 2));\n"
+            "  prints(\"\\n\");\n"
+            "  return 0;\n}\n",
+            fun - 1);
+}
+
+#undef T
@@ -0,0 +1,48 @@
+#ifndef GEN_H
+#define GEN_H
+
+#include <stdio.h>
+
+// A generator of dragon programs of a given shape, for
+// measuring how the compiler scales. The programs are
+// well-typed, terminate, and print a checksum, so they
+// can be run as well as compiled.
+//
+// Each function takes two ints, declares "locals" int
+// variables, and has "blocks" statement groups. A group
+// is a chain of "depth" nested "if"s and "for"s, with
+// straight-line code at each level. The "strings" string
+// literals of a function are printed from its groups. Every function
+// but the first calls the one before it. With "classes"
+// above 0, each function also keeps an object "o" of one
+// of the classes, whose fields the straight-line code
+// reads and writes, and which it replaces by a new one
+// linked to the old; only the x86 back end takes these
+// yet.
+
+#define T Gen_t
+
+typedef struct {
+    long funcs;
+    long blocks;
+    long depth;
+    long locals;
+    long classes;
+    long strings;
+    unsigned long seed;
+} T;
+
+extern const char *Gen_dims[];
+
+// the defaults
+void Gen_init(T *g);
+// the parameter of dimension "dim" (in "Gen_dims"), or 0
+long *Gen_dim(T *g, const char *dim);
+// set "-dim <value>"; returns 0 if "option" is none
+int Gen_option(T *g, const char *option, const char *value);
+void Gen_usage(FILE *file);
+void Gen_program(FILE *file, T *g);
+
+#undef T
+
+#endif
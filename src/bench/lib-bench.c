@@ -0,0 +1,495 @@
+#include "../lib/char-buffer.h"
+#include "../lib/graph.h"
+#include "../lib/hash-set.h"
+#include "../lib/hash.h"
+#include "../lib/list.h"
+#include "../lib/mem.h"
+#include "../lib/property.h"
+#include "../lib/set.h"
+#include "../lib/stack.h"
+#include "../lib/tree.h"
+#include "../lib/vector.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+// dragon-libbench [options]
+// times the containers of "lib/" on fixed workloads, at
+// sizes growing tenfold from 10 up to "-max". Each
+// workload is repeated until it has run for "-min-time",
+// and its time and allocation are reported per element.
+// A workload is not tried at a larger size once a single
+// run is expected to take longer than "-budget".
+//
+// The elements are records numbered 0, 1, ..., which is
+// what the index-based containers (sets over a universe,
+// properties, graphs, trees) need. Everything a run
+// allocates goes into an arena of its own, released after
+// the run, so runs do not disturb each other.
+//
+// "-format csv" and "-format json" are for comparing runs,
+// e.g., of a container before and after a change.
+
+#define BENCH_ARENA MEM_ARENA_AST
+
+typedef struct {
+    long index;
+} *Elem_t;
+
+typedef struct {
+    String_t structure;
+    String_t workload;
+    // untimed, builds what "run" works on; may be 0
+    void (*setup)(long n);
+    void (*run)(long n);
+} Work_t;
+
+static long maxSize = 1000000;
+static double minTime = 50;
+static double budget = 2000;
+static String_t format = "text";
+static String_t only = 0;
+
+// 2 * "maxSize" elements: "n" and above are never in a
+// container, for lookups that miss
+static Elem_t *elems = 0;
+static Set_Universe_t universe = 0;
+// the size "universe" was made for
+static long universeSize = 0;
+
+// what "setup" builds for "run"
+static Poly_t x = 0;
+static Poly_t y = 0;
+// keeps the results of lookups alive
+static volatile long sink = 0;
+
+static double now(void) {
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (double) t.tv_sec * 1e3 + (double) t.tv_nsec / 1e6;
+}
+
+static long Elem_index(Elem_t e) {
+    return e->index;
+}
+
+static long Elem_equals(Elem_t e1, Elem_t e2) {
+    return e1 == e2;
+}
+
+static long Elem_hashCode(Elem_t e) {
+    return (long) ((unsigned long) e->index * 2654435761UL);
+}
+
+static void Elem_visit(Elem_t e) {
+    sink += e->index;
+}
+
+static void universeOf(long n) {
+    universe = Set_Universe_new(2 * n, (Poly_tyIndex) Elem_index, (Poly_t *) elems);
+    universeSize = n;
+}
+
+///////////////////////////////////////////////////////
+// List_t, Vector_t, Stack_t
+static void workListBuild(long n) {
+    List_t l = List_new();
+
+    for (long i = 0; i < n; i++)
+        List_insertLast(l, elems[i]);
+    x = l;
+}
+
+static void workListIterate(long n) {
+    for (List_t p = List_getFirst(x); p; p = p->next)
+        sink += ((Elem_t) p->data)->index;
+}
+
+static void workVectorBuild(long n) {
+    Vector_t v = Vector_new();
+
+    for (long i = 0; i < n; i++)
+        Vector_insertLast(v, elems[i]);
+    x = v;
+}
+
+static void workVectorIndex(long n) {
+    for (long i = 0; i < n; i++)
+        sink += ((Elem_t) Vector_nth(x, i))->index;
+}
+
+static void workStackPushPop(long n) {
+    Stack_t s = Stack_new();
+
+    for (long i = 0; i < n; i++)
+        Stack_push(s, elems[i]);
+    while (!Stack_isEmpty(s))
+        sink += ((Elem_t) Stack_pop(s))->index;
+}
+
+///////////////////////////////////////////////////////
+// Hash_t, HashSet_t
+static void workHashBuild(long n) {
+    Hash_t h = Hash_new((tyHashCode) Elem_hashCode, (Poly_tyEquals) Elem_equals, 0);
+
+    for (long i = 0; i < n; i++)
+        Hash_insert(h, elems[i], elems[i]);
+    x = h;
+}
+
+static void workHashHit(long n) {
+    for (long i = 0; i < n; i++)
+        sink += (Hash_lookup(x, elems[i]) != 0);
+}
+
+static void workHashMiss(long n) {
+    for (long i = n; i < 2 * n; i++)
+        sink += (Hash_lookup(x, elems[i]) != 0);
+}
+
+static HashSet_t hashSetRange(long from, long to) {
+    HashSet_t s = HashSet_new((tyHashCode) Elem_hashCode, (Poly_tyEquals) Elem_equals);
+
+    for (long i = from; i < to; i++)
+        HashSet_insert(s, elems[i]);
+    return s;
+}
+
+static void workHashSetBuild(long n) {
+    x = hashSetRange(0, n);
+}
+
+static void workHashSetHit(long n) {
+    for (long i = 0; i < n; i++)
+        sink += HashSet_exists(x, elems[i]);
+}
+
+// two sets of "n", overlapping by half
+static void workHashSetTwo(long n) {
+    x = hashSetRange(0, n);
+    y = hashSetRange(n / 2, n + n / 2);
+}
+
+static void workHashSetUnion(long n) {
+    HashSet_unionVoid(x, y);
+}
+
+///////////////////////////////////////////////////////
+// Set_t: by equality, as bits, and sparse
+static Set_t (*newSet)(void) = 0;
+
+static Set_t newEqualsSet(void) {
+    return Set_new((Poly_tyEquals) Elem_equals);
+}
+
+static Set_t newBitsSet(void) {
+    return Set_newBits(universe);
+}
+
+static Set_t newSparseSet(void) {
+    return Set_newSparse(universe);
+}
+
+static Set_t setRange(long from, long to) {
+    Set_t s = newSet();
+
+    for (long i = from; i < to; i++)
+        Set_insert(s, elems[i]);
+    return s;
+}
+
+static void workSetBuild(long n) {
+    x = setRange(0, n);
+}
+
+static void workSetHit(long n) {
+    for (long i = 0; i < n; i++)
+        sink += Set_exists(x, elems[i]);
+}
+
+static void workSetIterate(long n) {
+    Set_foreach(x, (Poly_tyVoid) Elem_visit);
+}
+
+static void workSetTwo(long n) {
+    x = setRange(0, n);
+    y = setRange(n / 2, n + n / 2);
+}
+
+static void workSetUnion(long n) {
+    Set_unionVoid(x, y);
+}
+
+#define SET_KIND(kind, make)                 \
+    static void work##kind##Setup(long n) {  \
+        universeOf(n);                       \
+        newSet = make;                       \
+    }                                        \
+    static void work##kind##Build(long n) {  \
+        work##kind##Setup(n);                \
+        workSetBuild(n);                     \
+    }                                        \
+    static void work##kind##Two(long n) {    \
+        work##kind##Setup(n);                \
+        workSetTwo(n);                       \
+    }                                        \
+    static void work##kind##Insert(long n) { \
+        workSetBuild(n);                     \
+    }
+
+SET_KIND(SetEquals, newEqualsSet)
+SET_KIND(SetBits, newBitsSet)
+SET_KIND(SetSparse, newSparseSet)
+
+#undef SET_KIND
+
+///////////////////////////////////////////////////////
+// Property_t
+static void workPropertyBuild(long n) {
+    Property_t p = Property_new((Poly_tyIndex) Elem_index);
+
+    for (long i = 0; i < n; i++)
+        Property_set(p, elems[i], elems[i]);
+    x = p;
+}
+
+static void workPropertyHit(long n) {
+    for (long i = 0; i < n; i++)
+        sink += (Property_get(x, elems[i]) != 0);
+}
+
+static void workPropertyClear(long n) {
+    Property_clear(x);
+}
+
+///////////////////////////////////////////////////////
+// Graph_t, Tree_t
+// A control-flow graph of "n" blocks: a chain, with a
+// branch around every fourth block and a loop back from
+// every sixteenth, like the output of the front end.
+static void workGraphBuild(long n) {
+    Graph_t g = Graph_new((Poly_tyEquals) Elem_equals, (Poly_tyIndex) Elem_index);
+
+    for (long i = 0; i < n; i++)
+        Graph_insertVertex(g, elems[i]);
+    for (long i = 0; i + 1 < n; i++) {
+        Graph_insertEdge(g, elems[i], elems[i + 1]);
+        if (i % 4 == 0 && i + 2 < n)
+            Graph_insertEdge(g, elems[i], elems[i + 2]);
+        if (i % 16 == 15)
+            Graph_insertEdge(g, elems[i], elems[i - 8]);
+    }
+    x = g;
+}
+
+static void workGraphDfs(long n) {
+    Graph_dfs(x, elems[0], (Poly_tyVoid) Elem_visit);
+}
+
+static void workGraphRpo(long n) {
+    sink += List_size(Graph_rpo(x, elems[0]));
+}
+
+static void workGraphDominators(long n) {
+    sink += (Graph_domTree(x, elems[0]) != 0);
+}
+
+static void markDf(Elem_t v, Set_t df) {
+    sink += Set_size(df);
+}
+
+static void workGraphFrontiers(long n) {
+    sink += (Graph_df(x, elems[0], (void (*)(Poly_t, Set_t)) markDf) != 0);
+}
+
+// a balanced binary tree, as a dominator tree would be
+static void workTreeBuild(long n) {
+    Tree_t t = Tree_new((Poly_tyEquals) Elem_equals, (Poly_tyIndex) Elem_index);
+
+    for (long i = 0; i < n; i++)
+        Tree_insertVertex(t, elems[i]);
+    for (long i = 1; i < n; i++)
+        Tree_insertEdge(t, elems[(i - 1) / 2], elems[i]);
+    x = t;
+}
+
+static void workTreeDfs(long n) {
+    Tree_dfs(x, elems[0], (Poly_tyVoid) Elem_visit);
+}
+
+///////////////////////////////////////////////////////
+// CharBuffer_t
+static void workCharBufferFill(long n) {
+    CharBuffer_t b = CharBuffer_new();
+
+    for (long i = 0; i < n; i++)
+        CharBuffer_append(b, 'a' + (int) (i % 26));
+    sink += (long) strlen(CharBuffer_toString(b));
+}
+
+static Work_t works[] = {
+        {"List", "insert", 0, workListBuild},
+        {"List", "iterate", workListBuild, workListIterate},
+        {"Vector", "insert", 0, workVectorBuild},
+        {"Vector", "index", workVectorBuild, workVectorIndex},
+        {"Stack", "push-pop", 0, workStackPushPop},
+        {"Hash", "insert", 0, workHashBuild},
+        {"Hash", "lookup-hit", workHashBuild, workHashHit},
+        {"Hash", "lookup-miss", workHashBuild, workHashMiss},
+        {"HashSet", "insert", 0, workHashSetBuild},
+        {"HashSet", "exists", workHashSetBuild, workHashSetHit},
+        {"HashSet", "union", workHashSetTwo, workHashSetUnion},
+        {"Set", "insert", workSetEqualsSetup, workSetEqualsInsert},
+        {"Set", "exists", workSetEqualsBuild, workSetHit},
+        {"Set", "union", workSetEqualsTwo, workSetUnion},
+        {"Set", "iterate", workSetEqualsBuild, workSetIterate},
+        {"Set-bits", "insert", workSetBitsSetup, workSetBitsInsert},
+        {"Set-bits", "exists", workSetBitsBuild, workSetHit},
+        {"Set-bits", "union", workSetBitsTwo, workSetUnion},
+        {"Set-bits", "iterate", workSetBitsBuild, workSetIterate},
+        {"Set-sparse", "insert", workSetSparseSetup, workSetSparseInsert},
+        {"Set-sparse", "exists", workSetSparseBuild, workSetHit},
+        {"Set-sparse", "union", workSetSparseTwo, workSetUnion},
+        {"Set-sparse", "iterate", workSetSparseBuild, workSetIterate},
+        {"Property", "set", 0, workPropertyBuild},
+        {"Property", "get", workPropertyBuild, workPropertyHit},
+        {"Property", "clear", workPropertyBuild, workPropertyClear},
+        {"Graph", "build", 0, workGraphBuild},
+        {"Graph", "dfs", workGraphBuild, workGraphDfs},
+        {"Graph", "rpo", workGraphBuild, workGraphRpo},
+        {"Graph", "dominators", workGraphBuild, workGraphDominators},
+        {"Graph", "frontiers", workGraphBuild, workGraphFrontiers},
+        {"Tree", "build", 0, workTreeBuild},
+        {"Tree", "dfs", workTreeBuild, workTreeDfs},
+        {"CharBuffer", "append", 0, workCharBufferFill},
+};
+
+///////////////////////////////////////////////////////
+// driver
+static long numResults = 0;
+
+static void report(Work_t *w, long n, long reps, double ms, long bytes) {
+    double ns = ms * 1e6 / (double) reps / (double) n;
+    double b = (double) bytes / (double) reps / (double) n;
+
+    if (strcmp(format, "csv") == 0) {
+        if (numResults == 0)
+            printf("structure,workload,size,reps,ns_per_elem,bytes_per_elem\n");
+        printf("%s,%s,%ld,%ld,%.3f,%.1f\n", w->structure, w->workload, n, reps, ns, b);
+    } else if (strcmp(format, "json") == 0) {
+        printf("%s\n  {\"structure\": \"%s\", \"workload\": \"%s\", \"size\": %ld, "
+               "\"reps\": %ld, \"ns_per_elem\": %.3f, \"bytes_per_elem\": %.1f}",
+               (numResults == 0) ? "[" : ",", w->structure, w->workload, n, reps, ns, b);
+    } else {
+        if (numResults == 0)
+            printf("%-12s %-12s %9s %8s %12s %10s\n", "structure", "workload", "size", "reps", "ns/elem", "bytes/elem");
+        printf("%-12s %-12s %9ld %8ld %12.2f %10.1f\n", w->structure, w->workload, n, reps, ns, b);
+    }
+    fflush(stdout);
+    numResults++;
+}
+
+// one run in a fresh arena; returns its time in ms, and
+// adds that of its setup as well to "total"
+static double runOnce(Work_t *w, long n, long *bytes, double *total) {
+    double start, setup = now();
+    long before;
+    Elem_t first;
+
+    Mem_Arena_enter(BENCH_ARENA);
+    // the arena takes its first chunk now, and not on the
+    // clock, or it would swamp the small sizes
+    Mem_NEW(first);
+    x = y = 0;
+    if (w->setup)
+        w->setup(n);
+    before = Mem_total();
+    start = now();
+    w->run(n);
+    start = now() - start;
+    *bytes += Mem_total() - before;
+    Mem_Arena_enter(MEM_ARENA_GLOBAL);
+    Mem_Arena_release(BENCH_ARENA);
+    *total += now() - setup;
+    return start;
+}
+
+// The repetitions and the budget go by the time with the
+// setups: a cheap run on a costly setup (say, iterating a
+// set by equality) would take forever otherwise.
+static void bench(Work_t *w) {
+    double last = 0;
+
+    for (long n = 10; n <= maxSize; n *= 10) {
+        long reps = 0, bytes = 0;
+        double ms = 0, total = 0, once;
+
+        do {
+            ms += runOnce(w, n, &bytes, &total);
+            reps++;
+        } while (ms < minTime && total < 4 * minTime);
+        report(w, n, reps, ms, bytes);
+        // the next size takes at least ten times as long,
+        // or as much more as this one did over the last
+        once = total / (double) reps;
+        if (n * 10 <= maxSize && once * ((last > 0 && once / last > 10) ? once / last : 10) > budget) {
+            if (strcmp(format, "text") == 0)
+                printf("%-12s %-12s (larger sizes skipped: over %.0f ms)\n", w->structure, w->workload, budget);
+            return;
+        }
+        last = once;
+    }
+}
+
+static void usage(void) {
+    fprintf(stderr,
+            "Usage: dragon-libbench [options]\n"
+            "  -max <n>         the largest size (default 1000000)\n"
+            "  -min-time <ms>   time to repeat each workload for (default 50)\n"
+            "  -budget <ms>     skip sizes with runs expected this long (default 2000)\n"
+            "  -only <name>     only the structures or workloads named so\n"
+            "  -format <f>      {text|csv|json} (default text)\n");
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    for (int i = 1; i < argc; i += 2) {
+        String_t arg = argv[i], value = argv[i + 1];
+
+        if (!value)
+            usage();
+        if (strcmp(arg, "-max") == 0)
+            maxSize = atol(value);
+        else if (strcmp(arg, "-min-time") == 0)
+            minTime = atof(value);
+        else if (strcmp(arg, "-budget") == 0)
+            budget = atof(value);
+        else if (strcmp(arg, "-only") == 0)
+            only = value;
+        else if (strcmp(arg, "-format") == 0)
+            format = value;
+        else
+            usage();
+    }
+    if (maxSize < 10 || (strcmp(format, "text") != 0 && strcmp(format, "csv") != 0 && strcmp(format, "json") != 0))
+        usage();
+
+    Mem_init();
+    elems = calloc(2 * (unsigned long) maxSize, sizeof(*elems));
+    for (long i = 0; i < 2 * maxSize; i++) {
+        Mem_NEW(elems[i]);
+        elems[i]->index = i;
+    }
+
+    for (unsigned long i = 0; i < sizeof(works) / sizeof(works[0]); i++) {
+        Work_t *w = &works[i];
+
+        if (only && strcmp(only, w->structure) != 0 && strcmp(only, w->workload) != 0)
+            continue;
+        bench(w);
+    }
+    if (strcmp(format, "json") == 0)
+        printf("%s\n]\n", (numResults == 0) ? "[" : "");
+    return 0;
+}
@@ -0,0 +1,349 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+// dragon-runbench [options] [programs]
+// compiles each program of the corpus (by default, every
+// "*.c" in the current directory) with each code
+// generator, runs it several times, and reports its median
+// time and peak resident size. The output of the first
+// run is checked against "<program>.expect".
+//
+// With "-baseline <file>", the results are compared to
+// those saved by "-save <file>" earlier: a program that
+// used to work but no longer does, or that has become
+// slower by more than the tolerance, is a regression, and
+// the exit code is 1.
+//
+// There is no collector in this tree yet, so there are no
+// GC counts to report; the peak resident size is the
+// measure of memory.
+//
+// Like dragon itself, this must run where the runtime is
+// found at "../src/runtime" (e.g., in "bench/").
+
+#define MAX_PROGS 256
+#define MAX_RUNS 64
+#define NAME_SIZE 128
+
+// no difference below this many ms is taken as a
+// regression, whatever the tolerance
+#define NOISE 2.0
+
+enum {
+    OK = 0,
+    COMPILE_FAIL,
+    RUN_FAIL,
+    WRONG_OUTPUT,
+    NONE
+};
+
+static const char *statusNames[] = {"ok", "compile-fail", "run-fail", "wrong-output", "-"};
+
+static const char *codegens[] = {"C", "x86", 0};
+
+typedef struct {
+    char prog[NAME_SIZE];
+    const char *codegen;
+    long status;
+    // in ms, and in KB
+    double median;
+    long maxRss;
+} Result_t;
+
+static const char *dragon = "dragon";
+static const char *codegen = "all";
+static long runs = 5;
+static double tolerance = 20;
+static long timeout = 60;
+static const char *baseline = 0;
+static const char *save = 0;
+
+static long numProgs = 0;
+static char progs[MAX_PROGS][NAME_SIZE];
+static long numResults = 0;
+static Result_t results[MAX_PROGS * 2];
+
+static void usage(void) {
+    fprintf(stderr,
+            "Usage: dragon-runbench [options] [programs]\n"
+            "  -dragon <file>     the compiler (default \"dragon\")\n"
+            "  -codegen <cg>      {C|x86|all} (default all)\n"
+            "  -runs <n>          runs per program (default 5)\n"
+            "  -timeout <s>       seconds a run may take (default 60)\n"
+            "  -baseline <file>   compare with the results in file\n"
+            "  -tolerance <pct>   slow-down allowed over the baseline (default 20)\n"
+            "  -save <file>       save the results as a baseline\n");
+    exit(1);
+}
+
+static int compareNames(const void *x, const void *y) {
+    return strcmp(x, y);
+}
+
+static int compareDoubles(const void *x, const void *y) {
+    double a = *(const double *) x, b = *(const double *) y;
+
+    return (a > b) - (a < b);
+}
+
+static void addProg(const char *file) {
+    size_t n = strlen(file);
+
+    if (n < 3 || strcmp(file + n - 2, ".c") != 0 || n - 2 >= NAME_SIZE)
+        return;
+    if (numProgs == MAX_PROGS) {
+        fprintf(stderr, "too many programs\n");
+        exit(1);
+    }
+    memcpy(progs[numProgs], file, n - 2);
+    progs[numProgs][n - 2] = '\0';
+    numProgs++;
+}
+
+static void findProgs(void) {
+    DIR *dir = opendir(".");
+    struct dirent *e;
+
+    if (!dir) {
+        fprintf(stderr, "fail to open the current directory\n");
+        exit(1);
+    }
+    while ((e = readdir(dir)))
+        addProg(e->d_name);
+    closedir(dir);
+    qsort(progs, (size_t) numProgs, NAME_SIZE, compareNames);
+}
+
+static double now(void) {
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (double) t.tv_sec * 1e3 + (double) t.tv_nsec / 1e6;
+}
+
+// runs "bin" with its output in "out"; returns the time
+// in ms, or -1 if it fails
+static double runOnce(const char *bin, const char *out, long *maxRss) {
+    struct rusage usage;
+    double start = now();
+    int status;
+    pid_t pid;
+
+    fflush(stdout);
+    pid = fork();
+    if (pid < 0)
+        return -1;
+    if (pid == 0) {
+        if (!freopen(out, "w", stdout))
+            _exit(127);
+        // a run that takes too long is killed
+        alarm((unsigned) timeout);
+        execl(bin, bin, (char *) 0);
+        _exit(127);
+    }
+    if (wait4(pid, &status, 0, &usage) < 0)
+        return -1;
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+        return -1;
+    if (usage.ru_maxrss > *maxRss)
+        *maxRss = usage.ru_maxrss;
+    return now() - start;
+}
+
+// 0 if "x" and "y" differ or cannot be read
+static int sameFiles(const char *x, const char *y) {
+    FILE *f = fopen(x, "r"), *g = fopen(y, "r");
+    int same = f && g, c;
+
+    while (same && (c = fgetc(f)) != EOF)
+        same = (c == fgetc(g));
+    if (same)
+        same = (fgetc(g) == EOF);
+    if (f)
+        fclose(f);
+    if (g)
+        fclose(g);
+    return same;
+}
+
+static void measure(Result_t *r) {
+    char bin[NAME_SIZE + 16], out[NAME_SIZE + 16], expect[NAME_SIZE + 16], cmd[1024];
+    double times[MAX_RUNS];
+
+    snprintf(bin, sizeof(bin), "./%s.%s.bin", r->prog, r->codegen);
+    snprintf(out, sizeof(out), "%s.%s.out", r->prog, r->codegen);
+    snprintf(expect, sizeof(expect), "%s.expect", r->prog);
+    r->median = 0;
+    r->maxRss = 0;
+
+    snprintf(cmd, sizeof(cmd), "%s -codegen %s -o %s %s.c > /dev/null 2>&1",
+             dragon, r->codegen, bin, r->prog);
+    if (system(cmd) != 0) {
+        r->status = COMPILE_FAIL;
+        return;
+    }
+    r->status = OK;
+    for (long i = 0; i < runs; i++) {
+        times[i] = runOnce(bin, (i == 0) ? out : "/dev/null", &r->maxRss);
+        if (times[i] < 0) {
+            r->status = RUN_FAIL;
+            break;
+        }
+        if (i == 0 && !sameFiles(out, expect)) {
+            r->status = WRONG_OUTPUT;
+            break;
+        }
+    }
+    if (r->status == OK) {
+        qsort(times, (size_t) runs, sizeof(times[0]), compareDoubles);
+        r->median = times[runs / 2];
+        remove(out);
+    }
+    remove(bin);
+}
+
+///////////////////////////////////////////////////////
+// baselines, one line per result:
+//   program codegen status median(ms) maxRss(KB)
+static void saveResults(void) {
+    FILE *file = fopen(save, "w");
+
+    if (!file) {
+        fprintf(stderr, "fail to open file: %s\n", save);
+        exit(1);
+    }
+    fprintf(file, "# dragon-runbench: program codegen status median(ms) maxRss(KB)\n");
+    for (long i = 0; i < numResults; i++) {
+        Result_t *r = &results[i];
+
+        fprintf(file, "%s %s %s %.3f %ld\n",
+                r->prog, r->codegen, statusNames[r->status], r->median, r->maxRss);
+    }
+    fclose(file);
+}
+
+// the result in the baseline for "r", with status "NONE"
+// if there is none
+static Result_t findBaseline(Result_t *r) {
+    Result_t b = {"", 0, NONE, 0, 0};
+    char line[512], prog[NAME_SIZE], cg[16], status[32];
+    FILE *file = fopen(baseline, "r");
+
+    if (!file) {
+        fprintf(stderr, "fail to open file: %s\n", baseline);
+        exit(1);
+    }
+    while (fgets(line, sizeof(line), file)) {
+        double median;
+        long maxRss;
+
+        if (sscanf(line, "%127s %15s %31s %lf %ld", prog, cg, status, &median, &maxRss) != 5)
+            continue;
+        if (strcmp(prog, r->prog) != 0 || strcmp(cg, r->codegen) != 0)
+            continue;
+        for (long s = OK; s < NONE; s++)
+            if (strcmp(status, statusNames[s]) == 0)
+                b.status = s;
+        b.median = median;
+        b.maxRss = maxRss;
+    }
+    fclose(file);
+    return b;
+}
+
+// returns 1 on a regression
+static int report(Result_t *r) {
+    Result_t b;
+    int regress = 0;
+
+    printf("%-12s %-4s %-13s", r->prog, r->codegen, statusNames[r->status]);
+    if (r->status == OK)
+        printf(" %10.2f %10ld", r->median, r->maxRss);
+    else
+        printf(" %10s %10s", "-", "-");
+    if (!baseline) {
+        printf("\n");
+        return 0;
+    }
+
+    b = findBaseline(r);
+    if (b.status == OK && r->status == OK) {
+        double change = (r->median - b.median) / b.median * 100;
+
+        regress = change > tolerance && r->median - b.median > NOISE;
+        printf(" %10.2f %+7.1f%%", b.median, change);
+    } else {
+        regress = b.status == OK;
+        printf(" %10s %8s", statusNames[b.status], "");
+    }
+    printf("%s\n", (regress) ? "  <- regression" : "");
+    return regress;
+}
+
+int main(int argc, char **argv) {
+    long regressions = 0;
+    int i;
+
+    for (i = 1; i < argc && argv[i][0] == '-'; i += 2) {
+        const char *arg = argv[i], *value = argv[i + 1];
+
+        if (!value)
+            usage();
+        if (strcmp(arg, "-dragon") == 0)
+            dragon = value;
+        else if (strcmp(arg, "-codegen") == 0)
+            codegen = value;
+        else if (strcmp(arg, "-runs") == 0)
+            runs = atol(value);
+        else if (strcmp(arg, "-timeout") == 0)
+            timeout = atol(value);
+        else if (strcmp(arg, "-baseline") == 0)
+            baseline = value;
+        else if (strcmp(arg, "-tolerance") == 0)
+            tolerance = atof(value);
+        else if (strcmp(arg, "-save") == 0)
+            save = value;
+        else
+            usage();
+    }
+    if (runs < 1 || runs > MAX_RUNS || timeout < 1)
+        usage();
+    if (i < argc) {
+        for (; i < argc; i++)
+            addProg(argv[i]);
+    } else
+        findProgs();
+
+    printf("%-12s %-4s %-13s %10s %10s", "program", "cg", "status", "median(ms)", "maxRss(K)");
+    if (baseline)
+        printf(" %10s %8s", "baseline", "change");
+    printf("\n");
+    for (long p = 0; p < numProgs; p++) {
+        for (const char **cg = codegens; *cg; cg++) {
+            Result_t *r;
+
+            if (strcmp(codegen, "all") != 0 && strcmp(codegen, *cg) != 0)
+                continue;
+            r = &results[numResults++];
+            snprintf(r->prog, NAME_SIZE, "%s", progs[p]);
+            r->codegen = *cg;
+            measure(r);
+            regressions += report(r);
+        }
+    }
+    // the generated C or assembly of the last compile
+    remove("files-0.c");
+    remove("files-0.s");
+
+    if (save)
+        saveResults();
+    if (regressions)
+        printf("%ld regression(s)\n", regressions);
+    return regressions != 0;
+}
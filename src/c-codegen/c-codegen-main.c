@@ -1,19 +1,28 @@
 #include "c-codegen-main.h"
 #include "../control/pass.h"
+#include "../lib/error.h"
 #include "../lib/int.h"
+#include "../lib/io.h"
+#include "../lib/system.h"
 #include "c-codegen.h"
 
-static int counter = 0;
+int C_codegen_piped(void) {
+    return Control_pipe && Control_codegen == CODEGEN_C && !Control_dump_lookup(DUMP_C) && !Control_dump_lookup(DUMP_X86);
+}
 
-static String_t genFileName(void) {
+String_t C_codegen_fileName(void) {
     String_t f;
 
+    // next to those "assemble" makes
+    if (C_codegen_piped())
+        return String_concat(System_tempDir(), "/files-", Int_toString(Control_fileIndex), ".o", 0);
+
     if (Control_dump_lookup(DUMP_C)) {
-        f = String_concat("files-", Int_toString(counter++), ".c", 0);
+        f = String_concat("files-", Int_toString(Control_fileIndex), ".c", 0);
         return f;
     }
 
-    f = String_concat("", Control_asmDirectory, "files-", Int_toString(counter++), ".c", 0);
+    f = String_concat("", Control_asmDirectory, "files-", Int_toString(Control_fileIndex), ".c", 0);
     return f;
 }
 
@@ -21,18 +30,42 @@ static String_t out(Machine_Prog_t p) {
     String_t f;
     File_t file;
 
-    f = genFileName();
+    f = C_codegen_fileName();
     file = File_open(f, "w+");
     C_codegen(file, p);
     File_close(file);
     return f;
 }
 
+// gcc -c -g -I <dir> -x c -o <obj> -
+// gcc compiles as the C comes, and the C is never on disk.
+static String_t outPiped(Machine_Prog_t p) {
+    String_t cmd[] = {"gcc", "-c", "-g", "-I", Control_headerDirectory, "-x", "c", "-o", 0, "-", 0};
+    String_t f;
+    File_t file;
+    long pid;
+
+    f = C_codegen_fileName();
+    cmd[8] = f;
+    if (Control_Verb_order(VERBOSE_DETAIL, Control_verbose)) {
+        Io_printSpaces(6);
+        printf("%s", cmd[0]);
+        for (String_t *s = cmd + 1; *s; s++)
+            printf(" %s", *s);
+        printf("\n");
+    }
+    file = System_openPipe(cmd, &pid);
+    C_codegen(file, p);
+    if (System_closePipe(file, pid))
+        Error_error("fail to compile the generated C\n");
+    return f;
+}
+
 String_t C_codegen_main(Machine_Prog_t p) {
     Pass_t output;
     String_t f;
 
-    output = Pass_new("outputC", VERBOSE_SUBPASS, p, (Poly_tyId) out);
+    output = Pass_new("outputC", VERBOSE_SUBPASS, p, (Poly_tyId) (C_codegen_piped() ? outPiped : out));
     f = Pass_doit(&output);
     return f;
 }
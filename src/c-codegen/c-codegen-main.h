@@ -7,4 +7,13 @@
 
 String_t C_codegen_main (Machine_Prog_t p);
 
+// the name of the C file for the file being compiled, or
+// of its object file if "C_codegen_piped"
+String_t C_codegen_fileName(void);
+
+// whether the C goes to gcc through a pipe, leaving only
+// an object file (see "-pipe"); not when the C is to be
+// kept.
+int C_codegen_piped(void);
+
 #endif
@@ -32,22 +32,23 @@ static void outputOneString(Machine_Str_t s) {
     char *a = s->value;
 
     assert(s->name);
-    fprintf(file, "static char *%s = ", Id_toString(s->name));
-    fprintf(file, "%s", "\"");
+    File_write(file, "static char *");
+    File_write(file, Id_toString(s->name));
+    File_write(file, " = \"");
     while ((c = *a++)) {
         switch (c) {
             case '\n':
-                fprintf(file, "%s", "\\n");
+                File_write(file, "\\n");
                 break;
             case '\t':
-                fprintf(file, "%s", "\\t");
+                File_write(file, "\\t");
                 break;
             default:
-                fprintf(file, "%c", c);
+                File_writeChar(file, c);
                 break;
         }
     }
-    fprintf(file, "%s", "\";\n");
+    File_write(file, "\";\n");
 }
 
 static void outputStrings(List_t strings) {
@@ -92,6 +93,12 @@ static void outputStrings(List_t strings) {
 // be take down from the source by a "catch" clause.
 static List_t handlers = 0;
 
+// the symbol of a handler is its label, twice
+static void outputHandler(Label_t l) {
+    File_write(file, Label_toString(l));
+    File_write(file, Label_toString(l));
+}
+
 //////////////////////////////////////////////////////
 // layouts
 //static void outputLayouts(Machine_ObjInfo_t m) {
@@ -119,22 +126,22 @@ static void outputAtype(Atype_t ty) {
     assert(ty);
     switch (ty->kind) {
         case ATYPE_INT:
-            fprintf(file, "%s", "int");
+            File_write(file, "int");
             return;
         case ATYPE_INT_ARRAY:
-            fprintf(file, "%s", "int *");
+            File_write(file, "int *");
             return;
         case ATYPE_STRING:
-            fprintf(file, "%s", "char *");
+            File_write(file, "char *");
             return;
         case ATYPE_STRING_ARRAY:
-            fprintf(file, "%s", "char **");
+            File_write(file, "char **");
             return;
         case ATYPE_CLASS:
-            fprintf(file, "%s", "void *");
+            File_write(file, "void *");
             return;
         case ATYPE_CLASS_ARRAY:
-            fprintf(file, "%s", "void **");
+            File_write(file, "void **");
             return;
         case ATYPE_FUN:
             Error_impossible();
@@ -151,8 +158,8 @@ static void outputAtype(Atype_t ty) {
 // dec
 static void outputDec(Dec_t d) {
     outputAtype(d->ty);
-    fprintf(file, "%s", " ");
-    fprintf(file, "%s", Id_toString(d->id));
+    File_write(file, " ");
+    File_write(file, Id_toString(d->id));
     return;
 }
 
@@ -164,7 +171,7 @@ static void outputArgs(List_t l) {
         Dec_t dec = (Dec_t) l->data;
         outputDec(dec);
         if (l->next)
-            fprintf(file, "%s", ", ");
+            File_write(file, ", ");
         l = l->next;
     }
     return;
@@ -176,9 +183,9 @@ static void outputDecs(List_t l) {
     l = List_getFirst(l);
     while (l) {
         Dec_t dec = (Dec_t) l->data;
-        fprintf(file, "%s", "  ");
+        File_write(file, "  ");
         outputDec(dec);
-        fprintf(file, "%s", ";\n");
+        File_write(file, ";\n");
         l = l->next;
     }
     return;
@@ -190,13 +197,13 @@ static void outputOperand(Machine_Operand_t o) {
     assert(o);
     switch (o->kind) {
         case MACHINE_OP_INT:
-            fprintf(file, "%ld", o->u.int_lit);
+            File_writeLong(file, o->u.int_lit);
             break;
         case MACHINE_OP_GLOBAL:
-            fprintf(file, "%s", Id_toString(o->u.id));
+            File_write(file, Id_toString(o->u.id));
             break;
         case MACHINE_OP_ID:
-            fprintf(file, "%s", Id_toString(o->u.id));
+            File_write(file, Id_toString(o->u.id));
             break;
         default:
             Error_impossible();
@@ -211,18 +218,20 @@ static void outputMem(Machine_Mem_t m) {
     assert(m);
     switch (m->kind) {
         case MACHINE_MEM_ARRAY:
-            fprintf(file, "*(((A)%s", Id_toString(m->u.array.name));
-            fprintf(file, "%s", ")+");
+            File_write(file, "*(((A)");
+            File_write(file, Id_toString(m->u.array.name));
+            File_write(file, ")+");
             outputOperand(m->u.array.index);
-            fprintf(file, "%s", ")");
+            File_write(file, ")");
             break;
         case MACHINE_MEM_CLASS:
-            fprintf(file, "*(((C)%s", Id_toString(m->u.class.name));
+            File_write(file, "*(((C)");
+            File_write(file, Id_toString(m->u.class.name));
             // the index should always be equal or greater than 0,
             // so the "+" here is of no problem.
-            fprintf(file, "%s", ")+");
-            fprintf(file, "%ld", (m->u.class.index));
-            fprintf(file, "%s", ")");
+            File_write(file, ")+");
+            File_writeLong(file, (m->u.class.index));
+            File_write(file, ")");
             break;
         default:
             Error_impossible();
@@ -235,42 +244,44 @@ static void outputMem(Machine_Mem_t m) {
 // stm
 static void outputStm(Machine_Stm_t s) {
     assert(s);
-    fprintf(file, "%s", "  ");
+    File_write(file, "  ");
     switch (s->kind) {
         case MACHINE_STM_MOVE:
-            fprintf(file, "%s", Id_toString(s->u.move.dest));
-            fprintf(file, "%s", " = ");
+            File_write(file, Id_toString(s->u.move.dest));
+            File_write(file, " = ");
             outputOperand(s->u.move.src);
             break;
         case MACHINE_STM_BOP:
-            fprintf(file, "%s", Id_toString(s->u.bop.dest));
-            fprintf(file, "%s", " = ");
+            File_write(file, Id_toString(s->u.bop.dest));
+            File_write(file, " = ");
             outputOperand(s->u.bop.left);
-            fprintf(file, "%s", Operator_toString(s->u.bop.op));
+            File_write(file, Operator_toString(s->u.bop.op));
             outputOperand(s->u.bop.right);
             break;
         case MACHINE_STM_UOP:
-            fprintf(file, "%s", Id_toString(s->u.uop.dest));
-            fprintf(file, "%s", " = ");
-            fprintf(file, "%s", Operator_toString(s->u.uop.op));
+            File_write(file, Id_toString(s->u.uop.dest));
+            File_write(file, " = ");
+            File_write(file, Operator_toString(s->u.uop.op));
             outputOperand(s->u.uop.src);
             break;
 
         case MACHINE_STM_STORE:
             outputMem(s->u.store.m);
-            fprintf(file, "%s", " = ");
+            File_write(file, " = ");
             outputOperand(s->u.store.src);
             break;
         case MACHINE_STM_LOAD:
-            fprintf(file, "%s", Id_toString(s->u.load.dest));
-            fprintf(file, "%s", " = ");
+            File_write(file, Id_toString(s->u.load.dest));
+            File_write(file, " = ");
             outputMem(s->u.load.m);
             break;
         case MACHINE_STM_TRY: {
             List_insertLast(handlers, s->u.try);
-            fprintf(file, "do{\n  extern int %s%s;\n  ", Label_toString(s->u.try), Label_toString(s->u.try));
-            fprintf(file, "Dragon_Exn_try((int)&%s%s);\n  }while(0)", Label_toString(s->u.try),
-                    Label_toString(s->u.try));
+            File_write(file, "do{\n  extern int ");
+            outputHandler(s->u.try);
+            File_write(file, ";\n  Dragon_Exn_try((int)&");
+            outputHandler(s->u.try);
+            File_write(file, ");\n  }while(0)");
             break;
         }
         case MACHINE_STM_TRY_END: {
@@ -278,35 +289,39 @@ static void outputStm(Machine_Stm_t s) {
             // next goto...
             currentLabel = s->u.tryEnd;
             List_insertLast(handlers, currentLabel);
-            fprintf(file, "do{");
-            fprintf(file, "extern int %s%s;\n", Label_toString(s->u.tryEnd), Label_toString(s->u.tryEnd));
-            fprintf(file, "Dragon_Exn_end ((int)&%s%s);", Label_toString(s->u.tryEnd), Label_toString(s->u.tryEnd));
-            fprintf(file, "}while (0)");
+            File_write(file, "do{");
+            File_write(file, "extern int ");
+            outputHandler(s->u.tryEnd);
+            File_write(file, ";\nDragon_Exn_end ((int)&");
+            outputHandler(s->u.tryEnd);
+            File_write(file, ");");
+            File_write(file, "}while (0)");
             break;
         }
         case MACHINE_STM_RUNTIME_CLASS: {
-            fprintf(file, "%s", Id_toString(s->u.class.dest));
-            fprintf(file, "%s", " = ");
-            fprintf(file, "%s", Id_toString(s->u.class.fname));
-
-            fprintf(file, "%s", " (");
-            fprintf(file, "%ld, ", s->u.class.index);
-            fprintf(file, "%ld", s->u.class.size);
-            fprintf(file, "%s", ")");
-            fprintf(file, ";%s", " // (index, size)");
+            File_write(file, Id_toString(s->u.class.dest));
+            File_write(file, " = ");
+            File_write(file, Id_toString(s->u.class.fname));
+
+            File_write(file, " (");
+            File_writeLong(file, s->u.class.index);
+            File_write(file, ", ");
+            File_writeLong(file, s->u.class.size);
+            File_write(file, ")");
+            File_write(file, "; // (index, size)");
             break;
         }
         case MACHINE_STM_RUNTIME_ARRAY: {
-            fprintf(file, "%s", Id_toString(s->u.array.dest));
-            fprintf(file, "%s", " = ");
-            fprintf(file, "%s", Id_toString(s->u.array.fname));
-            fprintf(file, "%s", "(");
-            fprintf(file, "%d", s->u.array.isPtr);
-            fprintf(file, "%s", ", ");
+            File_write(file, Id_toString(s->u.array.dest));
+            File_write(file, " = ");
+            File_write(file, Id_toString(s->u.array.fname));
+            File_write(file, "(");
+            File_writeLong(file, s->u.array.isPtr);
+            File_write(file, ", ");
             outputOperand(s->u.array.size);
-            fprintf(file, "%s", ", ");
-            fprintf(file, "%d", s->u.array.scale);
-            fprintf(file, "%s", "); // (isPtr, size, scale)");
+            File_write(file, ", ");
+            File_writeLong(file, s->u.array.scale);
+            File_write(file, "); // (isPtr, size, scale)");
             break;
         }
         default:
@@ -314,7 +329,7 @@ static void outputStm(Machine_Stm_t s) {
             Error_impossible();
             break;
     }
-    fprintf(file, "%s", ";\n");
+    File_write(file, ";\n");
     return;
 }
 
@@ -322,52 +337,52 @@ static void outputStm(Machine_Stm_t s) {
 // transfer
 static void outputTransfer(Machine_Transfer_t t) {
     assert(t);
-    fprintf(file, "%s", "  ");
+    File_write(file, "  ");
     switch (t->kind) {
         case MACHINE_TRANS_IF:
-            fprintf(file, "%s", "if (");
+            File_write(file, "if (");
             Machine_Operand_print(file, t->u.iff.cond);
-            fprintf(file, "%s", ")\n    goto ");
-            fprintf(file, "%s", Label_toString(t->u.iff.truee));
-            fprintf(file, "%s", ";\n");
-            fprintf(file, "%s", "  else goto ");
-            fprintf(file, "%s", Label_toString(t->u.iff.falsee));
+            File_write(file, ")\n    goto ");
+            File_write(file, Label_toString(t->u.iff.truee));
+            File_write(file, ";\n");
+            File_write(file, "  else goto ");
+            File_write(file, Label_toString(t->u.iff.falsee));
             break;
         case MACHINE_TRANS_JUMP:
             if (!currentLabel) {
-                fprintf(file, "%s", "goto ");
-                fprintf(file, "%s", Label_toString(t->u.jump));
+                File_write(file, "goto ");
+                File_write(file, Label_toString(t->u.jump));
             } else {
                 currentLabel = 0;
             }
             break;
         case MACHINE_TRANS_RETURN:
-            fprintf(file, "%s", "return ");
+            File_write(file, "return ");
             Machine_Operand_print(file, t->u.ret);
             break;
         case MACHINE_TRANS_THROW:
-            fprintf(file, "%s", "Dragon_Exn_throw ()");
+            File_write(file, "Dragon_Exn_throw ()");
             break;
         case MACHINE_TRANS_CALL: {
             List_t args;
 
             // must save
             if (t->u.call.leave)
-                fprintf(file, "%s", "Dragon_Exn_save ();\n  ");
-            fprintf(file, "%s", Id_toString(t->u.call.dest));
-            fprintf(file, "%s", " = ");
-            fprintf(file, "%s", Id_toString(t->u.call.name));
-            fprintf(file, "%s", "(");
+                File_write(file, "Dragon_Exn_save ();\n  ");
+            File_write(file, Id_toString(t->u.call.dest));
+            File_write(file, " = ");
+            File_write(file, Id_toString(t->u.call.name));
+            File_write(file, "(");
             args = List_getFirst(t->u.call.args);
             while (args) {
                 Machine_Operand_t op = (Machine_Operand_t) args->data;
 
                 outputOperand(op);
                 if (args->next)
-                    fprintf(file, "%s", ", ");
+                    File_write(file, ", ");
                 args = args->next;
             }
-            fprintf(file, "%s", ")");
+            File_write(file, ")");
             break;
         }
         case MACHINE_TRANS_CALL_NOASSIGN: {
@@ -375,26 +390,26 @@ static void outputTransfer(Machine_Transfer_t t) {
 
             // must save
             if (t->u.call.leave)
-                fprintf(file, "%s", "Dragon_Exn_save ();\n  ");
-            fprintf(file, "%s", Id_toString(t->u.call.name));
-            fprintf(file, "%s", "(");
+                File_write(file, "Dragon_Exn_save ();\n  ");
+            File_write(file, Id_toString(t->u.call.name));
+            File_write(file, "(");
             args = List_getFirst(t->u.call.args);
             while (args) {
                 Machine_Operand_t op = (Machine_Operand_t) args->data;
 
                 outputOperand(op);
                 if (args->next)
-                    fprintf(file, "%s", ", ");
+                    File_write(file, ", ");
                 args = args->next;
             }
-            fprintf(file, "%s", ")");
+            File_write(file, ")");
             break;
         }
         default:
             Error_impossible();
             break;
     }
-    fprintf(file, "%s", ";\n");
+    File_write(file, ";\n");
     return;
 }
 
@@ -403,14 +418,18 @@ static void outputTransfer(Machine_Transfer_t t) {
 static void outputBlock(Machine_Block_t b) {
     assert(b);
 
-    fprintf(file, "%s:\n", Label_toString(b->label));
+    File_write(file, Label_toString(b->label));
+    File_write(file, ":\n");
     // if this label appears in the "handlers", it
     // says that it is a handler...
-    if (List_exists(handlers, b->label, (Poly_tyEquals) Label_equals))
-        fprintf(file, "__asm__(\"_%s%s:\\n\\t.byte 0x90\\n\");\n", Label_toString(b->label), Label_toString(b->label));
+    if (List_exists(handlers, b->label, (Poly_tyEquals) Label_equals)) {
+        File_write(file, "__asm__(\"_");
+        outputHandler(b->label);
+        File_write(file, ":\\n\\t.byte 0x90\\n\");\n");
+    }
     List_foreach(b->stms, (Poly_tyVoid) outputStm);
     outputTransfer(b->transfer);
-    fprintf(file, "%s", "\n");
+    File_write(file, "\n");
     return;
 }
 
@@ -421,17 +440,19 @@ static void outputFunction(Machine_Fun_t f) {
 
     handlers = List_new();
     outputAtype(f->type);
-    fprintf(file, " %s (", Id_toString(f->name));
+    File_write(file, " ");
+    File_write(file, Id_toString(f->name));
+    File_write(file, " (");
     outputArgs(f->args);
-    fprintf(file, "%s", ")\n{\n");
+    File_write(file, ")\n{\n");
     outputDecs(f->decs);
-    fprintf(file, "\n");
+    File_write(file, "\n");
 
     List_foreach(f->blocks, (Poly_tyVoid) outputBlock);
     // fprintf (file, "%s = %d", "FRAME_INDEX ", f->frameIndex);
     // to shut up the C compilers
     //fprintf (file, "  %s", "return 0;\n");
-    fprintf(file, "%s", "}\n\n");
+    File_write(file, "}\n\n");
     return;
 }
 
@@ -448,17 +469,17 @@ static Machine_Prog_t C_codegenTraced(Machine_Prog_t p) {
     //    List_t layouts;
 
     assert(p);
-    fprintf(file, "%s", COMMENT("header files:\n"));
-    fprintf(file, "%s", "extern long printi(long);\n\n");
+    File_write(file, COMMENT("header files:\n"));
+    File_write(file, "extern long printi(long);\n\n");
 
-    fprintf(file, "%s", COMMENT("headers:"));
+    File_write(file, COMMENT("headers:"));
     outputHeaders();
-    fprintf(file, "%s", "\n\n");
+    File_write(file, "\n\n");
 
 
-    fprintf(file, "%s", COMMENT("strings:"));
+    File_write(file, COMMENT("strings:"));
     outputStrings(p->strings);
-    fprintf(file, "%s", "\n\n");
+    File_write(file, "\n\n");
 
 #if 0
 
@@ -524,7 +545,7 @@ static Machine_Prog_t C_codegenTraced(Machine_Prog_t p) {
     fprintf(file, "%s", "};\n");
 #endif
 
-    fprintf(file, "%s", COMMENT("functions:"));
+    File_write(file, COMMENT("functions:"));
     List_foreach(p->funcs, (Poly_tyVoid) outputFunction);
 
     return p;
@@ -23,9 +23,21 @@ typedef enum {
 /*        all functions */
 
 static void Arg_setBuffer(long i) {
+    if (i < 1)
+        errorWrongArg("-buffer", "<n>", Int_toString(i));
     Control_bufferSize = i;
 }
 
+static void Arg_setCache(String_t s) {
+    Control_cache = s;
+}
+
+static void Arg_setCacheSize(long i) {
+    if (i < 0)
+        errorWrongArg("-cache-size", "<n>", Int_toString(i));
+    Control_cacheSize = i;
+}
+
 static void Arg_setDropPass(String_t s) {
     Control_dropPass_insert(s);
 }
@@ -60,6 +72,10 @@ static void Arg_setExpert(long b) {
     Control_expert = b ? EXPERT_EXPERT : EXPERT_NORMAL;
 }
 
+static void Arg_setFlushThread(long b) {
+    Control_flushThread = b;
+}
+
 static void Arg_setJpg(long b) {
     Control_jpg = b;
 }
@@ -82,16 +98,53 @@ static void Arg_setS(void *arg) {
     Control_dump_insert(DUMP_X86);
 }
 
+static void Arg_setPipe(long b) {
+    Control_pipe = b;
+}
+
+static void Arg_setProfile(String_t s) {
+    Control_profile = s;
+}
+
+static void Arg_setReadIr(long b) {
+    Control_readIr = b;
+}
+
+static void Arg_setRuntime(String_t s) {
+    Control_runtime = s;
+}
+
 static void Arg_setShowType(void *arg) {
     UNUSED(arg);
 
     Control_showType = 1;
 }
 
+static void Arg_setJobs(long i) {
+    if (i < 0)
+        errorWrongArg("-j", "<n>", Int_toString(i));
+    Control_jobs = i;
+}
+
+static void Arg_setThreads(long i) {
+    if (i < 0)
+        errorWrongArg("-threads", "<n>", Int_toString(i));
+    Control_threads = i;
+}
+
 static void Arg_setTrace(String_t s) {
     Trace_insert(s);
 }
 
+static void Arg_setWriteIr(String_t s) {
+    if (String_equals(s, "ssa"))
+        Control_writeIr = WRITE_IR_SSA;
+    else if (String_equals(s, "machine"))
+        Control_writeIr = WRITE_IR_MACHINE;
+    else
+        errorWrongArg("-write-ir", "{ssa|machine}", s);
+}
+
 static void Arg_setVerbose(long i) {
     switch (i) {
         case 0:
@@ -139,6 +192,18 @@ static struct Arg_t allArgs[] = {
          "set output buffer size for file (n M)",
          ARGTYPE_INT,
          (TyArg) Arg_setBuffer},
+        {EXPERT_NORMAL,
+         "cache",
+         "<dir>",
+         "cache compiled files in this directory",
+         ARGTYPE_STRING,
+         (TyArg) Arg_setCache},
+        {EXPERT_NORMAL,
+         "cache-size",
+         "<n>",
+         "keep the cache under n M",
+         ARGTYPE_INT,
+         (TyArg) Arg_setCacheSize},
         {EXPERT_NORMAL, "codegen", "{C|x86}", "which code generator to use", ARGTYPE_STRING, (TyArg) Arg_setCodegen},
         {EXPERT_NORMAL,
          "drop-pass",
@@ -159,6 +224,18 @@ static struct Arg_t allArgs[] = {
          "show expert level switches",
          ARGTYPE_BOOL,
          (TyArg) Arg_setExpert},
+        {EXPERT_EXPERT,
+         "flush-thread",
+         "{false|true}",
+         "write output files on a thread of their own",
+         ARGTYPE_BOOL,
+         (TyArg) Arg_setFlushThread},
+        {EXPERT_NORMAL,
+         "j",
+         "<n>",
+         "compile n files at a time (0 for one per core)",
+         ARGTYPE_INT,
+         (TyArg) Arg_setJobs},
         {EXPERT_NORMAL,
          "jpg",
          "{flase|true}",
@@ -183,6 +260,30 @@ static struct Arg_t allArgs[] = {
          "set the output file name",
          ARGTYPE_STRING,
          (TyArg) Arg_setO},
+        {EXPERT_NORMAL,
+         "pipe",
+         "{false|true}",
+         "pipe the generated C into gcc, with no files",
+         ARGTYPE_BOOL,
+         (TyArg) Arg_setPipe},
+        {EXPERT_NORMAL,
+         "profile",
+         "<file>",
+         "profile the passes into a Chrome trace file",
+         ARGTYPE_STRING,
+         (TyArg) Arg_setProfile},
+        {EXPERT_EXPERT,
+         "read-ir",
+         "{false|true}",
+         "read input files as binary IR (see -write-ir)",
+         ARGTYPE_BOOL,
+         (TyArg) Arg_setReadIr},
+        {EXPERT_NORMAL,
+         "runtime",
+         "<lib>",
+         "link with this prebuilt runtime library",
+         ARGTYPE_STRING,
+         (TyArg) Arg_setRuntime},
         {EXPERT_NORMAL,
          "S",
          "",
@@ -195,6 +296,12 @@ static struct Arg_t allArgs[] = {
          "show type information when dumping ILs",
          ARGTYPE_BOOL,
          (TyArg) Arg_setShowType},
+        {EXPERT_NORMAL,
+         "threads",
+         "<n>",
+         "optimize on n threads (0 for one per core)",
+         ARGTYPE_INT,
+         (TyArg) Arg_setThreads},
         {EXPERT_EXPERT,
          "trace",
          "<name>",
@@ -207,6 +314,12 @@ static struct Arg_t allArgs[] = {
          "how verbose to be",
          ARGTYPE_INT,
          (TyArg) Arg_setVerbose},
+        {EXPERT_EXPERT,
+         "write-ir",
+         "{ssa|machine}",
+         "write this IR in binary, to <file>.<ir>.ir",
+         ARGTYPE_STRING,
+         (TyArg) Arg_setWriteIr},
         {EXPERT_NORMAL,
          0,
          0,
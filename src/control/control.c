@@ -7,6 +7,7 @@
 String_t Control_asmDirectory = "./";
 String_t Control_libDirectory = "./";
 String_t Control_headerDirectory = "./";
+long Control_fileIndex = 0;
 
 typedef struct Flag_t *Flag_t;
 
@@ -17,28 +18,41 @@ struct Flag_t {
     Tuple_t (*toString)(void);
 
     void (*reset)(void);
+
+    // whether it changes the generated code
+    int code;
 };
 
 static Flag_t Flag_new(String_t name,
                        Tuple_t (*toString)(void),
-                       void (*reset)(void)) {
+                       void (*reset)(void),
+                       int code) {
     Flag_t f;
 
     Mem_NEW(f);
     f->name = name;
     f->toString = toString;
     f->reset = reset;
+    f->code = code;
     return f;
 }
 
-static struct List_t allFlagsHead = {0, 0};
-static List_t allFlags = &allFlagsHead;
+static struct List_Head_t allFlagsHead = {{0, 0}, 0};
+static List_t allFlags = &allFlagsHead.node;
 
 #define Flag_add(name, f)                 \
     List_insertLast(allFlags,             \
                     Flag_new(name,        \
                              f##ToString, \
-                             f##Reset))
+                             f##Reset,    \
+                             0))
+
+#define Flag_addCode(name, f)             \
+    List_insertLast(allFlags,             \
+                    Flag_new(name,        \
+                             f##ToString, \
+                             f##Reset,    \
+                             1))
 
 /* buffer size */
 long Control_bufferSize = 16;
@@ -53,6 +67,32 @@ static void Control_bufferSizeReset(void) {
     Control_bufferSize = Control_bufferSizeDefault;
 }
 
+/* cache */
+String_t Control_cache = 0;
+static String_t Control_cacheDefault = 0;
+
+static Tuple_t Control_cacheToString(void) {
+    return Tuple_new((Control_cache) ? Control_cache : "\"\"",
+                     "\"\"");
+}
+
+static void Control_cacheReset(void) {
+    Control_cache = Control_cacheDefault;
+}
+
+/* cache size */
+long Control_cacheSize = 256;
+long Control_cacheSizeDefault = 256;
+
+static Tuple_t Control_cacheSizeToString(void) {
+    return Tuple_new(Int_toString(Control_cacheSize),
+                     Int_toString(Control_cacheSizeDefault));
+}
+
+static void Control_cacheSizeReset(void) {
+    Control_cacheSize = Control_cacheSizeDefault;
+}
+
 /* code gen */
 Codegen_t Control_codegen = CODEGEN_C;
 static Codegen_t Control_codegenDefault = CODEGEN_C;
@@ -67,8 +107,8 @@ static void Control_codegenReset(void) {
 
 ////////////////////////////////////////////////////
 /* drop pass */
-static struct List_t head = {0, 0};
-static List_t Control_dropPass = &head;
+static struct List_Head_t head = {{0, 0}, 0};
+static List_t Control_dropPass = &head.node;
 static List_t Control_dropPassDefault = 0;
 
 static Tuple_t Control_dropPassToString(void) {
@@ -177,6 +217,20 @@ static void Control_expertReset(void) {
     Control_expert = Control_expertDefault;
 }
 
+//////////////////////////////////////////////////////
+// flush thread
+long Control_flushThread = 0;
+long Control_flushThreadDefault = 0;
+
+static Tuple_t Control_flushThreadToString(void) {
+    return Tuple_new(Control_flushThread ? "true" : "false",
+                     "false");
+}
+
+static void Control_flushThreadReset(void) {
+    Control_flushThread = Control_flushThreadDefault;
+}
+
 /////////////////////////////////////////////////////
 // label info
 long Control_labelInfo = 0;
@@ -195,8 +249,8 @@ static void Control_labelInfoReset(void) {
 
 //////////////////////////////////////////////////////
 // log pass
-static struct List_t logPassHead = {0, 0};
-static List_t Control_logPasses = &logPassHead;
+static struct List_Head_t logPassHead = {{0, 0}, 0};
+static List_t Control_logPasses = &logPassHead.node;
 static List_t Control_logPassDefault = 0;
 
 static Tuple_t Control_logPassToString(void) {
@@ -239,8 +293,8 @@ static void Control_oReset(void) {
 
 /////////////////////////////////////////////////////
 // target-size
-int Control_Target_size = 4;
-//static int Control_Target_sizeDefault = 4;
+int Control_Target_size = 8;
+//static int Control_Target_sizeDefault = 8;
 //
 //static Tuple_t Control_Target_sizeToString() {
 //    return Tuple_new(Int_toString(Control_Target_size), Int_toString(Control_Target_sizeDefault));
@@ -250,6 +304,68 @@ int Control_Target_size = 4;
 //    Control_Target_size = Control_Target_sizeDefault;
 //}
 
+//////////////////////////////////////////////////////
+// pipe
+long Control_pipe = 0;
+long Control_pipeDefault = 0;
+
+static Tuple_t Control_pipeToString(void) {
+    return Tuple_new(Control_pipe ? "true" : "false",
+                     "false");
+}
+
+static void Control_pipeReset(void) {
+    Control_pipe = Control_pipeDefault;
+}
+
+//////////////////////////////////////////////////////
+// profile
+String_t Control_profile = 0;
+static String_t Control_profileDefault = 0;
+
+static Tuple_t Control_profileToString(void) {
+    return Tuple_new((Control_profile) ? Control_profile : "\"\"",
+                     "\"\"");
+}
+
+static void Control_profileReset(void) {
+    Control_profile = Control_profileDefault;
+}
+
+//////////////////////////////////////////////////////
+// read IR
+long Control_readIr = 0;
+long Control_readIrDefault = 0;
+
+static Tuple_t Control_readIrToString(void) {
+    return Tuple_new(Control_readIr ? "true" : "false",
+                     "false");
+}
+
+static void Control_readIrReset(void) {
+    Control_readIr = Control_readIrDefault;
+}
+
+//////////////////////////////////////////////////////
+// runtime
+// the build passes the library it makes along with dragon
+#ifdef DRAGON_RUNTIME
+String_t Control_runtime = DRAGON_RUNTIME;
+static String_t Control_runtimeDefault = DRAGON_RUNTIME;
+#else
+String_t Control_runtime = 0;
+static String_t Control_runtimeDefault = 0;
+#endif
+
+static Tuple_t Control_runtimeToString(void) {
+    return Tuple_new((Control_runtime) ? Control_runtime : "\"\"",
+                     (Control_runtimeDefault) ? Control_runtimeDefault : "\"\"");
+}
+
+static void Control_runtimeReset(void) {
+    Control_runtime = Control_runtimeDefault;
+}
+
 ////////////////////////////////////////////////////////
 /* show type */
 long Control_showType = 0;
@@ -264,6 +380,20 @@ static void Control_showTypeReset(void) {
     Control_showType = Control_showTypeDefault;
 }
 
+////////////////////////////////////////////////////////
+// jobs
+long Control_jobs = 1;
+long Control_jobsDefault = 1;
+
+static Tuple_t Control_jobsToString(void) {
+    return Tuple_new(Int_toString(Control_jobs),
+                     Int_toString(Control_jobsDefault));
+}
+
+static void Control_jobsReset(void) {
+    Control_jobs = Control_jobsDefault;
+}
+
 ////////////////////////////////////////////////////////
 // keep jpg files
 long Control_jpg = 0;
@@ -278,6 +408,20 @@ static void Control_jpgReset(void) {
     Control_jpg = Control_jpgDefault;
 }
 
+////////////////////////////////////////////////////////
+// threads
+long Control_threads = 0;
+long Control_threadsDefault = 0;
+
+static Tuple_t Control_threadsToString(void) {
+    return Tuple_new(Int_toString(Control_threads),
+                     Int_toString(Control_threadsDefault));
+}
+
+static void Control_threadsReset(void) {
+    Control_threads = Control_threadsDefault;
+}
+
 ////////////////////////////////////////////////////////
 /* trace */
 List_t Control_trace = 0;
@@ -326,23 +470,71 @@ static void Control_verboseReset(void) {
     Control_verbose = Control_verboseDefault;
 }
 
+//////////////////////////////////////////////////////
+// write IR
+WriteIr_t Control_writeIr = WRITE_IR_NONE;
+WriteIr_t Control_writeIrDefault = WRITE_IR_NONE;
+
+static Tuple_t Control_writeIrToString(void) {
+    switch (Control_writeIr) {
+        case WRITE_IR_SSA:
+            return Tuple_new("ssa", "\"\"");
+        case WRITE_IR_MACHINE:
+            return Tuple_new("machine", "\"\"");
+        default:
+            return Tuple_new("\"\"", "\"\"");
+    }
+}
+
+static void Control_writeIrReset(void) {
+    Control_writeIr = Control_writeIrDefault;
+}
+
 int Control_Verb_order(Verbose_t l1, Verbose_t l2) {
     return l1 <= l2;
 }
 
 void Control_init(void) {
     Flag_add("bufferSize flag: ", Control_bufferSize);
-    Flag_add("code gen: ", Control_codegen);
-    Flag_add("drop pass flag: ", Control_dropPass);
+    Flag_add("cache flag: ", Control_cache);
+    Flag_add("cache size flag: ", Control_cacheSize);
+    Flag_addCode("code gen: ", Control_codegen);
+    Flag_addCode("drop pass flag: ", Control_dropPass);
     Flag_add("dump flag: ", Control_dump);
     Flag_add("expert flag: ", Control_expert);
+    Flag_add("flush thread flag: ", Control_flushThread);
+    Flag_add("jobs flag: ", Control_jobs);
     Flag_add("jpg flag: ", Control_jpg);
-    Flag_add("labelInfo flag: ", Control_labelInfo);
+    Flag_addCode("labelInfo flag: ", Control_labelInfo);
     Flag_add("logPass flag: ", Control_logPass);
     Flag_add("output name flag: ", Control_o);
+    Flag_addCode("pipe flag: ", Control_pipe);
+    Flag_add("profile flag: ", Control_profile);
+    Flag_add("read IR flag: ", Control_readIr);
+    Flag_add("runtime flag: ", Control_runtime);
     Flag_add("show type flag: ", Control_showType);
+    Flag_add("threads flag: ", Control_threads);
     Flag_add("trace flag: ", Control_trace);
     Flag_add("verbose flag: ", Control_verbose);
+    Flag_add("write IR flag: ", Control_writeIr);
+}
+
+String_t Control_codeFlagsToString(void) {
+    List_t p = List_getFirst(allFlags);
+    String_t s = "";
+    Flag_t f;
+
+    while (p) {
+        f = (Flag_t) p->data;
+        if (f->code)
+            s = String_concat(s,
+                              f->name,
+                              (String_t) Tuple_first(f->toString()),
+                              "\n",
+                              0);
+        p = p->next;
+    }
+    return s;
 }
 
 void Control_printFlags(void) {
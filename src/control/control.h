@@ -30,15 +30,43 @@ typedef enum {
     CODEGEN_X86
 } Codegen_t;
 
+typedef enum {
+    WRITE_IR_NONE,
+    WRITE_IR_SSA,
+    WRITE_IR_MACHINE
+} WriteIr_t;
+
+// the output buffer of files, in megabytes
 extern long Control_bufferSize;
+// the directory to cache compiled files in, 0 for none
+extern String_t Control_cache;
+// the size of the cache, in megabytes
+extern long Control_cacheSize;
 extern Codegen_t Control_codegen;
 extern Expert_t Control_expert;
+// write output files on a thread of their own
+extern long Control_flushThread;
+// number of files to compile at a time, 0 for one per core
+extern long Control_jobs;
 extern long Control_labelInfo;
 // show type information in ILs
+// pipe the generated C into gcc, and take the object
+extern long Control_pipe;
+// the file to write the pass profile to, 0 for none
+extern String_t Control_profile;
+// the input files are binary IR, not source
+extern long Control_readIr;
+// the prebuilt runtime library, 0 to compile the runtime
+// from source at each link
+extern String_t Control_runtime;
 extern long Control_showType;
+// number of threads, 0 for one per core
+extern long Control_threads;
 extern List_t Control_trace;
 extern Verbose_t Control_verbose;
 extern String_t Control_out_file_name;
+// which IR to also write in binary
+extern WriteIr_t Control_writeIr;
 
 // keep jpg, should be a more
 extern long Control_jpg;
@@ -49,6 +77,9 @@ extern long Control_jpg;
 extern String_t Control_asmDirectory;
 extern String_t Control_libDirectory;
 extern String_t Control_headerDirectory;
+// the index of the file being compiled, which numbers
+// its output files
+extern long Control_fileIndex;
 
 int Control_Verb_order(Verbose_t v1, Verbose_t v2);
 void Control_dump_insert(Dump_t);
@@ -66,6 +97,9 @@ extern int Control_Target_size;
 //
 void Control_init(void);
 void Control_printFlags(void);
+// the current settings of the flags that change the
+// generated code, one per line
+String_t Control_codeFlagsToString(void);
 
 
 #endif
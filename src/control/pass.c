@@ -2,29 +2,66 @@
 #include "verbose.h"
 #include "log.h"
 #include "pass.h"
+#include "profile.h"
+#include "../lib/thread.h"
 
 Pass_t Pass_new(String_t name, Verbose_t level, Poly_t thunk, Poly_t (*a)(Poly_t)) {
-    Pass_t x = {name, level, thunk, a};
+    Pass_t x = {name, level, thunk, a, 0, 0};
     return x;
 }
 
+Pass_t Pass_newIr(String_t name, Verbose_t level, Poly_t thunk, Poly_t (*a)(Poly_t), Pass_tySize in, Pass_tySize out) {
+    Pass_t x = {name, level, thunk, a, in, out};
+    return x;
+}
+
+static Profile_Event_t enter(Pass_t *p) {
+    long size[3];
+
+    if (!p->sizeIn)
+        return Profile_enter(p->name, 0);
+    p->sizeIn(p->thunk, &size[0], &size[1], &size[2]);
+    return Profile_enter(p->name, size);
+}
+
+static void leave(Pass_t *p, Profile_Event_t e, Poly_t r) {
+    long size[3];
+
+    if (!p->sizeOut) {
+        Profile_leave(e, 0);
+        return;
+    }
+    p->sizeOut(r, &size[0], &size[1], &size[2]);
+    Profile_leave(e, size);
+}
+
 Poly_t Pass_doit(Pass_t *p) {
     Poly_t r;
+    long threads = 0;
+    Profile_Event_t event = 0;
 
     // if this pass is to be dropped, then do nothing
     if (Control_mayDropPass(p->name))
         return p->thunk;
 
-    // if this pass is to be logged, then do this
+    // if this pass is to be logged, then do this, on one
+    // thread, to keep the log in order
     if (Control_logPass(p->name)) {
         Log_set(p->name);
+        threads = Thread_setNum(1);
     }
 
+    if (Control_profile)
+        event = enter(p);
     Verbose_TRACE (p->name, p->action, (p->thunk), r, p->level);
+    if (event)
+        leave(p, event, r);
 
     // reset the log
-    if (Control_logPass(p->name))
+    if (Control_logPass(p->name)) {
         Log_reset();
+        Thread_setNum(threads);
+    }
 
     return r;
 }
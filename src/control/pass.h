@@ -5,14 +5,23 @@
 #include "../lib/poly.h"
 #include "control.h"
 
+// the numbers of functions, blocks and statements in an
+// IR program (e.g., "Ssa_Prog_size")
+typedef void (*Pass_tySize)(Poly_t, long *funcs, long *blocks, long *stms);
+
 typedef struct {
     String_t name;      // name of a compilation pass
     Verbose_t level;    // at what level to see
     Poly_t thunk;       // argument to this pass
     Poly_t (*action)(Poly_t);  // actions.
+    Pass_tySize sizeIn;  // size of the argument, for profiling
+    Pass_tySize sizeOut; // size of the result, for profiling
 } Pass_t;
 
 Pass_t Pass_new(String_t, Verbose_t, Poly_t, Poly_t (*)(Poly_t));
+// a pass over IR programs whose sizes are known, either
+// of which may be 0
+Pass_t Pass_newIr(String_t, Verbose_t, Poly_t, Poly_t (*)(Poly_t), Pass_tySize in, Pass_tySize out);
 
 Poly_t Pass_doit(Pass_t *pass);
 
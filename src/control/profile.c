@@ -0,0 +1,254 @@
+#include "profile.h"
+#include "control.h"
+#include "../lib/error.h"
+#include "../lib/hash.h"
+#include "../lib/int.h"
+#include "../lib/list.h"
+#include "../lib/mem.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <unistd.h>
+
+#define T Profile_Event_t
+
+struct T {
+    String_t name;
+    // in microseconds, since "origin"
+    double start;
+    double end;
+    long alloc;
+    // in KB
+    long maxRss;
+    // functions, blocks and statements; -1 if not known
+    long in[3];
+    long out[3];
+    long pid;
+};
+
+// List<T>, in the order the passes finish
+static List_t events = 0;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static double origin = 0;
+
+static double now(void) {
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (double) t.tv_sec * 1e6 + (double) t.tv_nsec / 1e3;
+}
+
+static long maxRss(void) {
+    struct rusage r;
+
+    getrusage(RUSAGE_SELF, &r);
+    return r.ru_maxrss;
+}
+
+static void setSize(long *to, long *from) {
+    for (int i = 0; i < 3; i++)
+        to[i] = (from) ? from[i] : -1;
+}
+
+// the records outlive the arenas of the passes
+static T newEvent(void) {
+    T e;
+
+    Mem_NEW_IN(e, MEM_ARENA_GLOBAL);
+    return e;
+}
+
+static void insert(T e) {
+    Mem_Arena_t old;
+
+    pthread_mutex_lock(&lock);
+    old = Mem_Arena_enter(MEM_ARENA_GLOBAL);
+    if (!events)
+        events = List_new();
+    List_insertLast(events, e);
+    Mem_Arena_enter(old);
+    pthread_mutex_unlock(&lock);
+}
+
+void Profile_init(void) {
+    origin = now();
+}
+
+T Profile_enter(String_t name, long *size) {
+    T e = newEvent();
+
+    e->name = name;
+    setSize(e->in, size);
+    e->alloc = Mem_total();
+    e->start = now() - origin;
+    return e;
+}
+
+void Profile_leave(T e, long *size) {
+    e->end = now() - origin;
+    e->alloc = Mem_total() - e->alloc;
+    e->maxRss = maxRss();
+    setSize(e->out, size);
+    e->pid = getpid();
+    insert(e);
+}
+
+void Profile_clear(void) {
+    events = 0;
+}
+
+//////////////////////////////////////////////////////
+// between processes, one record per line
+#define OUT "%.0f\t%.0f\t%ld\t%ld\t%ld %ld %ld\t%ld %ld %ld\t%ld\t"
+#define IN "%lf\t%lf\t%ld\t%ld\t%ld %ld %ld\t%ld %ld %ld\t%ld\t"
+
+String_t Profile_export(void) {
+    String_t s = "";
+    char buf[256];
+    List_t p;
+
+    for (p = (events) ? List_getFirst(events) : 0; p; p = p->next) {
+        T e = p->data;
+
+        snprintf(buf, sizeof(buf), OUT,
+                 e->start, e->end, e->alloc, e->maxRss,
+                 e->in[0], e->in[1], e->in[2],
+                 e->out[0], e->out[1], e->out[2],
+                 e->pid);
+        s = String_concat(s, buf, e->name, "\n", 0);
+    }
+    return s;
+}
+
+void Profile_import(String_t s) {
+    char name[128];
+    int n;
+
+    while (*s) {
+        T e = newEvent();
+
+        if (sscanf(s, IN "%127[^\n]\n%n",
+                   &e->start, &e->end, &e->alloc, &e->maxRss,
+                   &e->in[0], &e->in[1], &e->in[2],
+                   &e->out[0], &e->out[1], &e->out[2],
+                   &e->pid, name, &n)
+            != 12)
+            Error_impossible();
+        e->name = Mem_allocIn(MEM_ARENA_GLOBAL, (long) strlen(name) + 1);
+        strcpy(e->name, name);
+        insert(e);
+        s += n;
+    }
+}
+
+#undef OUT
+#undef IN
+
+//////////////////////////////////////////////////////
+// output
+static void printSize(FILE *file, String_t what, long *size) {
+    if (size[0] < 0)
+        return;
+    fprintf(file, ", \"funcs%s\": %ld, \"blocks%s\": %ld, \"stms%s\": %ld",
+            what, size[0], what, size[1], what, size[2]);
+}
+
+static void saveTrace(void) {
+    FILE *file;
+    List_t p;
+
+    file = fopen(Control_profile, "w");
+    if (!file)
+        Error_error2("fail to open file:", Control_profile);
+    fprintf(file, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+    for (p = List_getFirst(events); p; p = p->next) {
+        T e = p->data;
+
+        // pass names have no characters to escape
+        fprintf(file,
+                "{\"name\": \"%s\", \"cat\": \"pass\", \"ph\": \"X\", "
+                "\"ts\": %.0f, \"dur\": %.0f, \"pid\": %ld, \"tid\": %ld, "
+                "\"args\": {\"alloc\": %ld, \"maxRss\": %ld",
+                e->name, e->start, e->end - e->start, e->pid, e->pid,
+                e->alloc, e->maxRss * 1024);
+        printSize(file, "In", e->in);
+        printSize(file, "Out", e->out);
+        fprintf(file, "}}%s\n", (p->next) ? "," : "");
+    }
+    fprintf(file, "]}\n");
+    fclose(file);
+}
+
+// the totals of a pass over all its runs
+typedef struct {
+    String_t name;
+    long calls;
+    double time;
+    long alloc;
+    long maxRss;
+    long stmsIn;
+    long stmsOut;
+} *Sum_t;
+
+// "-1" for not known
+static void addSize(long *sum, long n) {
+    if (n < 0)
+        return;
+    *sum = (*sum < 0) ? n : *sum + n;
+}
+
+static String_t sizeToString(long n) {
+    return (n < 0) ? "-" : Int_toString(n);
+}
+
+static void printSummary(void) {
+    Hash_t table;
+    List_t sums, p;
+    Sum_t sum;
+
+    table = Hash_new((tyHashCode) String_hashCode, (Poly_tyEquals) String_equals, 0);
+    sums = List_new();
+    for (p = List_getFirst(events); p; p = p->next) {
+        T e = p->data;
+
+        sum = Hash_lookup(table, e->name);
+        if (!sum) {
+            Mem_NEW(sum);
+            sum->name = e->name;
+            sum->calls = sum->alloc = sum->maxRss = 0;
+            sum->stmsIn = sum->stmsOut = -1;
+            sum->time = 0;
+            Hash_insert(table, e->name, sum);
+            List_insertLast(sums, sum);
+        }
+        sum->calls++;
+        sum->time += e->end - e->start;
+        sum->alloc += e->alloc;
+        if (e->maxRss > sum->maxRss)
+            sum->maxRss = e->maxRss;
+        addSize(&sum->stmsIn, e->in[2]);
+        addSize(&sum->stmsOut, e->out[2]);
+    }
+
+    printf("Pass profile (in %s):\n", Control_profile);
+    printf("  %-26s %6s %10s %10s %10s %9s %9s\n",
+           "pass", "calls", "time(ms)", "alloc(K)", "maxRss(K)", "stms in", "stms out");
+    for (p = List_getFirst(sums); p; p = p->next) {
+        sum = p->data;
+        printf("  %-26s %6ld %10.3f %10ld %10ld %9s %9s\n",
+               sum->name, sum->calls, sum->time / 1e3,
+               sum->alloc / 1024, sum->maxRss,
+               sizeToString(sum->stmsIn), sizeToString(sum->stmsOut));
+    }
+}
+
+void Profile_save(void) {
+    if (!events)
+        return;
+    saveTrace();
+    printSummary();
+}
+
+#undef T
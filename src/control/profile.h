@@ -0,0 +1,40 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include "../lib/string.h"
+
+// With "-profile <file>", every pass run by "Pass_doit"
+// is recorded: its wall time, the bytes it allocated, the
+// peak resident size of the compiler when it finished,
+// and, for the passes over SSA and machine IR, the sizes
+// of the IR it took and gave (functions, blocks and
+// statements). At exit, the records go to <file> as a
+// Chrome trace ("chrome://tracing", or Perfetto), and a
+// summary per pass is printed.
+
+#define T Profile_Event_t
+
+typedef struct T *T;
+
+// start the clock all times are relative to
+void Profile_init(void);
+
+// "size" is 0, or the numbers of functions, blocks and
+// statements of the input
+T Profile_enter(String_t name, long *size);
+// "size" as above, for the output
+void Profile_leave(T e, long *size);
+
+// forget the records so far (e.g., those a child
+// process inherits)
+void Profile_clear(void);
+// the records of this process, as text for another one
+// to import
+String_t Profile_export(void);
+void Profile_import(String_t s);
+
+void Profile_save(void);
+
+#undef T
+
+#endif
@@ -9,14 +9,14 @@
 #define Verbose_TRACE(s, f, x, r, level)                                  \
     do {                                                                  \
         clock_t start = clock(), finish = clock();                        \
-        clock_t gcStart = clock(), gcFinish = clock();                    \
+        long allocStart = 0;                                              \
         int exists = Control_Verb_order(level, Control_verbose);          \
         if (exists) {                                                     \
             Trace_spaces();                                               \
             printf("%s starting\n", s);                                   \
             Trace_indent();                                               \
             start = clock();                                              \
-            gcStart = Mem_getClock();                                     \
+            allocStart = Mem_total();                                     \
         }                                                                 \
         r = f x;                                                          \
         if (exists) {                                                     \
@@ -24,11 +24,10 @@
             Trace_spaces();                                               \
             printf("%s finished", s);                                     \
             finish = clock();                                             \
-            gcFinish = Mem_getClock();                                    \
             if (Control_Verb_order(VERBOSE_DETAIL, Control_verbose)) {    \
-                printf("  @time: %.3lf (GC: %.3lf)",                      \
+                printf("  @time: %.3lf (alloc: %ldK)",                    \
                        ((double) (finish - start)) / CLOCKS_PER_SEC,      \
-                       ((double) (gcFinish - gcStart)) / CLOCKS_PER_SEC); \
+                       (Mem_total() - allocStart) / 1024);                \
             }                                                             \
             printf("\n");                                                 \
         }                                                                 \
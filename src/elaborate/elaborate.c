@@ -10,6 +10,7 @@
 #include "env.h"
 #include "type.h"
 #include <assert.h>
+#include <string.h>
 
 static void error(String_t, Region_t);
 
@@ -155,9 +156,24 @@ static struct Exp_Result_t Elab_exp(E e) {
             Type_t tint = Type_new_int();
 
             r1 = Elab_exp(e->u.bop.left);
-            checkType(tint, r1.type, e->region);
             r2 = Elab_exp(e->u.bop.right);
-            checkType(tint, r2.type, e->region);
+            // "==" and "!=" also compare references, and
+            // "null" with any of them
+            if (strcmp(e->u.bop.bop, "==") == 0 || strcmp(e->u.bop.bop, "!=") == 0) {
+                Type_t ty1 = r1.type, ty2 = r2.type;
+
+                if (ty1->kind == TYPE_A_STRING || ty2->kind == TYPE_A_STRING)
+                    error("string type can not be compared", e->region);
+                else if (ty1->kind == TYPE_A_NS && ty2->kind == TYPE_A_NS)
+                    ;
+                else if (ty1->kind == TYPE_A_NS)
+                    checkType(ty2, ty1, e->region);
+                else
+                    checkType(ty1, ty2, e->region);
+            } else {
+                checkType(tint, r1.type, e->region);
+                checkType(tint, r2.type, e->region);
+            }
             result.exp = Ast_Exp_new_bop(e->u.bop.bop,
                                          r1.exp,
                                          r2.exp,
@@ -444,6 +460,10 @@ static Ast_Dec_t Elab_dec(Ast_Dec_t t) {
         Type_t ety = r.type;
         newInit = r.exp;
         checkType(ty, ety, AstId_getRegion(t->var));
+        // "null" takes the declared type, as the initialization
+        // is later rewritten into an assignment of this type
+        if (ety->kind == TYPE_A_NS)
+            newInit->ty = ty;
     }
     return Ast_Dec_new(newty, newName, newInit);
 }
@@ -3,6 +3,7 @@
 #include "../lib/app-list.h"
 #include "../lib/error.h"
 #include "../lib/list.h"
+#include "../lib/mem.h"
 #include "../lib/property.h"
 #include "../lib/stack.h"
 #include "../lib/string.h"
@@ -516,8 +517,15 @@ static Class_t Elab_classEach(Ast_Class_t c) {
     return Class_new(AstId_toId(c->name), List_map(c->fields, (Poly_tyId) Elab_dec));
 }
 
+// classes are referenced by every later IR, so they are
+// built in the global arena.
 static List_t Elab_classes(List_t classes) {
-    return List_map(classes, (Poly_tyId) Elab_classEach);
+    List_t newClasses;
+    Mem_Arena_t old = Mem_Arena_enter(MEM_ARENA_GLOBAL);
+
+    newClasses = List_map(classes, (Poly_tyId) Elab_classEach);
+    Mem_Arena_enter(old);
+    return newClasses;
 }
 
 /////////////////////////////////////////////////////////
@@ -3,6 +3,7 @@
 #include "../lib/int.h"
 #include "../lib/mem.h"
 #include <assert.h>
+#include <string.h>
 
 #define E Hil_Exp_t
 #define F Hil_Fun_t
@@ -95,7 +96,8 @@ E Hil_Exp_new_unary(String_t op, E x, Atype_t ty) {
     Mem_NEW(e);
     e->kind = HIL_EXP_UOP;
     e->u.unary.e = x;
-    e->u.unary.op = Operator_fromString(op);
+    // the unary "-" is not the binary one
+    e->u.unary.op = (strcmp(op, "!") == 0) ? OP_NOT : OP_NEG;
     e->ty = ty;
     return e;
 }
@@ -8,6 +8,7 @@
 #include "../lib/property.h"
 #include "../lib/trace.h"
 #include "../lib/unused.h"
+#include "../lib/vector.h"
 #include <assert.h>
 
 //////////////////////////////////////////////////////
@@ -51,7 +52,7 @@ static Property_t labelInfoProp = 0;
 
 static void LabelInfo_init(void) {
     if (Control_labelInfo)
-        labelInfoProp = Property_new((Poly_tyPlist) Label_plist);
+        labelInfoProp = Property_new((Poly_tyIndex) Label_index);
 }
 
 static void LabelInfo_clear(void) {
@@ -98,8 +99,8 @@ typedef struct {
     } u;
 } *Cache_Data_t;
 
-// List<Cache_Data_t>
-static List_t caches = 0;
+// Vector<Cache_Data_t>
+static Vector_t caches = 0;
 
 static void emitLabel(Label_t s) {
     Cache_Data_t p;
@@ -107,7 +108,7 @@ static void emitLabel(Label_t s) {
     Mem_NEW(p);
     p->kind = LABEL;
     p->u.label = s;
-    List_insertLast(caches, p);
+    Vector_insertLast(caches, p);
 }
 
 static void emitStm(Ssa_Stm_t s) {
@@ -116,7 +117,7 @@ static void emitStm(Ssa_Stm_t s) {
     Mem_NEW(p);
     p->kind = STM;
     p->u.stm = s;
-    List_insertLast(caches, p);
+    Vector_insertLast(caches, p);
 }
 
 static void emitTrans(Ssa_Transfer_t s) {
@@ -125,7 +126,7 @@ static void emitTrans(Ssa_Transfer_t s) {
     Mem_NEW(p);
     p->kind = TRANS;
     p->u.trans = s;
-    List_insertLast(caches, p);
+    Vector_insertLast(caches, p);
 }
 
 //static List_t getBeforeClear() {
@@ -137,7 +138,7 @@ static void emitTrans(Ssa_Transfer_t s) {
 static void Cache_log(void) {
     assert(caches);
 
-    List_t p = List_getFirst(caches);
+    List_t p = Vector_getFirst(caches);
     while (p) {
         Cache_Data_t data = (Cache_Data_t) p->data;
 
@@ -544,9 +545,10 @@ static void Trans_stm(Hil_Stm_t s) {
             emitTrans(Ssa_Transfer_new_throw());
             return;
         }
+        // leave the "try", and go to its handler
         case HIL_STM_LOCALTHROW: {
             emitStm(Ssa_Stm_new_try_end(s->u.localThrow));
-            //emitTrans (Ssa_Transfer_new_jump (s->u.localThrow));
+            emitTrans(Ssa_Transfer_new_jump(s->u.localThrow));
             return;
         }
         case HIL_STM_TRYCATCH: {
@@ -584,7 +586,7 @@ static Property_t substProp = 0;
 static List_t labelCache = 0;
 
 static void LabelCache_init(void) {
-    substProp = Property_new((Poly_tyPlist) Label_plist);
+    substProp = Property_new((Poly_tyIndex) Label_index);
     labelCache = List_new();
 }
 
@@ -625,7 +627,7 @@ struct Block_Result_t {
 // cook blocks
 static struct Block_Result_t cookBlocks(void) {
     struct Block_Result_t result = {0, 0};
-    List_t p = List_getFirst(caches);
+    List_t p = Vector_getFirst(caches);
     // List<Ssa_Stm_t>
     List_t stms = List_new();
     // List<Ssa_Block_t>
@@ -701,7 +703,7 @@ static Ssa_Fun_t Trans_funEach(Hil_Fun_t f) {
 
     assert(f);
 
-    caches = List_new();
+    caches = Vector_new();
     allDecs = List_new();
 
     LabelInfo_init();
@@ -747,7 +749,10 @@ static Ssa_Fun_t Trans_funEach(Hil_Fun_t f) {
     LabelInfo_clear();
     Property_clear(substProp);
 
-    return Ssa_Fun_new(f->type, f->name, f->args, f->decs, blocks, fun.retId, fun.entryLabel, fun.exitLabel);
+    // copy the declaration lists, as the HIL arena will be
+    // released once the SSA program has been built.
+    return Ssa_Fun_new(f->type, f->name, List_copy(f->args), List_copy(f->decs), blocks, fun.retId, fun.entryLabel,
+                       fun.exitLabel);
 }
 
 static List_t Trans_funcs(List_t fs) {
@@ -775,7 +780,7 @@ static Ssa_Prog_t Hil_transTraced(Hil_Prog_t p) {
     List_t newFuncs;
 
     assert(p);
-    fieldProp = Property_newInitFun((Poly_tyPlist) Id_plist, (Poly_tyPropInit) fieldPropInitFun);
+    fieldProp = Property_newInitFun((Poly_tyIndex) Id_index, (Poly_tyPropInit) fieldPropInitFun);
 
     // scan all fields for each class and remember them
     List_foreach(p->classes, (Poly_tyVoid) scanFields);
@@ -783,7 +788,7 @@ static Ssa_Prog_t Hil_transTraced(Hil_Prog_t p) {
     newFuncs = Trans_funcs(p->funcs);
     // clear properties
     Property_clear(fieldProp);
-    return Ssa_Prog_new(p->classes, newFuncs);
+    return Ssa_Prog_new(List_copy(p->classes), newFuncs);
 }
 
 static void printArg(Hil_Prog_t p) {
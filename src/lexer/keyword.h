@@ -1,39 +1,87 @@
 #ifndef KEY_WORD_H
 #define KEY_WORD_H
 
-#include "../lib/string.h"
 #include "token.h"
+#include <string.h>
 
-struct KeyWord_t {
-    char *str;
-    Token_Kind_t kind;
-};
+// Keywords are told apart first by their length and then by
+// their first character, which leaves at most one candidate
+// to compare against, so an identifier costs two jumps and
+// (rarely) one "memcmp" instead of a scan of every keyword.
+#define KEY(str, k)                                 \
+    return (0 == memcmp(s + 1, (str) + 1, n - 1)) \
+                   ? (k)                            \
+                   : TOKEN_ID
 
-struct KeyWord_t keyWordTable[] = {
-        {"break", TOKEN_BREAK},
-        {"catch", TOKEN_CATCH},
-        {"class", TOKEN_CLASS},
-        {"continue", TOKEN_CONTINUE},
-        {"do", TOKEN_DO},
-        {"else", TOKEN_ELSE},
-        {"for", TOKEN_FOR},
-        {"if", TOKEN_IF},
-        {"int", TOKEN_INT},
-        {"new", TOKEN_NEW},
-        {"null", TOKEN_NULL},
-        {"return", TOKEN_RETURN},
-        {"string", TOKEN_STRING},
-        {"throw", TOKEN_THROW},
-        {"try", TOKEN_TRY},
-        {"while", TOKEN_WHILE},
-        {0, (Token_Kind_t) 0}};
-
-static int isKeyWord(const char *s) {
-    char *t;
-    for (int i = 0; (t = keyWordTable[i].str); i++)
-        if (0 == strcmp(s, t))
-            return keyWordTable[i].kind;
-    return 0;
+// "s" holds "n" characters; answers "TOKEN_ID" if "s" is
+// not a keyword.
+static Token_Kind_t isKeyWord(const char *s, unsigned long n) {
+    switch (n) {
+        case 2:
+            switch (s[0]) {
+                case 'd':
+                    KEY("do", TOKEN_DO);
+                case 'i':
+                    KEY("if", TOKEN_IF);
+                default:
+                    return TOKEN_ID;
+            }
+        case 3:
+            switch (s[0]) {
+                case 'f':
+                    KEY("for", TOKEN_FOR);
+                case 'i':
+                    KEY("int", TOKEN_INT);
+                case 'n':
+                    KEY("new", TOKEN_NEW);
+                case 't':
+                    KEY("try", TOKEN_TRY);
+                default:
+                    return TOKEN_ID;
+            }
+        case 4:
+            switch (s[0]) {
+                case 'e':
+                    KEY("else", TOKEN_ELSE);
+                case 'n':
+                    KEY("null", TOKEN_NULL);
+                default:
+                    return TOKEN_ID;
+            }
+        case 5:
+            switch (s[0]) {
+                case 'b':
+                    KEY("break", TOKEN_BREAK);
+                case 'c':
+                    // "catch" and "class"
+                    if ('a' == s[1])
+                        KEY("catch", TOKEN_CATCH);
+                    KEY("class", TOKEN_CLASS);
+                case 't':
+                    KEY("throw", TOKEN_THROW);
+                case 'w':
+                    KEY("while", TOKEN_WHILE);
+                default:
+                    return TOKEN_ID;
+            }
+        case 6:
+            switch (s[0]) {
+                case 'r':
+                    KEY("return", TOKEN_RETURN);
+                case 's':
+                    KEY("string", TOKEN_STRING);
+                default:
+                    return TOKEN_ID;
+            }
+        case 8:
+            if ('c' == s[0])
+                KEY("continue", TOKEN_CONTINUE);
+            return TOKEN_ID;
+        default:
+            return TOKEN_ID;
+    }
 }
 
+#undef KEY
+
 #endif
@@ -3,47 +3,96 @@
  */
 #include "lex.h"
 #include "../control/error-msg.h"
-#include "../lib/char-buffer.h"
 #include "../lib/char.h"
 #include "../lib/error.h"
 #include "../lib/int.h"
+#include "../lib/mem.h"
 #include "../lib/string.h"
 #include "../lib/trace.h"
+#include "../lib/unused.h"
+#include "scan.h"
 #include "token.h"
 #include <assert.h>
+#include <fcntl.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include "keyword.h"
 
 // data structure for position information.
 struct Pos_t {
     String_t fname;// file name
-    FILE *fp;      // file pointer to the fname
     int line;      // line number, starting from 1
-    int column;    // column number, starting from 0
 };
 
-static struct Pos_t pos = {0, 0, 1, 0};
-
-static CharBuffer_t numBuffer = 0;
-static CharBuffer_t strBuffer = 0;
-static CharBuffer_t idBuffer = 0;
-
+static struct Pos_t pos = {0, 1};
+
+// The whole source file is mapped into memory, followed by
+// a '\0' at "end" and at least "SCAN_PAD" more zeros, so
+// that the scanners in "scan.h" may run over it.
+static char *end = 0;
+// the next character to read
+static char *cur = 0;
+// the first character of the current line, for columns
+static char *lineStart = 0;
+
+// Lexemes are zero-copy: an identifier or a number is
+// ended in place, by overwriting the character just after
+// it with '\0'. The mapping is private, so the file itself
+// is untouched, and it is never unmapped, as lexemes are
+// referenced by Ids in every later IR. The overwritten
+// character is kept here, until the next token reads it.
+static char *heldAt = 0;
+static int heldChar = 0;
+
+// reading EOF counts as one character, as "getc" did,
+// which keeps the columns of EOF tokens.
 static int get_char(void) {
-    pos.column++;
-    return getc(pos.fp);
+    int c;
+
+    if (cur >= end) {
+        cur = end + 1;
+        return EOF;
+    }
+    c = (cur == heldAt) ? heldChar : (unsigned char) *cur;
+    cur++;
+    return c;
 }
 
 static void unget_char(int c) {
-    pos.column--;
-    ungetc(c, pos.fp);
+    UNUSED(c);
+    cur--;
+}
+
+// the text in [start, stop), as a string
+static String_t lexeme(char *start, char *stop) {
+    String_t s;
+
+    // "start" itself has been overwritten to end the
+    // last lexeme, as in "1x". This is rare, so copy.
+    if (start == heldAt) {
+        long n = stop - start;
+        Mem_Arena_t old = Mem_Arena_enter(MEM_ARENA_GLOBAL);
+
+        Mem_NEW_SIZE(s, n + 1);
+        Mem_Arena_enter(old);
+        s[0] = (char) heldChar;
+        memcpy(s + 1, start + 1, (unsigned long) (n - 1));
+        return s;
+    }
+    heldAt = stop;
+    heldChar = (unsigned char) *stop;
+    *stop = '\0';
+    return start;
 }
 
 static void cookComment(void);
 
-static Token_t cookId(int theChar, Coordinate_t left);
+static Token_t cookId(Coordinate_t left);
 
-static Token_t cookNum(int theChar, Coordinate_t left);
+static Token_t cookNum(Coordinate_t left);
 
 static Token_t cookString(Coordinate_t left);
 
@@ -55,16 +104,17 @@ static int escape(int c);
 
 static Coordinate_t getPos(void);
 
-static int isAlpha(int c);
-
-static int columnBackup = 0;
+// the column of the last character read, from 0
+static int column(void) {
+    return (int) (cur - 1 - lineStart);
+}
 
 static Coordinate_t getPos(void) {
-    return Coordinate_new(pos.fname, pos.line, pos.column - 1);
+    return Coordinate_new(pos.fname, pos.line, column());
 }
 
 static void error(char *msg) {
-    ErrorMsg_lexError(msg, pos.fname, pos.line, pos.column);
+    ErrorMsg_lexError(msg, pos.fname, pos.line, column() + 1);
 }
 
 static void error2(String_t msg, String_t fname, int line, int column) {
@@ -73,60 +123,68 @@ static void error2(String_t msg, String_t fname, int line, int column) {
 
 
 static int eatBlanks(void) {
-    int cur;
+    int c;
 
-    cur = get_char();
-    while (Char_isBlank(cur)) {
-        cur = get_char();
+    c = get_char();
+    if (Char_isBlank(c)) {
+        cur = Scan_blanks(cur);
+        c = get_char();
     }
-    return cur;
+    return c;
 }
 
 static void cookComment(void) {
     int c;
+
+    cur = Scan_line(cur);
     c = get_char();
-    while ('\n' != c)
-        c = get_char();
+    if ('\n' != c)
+        return;
     pos.line++;
-    pos.column = 0;
+    lineStart = cur;
     return;
 }
 
-static Token_t cookNum(int c, Coordinate_t leftPos) {
-    CharBuffer_append(numBuffer, c);
-    c = get_char();
-    while (Char_isDigit(c)) {
-        CharBuffer_append(numBuffer, c);
-        c = get_char();
-    }
-    unget_char(c);
+static Token_t cookNum(Coordinate_t leftPos) {
+    char *start = cur - 1;
+
+    cur = Scan_digits(cur);
     return Token_new(TOKEN_INTLIT,
-                     CharBuffer_toStringBeforeClear(numBuffer),
+                     lexeme(start, cur),
                      leftPos,
                      getPos());
 }
 
+// escapes only shrink the text, so they are decoded in
+// place, and the closing quote becomes the '\0'.
 static Token_t cookString(Coordinate_t leftPos) {
     int c;
+    char *start = cur;
+    char *to = cur;
     String_t fname = pos.fname;
     int line = pos.line;
-    int column = pos.column;
+    int column = (int) (cur - lineStart);
 
-    c = get_char();
-    while (c != EOF && c != '\n' && c != '\"') {
-        if (c == '\\') {
-            c = get_char();
-            CharBuffer_append(strBuffer, escape(c));
-        } else
-            CharBuffer_append(strBuffer, c);
+    while (1) {
+        char *stop = Scan_string(cur);
+
+        if (to != cur)
+            memmove(to, cur, (unsigned long) (stop - cur));
+        to += stop - cur;
+        cur = stop;
         c = get_char();
+        if (c != '\\')
+            break;
+        c = get_char();
+        *to++ = (char) escape(c);
     }
-    if (c == EOF)
+    if (c == EOF || c == '\0')
         error2("unclosed string", fname, line, column);
     else if (c == '\n')
         error("don't allow newLine in strings");
+    *to = '\0';
     return Token_new(TOKEN_STRINGLIT,
-                     CharBuffer_toStringBeforeClear(strBuffer),
+                     start,
                      leftPos,
                      getPos());
 }
@@ -142,31 +200,24 @@ static int escape(int c) {
         case '\"':
             return '\"';
         default:
-            ErrorMsg_lexError("bad escape sequence", pos.fname, pos.line, pos.column);
+            error("bad escape sequence");
             return 0;
     }
 }
 
-static int isAlpha(int c) {
-    return (Char_isAlpha(c)) || ('_' == c);
-}
-
-static Token_t cookId(int c, Coordinate_t leftPos) {
+// Identifiers are interned here, once, and the token
+// carries the "Id_t" on to the parser.
+static Token_t cookId(Coordinate_t leftPos) {
     Token_Kind_t kind;
     String_t str;
+    char *start = cur - 1;
 
-    CharBuffer_append(idBuffer, c);
-    c = get_char();
-    while (isAlpha(c) || Char_isDigit(c)) {
-        CharBuffer_append(idBuffer, c);
-        c = get_char();
-    }
-    unget_char(c);
-    str = CharBuffer_toStringBeforeClear(idBuffer);
-    kind = isKeyWord(str);
-    if (kind > 0)
+    cur = Scan_idChars(cur);
+    str = lexeme(start, cur);
+    kind = isKeyWord(str, (unsigned long) (cur - start));
+    if (kind != TOKEN_ID)
         return Token_new(kind, 0, leftPos, getPos());
-    return Token_new(TOKEN_ID, str, leftPos, getPos());
+    return Token_newId(Id_fromString(str), str, leftPos, getPos());
 }
 
 
@@ -181,16 +232,12 @@ static Token_t Lex_getTokenTraced(void) {
     // eat blanks, until we reach the first non-blank char.
     firstChar = eatBlanks();
 
-    // For now, only accept Unix-style newlines, but it's
-    // not hard to add support for other styles of newlines
-    // such as the Windows '\r\n'.
-    if ('\n' == firstChar) {
+    // The '\r' of Windows-style newlines is eaten as a
+    // blank, so only '\n' ends a line.
+    while ('\n' == firstChar) {
         pos.line++;
-        // We should back up the old column number for ...
-        columnBackup = pos.column;
-        pos.column = 0;
-        // recursively call itself to get a token
-        return Lex_getTokenTraced();
+        lineStart = cur;
+        firstChar = eatBlanks();
     }
 
     // from now on, ready to handle a normal token, first
@@ -200,13 +247,13 @@ static Token_t Lex_getTokenTraced(void) {
     // if the first character is a digit, goto "cookNum".
     // the following other cases are similar.
     if (Char_isDigit(firstChar))
-        return cookNum(firstChar, leftPos);
+        return cookNum(leftPos);
 
     if ('\"' == firstChar)
         return cookString(leftPos);
 
     if (Char_isAlpha(firstChar))
-        return cookId(firstChar, leftPos);
+        return cookId(leftPos);
 
     switch (firstChar) {
         case '/': {
@@ -357,15 +404,76 @@ Token_t Lex_getToken(void) {
     return r;
 }
 
+// Map "fd" with "SCAN_PAD" zeros after its "size" bytes:
+// reserve zeroed pages for both, then put the file over
+// the front of them. Pages past the end of a file read as
+// zeros, too.
+static char *mapFile(int fd, long size) {
+    long page = sysconf(_SC_PAGESIZE);
+    long total = (size + SCAN_PAD + page - 1) / page * page;
+    char *base;
+
+    base = mmap(0, (size_t) total, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON, -1, 0);
+    if (base == MAP_FAILED)
+        return 0;
+    if (size == 0)
+        return base;
+    if (mmap(base, (size_t) size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        munmap(base, (size_t) total);
+        return 0;
+    }
+    return base;
+}
+
+// for inputs that can not be mapped, such as pipes
+static char *readFile(int fd, long *size) {
+    long cap = 4096;
+    long n = 0;
+    char *buf;
+    ssize_t got;
+    Mem_Arena_t old = Mem_Arena_enter(MEM_ARENA_GLOBAL);
+
+    Mem_NEW_SIZE(buf, cap + SCAN_PAD + 1);
+    while ((got = read(fd, buf + n, (size_t) (cap - n))) > 0) {
+        n += got;
+        if (n == cap) {
+            char *bigger;
+
+            Mem_NEW_SIZE(bigger, 2 * cap + SCAN_PAD + 1);
+            memcpy(bigger, buf, (unsigned long) n);
+            buf = bigger;
+            cap *= 2;
+        }
+    }
+    Mem_Arena_enter(old);
+    *size = n;
+    return buf;
+}
+
 void Lex_init(String_t fname) {
+    int fd;
+    struct stat st;
+    long size = 0;
+    char *buf = 0;
+
+    fd = open(fname, O_RDONLY);
+    if (fd < 0)
+        ErrorMsg_die(String_concat("can not open file: ", fname, 0));
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+        size = (long) st.st_size;
+        buf = mapFile(fd, size);
+    }
+    if (!buf)
+        buf = readFile(fd, &size);
+    close(fd);
+
     // init file positions
     pos.fname = fname;
-    pos.fp = fopen(fname, "r");
     pos.line = 1;
-    pos.column = 0;
-    // init buffers to hold token values
-    numBuffer = CharBuffer_new();
-    strBuffer = CharBuffer_new();
-    idBuffer = CharBuffer_new();
+    cur = buf;
+    end = buf + size;
+    lineStart = buf;
+    heldAt = 0;
+    heldChar = 0;
     //    return;
 }
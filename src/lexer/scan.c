@@ -0,0 +1,124 @@
+#include "scan.h"
+
+// The kernels are picked at compile time: AVX2 if the
+// compiler may use it, then SSE2 (always there on x86-64),
+// and plain C otherwise. A vector kernel computes, for a
+// block of characters, the bit mask of those that end the
+// run, and returns at the lowest set bit.
+#if defined(__AVX2__)
+#include <immintrin.h>
+
+typedef __m256i Block_t;
+#define BLOCK_SIZE 32
+#define LOAD(p) _mm256_loadu_si256((const __m256i *) (p))
+#define SPLAT(c) _mm256_set1_epi8(c)
+#define EQ(x, c) _mm256_cmpeq_epi8((x), SPLAT(c))
+// signed compares: bytes above 0x7f are in no class
+#define GT(x, c) _mm256_cmpgt_epi8((x), SPLAT(c))
+#define LT(x, c) _mm256_cmpgt_epi8(SPLAT(c), (x))
+#define OR(x, y) _mm256_or_si256((x), (y))
+#define AND(x, y) _mm256_and_si256((x), (y))
+#define MASK(x) ((unsigned) _mm256_movemask_epi8(x))
+#define ALL 0xffffffffu
+
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+
+typedef __m128i Block_t;
+#define BLOCK_SIZE 16
+#define LOAD(p) _mm_loadu_si128((const __m128i *) (p))
+#define SPLAT(c) _mm_set1_epi8(c)
+#define EQ(x, c) _mm_cmpeq_epi8((x), SPLAT(c))
+#define GT(x, c) _mm_cmpgt_epi8((x), SPLAT(c))
+#define LT(x, c) _mm_cmpgt_epi8(SPLAT(c), (x))
+#define OR(x, y) _mm_or_si128((x), (y))
+#define AND(x, y) _mm_and_si128((x), (y))
+#define MASK(x) ((unsigned) _mm_movemask_epi8(x))
+#define ALL 0xffffu
+
+#endif
+
+typedef enum {
+    CLASS_BLANK,
+    CLASS_ID,
+    CLASS_DIGIT,
+    CLASS_LINE,
+    CLASS_STRING
+} Class_t;
+
+#ifdef BLOCK_SIZE
+// the characters in "x" that end a run of class "c"
+static inline unsigned stops(Block_t x, Class_t c) {
+    switch (c) {
+        case CLASS_BLANK:
+            return ~MASK(OR(OR(EQ(x, ' '), EQ(x, '\t')), EQ(x, '\r'))) & ALL;
+        case CLASS_ID: {
+            Block_t lower = OR(x, SPLAT(0x20));
+            Block_t alpha = AND(GT(lower, 'a' - 1), LT(lower, 'z' + 1));
+            Block_t digit = AND(GT(x, '0' - 1), LT(x, '9' + 1));
+
+            return ~MASK(OR(OR(alpha, digit), EQ(x, '_'))) & ALL;
+        }
+        case CLASS_DIGIT:
+            return ~MASK(AND(GT(x, '0' - 1), LT(x, '9' + 1))) & ALL;
+        case CLASS_LINE:
+            return MASK(OR(EQ(x, '\n'), EQ(x, '\0')));
+        case CLASS_STRING:
+            return MASK(OR(OR(EQ(x, '\"'), EQ(x, '\\')), OR(EQ(x, '\n'), EQ(x, '\0'))));
+        default:
+            return ALL;
+    }
+}
+
+static inline char *scan(char *p, Class_t c) {
+    unsigned m;
+
+    while (!(m = stops(LOAD(p), c)))
+        p += BLOCK_SIZE;
+    return p + __builtin_ctz(m);
+}
+
+#else
+static inline int member(int ch, Class_t c) {
+    switch (c) {
+        case CLASS_BLANK:
+            return ch == ' ' || ch == '\t' || ch == '\r';
+        case CLASS_ID:
+            return ('a' <= ch && ch <= 'z') || ('A' <= ch && ch <= 'Z') || ('0' <= ch && ch <= '9') || ch == '_';
+        case CLASS_DIGIT:
+            return '0' <= ch && ch <= '9';
+        case CLASS_LINE:
+            return ch != '\n' && ch != '\0';
+        case CLASS_STRING:
+            return ch != '\"' && ch != '\\' && ch != '\n' && ch != '\0';
+        default:
+            return 0;
+    }
+}
+
+static inline char *scan(char *p, Class_t c) {
+    while (member((unsigned char) *p, c))
+        p++;
+    return p;
+}
+#endif
+
+char *Scan_blanks(char *p) {
+    return scan(p, CLASS_BLANK);
+}
+
+char *Scan_idChars(char *p) {
+    return scan(p, CLASS_ID);
+}
+
+char *Scan_digits(char *p) {
+    return scan(p, CLASS_DIGIT);
+}
+
+char *Scan_line(char *p) {
+    return scan(p, CLASS_LINE);
+}
+
+char *Scan_string(char *p) {
+    return scan(p, CLASS_STRING);
+}
@@ -0,0 +1,21 @@
+#ifndef SCAN_H
+#define SCAN_H
+
+// Character-class scanners for the lexer. Each returns the
+// first position at or after "p" whose character is not in
+// the class. The text must end with a '\0', and must stay
+// readable for "SCAN_PAD" bytes past it, as the vector
+// kernels read whole blocks at a time.
+#define SCAN_PAD 64
+
+// ' ', '\t' and '\r'
+char *Scan_blanks(char *p);
+// letters, digits and '_'
+char *Scan_idChars(char *p);
+char *Scan_digits(char *p);
+// stop at '\n' or '\0'
+char *Scan_line(char *p);
+// stop at '\"', '\\', '\n' or '\0'
+char *Scan_string(char *p);
+
+#endif
@@ -1,4 +1,5 @@
 #include "token.h"
+#include "../lib/char.h"
 #include "../lib/mem.h"
 #include <assert.h>
 
@@ -10,10 +11,20 @@ T Token_new(Token_Kind_t kind, String_t lexeme, Coordinate_t left, Coordinate_t
     Mem_NEW(temp);
     temp->kind = kind;
     temp->lexeme = lexeme;
+    temp->id = 0;
     temp->region = Region_new(left, right);
     return temp;
 }
 
+T Token_newId(Id_t id, String_t lexeme, Coordinate_t left, Coordinate_t right) {
+    Token_t temp;
+
+    assert(id);
+    temp = Token_new(TOKEN_ID, lexeme, left, right);
+    temp->id = id;
+    return temp;
+}
+
 String_t Token_Kind_toString(Token_Kind_t kind) {
     switch (kind) {
         case TOKEN_AND:
@@ -69,6 +80,9 @@ String_t Token_Kind_toString(Token_Kind_t kind) {
         case TOKEN_WHILE:
             return "while";
         default:
+            // single-character tokens are their own kinds.
+            if (kind > 0)
+                return Char_toString(kind);
             fprintf(stderr, "kind==%d\n", kind);
             Error_impossible();
             return 0;
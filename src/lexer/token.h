@@ -7,6 +7,7 @@
 #ifndef TOKEN_H
 #define TOKEN_H
 
+#include "../atoms/id.h"
 #include "../control/coordinate.h"
 #include "../control/region.h"
 #include "../lib/string.h"
@@ -47,6 +48,9 @@ typedef struct T *T;
 struct T {
     Token_Kind_t kind;
     String_t lexeme;
+    // the interned identifier, for "TOKEN_ID" only, so that
+    // later phases need not hash the lexeme again.
+    Id_t id;
     Region_t region;
 };
 
@@ -54,6 +58,10 @@ T Token_new(Token_Kind_t kind,
             String_t lexeme,
             Coordinate_t left,
             Coordinate_t right);
+T Token_newId(Id_t id,
+              String_t lexeme,
+              Coordinate_t left,
+              Coordinate_t right);
 String_t Token_Kind_toString(Token_Kind_t kind);
 String_t Token_toString(T t);
 String_t Token_toStringWithPos(T t);
@@ -4,9 +4,10 @@
 /* editor-dependent. */
 #define TAB_SIZE 8
 
-/* a subset of the ASCII. */
+/* a subset of the ASCII. The '\r' of Windows-style
+ * newlines is taken as a blank. */
 int Char_isBlank(int c) {
-    return c == ' ' || c == '\t';
+    return c == ' ' || c == '\t' || c == '\r';
 }
 
 int Char_blankSize(int c) {
@@ -15,6 +16,8 @@ int Char_blankSize(int c) {
             return 1;
         case '\t':
             return TAB_SIZE;
+        case '\r':
+            return 0;
         default:
             return -1;
     }
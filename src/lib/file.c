@@ -1,18 +1,265 @@
+// for "fopencookie"
+#define _GNU_SOURCE
 #include "file.h"
 #include "error.h"
 #include <assert.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef __GLIBC__
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 #define T File_t
 
+static long bufferSize = BUFSIZ;
+static int background = 0;
+
+void File_init(long size, int bg) {
+    assert(size > 0);
+    bufferSize = size;
+    background = bg;
+}
+
+///////////////////////////////////////////////////////
+// buffers
+// The buffers given to open files, freed as they are
+// closed. They are malloc-ed, as they are big and do
+// not live as long as any arena.
+typedef struct Buffer_t *Buffer_t;
+
+struct Buffer_t {
+    T file;
+    char *data;
+    Buffer_t next;
+};
+
+static Buffer_t buffers = 0;
+static pthread_mutex_t buffersLock = PTHREAD_MUTEX_INITIALIZER;
+
+static void Buffer_give(T file) {
+    Buffer_t b = malloc(sizeof(*b));
+    char *data = malloc((size_t) bufferSize);
+
+    // the file keeps its default buffer then
+    if (!b || !data || setvbuf(file, data, _IOFBF, (size_t) bufferSize)) {
+        free(b);
+        free(data);
+        return;
+    }
+    b->file = file;
+    b->data = data;
+    pthread_mutex_lock(&buffersLock);
+    b->next = buffers;
+    buffers = b;
+    pthread_mutex_unlock(&buffersLock);
+}
+
+// must be taken before the file is closed: another file
+// may be opened at the same address right after.
+static Buffer_t Buffer_take(T file) {
+    Buffer_t b = 0;
+
+    pthread_mutex_lock(&buffersLock);
+    for (Buffer_t *p = &buffers; *p; p = &(*p)->next) {
+        if ((*p)->file == file) {
+            b = *p;
+            *p = b->next;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&buffersLock);
+    return b;
+}
+
+///////////////////////////////////////////////////////
+// background writers
+// A file whose writes are handed to a thread: the C
+// library calls "Writer_write" with a full buffer, which
+// is copied for the thread to write out, so the library
+// can fill its buffer again meanwhile. At most one
+// buffer is out at a time.
+#ifdef __GLIBC__
+
+typedef struct Writer_t *Writer_t;
+
+struct Writer_t {
+    int fd;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    // the bytes handed to the thread, "size" is 0 when
+    // they are written
+    char *data;
+    size_t size;
+    size_t capacity;
+    int closing;
+    int failed;
+};
+
+static void *Writer_run(void *arg) {
+    Writer_t w = arg;
+
+    pthread_mutex_lock(&w->lock);
+    for (;;) {
+        size_t size, done = 0;
+        int failed = 0;
+
+        while (!w->size && !w->closing)
+            pthread_cond_wait(&w->cond, &w->lock);
+        if (!w->size)
+            break;
+        size = w->size;
+        // "data" is left alone until "size" is 0 again
+        pthread_mutex_unlock(&w->lock);
+        while (done < size) {
+            ssize_t n = write(w->fd, w->data + done, size - done);
+
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n < 0) {
+                failed = 1;
+                break;
+            }
+            done += (size_t) n;
+        }
+        pthread_mutex_lock(&w->lock);
+        w->failed |= failed;
+        w->size = 0;
+        pthread_cond_broadcast(&w->cond);
+    }
+    pthread_mutex_unlock(&w->lock);
+    return 0;
+}
+
+// returns 0 on errors, as "fopencookie" expects
+static ssize_t Writer_write(void *cookie, const char *buf, size_t size) {
+    Writer_t w = cookie;
+
+    pthread_mutex_lock(&w->lock);
+    while (w->size)
+        pthread_cond_wait(&w->cond, &w->lock);
+    if (size > w->capacity) {
+        char *data = realloc(w->data, size);
+
+        if (!data)
+            w->failed = 1;
+        else {
+            w->data = data;
+            w->capacity = size;
+        }
+    }
+    if (w->failed) {
+        pthread_mutex_unlock(&w->lock);
+        return 0;
+    }
+    memcpy(w->data, buf, size);
+    w->size = size;
+    pthread_cond_broadcast(&w->cond);
+    pthread_mutex_unlock(&w->lock);
+    return (ssize_t) size;
+}
+
+static void Writer_free(Writer_t w) {
+    pthread_mutex_destroy(&w->lock);
+    pthread_cond_destroy(&w->cond);
+    free(w->data);
+    free(w);
+}
+
+static void Writer_stop(Writer_t w) {
+    pthread_mutex_lock(&w->lock);
+    w->closing = 1;
+    pthread_cond_broadcast(&w->cond);
+    pthread_mutex_unlock(&w->lock);
+    pthread_join(w->thread, 0);
+}
+
+static int Writer_close(void *cookie) {
+    Writer_t w = cookie;
+    int failed;
+
+    Writer_stop(w);
+    failed = w->failed;
+    if (close(w->fd))
+        failed = 1;
+    Writer_free(w);
+    return (failed) ? -1 : 0;
+}
+
+// 0 if the thread cannot be had, and "fd" is left open;
+// otherwise, it is closed with the file
+static T Writer_new(int fd) {
+    cookie_io_functions_t io = {0, Writer_write, 0, Writer_close};
+    Writer_t w;
+    T file;
+
+    w = calloc(1, sizeof(*w));
+    if (!w)
+        return 0;
+    w->fd = fd;
+    pthread_mutex_init(&w->lock, 0);
+    pthread_cond_init(&w->cond, 0);
+    if (pthread_create(&w->thread, 0, Writer_run, w)) {
+        Writer_free(w);
+        return 0;
+    }
+    file = fopencookie(w, "w", io);
+    if (!file) {
+        Writer_stop(w);
+        Writer_free(w);
+    }
+    return file;
+}
+
+#endif
+
+///////////////////////////////////////////////////////
+// files
+static T openBuffered(String_t fname, String_t mode) {
+    T file = 0;
+
+#ifdef __GLIBC__
+    // no reads through the thread
+    if (background && mode[0] == 'w') {
+        int fd = open(fname, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+
+        if (fd >= 0 && !(file = Writer_new(fd)))
+            close(fd);
+    }
+#endif
+    if (!file)
+        file = fopen(fname, mode);
+    if (file && mode[0] != 'r')
+        Buffer_give(file);
+    return file;
+}
+
+T File_fromDescriptor(int fd) {
+    T file = 0;
+
+#ifdef __GLIBC__
+    if (background)
+        file = Writer_new(fd);
+#endif
+    if (!file)
+        file = fdopen(fd, "w");
+    if (file)
+        Buffer_give(file);
+    return file;
+}
+
 int File_saveToFile(String_t fname, T (*print)(T, Poly_t), Poly_t x) {
-    T file = fopen(fname, "w+");
+    T file = openBuffered(fname, "w+");
 
     if (!file)
         Error_bug(String_concat("fail to open file: ",
                                 fname,
                                 0));
     print(file, x);
-    fclose(file);
+    File_close(file);
     return 0;
 }
 
@@ -22,7 +269,7 @@ int File_flush(T f) {
 
 T File_open(String_t s, String_t mode) {
     T fp;
-    if ((fp = fopen(s, mode)))
+    if ((fp = openBuffered(s, mode)))
         return fp;
 
     Error_error(String_concat("file open failed: ", s, " in mode ", "[", mode, "]", 0));
@@ -37,9 +284,42 @@ void File_write(T f, String_t s) {
     return;
 }
 
-void File_close(T f) {
+void File_writeChar(T f, int c) {
+    assert(f);
+
+    putc(c, f);
+}
+
+void File_writeLong(T f, long n) {
+    char digits[24];
+    char *p = digits + sizeof(digits);
+    // so that the most negative long can be negated
+    unsigned long u = (n < 0) ? -(unsigned long) n : (unsigned long) n;
+
+    assert(f);
+    do {
+        *--p = (char) ('0' + u % 10);
+        u /= 10;
+    } while (u);
+    if (n < 0)
+        *--p = '-';
+    fwrite(p, 1, (size_t) (digits + sizeof(digits) - p), f);
+}
+
+int File_tryClose(T f) {
+    Buffer_t b = Buffer_take(f);
     int r = fclose(f);
 
+    if (b) {
+        free(b->data);
+        free(b);
+    }
+    return r;
+}
+
+void File_close(T f) {
+    int r = File_tryClose(f);
+
     if (r) {
         *((int *) 1) = 0;
         Error_error("close file failed\n");
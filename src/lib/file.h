@@ -11,16 +11,37 @@ typedef FILE *T;
 
 typedef T (*Poly_tyPrint)(T, Poly_t);
 
+// Files opened for writing by "File_open" and
+// "File_saveToFile" get an output buffer of "size" bytes
+// (the compiler's output is written in many small pieces).
+// With "background" set, the buffer is written out on a
+// thread of its own, while the next one is being filled;
+// this is only done where the C library can hook the
+// writes (glibc), and the writes are direct elsewhere.
+void File_init(long size, int background);
+
 int File_flush(T);
 
 int File_saveToFile(String_t fname, Poly_tyPrint print, Poly_t x);
 
 T File_open(String_t fname, String_t mode);
 
+// a file writing to the descriptor "fd" (e.g., a pipe),
+// buffered as the files above; "fd" is closed with it.
+T File_fromDescriptor(int fd);
+
 void File_write(T, String_t s);
 
+// these format in place, without building strings
+void File_writeChar(T, int c);
+void File_writeLong(T, long n);
+
 void File_close(T);
 
+// close, and return nonzero on errors, which "File_close"
+// takes as fatal
+int File_tryClose(T);
+
 #undef T
 
 #endif
@@ -1,52 +1,75 @@
 #include "graph.h"
-#include "../ssa/ssa.h"
 #include "dot.h"
 #include "error.h"
+#include "hash.h"
 #include "list.h"
 #include "mem.h"
-#include "property-list.h"
-#include "property.h"
 #include "set.h"
-#include "unused.h"
 #include <assert.h>
 #include <stdio.h>
 
-//
-#ifdef printf
-#undef printf
-#endif
-#define printf noop
-#define dprintf noop
-
-static int noop(const char *s, ...) {
-    UNUSED(s);
-    return 0;
-}
+#define T Graph_t
 
-struct Ssa_Block_t;
+#define V Vertex_t
+#define Ex Edge_t
 
-#define T Graph_t
+typedef struct V *V;
+typedef struct Ex *Ex;
+
+// The compressed sparse row form of the edges: the
+// successors of the vertex indexed "i" are
+// "succs[succStart[i] .. succStart[i+1])", and likewise
+// for predecessors. Both keep the order of insertion.
+typedef struct {
+    // indexed by vertex index
+    V *vertices;
+    long *succStart;
+    V *succs;
+    long *predStart;
+    V *preds;
+} Csr_t;
+
+// A depth-first numbering from "start". Unreachable
+// vertices have number -1.
+typedef struct {
+    V start;
+    long *pre;
+    long *post;
+    // the reachable vertices, in preorder and reverse
+    // postorder
+    V *preorder;
+    V *rpo;
+    long numReached;
+} Dfs_t;
 
 struct T {
     String_t name;
     Poly_tyEquals equals;
     // List<V>
     List_t vs;
+    // number of vertices, which are indexed 0, 1, ...
+    long numVs;
+    long numEdges;
+    // numbers the vertex data
+    Poly_tyIndex index;
+    // data -> V, hashed on the data's index, which is
+    // numbered across the program, so a table indexed by it
+    // would be as large as the program, not the graph
+    Hash_t vertexMap;
+    // both of these are built on demand, and dropped
+    // whenever the graph changes.
+    Csr_t *csr;
+    Dfs_t *dfs;
 };
 
-#define V Vertex_t
-#define Ex Edge_t
-
-typedef struct V *V;
-typedef struct Ex *Ex;
-
 ///////////////////////////////////////////////////////
 // vertex
 struct V {
     Poly_t data;
+    // position in the graph's vertex list
+    long index;
     // List<E>
     List_t edges;
-    Plist_t plist;
 };
 
 static V Vertex_new(Poly_t data) {
@@ -55,29 +78,14 @@ static V Vertex_new(Poly_t data) {
     Mem_NEW(v);
     v->data = data;
     v->edges = List_new();
-    v->plist = Plist_new();
     return v;
 }
 
-static Plist_t Vertex_plist(V v) {
-    assert(v);
-
-    return v->plist;
-}
-
-static int Vertex_equals(V v1, V v2) {
-    assert(v1);
-    assert(v2);
-
-    return v1 == v2;
-}
-
 ////////////////////////////////////////////////////////
 // edge
 struct Ex {
     V from;
     V to;
-    Plist_t plist;
 };
 
 static Ex Edge_new(V from, V to) {
@@ -86,7 +94,6 @@ static Ex Edge_new(V from, V to) {
     Mem_NEW(e);
     e->from = from;
     e->to = to;
-    e->plist = Plist_new();
     return e;
 }
 
@@ -98,53 +105,40 @@ static Ex Edge_new(V from, V to) {
 //}
 
 
-//static Plist_t Edge_plist(E e) {
-//    assert(e);
-//
-//    return e->plist;
-//}
 //
 
 /////////////////////////////////////////////////////
 // graph
-T Graph_new(Poly_tyEquals eq) {
-    T g;
-
-    Mem_NEW(g);
-    g->name = "NONE";
-    g->equals = eq;
-    g->vs = List_new();
-    return g;
+T Graph_new(Poly_tyEquals eq, Poly_tyIndex index) {
+    return Graph_newWithName(eq, index, "NONE");
 }
 
-T Graph_newWithName(Poly_tyEquals eq, String_t name) {
+T Graph_newWithName(Poly_tyEquals eq, Poly_tyIndex index, String_t name) {
     T g;
 
     Mem_NEW(g);
     g->name = name;
     g->equals = eq;
     g->vs = List_new();
+    g->numVs = 0;
+    g->numEdges = 0;
+    g->index = index;
+    g->vertexMap = Hash_new(index, eq, 0);
+    g->csr = 0;
+    g->dfs = 0;
     return g;
 }
 
 static V searchVertex(T g, Poly_t data) {
-    List_t p;
-    Poly_tyEquals equals;
+    V v;
 
     assert(g);
     assert(data);
 
-    p = List_getFirst(g->vs);
-    equals = g->equals;
-    while (p) {
-        V v = (V) (p->data);
-
-        if (equals(data, v->data))
-            return v;
-        p = p->next;
-    }
-    Error_error("vertex not found: graph.c\n");
-    return 0;
+    v = Hash_lookup(g->vertexMap, data);
+    if (!v)
+        Error_error("vertex not found: graph.c\n");
+    return v;
 }
 
 //static E searchEdge(T g, Poly_t from, Poly_t to) {
@@ -165,7 +159,11 @@ static V searchVertex(T g, Poly_t data) {
 //
 void Graph_insertVertex(T g, Poly_t x) {
     V v = Vertex_new(x);
+    v->index = g->numVs++;
     List_insertLast(g->vs, v);
+    Hash_insert(g->vertexMap, x, v);
+    g->csr = 0;
+    g->dfs = 0;
     return;
 }
 
@@ -174,9 +172,171 @@ void Graph_insertEdge(T g, Poly_t from, Poly_t to) {
     V tv = searchVertex(g, to);
     Ex e = Edge_new(fv, tv);
     List_insertLast(fv->edges, e);
+    g->numEdges++;
+    g->csr = 0;
+    g->dfs = 0;
     return;
 }
 
+long Graph_numVertices(T g) {
+    assert(g);
+    return g->numVs;
+}
+
+/////////////////////////////////////////////////////
+// compressed sparse rows
+static Csr_t *Graph_csr(T g) {
+    Csr_t *csr;
+    List_t vs;
+    long *fill;
+    long n = g->numVs;
+    // "Mem_NEW_SIZE" rejects empty buffers
+    long m = g->numEdges + 1;
+
+    if (g->csr)
+        return g->csr;
+
+    Mem_NEW(csr);
+    Mem_NEW_SIZE(csr->vertices, n + 1);
+    Mem_NEW_SIZE(csr->succStart, n + 1);
+    Mem_NEW_SIZE(csr->succs, m);
+    Mem_NEW_SIZE(csr->predStart, n + 1);
+    Mem_NEW_SIZE(csr->preds, m);
+    Mem_NEW_SIZE(fill, n + 1);
+
+    // count the degrees, and lay out the successors
+    vs = List_getFirst(g->vs);
+    while (vs) {
+        V v = (V) vs->data;
+        List_t edges = List_getFirst(v->edges);
+        long k = csr->succStart[v->index];
+
+        csr->vertices[v->index] = v;
+        while (edges) {
+            Ex e = (Ex) edges->data;
+
+            csr->succs[k++] = e->to;
+            csr->predStart[e->to->index + 1]++;
+            edges = edges->next;
+        }
+        csr->succStart[v->index + 1] = k;
+        vs = vs->next;
+    }
+    for (long i = 0; i < n; i++) {
+        csr->predStart[i + 1] += csr->predStart[i];
+        fill[i] = csr->predStart[i];
+    }
+    // the predecessors of each vertex come out in vertex
+    // order, as vertices are visited in index order.
+    for (long i = 0; i < n; i++) {
+        for (long k = csr->succStart[i]; k < csr->succStart[i + 1]; k++) {
+            V to = csr->succs[k];
+
+            csr->preds[fill[to->index]++] = csr->vertices[i];
+        }
+    }
+    g->csr = csr;
+    return csr;
+}
+
+/////////////////////////////////////////////////////
+// depth-first numbering, iteratively, so that long
+// straight-line graphs cannot overflow the C stack.
+static Dfs_t *Graph_dfsNumber(T g, V start) {
+    Csr_t *csr = Graph_csr(g);
+    Dfs_t *dfs;
+    // the path from "start": a vertex, and the position of
+    // its next successor to look at
+    V *stack;
+    long *next;
+    long top = 0;
+    long preNum = 0;
+    long postNum = 0;
+    long n = g->numVs;
+
+    if (g->dfs && g->dfs->start == start)
+        return g->dfs;
+
+    Mem_NEW(dfs);
+    dfs->start = start;
+    Mem_NEW_SIZE(dfs->pre, n + 1);
+    Mem_NEW_SIZE(dfs->post, n + 1);
+    Mem_NEW_SIZE(dfs->preorder, n + 1);
+    Mem_NEW_SIZE(dfs->rpo, n + 1);
+    Mem_NEW_SIZE(stack, n + 1);
+    Mem_NEW_SIZE(next, n + 1);
+    for (long i = 0; i < n; i++) {
+        dfs->pre[i] = -1;
+        dfs->post[i] = -1;
+    }
+
+    dfs->pre[start->index] = preNum;
+    dfs->preorder[preNum++] = start;
+    stack[top] = start;
+    next[top] = csr->succStart[start->index];
+    top++;
+    while (top > 0) {
+        V v = stack[top - 1];
+
+        if (next[top - 1] < csr->succStart[v->index + 1]) {
+            V to = csr->succs[next[top - 1]++];
+
+            if (dfs->pre[to->index] >= 0)
+                continue;
+            dfs->pre[to->index] = preNum;
+            dfs->preorder[preNum++] = to;
+            stack[top] = to;
+            next[top] = csr->succStart[to->index];
+            top++;
+            continue;
+        }
+        dfs->post[v->index] = postNum++;
+        top--;
+    }
+    dfs->numReached = preNum;
+    for (long i = 0; i < n; i++) {
+        long post = dfs->post[i];
+
+        if (post >= 0)
+            dfs->rpo[postNum - 1 - post] = csr->vertices[i];
+    }
+    g->dfs = dfs;
+    return dfs;
+}
+
+List_t Graph_rpo(T g, Poly_t start) {
+    Dfs_t *dfs;
+    List_t result = List_new();
+
+    assert(g);
+    assert(start);
+
+    dfs = Graph_dfsNumber(g, searchVertex(g, start));
+    for (long i = 0; i < dfs->numReached; i++)
+        List_insertLast(result, dfs->rpo[i]->data);
+    return result;
+}
+
+long Graph_preNum(T g, Poly_t start, Poly_t x) {
+    assert(g);
+    return Graph_dfsNumber(g, searchVertex(g, start))->pre[searchVertex(g, x)->index];
+}
+
+long Graph_postNum(T g, Poly_t start, Poly_t x) {
+    assert(g);
+    return Graph_dfsNumber(g, searchVertex(g, start))->post[searchVertex(g, x)->index];
+}
+
+long Graph_rpoNum(T g, Poly_t start, Poly_t x) {
+    Dfs_t *dfs;
+    long post;
+
+    assert(g);
+    dfs = Graph_dfsNumber(g, searchVertex(g, start));
+    post = dfs->post[searchVertex(g, x)->index];
+    return (post < 0) ? -1 : dfs->numReached - 1 - post;
+}
+
 //void Graph_visitAllVertex(T g, void (*visit)(Poly_t)) {
 //    List_t l = List_getFirst(g->vs);
 //
@@ -216,495 +376,227 @@ void Graph_toJpg(T g, Poly_tyPrint printer) {
 
 ////////////////////////////////////////////////////
 // dfs
-static void Graph_dfsDoit(T g, V v, Poly_tyVoid f, Property_t visited) {
-    List_t edges;
-
-    f(v->data);
-    Property_set(visited, v, (Poly_t) 1);
-    edges = List_getFirst(v->edges);
-    while (edges) {
-        Ex e = (Ex) edges->data;
-        V to = e->to;
-        Poly_t visitedTo = Property_get(visited, to);
-        if (!visitedTo) {
-            Graph_dfsDoit(g, to, f, visited);
-        } else
-            ;
-        edges = edges->next;
-    }
-    return;
-}
-
+// visit in preorder, as the recursive version did
 void Graph_dfs(T g, Poly_t start, Poly_tyVoid f) {
     V sv;
-    Property_t visited;
+    Dfs_t *dfs;
 
     assert(g);
     assert(start);
     assert(f);
 
     sv = searchVertex(g, start);
-    visited = Property_new((Poly_tyPlist) Vertex_plist);
-    if (sv)
-        Graph_dfsDoit(g, sv, f, visited);
+    dfs = Graph_dfsNumber(g, sv);
 
     // don't visit nodes unreachable from start
     // may add a flag to control this
-
-    Property_clear(visited);
+    for (long i = 0; i < dfs->numReached; i++)
+        f(dfs->preorder[i]->data);
     return;
 }
 
 ////////////////////////////////////////////////////
 // dominator tree-related
-static void markPreds(T g, Property_t preds) {
-    assert(g);
 
-    List_t vs = List_getFirst(g->vs);
-    while (vs) {
-        V from = (V) vs->data;
-        List_t edges = List_getFirst(from->edges);
-        while (edges) {
-            Ex e = (Ex) edges->data;
-            V to = e->to;
-
-            // "from" is a predecesor for "to"
-            Set_t set = Property_get(preds, to);
-            if (set) {
-                Set_insert(set, from);
-            } else {
-                Set_t newSet = Set_new((Poly_tyEquals) Vertex_equals);
-                Set_insert(newSet, from);
-                Property_set(preds, to, newSet);
-            }
-            edges = edges->next;
-        }
-        vs = vs->next;
-    }
-    return;
+// the idom of "v", where the entry has none.
+static V idomOf(V *idom, V startv, V v) {
+    return (v == startv) ? 0 : idom[v->index];
 }
 
-//static void predDoit(V v) {
-//    printf("%s ", v->data);
-//    return;
-//}
-
-//static void printPreds(T g, Property_t preds) {
-//
-//    assert(g);
-//
-//    List_t vs = List_getFirst(g->vs);
-//    while (vs) {
-//        V from = (V) vs->data;
-//        Set_t set = Property_get(preds, from);
-//        // hard-coded here
-//        printf("%s ==>", from->data);
-//        if (set) {
-//            printf("(%d) ", Set_size(set));
-//            Set_foreach(set, (Poly_tyVoid) predDoit);
-//        } else
-//            printf("[]");
-//        printf("\n");
-//        vs = vs->next;
-//    }
-//    return;
-//}
-
-static void printOneVertex(V v) {
-    dprintf("%s, ", Label_toString(((Ssa_Block_t) (v->data))->label));
-}
-
-static void printDoms(T g, Property_t domProp) {
-    assert(g);
-
-    List_t vs = List_getFirst(g->vs);
-    while (vs) {
-        V from = (V) vs->data;
-        Set_t set = Property_get(domProp, from);
-        // hard-coded here
-        dprintf("%s ==>", Label_toString(((Ssa_Block_t) (from->data))->label));
-        if (!set)
-            Error_impossible();
-
-        dprintf("(%d doms) [", Set_size(set));
-        Set_foreach(set, (Poly_tyVoid) printOneVertex);
-        dprintf("]\n");
-        vs = vs->next;
-    }
-    return;
-}
-
-static void initDom(T g, V start, Property_t dom) {
-    List_t vs = List_getFirst(g->vs);
-
-    while (vs) {
-        V v = (V) vs->data;
-
-        Property_set(dom, v, Set_fromList((Poly_tyEquals) Vertex_equals, g->vs));
-        vs = vs->next;
+// walk two fingers up the dominator tree, until they meet
+// at the nearest common dominator. Postorder numbers grow
+// towards the entry.
+static V intersect(Dfs_t *dfs, V *idom, V b1, V b2) {
+    while (b1 != b2) {
+        while (dfs->post[b1->index] < dfs->post[b2->index])
+            b1 = idom[b1->index];
+        while (dfs->post[b2->index] < dfs->post[b1->index])
+            b2 = idom[b2->index];
     }
-    Property_set(dom, start, Set_singleton((Poly_tyEquals) Vertex_equals, start));
-    return;
-}
-
-static Set_t idomPropInitFun(V v) {
-    UNUSED(v);
-    return Set_new((Poly_tyEquals) Vertex_equals);
-}
-
-static Property_t globalDeletable = 0;
-
-static long idomDeletable(V v) {
-    Poly_t k = Property_get(globalDeletable, v);
-    return (long) k;
+    return b1;
 }
 
-// This algorithm is based on Figure 7-14 of Muchnick.
-
-// Calculate dominator tree.
-// The returned tree consists of graph vertex.
-// If dom!=0, return dominace property
-// If idom!=0, return the
-// immediate dominator in "idom" (it is on the
-// graph vertex, not tree vertex).
-static Tree_t Graph_domTreeReal(T g, Poly_t start, Property_t *domProp, Property_t *idomProp) {
-    // Tree<Vertex_t>
-    Tree_t tree;
-    // calculate the predessors for each vertex
-    // V -> Set<V>
-    Property_t preds;
-    // V -> Set<V>, may not be empty
-    Property_t dom;
-    // V -> Set<V>, may be empty
-    Property_t idom;
-
-    V startv;
-    int changed;
-
-    startv = searchVertex(g, start);
-
-    preds = Property_new((Poly_tyPlist) Vertex_plist);
-    markPreds(g, preds);
-    //now, every vertex should have predessors
-    //printPreds (g, preds);
-
-    // V -> dom (a set of vertex)
-    dom = Property_new((Poly_tyPlist) Vertex_plist);
-    // init dom for all vertex
-    initDom(g, startv, dom);
-    //now, every vertex should have initial dominators
-    printf("initialized dominators\n");
-    //printPreds (g, dom);
-
-    idom = Property_newInitFun((Poly_tyPlist) Vertex_plist, (Poly_tyPropInit) idomPropInitFun);
-
-    // fix-point algorithm. later, this should be changed
-    // to a more efficient algorithm such as bitarray-based
-    changed = 1;
+// This algorithm is based on Cooper, Harvey and Kennedy,
+// "A Simple, Fast Dominance Algorithm".
+
+// Calculate the immediate dominators, indexed by vertex
+// index. The entry is its own idom, and unreachable vertices
+// have none. Visiting in reverse postorder, every vertex
+// but the entry has a processed predecessor, and the loop
+// settles in a few rounds even on irreducible graphs.
+static V *Graph_idoms(T g, V startv) {
+    Csr_t *csr = Graph_csr(g);
+    Dfs_t *dfs = Graph_dfsNumber(g, startv);
+    V *idom;
+    int changed = 1;
+
+    Mem_NEW_SIZE(idom, g->numVs + 1);
+    idom[startv->index] = startv;
     while (changed) {
-        List_t vs = List_getFirst(g->vs);
         changed = 0;
-
-        while (vs) {
-            V current = (V) vs->data;
-            List_t predList;
-            Set_t predSet;
-            // this will hold the final result
-            Set_t result = Set_new((Poly_tyEquals) Vertex_equals);
-            Set_t domSetCurrent = Property_get(dom, current);
-            // should we require this?
-            result = Set_union(result, domSetCurrent);
-
-            // as the dom set has been properly initialized, so
-            // it must not be empty.
-            if (!domSetCurrent)
-                Error_impossible();
-            // the entry vertex should not be caculated
-            if (Vertex_equals(current, startv)) {
-                vs = vs->next;
-                continue;
+        // the entry comes first in reverse postorder
+        for (long i = 1; i < dfs->numReached; i++) {
+            V b = dfs->rpo[i];
+            V newIdom = 0;
+
+            for (long k = csr->predStart[b->index]; k < csr->predStart[b->index + 1]; k++) {
+                V p = csr->preds[k];
+
+                // not processed yet, or unreachable
+                if (!idom[p->index])
+                    continue;
+                newIdom = newIdom ? intersect(dfs, idom, p, newIdom) : p;
             }
-            // this is a normal vertex. Every vertex should
-            // have predessor set, except for entry vertex.
-            predSet = (Set_t) Property_get(preds, current);
-            if (!predSet)
+            if (!newIdom)
                 Error_impossible();
-
-            // /\ pred_p dom(p)
-            predList = List_getFirst(Set_toList(predSet));
-            while (predList) {
-                V p = (V) predList->data;
-                Set_t domforP = Property_get(dom, p);
-
-                printf("looping preds\n");
-                result = Set_intersection(result, domforP);
-                predList = predList->next;
-            }
-            Set_insert(result, current);
-            // changed?
-            if (!Set_equals(result, domSetCurrent)) {
+            if (idom[b->index] != newIdom) {
+                idom[b->index] = newIdom;
                 changed = 1;
-                Property_set(dom, current, result);
-            }
-            vs = vs->next;
-        }
-
-    }// end of outer loop
-    // now, the dom set should be ready
-    printf("dominators finished\n");
-    printDoms(g, dom);
-
-    // construct the dominator tree
-    {
-        List_t vs = List_getFirst(g->vs);
-        // which vertex is the deleta candidate from idom
-        Property_t deletable = Property_new((Poly_tyPlist) Vertex_plist);
-
-        // init
-        while (vs) {
-            V current = (V) vs->data;
-            Set_t domSet = (Set_t) Property_get(dom, current);
-            Set_t idomSet = (Set_t) Set_new((Poly_tyEquals) Vertex_equals);
-
-            idomSet = Set_union(idomSet, domSet);
-            Set_delete(idomSet, current);
-            Property_set(idom, current, idomSet);
-            vs = vs->next;
-        }
-        printf("sub-dominators finished\n");
-        printDoms(g, idom);
-
-        //
-        vs = List_getFirst(g->vs);
-        while (vs) {
-            V current = (V) vs->data;
-            Set_t idomSet = (Set_t) Property_get(idom, current);
-            List_t idomList = List_getFirst(Set_toList(idomSet));
-            List_t loop = idomList;
-            List_t nest = idomList;
-
-            while (loop) {
-                V x = (V) loop->data;
-                nest = idomList;
-
-                while (nest) {
-                    V y = (V) nest->data;
-                    Set_t domfory = Property_get(dom, y);
-
-                    if (Vertex_equals(x, y)) {
-                        nest = nest->next;
-                        continue;
-                    } else
-                        ;
-                    if (Set_exists(domfory, x))
-                        Property_set(deletable, x, (Poly_t) 1);
-                    else
-                        ;
-                    nest = nest->next;
-                }
-                loop = loop->next;
             }
-            globalDeletable = deletable;
-            Set_deleteAll(idomSet, (Poly_tyPred) idomDeletable);
-            Property_clear(deletable);
-            vs = vs->next;
         }
-    }// local scope
-
-    printf("i-dominators finished\n");
-    printDoms(g, idom);
-
-    Property_clear(preds);
-
-    // contruct tree
-    {
-        List_t vs = List_getFirst(g->vs);
-
-        tree = Tree_newWithName((Poly_tyEquals) Vertex_equals, String_concat(g->name, "domTree", 0));
+    }
+    return idom;
+}
 
-        // insert all graph vertex
-        while (vs) {
-            V v = (V) vs->data;
+// The returned tree holds the data of all graph vertices,
+// and an edge from each reachable vertex's idom to it.
+static Tree_t Graph_domTreeReal(T g, V startv, V *idom) {
+    Tree_t tree;
+    List_t vs;
 
-            // note that we should insert the data, not vertex
-            Tree_insertVertex(tree, v);
-            vs = vs->next;
-        }
+    tree = Tree_newWithName(g->equals, g->index, String_concat(g->name, "domTree", 0));
 
-        // insert domination edges
-        vs = List_getFirst(g->vs);
-        while (vs) {
-            V v = (V) vs->data;
-            Set_t idomSet = Property_get(idom, v);
-            List_t idomList = List_getFirst(Set_toList(idomSet));
-            int num = 0;
-            while (idomList) {
-                V from = (V) idomList->data;
-
-                Tree_insertEdge(tree, from, v);
-                num++;
-                idomList = idomList->next;
-            }
-            // if more that one idom, it must be our error.
-            if (num > 1)
-                Error_impossible();
+    // insert all graph vertex
+    vs = List_getFirst(g->vs);
+    while (vs) {
+        V v = (V) vs->data;
 
-            vs = vs->next;
-        }
+        Tree_insertVertex(tree, v->data);
+        vs = vs->next;
     }
 
-    if (idomProp)
-        *idomProp = idom;
-    else
-        Property_clear(idom);
-
-    if (domProp)
-        *domProp = dom;
-    else
-        Property_clear(dom);
+    // insert domination edges
+    vs = List_getFirst(g->vs);
+    while (vs) {
+        V v = (V) vs->data;
+        V from = idomOf(idom, startv, v);
 
+        if (from)
+            Tree_insertEdge(tree, from->data, v->data);
+        vs = vs->next;
+    }
     return tree;
 }
 
+// Calculate the dominance frontiers, by the "runner"
+// algorithm of Cooper, Harvey and Kennedy (after Cytron
+// et al.): "b" is in the frontier of every vertex on the
+// dominator-tree path from each predecessor of "b" up to,
+// but excluding, idom(b). Returns a list of vertex data
+// for each vertex index.
+static List_t *Graph_frontiers(T g, V startv, V *idom) {
+    Csr_t *csr = Graph_csr(g);
+    List_t *df;
+    // the last vertex added to each frontier, as one "b"
+    // may be reached from several predecessors.
+    V *last;
+    List_t vs;
 
-//////////////////////////////////////////////////////
-// dominator frontier
-
-// Return: Set<V>
-static Set_t Graph_dfDoit(T g, V n, Tree_t domTree, Property_t dom, Property_t idom, void (*markDf)(Poly_t, Set_t)) {
-    // Set<V>
-    Set_t dfSet = Set_new((Poly_tyEquals) Vertex_equals);
-    Set_t markSet = Set_new((Poly_tyEquals) g->equals);
-
-    List_t nedges = List_getFirst(n->edges);
-    // List<V>
-    List_t children = List_getFirst(Tree_children(domTree, n));
-
-    while (nedges) {
-        Ex e = nedges->data;
-        V y = e->to;
-        Set_t idomy = Property_get(idom, y);
-
-        // the idom set is empty
-        if (Set_size(idomy) == 0)
-            Set_insert(dfSet, y);
-
-        if (Set_size(idomy) > 1)
-            Error_impossible();
-
-
-        if (!Set_exists(idomy, n))
-            Set_insert(dfSet, y);
+    Mem_NEW_SIZE(df, g->numVs + 1);
+    Mem_NEW_SIZE(last, g->numVs + 1);
 
-        nedges = nedges->next;
-    }
+    vs = List_getFirst(g->vs);
+    while (vs) {
+        V b = (V) vs->data;
+        V stop = idomOf(idom, startv, b);
 
-    while (children) {
-        V c = (V) children->data;
-        Set_t dfOfc = Graph_dfDoit(g, c, domTree, dom, idom, markDf);
-        List_t dfOfcList = List_getFirst(Set_toList(dfOfc));
-        while (dfOfcList) {
-            V w = (V) dfOfcList->data;
-            Set_t domofw = Property_get(dom, w);
-            if (!domofw)
-                Error_impossible();
-            // if n does not dominate w, or if n==w
-            if (!Set_exists(domofw, n) || Vertex_equals(n, w))
-                Set_insert(dfSet, w);
+        vs = vs->next;
+        // unreachable
+        if (!idom[b->index])
+            continue;
+        for (long k = csr->predStart[b->index]; k < csr->predStart[b->index + 1]; k++) {
+            V runner = csr->preds[k];
 
-            dfOfcList = dfOfcList->next;
-        }
-        children = children->next;
-    }
-    // mark df set on data
-    printf("%s ==> [", Label_toString(((Ssa_Block_t) (n->data))->label));
-    {
-        List_t l = List_getFirst(Set_toList(dfSet));
-        while (l) {
-            V v = (V) l->data;
-            Label_t label = ((Ssa_Block_t) (v->data))->label;
-            printf("%s ", Label_toString(label));
-            Set_insert(markSet, v->data);
-            l = l->next;
+            if (!idom[runner->index])
+                continue;
+            while (runner != stop) {
+                if (last[runner->index] != b) {
+                    if (!df[runner->index])
+                        df[runner->index] = List_new();
+                    List_insertLast(df[runner->index], b->data);
+                    last[runner->index] = b;
+                }
+                runner = idomOf(idom, startv, runner);
+            }
         }
-        printf("]\n");
-        markDf(n->data, markSet);
     }
-    return dfSet;
-}
-
-static Poly_t localMap(V v) {
-    return v->data;
+    return df;
 }
 
 // mark each vertex df, when markDf!=0
 Tree_t Graph_df(T g, Poly_t start, void (*markDf)(Poly_t, Set_t)) {
-    // V -> Set_t<V>
-    Property_t domProp = Property_new((Poly_tyPlist) Vertex_plist);
-    // V -> Set_t<V>, may be empty
-    Property_t idomProp = Property_new((Poly_tyPlist) Vertex_plist);
-    // Tree<V>
-    Tree_t domTree = Graph_domTreeReal(g, start, &domProp, &idomProp);
-
-
-    V startv = searchVertex(g, start);
+    V startv;
+    V *idom;
+    List_t *df;
+    List_t vs;
 
-    // checking doms
-    dprintf("checking doms:\n");
-    printDoms(g, domProp);
-    dprintf("checking idoms:\n");
-    printDoms(g, idomProp);
+    assert(g);
+    assert(start);
 
-    dprintf("Graph_df starting:\n");
-    Graph_dfDoit(g, startv, domTree, domProp, idomProp, markDf);
+    startv = searchVertex(g, start);
+    idom = Graph_idoms(g, startv);
+    df = Graph_frontiers(g, startv, idom);
 
+    vs = List_getFirst(g->vs);
+    while (vs && markDf) {
+        V v = (V) vs->data;
 
-    Property_clear(domProp);
-    Property_clear(idomProp);
-    dprintf("Graph_df finished\n");
-    return Tree_map(domTree, g->equals, (Poly_tyId) localMap);
+        // only reachable vertices have a frontier
+        if (idom[v->index])
+            markDf(v->data, Set_fromList(g->equals, df[v->index] ? df[v->index] : List_new()));
+        vs = vs->next;
+    }
+    return Graph_domTreeReal(g, startv, idom);
 }
 
 Tree_t Graph_domTree(T g, Poly_t start) {
-    V startv = searchVertex(g, start);
-    Tree_t domTree = Graph_domTreeReal(g, startv, 0, 0);
-    return Tree_map(domTree, g->equals, (Poly_tyId) localMap);
+    V startv;
+
+    assert(g);
+    assert(start);
+
+    startv = searchVertex(g, start);
+    return Graph_domTreeReal(g, startv, Graph_idoms(g, startv));
 }
 
 List_t Graph_successors(T g, Poly_t k) {
     List_t result = List_new();
     V v = searchVertex(g, k);
-    List_t edges = List_getFirst(v->edges);
+    Csr_t *csr = Graph_csr(g);
 
-    while (edges) {
-        Ex e = (Ex) edges->data;
-        V to = e->to;
-
-        List_insertLast(result, to->data);
-        edges = edges->next;
-    }
+    for (long i = csr->succStart[v->index]; i < csr->succStart[v->index + 1]; i++)
+        List_insertLast(result, csr->succs[i]->data);
     return result;
 }
 
+// each predecessor appears once, even if it has several
+// edges to "k".
 List_t Graph_predessors(T g, Poly_t k) {
-    Set_t set = Set_new(g->equals);
+    List_t result = List_new();
     V v = searchVertex(g, k);
-    List_t vs = List_getFirst(g->vs);
+    Csr_t *csr = Graph_csr(g);
+    V last = 0;
 
-    while (vs) {
-        V which = (V) vs->data;
-        List_t edges = List_getFirst(which->edges);
-        while (edges) {
-            Ex e = (Ex) edges->data;
-            V to = e->to;
-            if (Vertex_equals(to, v))
-                Set_insert(set, which->data);
+    for (long i = csr->predStart[v->index]; i < csr->predStart[v->index + 1]; i++) {
+        V which = csr->preds[i];
 
-            edges = edges->next;
-        }
-        vs = vs->next;
+        // parallel edges from one vertex are adjacent
+        if (which == last)
+            continue;
+        List_insertLast(result, which->data);
+        last = which;
     }
-    return Set_toList(set);
+    return result;
 }
 
 
@@ -712,4 +604,3 @@ List_t Graph_predessors(T g, Poly_t k) {
 #undef V
 #undef Ex
 
-#undef dprintf
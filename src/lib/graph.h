@@ -14,9 +14,11 @@
 
 typedef struct T *T;
 
-T Graph_new(Poly_tyEquals equals);
+// "index" numbers the vertex data, which is how vertices
+// are found in constant time.
+T Graph_new(Poly_tyEquals equals, Poly_tyIndex index);
 
-T Graph_newWithName(Poly_tyEquals equals, String_t graphName);
+T Graph_newWithName(Poly_tyEquals equals, Poly_tyIndex index, String_t graphName);
 
 void Graph_insertVertex(T g, Poly_t data);
 
@@ -34,10 +36,23 @@ void Graph_toJpgWithName(T g, Poly_tyPrint printer, String_t fname);
 //                    , String_t fname
 //                    , Property_t edgeProp);
 
+long Graph_numVertices(T g);
+
+// visit the vertices reachable from "start", in preorder.
 void Graph_dfs(T g,
                Poly_t start,
                void (*visit)(Poly_t));
 
+// the vertices reachable from "start", in reverse postorder.
+List_t Graph_rpo(T g, Poly_t start);
+
+// depth-first numbers of "x", counting from 0 in a search
+// from "start", or -1 if "x" is unreachable. They are
+// cached until the graph changes.
+long Graph_preNum(T g, Poly_t start, Poly_t x);
+long Graph_postNum(T g, Poly_t start, Poly_t x);
+long Graph_rpoNum(T g, Poly_t start, Poly_t x);
+
 // Tree<Poly_t>
 Tree_t Graph_domTree(T g, Poly_t start);
 
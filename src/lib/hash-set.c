@@ -2,6 +2,7 @@
 #include "hash.h"
 #include "list.h"
 #include "mem.h"
+#include "thread.h"
 #include "unused.h"
 #include <assert.h>
 
@@ -122,7 +123,7 @@ T HashSet_union(T set1, T set2) {
 
 //////////////////////////////////////////////////
 // HashSet_unionVoid
-static T gset = 0;
+static Thread_local T gset = 0;
 
 static void localForeach(Poly_t x) {
     HashSet_insert(gset, x);
@@ -5,23 +5,45 @@
 #include "list.h"
 #include "mem.h"
 #include "string.h"
-#include "todo.h"
-#include "triple.h"
-#include "unused.h"
+#include "thread.h"
 #include <assert.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 
-#define INIT_SIZE 4096
-#define INIT_MASK 4095
-#define INIT_LOAD_FACTOR (0.25)
+// The table is open-addressed with Robin Hood probing:
+// every entry lives inline in the slot array, and an entry
+// that is farther from its home slot than the one sitting
+// in its way takes that slot over. Probe sequences hence
+// stay short even under a high load, a lookup may stop as
+// soon as it meets an entry closer to home than the key
+// it is after, and deletion just shifts the following run
+// back by one, so no tombstones are ever left behind.
+#define INIT_SIZE 8
+#define INIT_SHIFT 61
+#define INIT_LOAD_FACTOR (0.8)
+
+// Fibonacci hashing: the user hash code is multiplied by
+// 2^64/phi and the top bits are taken as the home slot,
+// so poor hash codes (e.g., sums of small numbers) still
+// spread over the whole table.
+#define GOLDEN 0x9e3779b97f4a7c15UL
 
 #define T Hash_t
 #define K Poly_t
 #define V Poly_t
 
+typedef struct {
+    // 0 for an empty slot
+    K key;
+    V value;
+    // the scrambled hash code, which is kept to grow the
+    // table without calling "hashCode" again
+    unsigned long hash;
+} Slot_t;
+
 struct T {
-    List_t *buckets;
+    Slot_t *slots;
 
     long (*hashCode)(K);
 
@@ -29,32 +51,58 @@ struct T {
 
     void (*dup)(K, K);
 
-    //void (*notFound)(K);
     long numItems;
     long size;
     long mask;
+    // home slot = hash >> shift
+    int shift;
     double load;
 };
 
-//T Hash_newRaw(long (*hashCode)(K), long (*equals)(K, K)) {
-//    return Hash_new(hashCode, equals, 0);
-//}
+typedef struct Status_t {
+    long insertions;
+    long lookups;
+    long links;
+    long longest;
+    long maxSize;
+    double maxLoad;
+    // the statistics of the thread linked before this one
+    struct Status_t *next;
+    int linked;
+} Status_t;
+
+// Statistics are kept per thread, so counting takes no
+// lock, and each thread links its own into "threads" the
+// first time it counts; "Hash_statusAll" sums them all up.
+// Only the main thread and the pool workers hash, and
+// they never exit, so the links stay valid.
+static Thread_local Status_t all = {0, 0, 0, 0, 0, 0.0, 0, 0};
+static Status_t *threads = 0;
+static pthread_mutex_t threadsLock = PTHREAD_MUTEX_INITIALIZER;
+
+static Status_t *status(void) {
+    if (!all.linked) {
+        pthread_mutex_lock(&threadsLock);
+        all.next = threads;
+        threads = &all;
+        all.linked = 1;
+        pthread_mutex_unlock(&threadsLock);
+    }
+    return &all;
+}
 
 T Hash_new(long (*hashCode)(K), long (*equals)(K, K), void (*dup)(K, K)) {
     T h;
 
     Mem_NEW(h);
-    Mem_NEW_SIZE(h->buckets, INIT_SIZE);
-
-    for (long i = 0; i < INIT_SIZE; i++)
-        *(h->buckets + i) = List_new();
+    Mem_NEW_SIZE(h->slots, INIT_SIZE);
     h->hashCode = hashCode;
     h->equals = equals;
     h->dup = dup;
-    //h->notFound = notFound;
     h->numItems = 0;
     h->size = INIT_SIZE;
-    h->mask = INIT_MASK;
+    h->mask = INIT_SIZE - 1;
+    h->shift = INIT_SHIFT;
     h->load = INIT_LOAD_FACTOR;
     return h;
 }
@@ -63,178 +111,174 @@ static double currentLoad(T h) {
     return 1.0 * (double) h->numItems / (double) h->size;
 }
 
-//T Hash_clone(T old) {
-//    T h;
-//    int i;
-//    int newSize = old->size * 2;
-//
-//    Mem_NEW(h);
-//    Mem_NEW_SIZE(h->buckets, newSize);
-//
-//    for (i = 0; i < newSize; i++)
-//        *(h->buckets + i) = List_new();
-//    h->numItems = old->numItems + 1;
-//    h->size = newSize;
-//    h->mask = newSize - 1;
-//    h->hashCode = old->hashCode;
-//    h->equals = old->equals;
-//    return h;
-//}
+static unsigned long scramble(T h, K k) {
+    return (unsigned long) h->hashCode(k) * GOLDEN;
+}
 
-typedef struct {
-    long insertions;
-    long lookups;
-    long links;
-    long longest;
-    long maxSize;
-    double maxLoad;
-} Status_t;
+static long home(T h, unsigned long hash) {
+    return (long) (hash >> h->shift);
+}
 
-static Status_t all = {0, 0, 0, 0, 0, 0.0};
+// how far the entry in slot "i" is from its home slot
+static long distance(T h, long i) {
+    return (i - home(h, h->slots[i].hash)) & h->mask;
+}
 
-void Hash_insert(T h, K k, V v) {
-    long initHc, hc;
-    List_t list;
-    K result;
+static void record(T h, long link) {
+    double load = currentLoad(h);
+    Status_t *s = status();
+
+    s->links += link;
+    if (link > s->longest)
+        s->longest = link;
+    if (h->size > s->maxSize)
+        s->maxSize = h->size;
+    if (load > s->maxLoad)
+        s->maxLoad = load;
+}
 
-    assert(h);
-    all.insertions++;
-    if (Hash_lookupCand(h, k, &result)) {
-        if (h->dup) {
-            h->dup(result, k);
+// the slot holding "k", or -1
+static long search(T h, K k, unsigned long hash) {
+    long i = home(h, hash);
+    long dist = 0;
+
+    while (h->slots[i].key && dist <= distance(h, i)) {
+        if (h->slots[i].hash == hash && h->equals(k, h->slots[i].key)) {
+            record(h, dist + 1);
+            return i;
         }
+        i = (i + 1) & h->mask;
+        dist++;
     }
-    initHc = h->hashCode(k);
-    hc = initHc & (h->mask);
-    list = *(h->buckets + hc);
-    List_insertFirst(list,
-                     Triple_new(k,
-                                (Poly_t) initHc, v));
-    h->numItems++;
-    if (currentLoad(h) >= h->load) {
-        List_t *oldBuckets, *newBuckets;
-        long oldSize, newSize;
-
-        oldBuckets = h->buckets;
-        oldSize = h->size;
-        newSize = oldSize * 2;
-        Mem_NEW_SIZE(newBuckets, newSize);
-        for (long i = 0; i < newSize; i++)
-            *(newBuckets + i) = List_new();
-        h->buckets = newBuckets;
-        h->size = newSize;
-        h->mask = newSize - 1;
-        for (long i = 0; i < oldSize; i++) {
-            List_t listx = *(oldBuckets + i);
-            listx = List_getFirst(listx);
-            while (listx) {
-                Triple_t t = (Triple_t) (listx->data);
-                Poly_t p = Triple_second(t);
-                long initHcx = (long) p;
-                List_insertLast(*(newBuckets + (initHcx & h->mask)), t);
-                list = list->next;
-            }
+    record(h, dist + 1);
+    return -1;
+}
+
+// "s" is known not to be in the table, and there is room.
+static void place(T h, Slot_t s) {
+    long i = home(h, s.hash);
+    long dist = 0;
+
+    while (h->slots[i].key) {
+        long d = distance(h, i);
+
+        if (d < dist) {
+            Slot_t tmp = h->slots[i];
+
+            h->slots[i] = s;
+            s = tmp;
+            dist = d;
         }
+        i = (i + 1) & h->mask;
+        dist++;
+    }
+    h->slots[i] = s;
+}
+
+static void grow(T h) {
+    Slot_t *old = h->slots;
+    long oldSize = h->size;
+
+    h->size = oldSize * 2;
+    h->mask = h->size - 1;
+    h->shift--;
+    Mem_NEW_SIZE(h->slots, h->size);
+    for (long i = 0; i < oldSize; i++)
+        if (old[i].key)
+            place(h, old[i]);
+}
+
+// A key already bound is re-bound, after "dup" has been
+// told, so the newest binding is the one found.
+void Hash_insert(T h, K k, V v) {
+    unsigned long hash;
+    long i;
+    Slot_t s;
+
+    assert(h);
+    assert(k);
+    status()->insertions++;
+    hash = scramble(h, k);
+    i = search(h, k, hash);
+    if (i >= 0) {
+        if (h->dup)
+            h->dup(h->slots[i].key, k);
+        h->slots[i].key = k;
+        h->slots[i].value = v;
+        return;
     }
+    if ((double) (h->numItems + 1) > h->load * (double) h->size)
+        grow(h);
+    s.key = k;
+    s.value = v;
+    s.hash = hash;
+    place(h, s);
+    h->numItems++;
     return;
 }
 
-static int longestChain(T h) {
-    int max = 0;
-    int current;
-    int i;
+static long longestProbe(T h) {
+    long max = 0;
 
-    for (i = 0; i < h->size; i++) {
-        current = List_size(*(h->buckets + i));
-        if (current > max)
-            max = current;
+    for (long i = 0; i < h->size; i++) {
+        if (h->slots[i].key && distance(h, i) + 1 > max)
+            max = distance(h, i) + 1;
     }
     return max;
 }
 
-static int numEmptyBuckets(T h) {
-    int empty = 0;
-    int i;
+static long numEmptySlots(T h) {
+    long empty = 0;
     assert(h);
 
-    for (i = 0; i < h->size; i++) {
-        if (List_isEmpty(*(h->buckets + i)))
+    for (long i = 0; i < h->size; i++) {
+        if (!h->slots[i].key)
             empty++;
     }
     return empty;
 }
 
 String_t Hash_status(T h) {
-    int empty;
     String_t s;
 
     assert(h);
-    empty = numEmptyBuckets(h);
     s = String_concat("number of items are: ",
                       Int_toString(h->numItems),
-                      "\nnumber of buckets: ",
+                      "\nnumber of slots: ",
                       Int_toString(h->size),
-                      "\nnumber of empty buckets: ",
-                      numEmptyBuckets(h),
-                      "\nnumber of not empty buckets: ",
-                      Int_toString(h->size - empty),
-                      "\nlongest chain size: ",
-                      Int_toString(longestChain(h)),
-                      "\ncrrent load factor: ",
+                      "\nnumber of empty slots: ",
+                      Int_toString(numEmptySlots(h)),
+                      "\nlongest probe: ",
+                      Int_toString(longestProbe(h)),
+                      "\ncurrent load factor: ",
+                      Double_toString(currentLoad(h)),
+                      "\nmaximal load factor: ",
                       Double_toString(h->load),
-                      "\ndefault load factor: ",
-                      Double_toString(INIT_LOAD_FACTOR),
                       0);
     return s;
 }
 
+double Hash_loadFactor(T h) {
+    assert(h);
+    return currentLoad(h);
+}
+
 V Hash_lookup(T h, K x) {
     return Hash_lookupCand(h, x, 0);
 }
 
 V Hash_lookupCand(T h, K x, K *result) {
-    long hc;
-    long link = 0;
-    double load;
-    List_t list;
+    long i;
 
     assert(h);
-
-    all.lookups++;
-    long size = Hash_size(h);
-    if (size > all.maxSize)
-        all.maxSize = size;
-    long ns = Hash_numItems(h);
-    load = 1.0 * (double) ns / (double) size;
-    if (load > all.maxLoad)
-        all.maxLoad = load;
-
-    hc = h->hashCode(x);
-    hc &= h->mask;
-
-    assert((hc >= 0 && hc < h->size));
-
-    list = List_getFirst(*(h->buckets + hc));
-    while (list) {
-        Triple_t t = (Triple_t) (list->data);
-        K key = Triple_first(t);
-        V value = Triple_third(t);
-
-        link++;
-        if (h->equals(x, key)) {
-            all.links += link;
-            if (link > all.longest)
-                all.longest = link;
-            if (result)
-                *result = key;
-            return value;
-        }
-        list = list->next;
-    }
-    all.links += link;
-    if (link > all.longest)
-        all.longest = link;
-    return 0;
+    assert(x);
+    status()->lookups++;
+    i = search(h, x, scramble(h, x));
+    if (i < 0)
+        return 0;
+    if (result)
+        *result = h->slots[i].key;
+    return h->slots[i].value;
 }
 
 V Hash_lookupOrInsert(T h, K k, V (*gen)(K)) {
@@ -248,9 +292,26 @@ V Hash_lookupOrInsert(T h, K k, V (*gen)(K)) {
 }
 
 void Hash_delete(T h, K k) {
-    UNUSED(h);
-    UNUSED(k);
-    TODO;
+    long i, next;
+
+    assert(h);
+    assert(k);
+    i = search(h, k, scramble(h, k));
+    if (i < 0)
+        Error_bug("Hash_delete: key not found");
+    // shift the rest of the run back, until an empty slot
+    // or an entry already at home.
+    next = (i + 1) & h->mask;
+    while (h->slots[next].key && distance(h, next) > 0) {
+        h->slots[i] = h->slots[next];
+        i = next;
+        next = (next + 1) & h->mask;
+    }
+    h->slots[i].key = 0;
+    h->slots[i].value = 0;
+    h->slots[i].hash = 0;
+    h->numItems--;
+    return;
 }
 
 long Hash_size(T h) {
@@ -264,50 +325,50 @@ long Hash_numItems(T h) {
 }
 
 void Hash_foreach(T h, void (*f)(K)) {
-    int index;
-    List_t list;
-
-    for (index = 0; index < h->size; index++) {
-        list = List_getFirst(*(h->buckets + index));
-        while (list) {
-            Triple_t t = (Triple_t) (list->data);
-            K key = Triple_first(t);
-
-            f(key);
-            list = list->next;
-        }
+    assert(h);
+    for (long i = 0; i < h->size; i++) {
+        if (h->slots[i].key)
+            f(h->slots[i].key);
     }
     return;
 }
 
 List_t Hash_keyToList(T h) {
-    int index;
-    List_t list;
     List_t result = List_new();
 
-    for (index = 0; index < h->size; index++) {
-        list = List_getFirst(*(h->buckets + index));
-        while (list) {
-            Triple_t t = (Triple_t) (list->data);
-            K key = Triple_first(t);
-
-            List_insertLast(result, key);
-            list = list->next;
-        }
+    assert(h);
+    for (long i = 0; i < h->size; i++) {
+        if (h->slots[i].key)
+            List_insertLast(result, h->slots[i].key);
     }
     return result;
 }
 
-void Hash_statusAll() {
+void Hash_statusAll(void) {
+    Status_t sum = {0, 0, 0, 0, 0, 0.0, 0, 0};
+
+    pthread_mutex_lock(&threadsLock);
+    for (Status_t *s = threads; s; s = s->next) {
+        sum.insertions += s->insertions;
+        sum.lookups += s->lookups;
+        sum.links += s->links;
+        if (s->longest > sum.longest)
+            sum.longest = s->longest;
+        if (s->maxSize > sum.maxSize)
+            sum.maxSize = s->maxSize;
+        if (s->maxLoad > sum.maxLoad)
+            sum.maxLoad = s->maxLoad;
+    }
+    pthread_mutex_unlock(&threadsLock);
     printf("%s\n", "Hash table status:");
-    printf("  Num of insertions: %ld\n", all.insertions);
-    printf("  Num of lookups   : %ld\n", all.lookups);
-    printf("  Num of links     : %ld\n", all.links);
-    printf("  Longest chain    : %ld\n", all.longest);
-    printf("  Max hash size    : %ld\n", all.maxSize);
-    printf("  Max load factor  : %lf\n", all.maxLoad);
-    printf("  Average position : %lf\n",
-           1.0 * (double) all.links / (double) all.lookups);
+    printf("  Num of insertions: %ld\n", sum.insertions);
+    printf("  Num of lookups   : %ld\n", sum.lookups);
+    printf("  Num of probes    : %ld\n", sum.links);
+    printf("  Longest probe    : %ld\n", sum.longest);
+    printf("  Max hash size    : %ld\n", sum.maxSize);
+    printf("  Max load factor  : %lf\n", sum.maxLoad);
+    printf("  Average probe    : %lf\n",
+           1.0 * (double) sum.links / (double) (sum.insertions + sum.lookups));
     return;
 }
 
@@ -9,13 +9,17 @@
 #define T List_t
 #define P Poly_t
 
+// the count kept beside a head node
+#define SIZE(l) (((struct List_Head_t *) (l))->size)
+
 T List_new() {
-    T l;
+    struct List_Head_t *h;
 
-    Mem_NEW(l);
-    l->data = 0;
-    l->next = 0;
-    return l;
+    Mem_NEW(h);
+    h->node.data = 0;
+    h->node.next = 0;
+    h->size = 0;
+    return &h->node;
 }
 
 static T List_new2(P x, T l) {
@@ -32,16 +36,8 @@ int List_isEmpty(T l) {
 }
 
 int List_size(T l) {
-    T p;
-    int i = 0;
-
     assert(l);
-    p = l->next;
-    while (p) {
-        i++;
-        p = p->next;
-    }
-    return i;
+    return (int) SIZE(l);
 }
 
 void List_append(T l1, T l2) {
@@ -70,12 +66,15 @@ void List_delete(T l, P x, Poly_tyEquals equals) {
         if (equals(x, current->data)) {
             current = current->next;
             prev->next = current;
+            SIZE(l)--;
             continue;
         } else
             ;
         prev = current;
         current = current->next;
     }
+    // "prev" is the last node left, or the head itself
+    l->data = (prev == l) ? 0 : prev;
     //    return;
 }
 
@@ -89,6 +88,9 @@ Poly_t List_removeHead(T l) {
     assert(l);
     p = l->next;
     l->next = l->next->next;
+    SIZE(l)--;
+    if (!l->next)
+        l->data = 0;
     return p->data;
 }
 
@@ -105,12 +107,14 @@ void List_deleteAll(T l, Poly_tyPred pred) {
         if (pred(current->data)) {
             current = current->next;
             prev->next = current;
+            SIZE(l)--;
             continue;
         } else
             ;
         prev = current;
         current = current->next;
     }
+    l->data = (prev == l) ? 0 : prev;
     //    return;
 }
 
@@ -134,12 +138,27 @@ T List_concat(T l1, T l2) {
     return result;
 }
 
+T List_copy(T l) {
+    List_t result, p;
+
+    assert(l);
+
+    result = List_new();
+    p = List_getFirst(l);
+    while (p) {
+        List_insertLast(result, p->data);
+        p = p->next;
+    }
+    return result;
+}
+
 void List_appendNode(T l1, T l2) {
     List_t tail;
 
     assert(l1);
     assert(l2);
 
+    SIZE(l1)++;
     if (l1->next == 0) {
         l1->next = l2;
         l1->data = l2;
@@ -162,9 +181,10 @@ void List_insertFirst(T l, P x) {
 
     assert(l);
     t = List_new2(x, l->next);
-    l->next = t;
-    if (l->data == 0)
+    if (l->next == 0)
         l->data = t;
+    l->next = t;
+    SIZE(l)++;
     //    return;
 }
 
@@ -180,6 +200,7 @@ void List_insertLast(T l, P x) {
     p = List_new2(x, 0);
     tail->next = p;
     l->data = p;
+    SIZE(l)++;
     //    return;
 }
 
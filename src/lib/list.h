@@ -14,6 +14,16 @@ struct T {
     List_t next;
 };
 
+// A list has a head node, which holds no element: its
+// "data" points to the last node, for constant-time
+// "List_insertLast". Only the head also counts the
+// elements, so it is allocated as a "struct List_Head_t";
+// the element nodes stay plain "struct List_t".
+struct List_Head_t {
+    struct T node;
+    long size;
+};
+
 typedef P (*Poly_tyFold)(P, P);
 
 typedef File_t (*Poly_tyListPrint)(File_t, P);
@@ -22,6 +32,9 @@ T List_new(void);
 
 T List_concat(T, T);
 
+// a fresh spine holding the same elements as "l".
+T List_copy(T l);
+
 int List_isEmpty(T l);
 
 int List_size(T l);
@@ -1,64 +1,211 @@
 #include <assert.h>
+#include <pthread.h>
 #include <stdio.h>
 
 #include "gc.h"
 #include "mem.h"
+#include "thread.h"
 
 long Mem_allocated = 0;
 long Mem_initFlag = 0;
 
-/* the accumulated time should include GC time */
-static clock_t totalClocks = 0;
+// Arenas are a list of chunks. Each thread bumps a pointer
+// into a chunk of its own, so allocation takes no lock;
+// only taking a new chunk does. Chunks come from "calloc",
+// so the memory handed out is zeroed in bulk rather than
+// byte by byte.
+#define CHUNK_SIZE (1024 * 1024)
+#define ALIGN 16
+
+typedef struct Chunk_t *Chunk_t;
+
+struct Chunk_t {
+    Chunk_t next;
+    long size;
+    long used;
+    // payload follows, aligned to ALIGN
+};
+
+#define CHUNK_HEADER ((long) ((sizeof(struct Chunk_t) + ALIGN - 1) & ~(unsigned long) (ALIGN - 1)))
+
+typedef struct {
+    Chunk_t chunks;
+    // bytes held by this arena, including chunk slack
+    long size;
+    // the largest "size" ever seen
+    long peak;
+    long numReleases;
+} Arena_t;
+
+// guards "arenas" and "Mem_allocated"
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+
+static Arena_t arenas[MEM_ARENA_NUM];
+
+static Thread_local Mem_Arena_t current = MEM_ARENA_GLOBAL;
+
+// the chunk this thread bumps into, for each arena, and
+// the "numReleases" of that arena when the chunk was
+// taken: a chunk taken before the last release is gone.
+static Thread_local Chunk_t mine[MEM_ARENA_NUM];
+static Thread_local long epochs[MEM_ARENA_NUM];
+
+static char *arenaNames[MEM_ARENA_NUM] = {
+        "global",
+        "ast",
+        "hil",
+        "ssa",
+        "machine"};
 
 void Mem_init(void) {
     //GC_INIT();
-    totalClocks = 0;
+    current = MEM_ARENA_GLOBAL;
 }
 
-#undef GC_MALLOC
-#define GC_MALLOC malloc
-
-void *Mem_alloc(long size) {
-    void *p;
-    clock_t start, finish;
+static Chunk_t Chunk_new(long size) {
+    Chunk_t c;
+    long total = CHUNK_HEADER + size;
 
-    start = clock();
-    p = GC_MALLOC((unsigned long) size);
-    if (0 == p)
+    c = calloc(1, (unsigned long) total);
+    if (0 == c)
         Error_error("allocation failed\n");
+    c->next = 0;
+    c->size = size;
+    c->used = 0;
+    return c;
+}
+
+// take a new chunk for "size" bytes, with "lock" held.
+static char *allocSlow(Mem_Arena_t a, long size) {
+    Arena_t *arena = &arenas[a];
+    Chunk_t c;
 
-    // initialized it with zeros to catch bugs
-    {
-        char *cp = (char *) p;
-        assert(cp);
-        for (long i = 0; i < size; i++)
-            cp[i] = '\0';
+    if (mine[a] && size > CHUNK_SIZE / 4) {
+        // big objects get a chunk of their own, which
+        // keeps the free space in the current one.
+        c = Chunk_new(size);
+    } else {
+        c = Chunk_new(size > CHUNK_SIZE ? size : CHUNK_SIZE);
+        mine[a] = c;
+        epochs[a] = arena->numReleases;
     }
+    c->used = size;
+    c->next = arena->chunks;
+    arena->chunks = c;
+    arena->size += CHUNK_HEADER + c->size;
+    if (arena->size > arena->peak)
+        arena->peak = arena->size;
+    return (char *) c + CHUNK_HEADER;
+}
+
+void *Mem_allocIn(Mem_Arena_t a, long size) {
+    Chunk_t c;
+    char *p;
 
-    // status info
-    Mem_allocated += size;
-    finish = clock();
-    totalClocks += (finish - start);
+    assert(a < MEM_ARENA_NUM);
+    size = (size + ALIGN - 1) & ~(long) (ALIGN - 1);
+    if (size == 0)
+        size = ALIGN;
+
+    c = mine[a];
+    if (c && epochs[a] != arenas[a].numReleases)
+        c = mine[a] = 0;
+    if (c && c->used + size <= c->size) {
+        p = (char *) c + CHUNK_HEADER + c->used;
+        c->used += size;
+        return p;
+    }
+    pthread_mutex_lock(&lock);
+    p = allocSlow(a, size);
+    pthread_mutex_unlock(&lock);
     return p;
 }
 
-clock_t Mem_getClock(void) {
-    return totalClocks;
+void *Mem_alloc(long size) {
+    return Mem_allocIn(current, size);
+}
+
+// the arena is per thread
+Mem_Arena_t Mem_Arena_enter(Mem_Arena_t a) {
+    Mem_Arena_t old = current;
+
+    assert(a < MEM_ARENA_NUM);
+    current = a;
+    return old;
+}
+
+Mem_Arena_t Mem_Arena_current(void) {
+    return current;
+}
+
+// no other thread may be allocating in "a" meanwhile.
+void Mem_Arena_release(Mem_Arena_t a) {
+    Arena_t *arena;
+    Chunk_t c;
+
+    if (a == MEM_ARENA_GLOBAL)
+        Error_bug("cannot release the global arena");
+    if (a == current)
+        Error_bug("cannot release the current arena");
+
+    pthread_mutex_lock(&lock);
+    arena = &arenas[a];
+    c = arena->chunks;
+    while (c) {
+        Chunk_t next = c->next;
+        Mem_allocated += c->used;
+        free(c);
+        c = next;
+    }
+    arena->chunks = 0;
+    arena->size = 0;
+    arena->numReleases++;
+    pthread_mutex_unlock(&lock);
+}
+
+long Mem_Arena_size(Mem_Arena_t a) {
+    assert(a < MEM_ARENA_NUM);
+    return arenas[a].size;
 }
 
 #define ONEM (1024 * 1024)
 
+// "Mem_allocated" counts the bytes in the released
+// chunks, to which the live ones are added here.
+static long total(void) {
+    long n = Mem_allocated;
+
+    for (int i = 0; i < MEM_ARENA_NUM; i++) {
+        for (Chunk_t c = arenas[i].chunks; c; c = c->next)
+            n += c->used;
+    }
+    return n;
+}
+
+long Mem_total(void) {
+    long n;
+
+    pthread_mutex_lock(&lock);
+    n = total();
+    pthread_mutex_unlock(&lock);
+    return n;
+}
+
 void Mem_status(void) {
-    unsigned long total = 0, sinceLast = 0;
+    long n;
 
-    //total = GC_get_total_bytes();
-    //sinceLast = GC_get_bytes_since_gc();
+    pthread_mutex_lock(&lock);
+    n = total();
     printf("Heap status:\n"
-           "  Total allocation        : %lu bytes (~%ldM)\n"
-           "  Allocation since last GC: %ld bytes (~%ldM)\n",
-           total, total / ONEM,
-           sinceLast, sinceLast / ONEM);
-
-    Mem_allocated = 0;
+           "  Total allocation        : %ld bytes (~%ldM)\n",
+           n, n / ONEM);
+    for (int i = 0; i < MEM_ARENA_NUM; i++) {
+        printf("  Arena %-8s: %ld bytes now, %ld bytes peak, %ld releases\n",
+               arenaNames[i],
+               arenas[i].size,
+               arenas[i].peak,
+               arenas[i].numReleases);
+    }
+    pthread_mutex_unlock(&lock);
     return;
 }
@@ -9,6 +9,21 @@
 extern long Mem_allocated;
 extern long Mem_initFlag;
 
+// Every allocation goes into an arena. There is one
+// arena per IR generation, plus a global one for data
+// that outlives any single generation (atoms, interned
+// strings, command-line state). A generation's arena is
+// released wholesale once the next generation has been
+// built from it.
+typedef enum {
+    MEM_ARENA_GLOBAL,
+    MEM_ARENA_AST,
+    MEM_ARENA_HIL,
+    MEM_ARENA_SSA,
+    MEM_ARENA_MACHINE,
+    MEM_ARENA_NUM
+} Mem_Arena_t;
+
 #define Mem_NEW(p)                     \
     do {                               \
         (p) = Mem_alloc(sizeof(*(p))); \
@@ -22,12 +37,37 @@ extern long Mem_initFlag;
         (p) = Mem_alloc((long) new_n);                              \
     } while (0)
 
+// allocate "p" in the arena "a", regardless of the
+// current one.
+#define Mem_NEW_IN(p, a)                      \
+    do {                                      \
+        (p) = Mem_allocIn((a), sizeof(*(p))); \
+    } while (0)
+
+// allocate from the current arena, the memory is zeroed.
 void *Mem_alloc(long size);
 
-clock_t Mem_getClock(void);
+void *Mem_allocIn(Mem_Arena_t a, long size);
+
+// make "a" the current arena of this thread, and return
+// the old one.
+Mem_Arena_t Mem_Arena_enter(Mem_Arena_t a);
+
+Mem_Arena_t Mem_Arena_current(void);
+
+// free all memory in arena "a" at once. It is an error
+// to release the global arena, or to release an arena
+// some other thread is allocating in.
+void Mem_Arena_release(Mem_Arena_t a);
+
+// bytes currently held by arena "a".
+long Mem_Arena_size(Mem_Arena_t a);
 
 void Mem_init(void);
 
+// bytes allocated so far, in all arenas
+long Mem_total(void);
+
 void Mem_status(void);
 
 #endif
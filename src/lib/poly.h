@@ -17,6 +17,9 @@ typedef void (*Poly_tyVoid)(T);
 
 typedef long (*Poly_tyPred)(T);
 
+// a small, unique index of an object, counting from 0
+typedef long (*Poly_tyIndex)(T);
+
 #undef T
 
 #endif
@@ -1,133 +1,123 @@
 #include "property.h"
-#include "double.h"
 #include "int.h"
-#include "list.h"
 #include "mem.h"
-#include "tuple.h"
+#include "thread.h"
 #include <assert.h>
+#include <string.h>
 
 #define T Property_t
 #define K Poly_t
 #define V Poly_t
 
+#define INIT_SIZE 64
+
+typedef struct {
+    V value;
+    // the slot is valid only if this is the current
+    // generation of its property.
+    unsigned long stamp;
+} Slot_t;
+
 struct T {
-    int i;
-    List_t plists;
+    // indexed by the key's index
+    Slot_t *slots;
+    long size;
+    // bumped on each "clear", which invalidates all slots.
+    // Starts from 1, as fresh slots are zeroed.
+    unsigned long generation;
 
-    Plist_t (*getPlist)(Poly_t);
+    Poly_tyIndex index;
 
     V(*init)
     (K);
 };
 
-static int counter = 0;
-static int numGets = 0;
-static int numLinks = 0;
-// the longest path a "get" walks
-static int longestPath = 0;
-
-T Property_new(Plist_t (*get)(K)) {
-    T t;
+// statistics are kept per thread
+static Thread_local long numGets = 0;
+static Thread_local long numGrows = 0;
+// the largest table ever allocated
+static Thread_local long largestSize = 0;
 
-    Mem_NEW(t);
-    t->i = counter++;
-    t->plists = List_new();
-    t->getPlist = get;
-    t->init = 0;
-    return t;
+T Property_new(Poly_tyIndex index) {
+    return Property_newInitFun(index, 0);
 }
 
-T Property_newInitFun(Plist_t (*get)(K), V (*init)(K)) {
+T Property_newInitFun(Poly_tyIndex index, V (*init)(K)) {
     T t;
 
+    assert(index);
     Mem_NEW(t);
-    t->i = counter++;
-    t->plists = List_new();
-    t->getPlist = get;
+    t->slots = 0;
+    t->size = 0;
+    t->generation = 1;
+    t->index = index;
     t->init = init;
     return t;
 }
 
+// make sure "i" has a slot
+static void grow(T prop, long i) {
+    Slot_t *slots;
+    long size = prop->size ? prop->size : INIT_SIZE;
+
+    while (size <= i)
+        size *= 2;
+    Mem_NEW_SIZE(slots, size);
+    if (prop->size)
+        memcpy(slots, prop->slots, (unsigned long) prop->size * sizeof(*slots));
+    prop->slots = slots;
+    prop->size = size;
+    ++numGrows;
+    if (size > largestSize)
+        largestSize = size;
+}
+
 void Property_set(T prop, K k, V v) {
-    Tuple_t tuple;
-    Plist_t plist;
+    long i;
 
     assert(prop);
     assert(k);
-    plist = prop->getPlist(k);
-    assert(plist);
-    tuple = Tuple_new((Poly_t) prop, v);
-    List_insertFirst(plist, tuple);
-    List_insertFirst(prop->plists, plist);
+    i = prop->index(k);
+    assert(i >= 0);
+    if (i >= prop->size)
+        grow(prop, i);
+    prop->slots[i].value = v;
+    prop->slots[i].stamp = prop->generation;
     //    return;
 }
 
 V Property_get(T prop, K k) {
-    Plist_t plist;
-    List_t p;
-    int thisPath = 0;
+    long i;
     V v = 0;
 
     assert(prop);
     assert(k);
-    plist = prop->getPlist(k);
-    p = List_getFirst(plist);
+    i = prop->index(k);
+    assert(i >= 0);
     ++numGets;
-    while (p) {
-        Tuple_t t = (Tuple_t) p->data;
-
-        ++numLinks;
-        ++thisPath;
-        if (Tuple_first(t) == prop) {
-            if (thisPath > longestPath)
-                longestPath = thisPath;
-
-            return Tuple_second(t);
-        }
-        p = p->next;
-    }
+    if (i < prop->size && prop->slots[i].stamp == prop->generation)
+        return prop->slots[i].value;
     // if the init is there, then set the new value and
     // return it.
     if (prop->init) {
         v = prop->init(k);
         Property_set(prop, k, v);
     }
-    if (thisPath > longestPath)
-        longestPath = thisPath;
     return v;
 }
 
 void Property_clear(T prop) {
-    List_t plists;
-    Plist_t prev;
-    Tuple_t tuple;
-
     assert(prop);
-    plists = List_getFirst(prop->plists);
-    while (plists) {
-        prev = (Plist_t) plists->data;
-        while (prev->next) {
-            tuple = (Tuple_t) prev->next->data;
-            if (Tuple_first(tuple) == prop) {
-                prev->next = prev->next->next;
-                continue;
-            }
-            prev = prev->next;
-        }
-        plists = plists->next;
-    }
+    prop->generation++;
 }
 
 String_t Property_status() {
-    String_t average;
-    if (numGets)
-        average = Double_toString(numLinks * 1.0 / numGets);
-    else
-        average = "0.0";
-    return String_concat("plist peeks: ",
+    return String_concat("property gets: ",
                          Int_toString(numGets),
-                         ", average position: ",
-                         average,
+                         ", table grows: ",
+                         Int_toString(numGrows),
+                         ", largest table: ",
+                         Int_toString(largestSize),
                          0);
 }
 
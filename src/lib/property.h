@@ -2,24 +2,27 @@
 #define PROPERTY_H
 
 #include "poly.h"
-#include "property-list.h"
 #include "string.h"
 
 #define T Property_t
 #define K Poly_t
 #define V Poly_t
-#define P Plist_t
 
+// A property maps keys to values. Every key must carry a
+// small, unique and sequential index ("Id_index",
+// "Label_index", ...), which picks its slot in a growable
+// table, so "get" and "set" take constant time, and so
+// does "clear".
 typedef struct T *T;
 
 typedef V (*Poly_tyPropInit)(K);
 
-T Property_new(Poly_tyPlist);
+T Property_new(Poly_tyIndex);
 // take an extra "init" argument, which will be called
 // when the search failed on some item "k", and the
 // generated
 // "V" will be set on that item "k".
-T Property_newInitFun(Poly_tyPlist, V (*init)(K));
+T Property_newInitFun(Poly_tyIndex, V (*init)(K));
 void Property_set(T prop, K k, V v);
 V Property_get(T, K k);
 void Property_clear(T prop);
@@ -28,6 +31,5 @@ String_t Property_status(void);
 #undef T
 #undef K
 #undef V
-#undef P
 
 #endif
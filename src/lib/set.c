@@ -4,60 +4,323 @@
 #include <assert.h>
 
 #define T Set_t
+#define U Set_Universe_t
+
+#define WORD_BITS ((long) (8 * sizeof(unsigned long)))
+
+struct U {
+    long size;
+
+    Poly_tyIndex index;
+
+    Poly_t *members;
+};
 
 struct T {
+    enum {
+        SET_LIST,
+        SET_BITS,
+        SET_SPARSE
+    } kind;
     Poly_tyEquals equals;
-    // use a very slow list-based set representation for now
+    // SET_LIST: a very slow list-based set representation,
+    // for members which have no numbering.
     List_t list;
+    // SET_BITS and SET_SPARSE: members are numbered by
+    // the universe.
+    U universe;
+    // SET_BITS: one bit per member of the universe
+    unsigned long *bits;
+    // SET_SPARSE: "dense[0..num)" holds the member numbers,
+    // and "sparse[i]" is the position of "i" in "dense".
+    long *dense;
+    long *sparse;
+    long num;
 };
 
+///////////////////////////////////////////////////////
+// universe
+U Set_Universe_new(long size, Poly_tyIndex index, Poly_t *members) {
+    U u;
+
+    assert(size >= 0);
+    assert(index);
+    assert(members || size == 0);
+    Mem_NEW(u);
+    u->size = size;
+    u->index = index;
+    u->members = members;
+    return u;
+}
+
+long Set_Universe_size(U u) {
+    assert(u);
+    return u->size;
+}
+
+static long numWords(U u) {
+    return (u->size + WORD_BITS - 1) / WORD_BITS;
+}
+
+static long indexOf(T set, Poly_t x) {
+    long i = set->universe->index(x);
+
+    assert(i >= 0 && i < set->universe->size);
+    return i;
+}
+
+///////////////////////////////////////////////////////
+// creation
 T Set_new(Poly_tyEquals equals) {
     T set;
 
     Mem_NEW(set);
+    set->kind = SET_LIST;
     set->equals = equals;
     set->list = List_new();
     return set;
 }
 
+static long bitsEquals(Poly_t x, Poly_t y) {
+    return x == y;
+}
+
+T Set_newBits(U u) {
+    T set;
+
+    assert(u);
+    Mem_NEW(set);
+    set->kind = SET_BITS;
+    set->equals = (Poly_tyEquals) bitsEquals;
+    set->universe = u;
+    // "Mem_NEW_SIZE" rejects empty buffers
+    Mem_NEW_SIZE(set->bits, numWords(u) + 1);
+    return set;
+}
+
+T Set_newSparse(U u) {
+    T set;
+
+    assert(u);
+    Mem_NEW(set);
+    set->kind = SET_SPARSE;
+    set->equals = (Poly_tyEquals) bitsEquals;
+    set->universe = u;
+    Mem_NEW_SIZE(set->dense, u->size + 1);
+    Mem_NEW_SIZE(set->sparse, u->size + 1);
+    set->num = 0;
+    return set;
+}
+
+T Set_fullBits(U u) {
+    T set = Set_newBits(u);
+    long words = numWords(u);
+    long rest = u->size % WORD_BITS;
+
+    for (long i = 0; i < words; i++)
+        set->bits[i] = ~0UL;
+    if (rest)
+        set->bits[words - 1] = (1UL << rest) - 1;
+    return set;
+}
+
+static T newLike(T set) {
+    switch (set->kind) {
+        case SET_LIST:
+            return Set_new(set->equals);
+        case SET_BITS:
+            return Set_newBits(set->universe);
+        case SET_SPARSE:
+            return Set_newSparse(set->universe);
+        default:
+            Error_impossible();
+            return 0;
+    }
+}
+
+static int sameBits(T set1, T set2) {
+    return set1->kind == SET_BITS && set2->kind == SET_BITS && set1->universe == set2->universe;
+}
+
+///////////////////////////////////////////////////////
+// iteration over all kinds of sets
+typedef struct {
+    T set;
+    long i;
+    List_t p;
+} Iter_t;
+
+static void Iter_init(Iter_t *it, T set) {
+    it->set = set;
+    it->i = 0;
+    it->p = (set->kind == SET_LIST) ? List_getFirst(set->list) : 0;
+}
+
+static int Iter_next(Iter_t *it, Poly_t *x) {
+    T set = it->set;
+
+    switch (set->kind) {
+        case SET_LIST:
+            if (!it->p)
+                return 0;
+            *x = it->p->data;
+            it->p = it->p->next;
+            return 1;
+        case SET_BITS:
+            while (it->i < set->universe->size) {
+                long w = it->i / WORD_BITS;
+                unsigned long word = set->bits[w] >> (it->i % WORD_BITS);
+
+                if (!word) {
+                    it->i = (w + 1) * WORD_BITS;
+                    continue;
+                }
+                it->i += __builtin_ctzl(word);
+                *x = set->universe->members[it->i];
+                it->i++;
+                return 1;
+            }
+            return 0;
+        case SET_SPARSE:
+            if (it->i >= set->num)
+                return 0;
+            *x = set->universe->members[set->dense[it->i++]];
+            return 1;
+        default:
+            Error_impossible();
+            return 0;
+    }
+}
+
+///////////////////////////////////////////////////////
+// operations
 int Set_exists(T set, Poly_t x) {
     List_t p;
 
     assert(set);
 
-    p = List_getFirst(set->list);
-    while (p) {
-        if (set->equals(x, p->data))
-            return 1;
-        p = p->next;
+    switch (set->kind) {
+        case SET_LIST:
+            p = List_getFirst(set->list);
+            while (p) {
+                if (set->equals(x, p->data))
+                    return 1;
+                p = p->next;
+            }
+            return 0;
+        case SET_BITS: {
+            long i = indexOf(set, x);
+            return (int) ((set->bits[i / WORD_BITS] >> (i % WORD_BITS)) & 1);
+        }
+        case SET_SPARSE: {
+            long i = indexOf(set, x);
+            long s = set->sparse[i];
+            return s < set->num && set->dense[s] == i;
+        }
+        default:
+            Error_impossible();
+            return 0;
     }
-    return 0;
+}
+
+static void sparseDelete(T set, long i) {
+    long s = set->sparse[i];
+    long last;
+
+    if (s >= set->num || set->dense[s] != i)
+        return;
+    last = set->dense[--set->num];
+    set->dense[s] = last;
+    set->sparse[last] = s;
 }
 
 void Set_delete(T set, Poly_t x) {
     assert(set);
-    List_delete(set->list, x, set->equals);
+
+    switch (set->kind) {
+        case SET_LIST:
+            List_delete(set->list, x, set->equals);
+            break;
+        case SET_BITS: {
+            long i = indexOf(set, x);
+            set->bits[i / WORD_BITS] &= ~(1UL << (i % WORD_BITS));
+            break;
+        }
+        case SET_SPARSE:
+            sparseDelete(set, indexOf(set, x));
+            break;
+        default:
+            Error_impossible();
+            break;
+    }
     //    return;
 }
 
 // delete all items x for pred(x) is true
 void Set_deleteAll(T set, Poly_tyPred pred) {
     assert(set);
-    List_deleteAll(set->list, pred);
+
+    switch (set->kind) {
+        case SET_LIST:
+            List_deleteAll(set->list, pred);
+            break;
+        case SET_BITS:
+            for (long i = 0; i < set->universe->size; i++) {
+                unsigned long mask = 1UL << (i % WORD_BITS);
+
+                if ((set->bits[i / WORD_BITS] & mask) && pred(set->universe->members[i]))
+                    set->bits[i / WORD_BITS] &= ~mask;
+            }
+            break;
+        case SET_SPARSE:
+            // deletion moves the last member, so walk backwards
+            for (long s = set->num - 1; s >= 0; s--) {
+                long i = set->dense[s];
+
+                if (pred(set->universe->members[i]))
+                    sparseDelete(set, i);
+            }
+            break;
+        default:
+            Error_impossible();
+            break;
+    }
     //    return;
 }
 
 void Set_foreach(T set, Poly_tyVoid f) {
+    Iter_t it;
+    Poly_t x;
+
     assert(set);
 
-    List_foreach(set->list, f);
+    if (set->kind == SET_LIST) {
+        List_foreach(set->list, f);
+        return;
+    }
+    Iter_init(&it, set);
+    while (Iter_next(&it, &x))
+        f(x);
     //    return;
 }
 
 int Set_isEmpty(T set) {
     assert(set);
 
-    return List_isEmpty(set->list);
+    switch (set->kind) {
+        case SET_LIST:
+            return List_isEmpty(set->list);
+        case SET_BITS:
+            for (long i = 0; i < numWords(set->universe); i++)
+                if (set->bits[i])
+                    return 0;
+            return 1;
+        case SET_SPARSE:
+            return set->num == 0;
+        default:
+            Error_impossible();
+            return 1;
+    }
 }
 
 // Remove one element from a set.
@@ -67,26 +330,84 @@ Poly_t Set_removeOne(T set) {
     if (Set_isEmpty(set))
         Error_impossible();
 
-    return List_removeHead(set->list);
+    switch (set->kind) {
+        case SET_LIST:
+            return List_removeHead(set->list);
+        case SET_BITS:
+            for (long w = 0; w < numWords(set->universe); w++) {
+                if (set->bits[w]) {
+                    long i = w * WORD_BITS + __builtin_ctzl(set->bits[w]);
+
+                    set->bits[w] &= set->bits[w] - 1;
+                    return set->universe->members[i];
+                }
+            }
+            Error_impossible();
+            return 0;
+        case SET_SPARSE:
+            return set->universe->members[set->dense[--set->num]];
+        default:
+            Error_impossible();
+            return 0;
+    }
 }
 
 void Set_insert(T set, Poly_t x) {
-    if (Set_exists(set, x))
-        return;
-    List_insertLast(set->list, x);
+    assert(set);
+
+    switch (set->kind) {
+        case SET_LIST:
+            if (Set_exists(set, x))
+                return;
+            List_insertLast(set->list, x);
+            break;
+        case SET_BITS: {
+            long i = indexOf(set, x);
+            set->bits[i / WORD_BITS] |= 1UL << (i % WORD_BITS);
+            break;
+        }
+        case SET_SPARSE: {
+            long i = indexOf(set, x);
+            long s = set->sparse[i];
+
+            if (s < set->num && set->dense[s] == i)
+                return;
+            set->dense[set->num] = i;
+            set->sparse[i] = set->num++;
+            break;
+        }
+        default:
+            Error_impossible();
+            break;
+    }
     //    return;
 }
 
 long Set_size(T set) {
+    long n = 0;
+
     assert(set);
 
-    return List_size(set->list);
+    switch (set->kind) {
+        case SET_LIST:
+            return List_size(set->list);
+        case SET_BITS:
+            for (long i = 0; i < numWords(set->universe); i++)
+                n += __builtin_popcountl(set->bits[i]);
+            return n;
+        case SET_SPARSE:
+            return set->num;
+        default:
+            Error_impossible();
+            return 0;
+    }
 }
 
 T Set_fromList(Poly_tyEquals equals, List_t l) {
     T set;
 
     Mem_NEW(set);
+    set->kind = SET_LIST;
     set->equals = equals;
     set->list = l;
     return set;
@@ -96,105 +417,156 @@ T Set_singleton(Poly_tyEquals equals, Poly_t x) {
     T set;
 
     Mem_NEW(set);
+    set->kind = SET_LIST;
     set->equals = equals;
     set->list = List_list(x, 0);
     return set;
 }
 
+// For list-based sets, this is the representation itself;
+// for the others, a fresh list in member order.
 List_t Set_toList(T set) {
+    List_t l;
+    Iter_t it;
+    Poly_t x;
+
     assert(set);
 
-    return (set->list);
+    if (set->kind == SET_LIST)
+        return (set->list);
+
+    l = List_new();
+    Iter_init(&it, set);
+    while (Iter_next(&it, &x))
+        List_insertLast(l, x);
+    return l;
 }
 
 T Set_intersection(T set1, T set2) {
     T newSet;
-    List_t p;
+    Iter_t it;
+    Poly_t v;
 
     assert(set1);
     assert(set2);
 
-    newSet = Set_new(set1->equals);
-    p = List_getFirst(set1->list);
-    while (p) {
-        Poly_t v = (Poly_t) p->data;
-
-        if (List_exists(set2->list, v, set1->equals))
+    newSet = newLike(set1);
+    if (sameBits(set1, set2)) {
+        for (long i = 0; i < numWords(set1->universe); i++)
+            newSet->bits[i] = set1->bits[i] & set2->bits[i];
+        return newSet;
+    }
+    Iter_init(&it, set1);
+    while (Iter_next(&it, &v)) {
+        if (Set_exists(set2, v))
             Set_insert(newSet, v);
-        else
-            ;
-        p = p->next;
     }
     return newSet;
 }
 
 T Set_union(T set1, T set2) {
     T newSet;
-    List_t p;
 
     assert(set1);
     assert(set2);
 
-    newSet = Set_new(set1->equals);
-    p = List_getFirst(set1->list);
-    while (p) {
-        Set_insert(newSet, p->data);
-        p = p->next;
-    }
-    p = List_getFirst(set2->list);
-    while (p) {
-        Poly_t v = (Poly_t) p->data;
-
-        if (!List_exists(set1->list, v, set1->equals))
-            Set_insert(newSet, v);
-        else
-            ;
-        p = p->next;
-    }
+    newSet = newLike(set1);
+    Set_unionVoid(newSet, set1);
+    Set_unionVoid(newSet, set2);
     return newSet;
 }
 
 void Set_unionVoid(T set1, T set2) {
-    List_t p;
+    Iter_t it;
+    Poly_t v;
 
     assert(set1);
     assert(set2);
 
-    p = List_getFirst(set2->list);
-    while (p) {
-        Poly_t v = (Poly_t) p->data;
+    if (sameBits(set1, set2)) {
+        for (long i = 0; i < numWords(set1->universe); i++)
+            set1->bits[i] |= set2->bits[i];
+        return;
+    }
+    Iter_init(&it, set2);
+    while (Iter_next(&it, &v))
+        Set_insert(set1, v);
+    //    return;
+}
+
+void Set_intersectionVoid(T set1, T set2) {
+    List_t victims = List_new();
+    Iter_t it;
+    Poly_t v;
 
-        // this may be further enhanced
-        if (!List_exists(set1->list, v, set1->equals))
-            Set_insert(set1, v);
-        else
-            ;
-        p = p->next;
+    assert(set1);
+    assert(set2);
+
+    if (sameBits(set1, set2)) {
+        for (long i = 0; i < numWords(set1->universe); i++)
+            set1->bits[i] &= set2->bits[i];
+        return;
+    }
+    // collect first, as deletion would upset the iteration
+    Iter_init(&it, set1);
+    while (Iter_next(&it, &v))
+        List_insertLast(victims, v);
+    victims = List_getFirst(victims);
+    while (victims) {
+        if (!Set_exists(set2, victims->data))
+            Set_delete(set1, victims->data);
+        victims = victims->next;
     }
     //    return;
 }
 
-int Set_equals(T set1, T set2) {
-    List_t p;
+void Set_differenceVoid(T set1, T set2) {
+    List_t victims = List_new();
+    Iter_t it;
+    Poly_t v;
 
     assert(set1);
+    assert(set2);
+
+    if (sameBits(set1, set2)) {
+        for (long i = 0; i < numWords(set1->universe); i++)
+            set1->bits[i] &= ~set2->bits[i];
+        return;
+    }
+    Iter_init(&it, set2);
+    while (Iter_next(&it, &v))
+        List_insertLast(victims, v);
+    victims = List_getFirst(victims);
+    while (victims) {
+        Set_delete(set1, victims->data);
+        victims = victims->next;
+    }
+}
+
+int Set_equals(T set1, T set2) {
+    Iter_t it;
+    Poly_t v;
+
     assert(set1);
+    assert(set2);
 
-    if (List_size(set1->list) != List_size(set2->list))
+    if (sameBits(set1, set2)) {
+        for (long i = 0; i < numWords(set1->universe); i++)
+            if (set1->bits[i] != set2->bits[i])
+                return 0;
+        return 1;
+    }
+    if (Set_size(set1) != Set_size(set2))
         return 0;
 
-    p = List_getFirst(set1->list);
-    while (p) {
-        Poly_t v = (Poly_t) p->data;
-
-        if (List_exists(set2->list, v, set1->equals))
-            ;
-        else
+    Iter_init(&it, set1);
+    while (Iter_next(&it, &v)) {
+        if (!Set_exists(set2, v))
             return 0;
-        p = p->next;
     }
     return 1;
 }
 
 
+#undef U
 #undef T
@@ -5,10 +5,30 @@
 #include "poly.h"
 
 #define T Set_t
+#define U Set_Universe_t
 
 typedef struct T *T;
 
+// A universe numbers a fixed collection of members as
+// 0, 1, ..., size-1. "index" maps a member to its number,
+// and "members[i]" maps the number "i" back. Dense sets
+// drawn from the same universe support word-parallel
+// union, intersection and comparison.
+typedef struct U *U;
+
+U Set_Universe_new(long size, Poly_tyIndex index, Poly_t *members);
+long Set_Universe_size(U u);
+
 T Set_new(Poly_tyEquals equals);
+// a word-packed bit vector over "u": best for sets that
+// hold a large fraction of the universe.
+T Set_newBits(U u);
+// a sparse set over "u": constant-time insertion, deletion
+// and clearing, and iteration proportional to the number
+// of members; best for small sets in a large universe.
+T Set_newSparse(U u);
+// a bit vector holding every member of "u".
+T Set_fullBits(U u);
 void Set_delete(T set, Poly_t x);
 void Set_deleteAll(T set1, Poly_tyPred pred);
 int Set_exists(T set, Poly_t x);
@@ -25,9 +45,16 @@ T Set_union(T, T);
 // this has the side effect of modifying "p". that is
 //   p = p \/ q
 void Set_unionVoid(T p, T q);
+// this has the side effect of modifying "p". that is
+//   p = p /\ q
+void Set_intersectionVoid(T p, T q);
+// this has the side effect of modifying "p". that is
+//   p = p - q
+void Set_differenceVoid(T p, T q);
 long Set_size(T set);
 int Set_equals(T set1, T set2);
 
+#undef U
 #undef T
 
 #endif
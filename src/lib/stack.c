@@ -31,8 +31,7 @@ P Stack_pop(T stk) {
     assert(stk);
     if (List_isEmpty(stk))
         Error_error("try to pop on empty stacks\n");
-    t = stk->next->data;
-    stk->next = stk->next->next;
+    t = List_removeHead(stk);
     return t;
 }
 
@@ -78,20 +78,50 @@ long String_size(T x) {
     return (long) strlen(x);
 }
 
-/* This function implements the algorithm on p.57
- * of the book "The Practice of Programming".
- */
-#define MULTIPLIER 31
+// A word-at-a-time multiply-rotate hash in the style of
+// MurmurHash: eight characters are mixed per step, and a
+// final avalanche makes every bit of the result depend on
+// every bit of the string, low bits included.
+#define M1 0x87c37b91114253d5UL
+#define M2 0x4cf5ad432745937fUL
+
+static unsigned long rotl(unsigned long x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+static unsigned long mix(unsigned long h, unsigned long w) {
+    w *= M1;
+    w = rotl(w, 31);
+    w *= M2;
+    h ^= w;
+    return rotl(h, 27) * 5 + 0x52dce729;
+}
+
 long String_hashCode(T x) {
-    long h = 0;
+    unsigned long n, h, w;
 
     assert(x);
-    while (*x) {
-        h = h * MULTIPLIER + (unsigned) *x++;
+    n = strlen(x);
+    h = n;
+    for (; n >= sizeof(w); n -= sizeof(w), x += sizeof(w)) {
+        memcpy(&w, x, sizeof(w));
+        h = mix(h, w);
     }
-    return h;
+    w = 0;
+    memcpy(&w, x, n);
+    h = mix(h, w);
+    // avalanche
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdUL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53UL;
+    h ^= h >> 33;
+    return (long) h;
 }
 
+#undef M1
+#undef M2
+
 
 void String_print(T x) {
     assert(x);
@@ -1,6 +1,22 @@
 #include "system.h"
+#include "char-buffer.h"
 #include "error.h"
+#include "mem.h"
+#include <assert.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <spawn.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+extern char **environ;
 
 void System_run(char *s) {
     if (!s)
@@ -10,3 +26,322 @@ void System_run(char *s) {
     // useless to check this.
     system(s);
 }
+
+long System_numCores(void) {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+
+    return (n > 0) ? n : 1;
+}
+
+static double now(void) {
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (double) t.tv_sec + (double) t.tv_nsec / 1e9;
+}
+
+//////////////////////////////////////////////////////
+// a bounded queue of child processes
+
+// the jobs of the current batch
+static Poly_t *jobs = 0;
+static pid_t *pids = 0;
+static double *starts = 0;
+static long numJobs = 0;
+
+// start jobs 0, 1, ..., numJobs-1 by "start", with at
+// most "n" of them running, and call "finish" as each one
+// exits; "wait" blocks until a child has exited, reaps it,
+// and returns its job, or -1 if it is not one of ours.
+static void runJobs(long n,
+                    pid_t (*start)(long i),
+                    long (*wait)(int *status),
+                    void (*finish)(long i, int status)) {
+    long next = 0, running = 0, i;
+    int status;
+
+    if (n < 1)
+        n = 1;
+    while (next < numJobs || running > 0) {
+        while (running < n && next < numJobs) {
+            starts[next] = now();
+            pids[next] = start(next);
+            next++;
+            running++;
+        }
+        i = wait(&status);
+        // not one of ours
+        if (i < 0)
+            continue;
+        pids[i] = 0;
+        running--;
+        finish(i, status);
+    }
+}
+
+static long waitAny(int *status) {
+    pid_t pid = waitpid(-1, status, 0);
+
+    if (pid < 0)
+        Error_error("fail to wait for child processes\n");
+    for (long i = 0; i < numJobs; i++) {
+        if (pids[i] == pid)
+            return i;
+    }
+    return -1;
+}
+
+static void newBatch(List_t l) {
+    List_t p;
+    long i;
+
+    numJobs = List_size(l);
+    Mem_NEW_SIZE(jobs, numJobs);
+    Mem_NEW_SIZE(pids, numJobs);
+    Mem_NEW_SIZE(starts, numJobs);
+    p = List_getFirst(l);
+    for (i = 0; p; i++, p = p->next)
+        jobs[i] = p->data;
+}
+
+//////////////////////////////////////////////////////
+// spawn
+static long numFailed = 0;
+static System_tyReport theReport = 0;
+
+static pid_t spawnOne(long i) {
+    char **argv = jobs[i];
+    pid_t pid;
+
+    if (posix_spawnp(&pid, argv[0], 0, 0, argv, environ))
+        Error_error2("fail to run", argv[0]);
+    return pid;
+}
+
+static void spawnDone(long i, int status) {
+    if (!WIFEXITED(status) || WEXITSTATUS(status))
+        numFailed++;
+    if (theReport)
+        theReport(jobs[i], now() - starts[i]);
+}
+
+long System_spawnAll(List_t cmds, long n, System_tyReport report) {
+    assert(cmds);
+    if (List_isEmpty(cmds))
+        return 0;
+
+    newBatch(cmds);
+    numFailed = 0;
+    theReport = report;
+    runJobs(n, spawnOne, waitAny, spawnDone);
+    return numFailed;
+}
+
+//////////////////////////////////////////////////////
+// pipe
+File_t System_openPipe(String_t *cmd, long *pid) {
+    posix_spawn_file_actions_t actions;
+    File_t file;
+    pid_t p;
+    int fd[2];
+
+    assert(cmd);
+    assert(pid);
+    if (pipe(fd))
+        Error_error("fail to make a pipe\n");
+    // a command that fails early is reported when it is
+    // waited for, not by the signal
+    signal(SIGPIPE, SIG_IGN);
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, fd[0], 0);
+    posix_spawn_file_actions_addclose(&actions, fd[0]);
+    posix_spawn_file_actions_addclose(&actions, fd[1]);
+    if (posix_spawnp(&p, cmd[0], &actions, 0, cmd, environ))
+        Error_error2("fail to run", cmd[0]);
+    posix_spawn_file_actions_destroy(&actions);
+    close(fd[0]);
+    file = File_fromDescriptor(fd[1]);
+    if (!file)
+        Error_error("fail to open a pipe\n");
+    *pid = p;
+    return file;
+}
+
+long System_closePipe(File_t file, long pid) {
+    long failed = File_tryClose(file) != 0;
+    int status;
+
+    while (waitpid((pid_t) pid, &status, 0) < 0) {
+        if (errno != EINTR)
+            return 1;
+    }
+    return failed || !WIFEXITED(status) || WEXITSTATUS(status);
+}
+
+//////////////////////////////////////////////////////
+// fork
+static String_t (*theFun)(Poly_t) = 0;
+// the read end of each job's pipe, or -1 when it is not
+// open, and what has been read from it so far
+static int *fds = 0;
+static CharBuffer_t *bufs = 0;
+static String_t *results = 0;
+static struct pollfd *polls = 0;
+static long *polled = 0;
+
+static pid_t forkOne(long i) {
+    int fd[2];
+    pid_t pid;
+
+    if (pipe(fd))
+        Error_error("fail to make a pipe\n");
+    // or a command run later would hold the pipe open
+    fcntl(fd[0], F_SETFD, FD_CLOEXEC);
+    fcntl(fd[1], F_SETFD, FD_CLOEXEC);
+    // or the child would print what is buffered again
+    fflush(stdout);
+    fflush(stderr);
+    pid = fork();
+    if (pid < 0)
+        Error_error("fail to fork\n");
+    if (0 == pid) {
+        String_t r;
+        size_t len;
+
+        close(fd[0]);
+        r = theFun(jobs[i]);
+        len = strlen(r);
+        if (write(fd[1], r, len) != (ssize_t) len)
+            Error_error("fail to write to the parent\n");
+        close(fd[1]);
+        exit(0);
+    }
+    close(fd[1]);
+    fds[i] = fd[0];
+    bufs[i] = CharBuffer_new();
+    return pid;
+}
+
+// read what is ready on the pipe of job "i"; 0 at its end
+static int drain(long i) {
+    char c[4096];
+    ssize_t k = read(fds[i], c, sizeof(c));
+
+    if (k < 0)
+        return errno == EINTR;
+    for (ssize_t j = 0; j < k; j++)
+        CharBuffer_append(bufs[i], c[j]);
+    return k > 0;
+}
+
+// A child blocks writing a result larger than the pipe
+// holds until it is read, so the parent reads every pipe
+// as data comes, and reaps a child only after its pipe
+// has ended.
+static long waitDrained(int *status) {
+    for (;;) {
+        long m = 0;
+
+        for (long i = 0; i < numJobs; i++) {
+            if (fds[i] < 0)
+                continue;
+            polls[m].fd = fds[i];
+            polls[m].events = POLLIN;
+            polls[m].revents = 0;
+            polled[m] = i;
+            m++;
+        }
+        if (0 == m) {
+            Error_impossible();
+            return -1;
+        }
+        if (poll(polls, (nfds_t) m, -1) < 0) {
+            if (errno == EINTR)
+                continue;
+            Error_error("fail to wait for child processes\n");
+        }
+        for (long j = 0; j < m; j++) {
+            long i = polled[j];
+
+            if (!polls[j].revents || drain(i))
+                continue;
+            close(fds[i]);
+            fds[i] = -1;
+            while (waitpid(pids[i], status, 0) < 0) {
+                if (errno != EINTR)
+                    Error_error("fail to wait for child processes\n");
+            }
+            return i;
+        }
+    }
+}
+
+static void forkDone(long i, int status) {
+    // what a failed child has sent may be cut short
+    if (!WIFEXITED(status) || WEXITSTATUS(status))
+        results[i] = 0;
+    else
+        results[i] = CharBuffer_numItems(bufs[i]) ? CharBuffer_toString(bufs[i]) : 0;
+    if (theReport)
+        theReport(jobs[i], now() - starts[i]);
+}
+
+List_t System_forkMap(List_t l, String_t (*f)(Poly_t), long n, System_tyReport report) {
+    List_t result = List_new();
+
+    assert(l);
+    assert(f);
+    if (List_isEmpty(l))
+        return result;
+
+    newBatch(l);
+    Mem_NEW_SIZE(fds, numJobs);
+    Mem_NEW_SIZE(bufs, numJobs);
+    Mem_NEW_SIZE(results, numJobs);
+    Mem_NEW_SIZE(polls, numJobs);
+    Mem_NEW_SIZE(polled, numJobs);
+    for (long i = 0; i < numJobs; i++)
+        fds[i] = -1;
+    theFun = f;
+    theReport = report;
+    runJobs(n, forkOne, waitDrained, forkDone);
+    for (long i = 0; i < numJobs; i++)
+        List_insertLast(result, results[i]);
+    return result;
+}
+
+//////////////////////////////////////////////////////
+// temporary directory
+static String_t tempDir = 0;
+
+String_t System_tempDir(void) {
+    if (!tempDir) {
+        Mem_Arena_t old = Mem_Arena_enter(MEM_ARENA_GLOBAL);
+        char *s = String_new("/tmp/dragon-XXXXXX");
+
+        if (!mkdtemp(s))
+            Error_error("fail to make a temporary directory\n");
+        tempDir = s;
+        Mem_Arena_enter(old);
+    }
+    return tempDir;
+}
+
+void System_removeTempDir(void) {
+    DIR *dir;
+    struct dirent *e;
+
+    if (!tempDir)
+        return;
+    dir = opendir(tempDir);
+    if (dir) {
+        while ((e = readdir(dir))) {
+            if (e->d_name[0] == '.')
+                continue;
+            remove(String_concat(tempDir, "/", e->d_name, 0));
+        }
+        closedir(dir);
+    }
+    rmdir(tempDir);
+    tempDir = 0;
+}
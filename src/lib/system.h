@@ -1,6 +1,47 @@
 #ifndef SYSTEM_H
 #define SYSTEM_H
 
+#include "file.h"
+#include "list.h"
+#include "poly.h"
+#include "string.h"
+
 void System_run(char *cmd);
 
+// the number of cores online, at least 1.
+long System_numCores(void);
+
+// called in the parent as each job finishes, with the
+// wall-clock time the job took.
+typedef void (*System_tyReport)(Poly_t job, double seconds);
+
+// Run every command in "cmds", each a 0-terminated array
+// of arguments ("String_t *"), by "posix_spawnp", with at
+// most "n" of them at a time. Return the number of
+// commands that failed.
+long System_spawnAll(List_t cmds, long n, System_tyReport report);
+
+// Start "cmd" as above, with its standard input read
+// from the file returned, e.g., to have a compiler read
+// code as it is generated. "System_closePipe" closes the
+// file, waits for the command, and returns nonzero if it
+// failed.
+File_t System_openPipe(String_t *cmd, long *pid);
+long System_closePipe(File_t file, long pid);
+
+// Compute "f(x)" for every "x" in "l", each in a child
+// process of its own, with at most "n" of them at a time.
+// A child sends the string "f" returns back through a
+// pipe; the result is in the order of "l", with 0 for a
+// child that failed or exited without sending one.
+List_t System_forkMap(List_t l, String_t (*f)(Poly_t), long n, System_tyReport report);
+
+// A directory private to this process, made on first use
+// (e.g., "/tmp/dragon-XXXXXX").
+String_t System_tempDir(void);
+
+// remove the directory above and the files in it, if it
+// has been made.
+void System_removeTempDir(void);
+
 #endif
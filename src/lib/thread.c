@@ -0,0 +1,160 @@
+#include "thread.h"
+#include "error.h"
+#include "mem.h"
+#include "system.h"
+#include <assert.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+// One round of "Thread_map". The elements are claimed by
+// bumping "next", so a worker that draws cheap elements
+// just claims more of them, which balances the load as
+// well as stealing would for a flat list of jobs.
+typedef struct {
+    Poly_t *in;
+    Poly_t *out;
+    long num;
+    atomic_long next;
+
+    Poly_tyId f;
+
+    void (*init)(void);
+
+    Mem_Arena_t arena;
+    long numThreads;
+} Job_t;
+
+// the pool: "size" threads in all, with the caller as
+// the 0th one.
+static long size = 1;
+static long num = 1;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+// signaled when a new round starts
+static pthread_cond_t start = PTHREAD_COND_INITIALIZER;
+// signaled when the last worker finished its round
+static pthread_cond_t done = PTHREAD_COND_INITIALIZER;
+static Job_t *job = 0;
+static unsigned long round = 0;
+static long running = 0;
+
+static Thread_local int inWorker = 0;
+
+static void runJob(Job_t *j) {
+    long i;
+
+    Mem_Arena_enter(j->arena);
+    if (j->init)
+        j->init();
+    while ((i = atomic_fetch_add(&j->next, 1)) < j->num)
+        j->out[i] = j->f(j->in[i]);
+}
+
+static void *worker(void *arg) {
+    long self = (long) arg;
+    unsigned long seen = 0;
+    Job_t *j;
+
+    inWorker = 1;
+    for (;;) {
+        pthread_mutex_lock(&lock);
+        while (seen == round)
+            pthread_cond_wait(&start, &lock);
+        seen = round;
+        j = job;
+        pthread_mutex_unlock(&lock);
+
+        if (self < j->numThreads)
+            runJob(j);
+
+        pthread_mutex_lock(&lock);
+        if (0 == --running)
+            pthread_cond_signal(&done);
+        pthread_mutex_unlock(&lock);
+    }
+    return 0;
+}
+
+void Thread_init(long n) {
+    pthread_t t;
+
+    if (size > 1)
+        Error_bug("the thread pool has been started");
+    if (n <= 0)
+        n = System_numCores();
+    for (long i = 1; i < n; i++) {
+        if (pthread_create(&t, 0, worker, (void *) i))
+            Error_error("fail to create threads\n");
+        pthread_detach(t);
+    }
+    size = n;
+    num = n;
+}
+
+long Thread_num(void) {
+    return num;
+}
+
+long Thread_setNum(long n) {
+    long old = num;
+
+    num = (n < 1) ? 1 : ((n > size) ? size : n);
+    return old;
+}
+
+List_t Thread_map(List_t l, Poly_tyId f, void (*init)(void)) {
+    Job_t j;
+    List_t p, result;
+    long i, n;
+
+    assert(l);
+    assert(f);
+    n = List_size(l);
+    result = List_new();
+    if (0 == n)
+        return result;
+
+    // sequentially, in the calling thread
+    if (num == 1 || n == 1 || inWorker) {
+        if (init)
+            init();
+        p = List_getFirst(l);
+        while (p) {
+            List_insertLast(result, f(p->data));
+            p = p->next;
+        }
+        return result;
+    }
+
+    Mem_NEW_SIZE(j.in, n);
+    Mem_NEW_SIZE(j.out, n);
+    p = List_getFirst(l);
+    for (i = 0; p; i++, p = p->next)
+        j.in[i] = p->data;
+    j.num = n;
+    atomic_init(&j.next, 0);
+    j.f = f;
+    j.init = init;
+    j.arena = Mem_Arena_current();
+    j.numThreads = (num < n) ? num : n;
+
+    pthread_mutex_lock(&lock);
+    job = &j;
+    running = size - 1;
+    round++;
+    pthread_cond_broadcast(&start);
+    pthread_mutex_unlock(&lock);
+
+    inWorker = 1;
+    runJob(&j);
+    inWorker = 0;
+
+    pthread_mutex_lock(&lock);
+    while (running)
+        pthread_cond_wait(&done, &lock);
+    job = 0;
+    pthread_mutex_unlock(&lock);
+
+    for (i = 0; i < n; i++)
+        List_insertLast(result, j.out[i]);
+    return result;
+}
@@ -0,0 +1,40 @@
+#ifndef THREAD_H
+#define THREAD_H
+
+// A pool of worker threads, which maps a function over
+// the elements of a list in parallel. It is meant for
+// passes over independent items (e.g., the functions of
+// a program): elements are handed out to workers one at a
+// time, as each worker becomes free, and the results come
+// back in the order of the list, so the output does not
+// depend on the number of threads, nor on the scheduling.
+//
+// State a pass keeps in file-level variables must then be
+// private to each worker, i.e., declared "Thread_local",
+// and set up by the "init" hook of "Thread_map".
+
+#include "list.h"
+#include "poly.h"
+
+#define Thread_local _Thread_local
+
+// start the pool with "n" threads in all, including the
+// calling one; 0 for one thread per core.
+void Thread_init(long n);
+
+// the number of threads that "Thread_map" runs on.
+long Thread_num(void);
+
+// set the number of threads to use, up to the size of the
+// pool, and return the old number; e.g., a pass that logs
+// as it goes sets 1.
+long Thread_setNum(long n);
+
+// map "f" over "l", and return the results in order. Each
+// thread calls "init" (if not 0) once, before it calls "f"
+// for the first time. Workers allocate in the current
+// arena of the caller. A call from inside a worker runs
+// sequentially.
+List_t Thread_map(List_t l, Poly_tyId f, void (*init)(void));
+
+#endif
@@ -1,5 +1,6 @@
 #include "trace.h"
 #include "list.h"
+#include "mem.h"
 #include "string.h"
 #include "unused.h"
 #include <stdio.h>
@@ -9,8 +10,16 @@
 
 static int indent = 0;
 
+// outlives every IR, so lives in the global arena.
 static List_t names = 0;
 
+static void initNames(void) {
+    Mem_Arena_t old = Mem_Arena_enter(MEM_ARENA_GLOBAL);
+
+    names = List_new();
+    Mem_Arena_enter(old);
+}
+
 void Trace_indent(void) {
     indent += STEP;
 }
@@ -27,16 +36,20 @@ void Trace_spaces(void) {
 
 int Trace_lookup(char *s) {
     if (!names)
-        names = List_new();
+        initNames();
     return List_exists(names,
                        s,
                        (Poly_tyEquals) String_equals);
 }
 
 void Trace_insert(char *s) {
+    Mem_Arena_t old;
+
     if (!names)
-        names = List_new();
+        initNames();
+    old = Mem_Arena_enter(MEM_ARENA_GLOBAL);
     List_insertFirst(names, s);
+    Mem_Arena_enter(old);
 }
 
 List_t Trace_allFuncs(void) {
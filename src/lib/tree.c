@@ -1,9 +1,9 @@
 #include "tree.h"
 #include "dot.h"
 #include "error.h"
+#include "hash.h"
 #include "list.h"
 #include "mem.h"
-#include "property-list.h"
 #include "property.h"
 #include <assert.h>
 #include <stdio.h>
@@ -16,6 +16,10 @@ struct T {
     String_t name;
     Poly_tyEquals equals;
     List_t vs;
+    // number of vertices, which are indexed 0, 1, ...
+    long numVs;
+    // data -> V, hashed on the data's index (see graph.c)
+    Hash_t vertexMap;
 };
 
 typedef struct V *V;
@@ -26,7 +30,8 @@ typedef struct Ex *Ex;
 struct V {
     Poly_t data;
     List_t edges;
-    Plist_t plist;
+    // position in the tree's vertex list
+    long index;
 };
 
 static V Vertex_new(Poly_t data) {
@@ -35,14 +40,13 @@ static V Vertex_new(Poly_t data) {
     Mem_NEW(v);
     v->data = data;
     v->edges = List_new();
-    v->plist = Plist_new();
     return v;
 }
 
-static Plist_t Vertex_plist(V v) {
+static long Vertex_index(V v) {
     assert(v);
 
-    return v->plist;
+    return v->index;
 }
 
 //static int Vertex_equals(V v1, V v2) {
@@ -57,7 +61,6 @@ static Plist_t Vertex_plist(V v) {
 struct Ex {
     V from;
     V to;
-    Plist_t plist;
 };
 
 static Ex Edge_new(V from, V to) {
@@ -66,7 +69,6 @@ static Ex Edge_new(V from, V to) {
     Mem_NEW(e);
     e->from = from;
     e->to = to;
-    e->plist = Plist_new();
     return e;
 }
 
@@ -78,53 +80,36 @@ static Ex Edge_new(V from, V to) {
 //}
 
 
-//static Plist_t Edge_plist(E e) {
-//    assert(e);
-//
-//    return e->plist;
-//}
 
 
 /////////////////////////////////////////////////////
 // tree
-T Tree_new(Poly_tyEquals eq) {
-    T g;
-
-    Mem_NEW(g);
-    g->name = "NONE";
-    g->equals = eq;
-    g->vs = List_new();
-    return g;
+T Tree_new(Poly_tyEquals eq, Poly_tyIndex index) {
+    return Tree_newWithName(eq, index, "NONE");
 }
 
-T Tree_newWithName(Poly_tyEquals eq, String_t name) {
+T Tree_newWithName(Poly_tyEquals eq, Poly_tyIndex index, String_t name) {
     T g;
 
     Mem_NEW(g);
     g->name = name;
     g->equals = eq;
     g->vs = List_new();
+    g->numVs = 0;
+    g->vertexMap = Hash_new(index, eq, 0);
     return g;
 }
 
 static V searchVertex(T g, Poly_t data) {
-    List_t p;
-    Poly_tyEquals equals;
+    V v;
 
     assert(g);
     assert(data);
 
-    p = List_getFirst(g->vs);
-    equals = g->equals;
-    while (p) {
-        V v = (V) (p->data);
-
-        if (equals(data, v->data))
-            return v;
-        p = p->next;
-    }
-    Error_error("vertex not found: tree.c\n");
-    return 0;
+    v = Hash_lookup(g->vertexMap, data);
+    if (!v)
+        Error_error("vertex not found: tree.c\n");
+    return v;
 }
 
 //static E searchEdge(T g, Poly_t from, Poly_t to) {
@@ -146,7 +131,9 @@ static V searchVertex(T g, Poly_t data) {
 //
 void Tree_insertVertex(T g, Poly_t x) {
     V v = Vertex_new(x);
+    v->index = g->numVs++;
     List_insertLast(g->vs, v);
+    Hash_insert(g->vertexMap, x, v);
     return;
 }
 
@@ -213,7 +200,7 @@ void Tree_dfs(T g, Poly_t start, Poly_tyVoid f) {
     assert(f);
 
     sv = searchVertex(g, start);
-    visited = Property_new((Poly_tyPlist) Vertex_plist);
+    visited = Property_new((Poly_tyIndex) Vertex_index);
     if (sv)
         Tree_dfsDoit(g, sv, f, visited);
 
@@ -245,8 +232,8 @@ List_t Tree_children(T t, Poly_t v) {
     return result;
 }
 
-Tree_t Tree_map(T t, Poly_tyEquals equals, Poly_t (*map)(Poly_t)) {
-    Tree_t newt = Tree_new(equals);
+Tree_t Tree_map(T t, Poly_tyEquals equals, Poly_tyIndex index, Poly_t (*map)(Poly_t)) {
+    Tree_t newt = Tree_new(equals, index);
     List_t vs = List_getFirst(t->vs);
 
     while (vs) {
@@ -0,0 +1,124 @@
+#include "vector.h"
+#include "error.h"
+#include "mem.h"
+#include <assert.h>
+#include <string.h>
+
+#define INIT_SIZE 16
+
+#define T Vector_t
+#define P Poly_t
+
+struct T {
+    struct List_t *nodes;
+    long size;
+    long capacity;
+};
+
+T Vector_new(void) {
+    T v;
+
+    Mem_NEW(v);
+    v->nodes = 0;
+    v->size = 0;
+    v->capacity = 0;
+    return v;
+}
+
+long Vector_size(T v) {
+    assert(v);
+    return v->size;
+}
+
+int Vector_isEmpty(T v) {
+    assert(v);
+    return 0 == v->size;
+}
+
+static void grow(T v) {
+    struct List_t *old = v->nodes;
+    long capacity = (v->capacity) ? (2 * v->capacity) : INIT_SIZE;
+
+    Mem_NEW_SIZE(v->nodes, capacity);
+    if (old)
+        memcpy(v->nodes, old, (unsigned long) v->size * sizeof(*old));
+    // re-link the moved nodes
+    for (long i = 0; i + 1 < v->size; i++)
+        v->nodes[i].next = &v->nodes[i + 1];
+    v->capacity = capacity;
+}
+
+void Vector_insertLast(T v, P x) {
+    assert(v);
+    if (v->size == v->capacity)
+        grow(v);
+    v->nodes[v->size].data = x;
+    v->nodes[v->size].next = 0;
+    if (v->size > 0)
+        v->nodes[v->size - 1].next = &v->nodes[v->size];
+    v->size++;
+}
+
+P Vector_nth(T v, long n) {
+    assert(v);
+    if (n < 0 || n >= v->size)
+        Error_bug("invalid argument");
+    return v->nodes[n].data;
+}
+
+void Vector_set(T v, long n, P x) {
+    assert(v);
+    if (n < 0 || n >= v->size)
+        Error_bug("invalid argument");
+    v->nodes[n].data = x;
+}
+
+P Vector_removeLast(T v) {
+    assert(v);
+    if (0 == v->size)
+        Error_impossible();
+    v->size--;
+    if (v->size > 0)
+        v->nodes[v->size - 1].next = 0;
+    return v->nodes[v->size].data;
+}
+
+void Vector_clear(T v) {
+    assert(v);
+    v->size = 0;
+}
+
+List_t Vector_getFirst(T v) {
+    assert(v);
+    return (v->size) ? v->nodes : 0;
+}
+
+void Vector_foreach(T v, Poly_tyVoid f) {
+    assert(v);
+    assert(f);
+    for (long i = 0; i < v->size; i++)
+        f(v->nodes[i].data);
+}
+
+T Vector_fromList(List_t l) {
+    T v = Vector_new();
+    List_t p = List_getFirst(l);
+
+    while (p) {
+        Vector_insertLast(v, p->data);
+        p = p->next;
+    }
+    return v;
+}
+
+List_t Vector_toList(T v) {
+    List_t l = List_new();
+
+    assert(v);
+    for (long i = 0; i < v->size; i++)
+        List_insertLast(l, v->nodes[i].data);
+    return l;
+}
+
+#undef P
+#undef T
@@ -0,0 +1,43 @@
+#ifndef VECTOR_H
+#define VECTOR_H
+
+// A growable array. Its nodes are "struct List_t", laid out
+// back to back and linked in order, so a vector is walked
+// exactly like a list:
+//   List_t p = Vector_getFirst(v);
+//   while (p) {
+//       ... p->data ...;
+//       p = p->next;
+//   }
+// but it is indexed in constant time and walked without
+// chasing pointers across the heap. Growing the vector
+// moves its nodes, so a walk must not span an insertion.
+
+#include "list.h"
+#include "poly.h"
+
+#define T Vector_t
+#define P Poly_t
+
+typedef struct T *T;
+
+T Vector_new(void);
+long Vector_size(T v);
+int Vector_isEmpty(T v);
+void Vector_insertLast(T v, P x);
+P Vector_nth(T v, long n);
+void Vector_set(T v, long n, P x);
+P Vector_removeLast(T v);
+// make "v" empty, keeping its storage for reuse.
+void Vector_clear(T v);
+// the first node, or 0 for an empty vector.
+List_t Vector_getFirst(T v);
+void Vector_foreach(T v, Poly_tyVoid f);
+T Vector_fromList(List_t l);
+// a fresh list holding the same elements.
+List_t Vector_toList(T v);
+
+#undef P
+#undef T
+
+#endif
@@ -1,23 +1,18 @@
 #include "gen-frame.h"
 #include "../control/control.h"
+#include "../lib/thread.h"
 #include "../lib/trace.h"
 
 // Generate frame information for each function.
 // For now, assume all arguments and local declarations
 // are located on the stack. (change this later!)
 
-static List_t allOffsets = 0;
 // the 0 index is the "length" info
 static int index = 1;
 
-static List_t getFrameInfo(void) {
-    List_t tmp = allOffsets;
-    allOffsets = 0;
-    return tmp;
-}
-
-//
-static int genOffsets(List_t args, List_t decs) {
+// Offsets are computed for all functions in parallel, and
+// then numbered in order.
+static Machine_FrameInfo_t genOffsets(List_t args, List_t decs) {
     Machine_FrameInfo_t newInfo;
     List_t offsets = List_new();
     List_t decOffsets = List_new();
@@ -52,24 +47,29 @@ static int genOffsets(List_t args, List_t decs) {
     }
 
     size *= Control_Target_size;
-    newInfo = Machine_FrameInfo_new(offsets, decOffsets, size);
-    List_insertLast(allOffsets, newInfo);
-    return index++;
+    newInfo = Machine_FrameInfo_new(offsets, decOffsets, size, 0, 0);
+    return newInfo;
 }
 
-static Machine_Fun_t genFunc(Machine_Fun_t f) {
-    int frameIndex;
-
-    frameIndex = genOffsets(f->args, f->decs);
-    return Machine_Fun_new(f->type, f->name, f->args, f->decs, f->blocks, f->retId, f->entry, f->exitt, frameIndex);
+static Machine_FrameInfo_t genInfo(Machine_Fun_t f) {
+    return genOffsets(f->args, f->decs);
 }
 
 static Machine_Prog_t Machine_genFrameTraced(Machine_Prog_t p) {
-    List_t newFuncs;
+    List_t newFuncs, allOffsets, funcs;
 
-    allOffsets = List_new();
-    newFuncs = List_map(p->funcs, (Poly_tyId) genFunc);
-    return Machine_Prog_new(p->strings, getFrameInfo(), p->layoutInfo, p->classes, newFuncs);
+    allOffsets = Thread_map(p->funcs, (Poly_tyId) genInfo, 0);
+    newFuncs = List_new();
+    funcs = List_getFirst(p->funcs);
+    while (funcs) {
+        Machine_Fun_t f = (Machine_Fun_t) funcs->data;
+
+        List_insertLast(newFuncs,
+                        Machine_Fun_new(f->type, f->name, f->args, f->decs, f->blocks, f->retId, f->entry, f->exitt,
+                                        index++));
+        funcs = funcs->next;
+    }
+    return Machine_Prog_new(p->strings, allOffsets, p->layoutInfo, p->classes, newFuncs);
 }
 
 static void printArg(Machine_Prog_t p) {
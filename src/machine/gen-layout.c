@@ -149,9 +149,9 @@ Machine_genLayoutTraced(Machine_Prog_t p) {
 
     Runtime_init();
 
-    indexProp = Property_new((Poly_tyPlist) Id_plist);
-    fieldProp = Property_new((Poly_tyPlist) Id_plist);
-    sizeProp = Property_new((Poly_tyPlist) Id_plist);
+    indexProp = Property_new((Poly_tyIndex) Id_index);
+    fieldProp = Property_new((Poly_tyIndex) Id_index);
+    sizeProp = Property_new((Poly_tyIndex) Id_index);
 
 
     // generate layout information for each class
@@ -0,0 +1,151 @@
+#include "liveness.h"
+#include "../lib/error.h"
+#include "../lib/mem.h"
+#include "../lib/property.h"
+#include "../lib/thread.h"
+#include <assert.h>
+
+// The state of this module is per thread, as functions are
+// processed on many threads.
+
+// Id_t -> long: the number of a variable in the universe,
+// plus 1
+static Thread_local Property_t numberProp = 0;
+// Label_t -> Set_t
+static Thread_local Property_t inProp = 0;
+static Thread_local Property_t outProp = 0;
+// Label_t -> Set_t: the variables a block reads before it
+// writes them, and those it writes
+static Thread_local Property_t useProp = 0;
+static Thread_local Property_t defProp = 0;
+
+void Machine_Liveness_init(void) {
+    numberProp = Property_new((Poly_tyIndex) Id_index);
+    inProp = Property_new((Poly_tyIndex) Label_index);
+    outProp = Property_new((Poly_tyIndex) Label_index);
+    useProp = Property_new((Poly_tyIndex) Label_index);
+    defProp = Property_new((Poly_tyIndex) Label_index);
+}
+
+static long numberOf(Id_t id) {
+    long n = (long) Property_get(numberProp, id);
+
+    if (!n)
+        Error_bug(String_concat("not a variable of this function: ", Id_toString(id), 0));
+    return n - 1;
+}
+
+static Set_Universe_t genUniverse(Machine_Fun_t f) {
+    long size = List_size(f->args) + List_size(f->decs), n = 0;
+    Poly_t *members;
+
+    // "Mem_NEW_SIZE" rejects empty buffers
+    Mem_NEW_SIZE(members, size + 1);
+    for (List_t p = List_getFirst(f->args); p; p = p->next, n++) {
+        members[n] = ((Dec_t) p->data)->id;
+        Property_set(numberProp, members[n], (Poly_t) (n + 1));
+    }
+    for (List_t p = List_getFirst(f->decs); p; p = p->next, n++) {
+        members[n] = ((Dec_t) p->data)->id;
+        Property_set(numberProp, members[n], (Poly_t) (n + 1));
+    }
+    return Set_Universe_new(size, (Poly_tyIndex) numberOf, members);
+}
+
+//////////////////////////////////////////////////////
+// the uses and defs of each block
+static Thread_local Set_t curUse = 0;
+static Thread_local Set_t curDef = 0;
+
+static void addUse(Id_t id) {
+    if (!Set_exists(curDef, id))
+        Set_insert(curUse, id);
+}
+
+static void addDef(Id_t id) {
+    Set_insert(curDef, id);
+}
+
+static void genUseDef(Machine_Block_t b, Set_Universe_t u) {
+    curUse = Set_newBits(u);
+    curDef = Set_newBits(u);
+    for (List_t p = List_getFirst(b->stms); p; p = p->next) {
+        Machine_Stm_foreachUse(p->data, addUse);
+        Machine_Stm_foreachDef(p->data, addDef);
+    }
+    Machine_Transfer_foreachUse(b->transfer, addUse);
+    Machine_Transfer_foreachDef(b->transfer, addDef);
+    Property_set(useProp, b->label, curUse);
+    Property_set(defProp, b->label, curDef);
+    Property_set(inProp, b->label, Set_newBits(u));
+    Property_set(outProp, b->label, Set_newBits(u));
+    curUse = 0;
+    curDef = 0;
+}
+
+//////////////////////////////////////////////////////
+// the fixed point
+static Thread_local Set_t curOut = 0;
+
+static void joinSucc(Label_t l) {
+    Set_t in = Property_get(inProp, l);
+
+    if (!in)
+        Error_bug(String_concat("no such block: ", Label_toString(l), 0));
+    Set_unionVoid(curOut, in);
+}
+
+// recompute "b", and return whether its "in" changed
+static int visit(Machine_Block_t b, Set_Universe_t u) {
+    Set_t in;
+
+    curOut = Set_newBits(u);
+    Machine_Transfer_foreachSucc(b->transfer, joinSucc);
+    Property_set(outProp, b->label, curOut);
+
+    in = Set_newBits(u);
+    Set_unionVoid(in, curOut);
+    Set_differenceVoid(in, Property_get(defProp, b->label));
+    Set_unionVoid(in, Property_get(useProp, b->label));
+    curOut = 0;
+    if (Set_equals(in, Property_get(inProp, b->label)))
+        return 0;
+    Property_set(inProp, b->label, in);
+    return 1;
+}
+
+Set_Universe_t Machine_liveness(Machine_Fun_t f) {
+    Set_Universe_t u;
+    Machine_Block_t *blocks;
+    long num = List_size(f->blocks), i = 0;
+    int changed = 1;
+
+    assert(f);
+    Property_clear(numberProp);
+    Property_clear(inProp);
+    Property_clear(outProp);
+    Property_clear(useProp);
+    Property_clear(defProp);
+
+    u = genUniverse(f);
+    Mem_NEW_SIZE(blocks, num + 1);
+    for (List_t p = List_getFirst(f->blocks); p; p = p->next) {
+        blocks[i++] = p->data;
+        genUseDef(p->data, u);
+    }
+    // backwards, as the information flows
+    while (changed) {
+        changed = 0;
+        for (i = num - 1; i >= 0; i--)
+            changed |= visit(blocks[i], u);
+    }
+    return u;
+}
+
+Set_t Machine_Liveness_in(Label_t l) {
+    return Property_get(inProp, l);
+}
+
+Set_t Machine_Liveness_out(Label_t l) {
+    return Property_get(outProp, l);
+}
@@ -0,0 +1,28 @@
+#ifndef LIVENESS_H
+#define LIVENESS_H
+
+#include "../lib/set.h"
+#include "machine.h"
+
+// Liveness of the arguments and declarations of a function,
+// at the entry and the exit of each of its blocks, by the
+// usual backward dataflow:
+//     out(b) = \/ in(s), for each successor s of b
+//     in(b)  = use(b) \/ (out(b) - def(b))
+// A call that may leave to a handler has that handler as a
+// successor.
+//
+// The sets are kept by this module, per thread, until it
+// is called for the next function on that thread.
+
+// the "init" hook of "Thread_map", for passes that use this
+void Machine_Liveness_init(void);
+// compute the liveness of "f", and return the universe of
+// its variables, which the sets are drawn from
+Set_Universe_t Machine_liveness(Machine_Fun_t f);
+// the variables live at the entry of the block "l"
+Set_t Machine_Liveness_in(Label_t l);
+// the variables live at the exit of the block "l"
+Set_t Machine_Liveness_out(Label_t l);
+
+#endif
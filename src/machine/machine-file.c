@@ -0,0 +1,379 @@
+#include "machine-file.h"
+#include "../lib/error.h"
+#include <assert.h>
+
+#define B Machine_Block_t
+#define F Machine_Fun_t
+#define I Machine_FrameInfo_t
+#define J Machine_ObjInfo_t
+#define M Machine_Mem_t
+#define O Machine_Operand_t
+#define P Machine_Prog_t
+#define R Machine_Str_t
+#define S Machine_Stm_t
+#define T Machine_Transfer_t
+
+#define W IrFile_Out_t
+#define D IrFile_In_t
+
+typedef void (*tyPut)(W, Poly_t);
+typedef Poly_t (*tyGet)(D);
+
+///////////////////////////////////////////////////////
+// writer
+static void putOperand(W out, O o) {
+    IrFile_putNat(out, o->kind);
+    switch (o->kind) {
+        case MACHINE_OP_INT:
+            IrFile_putInt(out, o->u.int_lit);
+            return;
+        case MACHINE_OP_GLOBAL:
+        case MACHINE_OP_ID:
+            IrFile_putId(out, o->u.id);
+            return;
+        default:
+            Error_impossible();
+    }
+}
+
+static void putMem(W out, M m) {
+    IrFile_putNat(out, m->kind);
+    switch (m->kind) {
+        case MACHINE_MEM_ARRAY:
+            IrFile_putId(out, m->u.array.name);
+            putOperand(out, m->u.array.index);
+            return;
+        case MACHINE_MEM_CLASS:
+            IrFile_putId(out, m->u.class.name);
+            IrFile_putId(out, m->u.class.field);
+            IrFile_putInt(out, m->u.class.index);
+            return;
+        default:
+            Error_impossible();
+    }
+}
+
+static void putStm(W out, S s) {
+    IrFile_putNat(out, s->kind);
+    switch (s->kind) {
+        case MACHINE_STM_MOVE:
+            IrFile_putId(out, s->u.move.dest);
+            putOperand(out, s->u.move.src);
+            return;
+        case MACHINE_STM_BOP:
+            IrFile_putId(out, s->u.bop.dest);
+            putOperand(out, s->u.bop.left);
+            IrFile_putNat(out, s->u.bop.op);
+            putOperand(out, s->u.bop.right);
+            return;
+        case MACHINE_STM_UOP:
+            IrFile_putId(out, s->u.uop.dest);
+            IrFile_putNat(out, s->u.uop.op);
+            putOperand(out, s->u.uop.src);
+            return;
+        case MACHINE_STM_STORE:
+            putMem(out, s->u.store.m);
+            putOperand(out, s->u.store.src);
+            return;
+        case MACHINE_STM_LOAD:
+            IrFile_putId(out, s->u.load.dest);
+            putMem(out, s->u.load.m);
+            return;
+        case MACHINE_STM_TRY:
+            IrFile_putLabel(out, s->u.try);
+            return;
+        case MACHINE_STM_TRY_END:
+            IrFile_putLabel(out, s->u.tryEnd);
+            return;
+        case MACHINE_STM_NEW_CLASS:
+            IrFile_putId(out, s->u.newClass.dest);
+            IrFile_putId(out, s->u.newClass.cname);
+            return;
+        case MACHINE_STM_NEW_ARRAY:
+            IrFile_putId(out, s->u.newArray.dest);
+            IrFile_putAtype(out, s->u.newArray.ty);
+            putOperand(out, s->u.newArray.size);
+            return;
+        case MACHINE_STM_RUNTIME_CLASS:
+            IrFile_putId(out, s->u.class.dest);
+            IrFile_putInt(out, s->u.class.index);
+            IrFile_putInt(out, s->u.class.size);
+            IrFile_putId(out, s->u.class.fname);
+            return;
+        case MACHINE_STM_RUNTIME_ARRAY:
+            IrFile_putId(out, s->u.array.dest);
+            IrFile_putInt(out, s->u.array.isPtr);
+            putOperand(out, s->u.array.size);
+            IrFile_putInt(out, s->u.array.scale);
+            IrFile_putId(out, s->u.array.fname);
+            return;
+        default:
+            Error_impossible();
+    }
+}
+
+static void putTransfer(W out, T t) {
+    IrFile_putNat(out, t->kind);
+    switch (t->kind) {
+        case MACHINE_TRANS_IF:
+            putOperand(out, t->u.iff.cond);
+            IrFile_putLabel(out, t->u.iff.truee);
+            IrFile_putLabel(out, t->u.iff.falsee);
+            return;
+        case MACHINE_TRANS_JUMP:
+            IrFile_putLabel(out, t->u.jump);
+            return;
+        case MACHINE_TRANS_RETURN:
+            putOperand(out, t->u.ret);
+            return;
+        case MACHINE_TRANS_CALL:
+            IrFile_putId(out, t->u.call.dest);
+            // fall through
+        case MACHINE_TRANS_CALL_NOASSIGN:
+            IrFile_putId(out, t->u.call.name);
+            IrFile_putList(out, t->u.call.args, (tyPut) putOperand);
+            IrFile_putLabel(out, t->u.call.leave);
+            IrFile_putLabel(out, t->u.call.normal);
+            return;
+        case MACHINE_TRANS_THROW:
+            return;
+        default:
+            Error_impossible();
+    }
+}
+
+static void putBlock(W out, B b) {
+    IrFile_putLabel(out, b->label);
+    IrFile_putList(out, b->stms, (tyPut) putStm);
+    putTransfer(out, b->transfer);
+}
+
+static void putFun(W out, F f) {
+    IrFile_putAtype(out, f->type);
+    IrFile_putId(out, f->name);
+    IrFile_putList(out, f->args, (tyPut) IrFile_putDec);
+    IrFile_putList(out, f->decs, (tyPut) IrFile_putDec);
+    IrFile_putList(out, f->blocks, (tyPut) putBlock);
+    IrFile_putId(out, f->retId);
+    IrFile_putLabel(out, f->entry);
+    IrFile_putLabel(out, f->exitt);
+    IrFile_putInt(out, f->frameIndex);
+}
+
+static void putStr(W out, R s) {
+    IrFile_putId(out, s->name);
+    IrFile_putString(out, s->value);
+}
+
+static void putFrameInfo(W out, I i) {
+    IrFile_putLongs(out, i->frameOffsets);
+    IrFile_putLongs(out, i->frameOffsetsDec);
+    IrFile_putInt(out, i->size);
+    // "regs" is given by the target, after the IR is saved
+}
+
+static void putObjInfo(W out, J j) {
+    IrFile_putLongs(out, j->offsets);
+}
+
+void Machine_Prog_write(String_t fname, P p) {
+    W out = IrFile_Out_new();
+
+    IrFile_putList(out, p->strings, (tyPut) putStr);
+    IrFile_putList(out, p->frameInfo, (tyPut) putFrameInfo);
+    IrFile_putList(out, p->layoutInfo, (tyPut) putObjInfo);
+    IrFile_putList(out, p->classes, (tyPut) IrFile_putClass);
+    IrFile_putList(out, p->funcs, (tyPut) putFun);
+    IrFile_save(out, fname, IR_FILE_MACHINE);
+}
+
+///////////////////////////////////////////////////////
+// reader
+static O getOperand(D in) {
+    switch (IrFile_getNat(in)) {
+        case MACHINE_OP_INT:
+            return Machine_Operand_new_int(IrFile_getInt(in));
+        case MACHINE_OP_GLOBAL:
+            return Machine_Operand_new_global(IrFile_getId(in));
+        case MACHINE_OP_ID:
+            return Machine_Operand_new_id(IrFile_getId(in));
+        default:
+            Error_error("invalid IR file\n");
+    }
+    return 0;
+}
+
+static M getMem(D in) {
+    Id_t name, field;
+
+    switch (IrFile_getNat(in)) {
+        case MACHINE_MEM_ARRAY:
+            name = IrFile_getId(in);
+            return Machine_Mem_new_array(name, getOperand(in));
+        case MACHINE_MEM_CLASS:
+            name = IrFile_getId(in);
+            field = IrFile_getId(in);
+            return Machine_Mem_new_class(name, field, IrFile_getInt(in));
+        default:
+            Error_error("invalid IR file\n");
+    }
+    return 0;
+}
+
+static S getStm(D in) {
+    Id_t dest;
+    O o;
+    Operator_t op;
+    M m;
+
+    switch (IrFile_getNat(in)) {
+        case MACHINE_STM_MOVE:
+            dest = IrFile_getId(in);
+            return Machine_Stm_new_move(dest, getOperand(in));
+        case MACHINE_STM_BOP:
+            dest = IrFile_getId(in);
+            o = getOperand(in);
+            op = (Operator_t) IrFile_getNat(in);
+            return Machine_Stm_new_bop(dest, o, op, getOperand(in));
+        case MACHINE_STM_UOP:
+            dest = IrFile_getId(in);
+            op = (Operator_t) IrFile_getNat(in);
+            return Machine_Stm_new_uop(dest, op, getOperand(in));
+        case MACHINE_STM_STORE:
+            m = getMem(in);
+            return Machine_Stm_new_store(m, getOperand(in));
+        case MACHINE_STM_LOAD:
+            dest = IrFile_getId(in);
+            return Machine_Stm_new_load(dest, getMem(in));
+        case MACHINE_STM_TRY:
+            return Machine_Stm_new_try(IrFile_getLabel(in));
+        case MACHINE_STM_TRY_END:
+            return Machine_Stm_new_try_end(IrFile_getLabel(in));
+        case MACHINE_STM_NEW_CLASS:
+            dest = IrFile_getId(in);
+            return Machine_Stm_new_newClass(dest, IrFile_getId(in));
+        case MACHINE_STM_NEW_ARRAY: {
+            Atype_t ty;
+
+            dest = IrFile_getId(in);
+            ty = IrFile_getAtype(in);
+            return Machine_Stm_new_newArray(dest, ty, getOperand(in));
+        }
+        case MACHINE_STM_RUNTIME_CLASS: {
+            long index, size;
+
+            dest = IrFile_getId(in);
+            index = IrFile_getInt(in);
+            size = IrFile_getInt(in);
+            return Machine_Stm_Runtime_class(dest, index, size, IrFile_getId(in));
+        }
+        case MACHINE_STM_RUNTIME_ARRAY: {
+            int isPtr, scale;
+
+            dest = IrFile_getId(in);
+            isPtr = (int) IrFile_getInt(in);
+            o = getOperand(in);
+            scale = (int) IrFile_getInt(in);
+            return Machine_Stm_Runtime_array(dest, isPtr, o, scale, IrFile_getId(in));
+        }
+        default:
+            Error_error("invalid IR file\n");
+    }
+    return 0;
+}
+
+static T getTransfer(D in) {
+    Id_t dest = 0, name;
+    List_t args;
+    Label_t leave;
+
+    switch (IrFile_getNat(in)) {
+        case MACHINE_TRANS_IF: {
+            O cond = getOperand(in);
+            Label_t truee = IrFile_getLabel(in);
+
+            return Machine_Transfer_new_if(cond, truee, IrFile_getLabel(in));
+        }
+        case MACHINE_TRANS_JUMP:
+            return Machine_Transfer_new_jump(IrFile_getLabel(in));
+        case MACHINE_TRANS_RETURN:
+            return Machine_Transfer_new_return(getOperand(in));
+        case MACHINE_TRANS_CALL:
+            dest = IrFile_getId(in);
+            name = IrFile_getId(in);
+            args = IrFile_getList(in, (tyGet) getOperand);
+            leave = IrFile_getLabel(in);
+            return Machine_Transfer_new_call(dest, name, args, leave, IrFile_getLabel(in));
+        case MACHINE_TRANS_CALL_NOASSIGN:
+            name = IrFile_getId(in);
+            args = IrFile_getList(in, (tyGet) getOperand);
+            leave = IrFile_getLabel(in);
+            return Machine_Transfer_new_callnoassign(name, args, leave, IrFile_getLabel(in));
+        case MACHINE_TRANS_THROW:
+            return Machine_Transfer_new_throw();
+        default:
+            Error_error("invalid IR file\n");
+    }
+    return 0;
+}
+
+static B getBlock(D in) {
+    Label_t label = IrFile_getLabel(in);
+    List_t stms = IrFile_getList(in, (tyGet) getStm);
+
+    return Machine_Block_new(label, stms, getTransfer(in));
+}
+
+static F getFun(D in) {
+    Atype_t type = IrFile_getAtype(in);
+    Id_t name = IrFile_getId(in);
+    List_t args = IrFile_getList(in, (tyGet) IrFile_getDec);
+    List_t decs = IrFile_getList(in, (tyGet) IrFile_getDec);
+    List_t blocks = IrFile_getList(in, (tyGet) getBlock);
+    Id_t retId = IrFile_getId(in);
+    Label_t entry = IrFile_getLabel(in);
+    Label_t exitt = IrFile_getLabel(in);
+
+    return Machine_Fun_new(type, name, args, decs, blocks, retId, entry, exitt, (int) IrFile_getInt(in));
+}
+
+static R getStr(D in) {
+    Id_t name = IrFile_getId(in);
+
+    return Machine_Str_new(name, IrFile_getString(in));
+}
+
+static I getFrameInfo(D in) {
+    List_t offsets = IrFile_getLongs(in);
+    List_t decOffsets = IrFile_getLongs(in);
+
+    return Machine_FrameInfo_new(offsets, decOffsets, (int) IrFile_getInt(in), 0, 0);
+}
+
+static J getObjInfo(D in) {
+    return Machine_ObjInfo_new(IrFile_getLongs(in));
+}
+
+P Machine_Prog_read(D in) {
+    List_t strings, frameInfo, layoutInfo, classes;
+
+    assert(IrFile_stage(in) == IR_FILE_MACHINE);
+    strings = IrFile_getList(in, (tyGet) getStr);
+    frameInfo = IrFile_getList(in, (tyGet) getFrameInfo);
+    layoutInfo = IrFile_getList(in, (tyGet) getObjInfo);
+    classes = IrFile_getList(in, (tyGet) IrFile_getClass);
+    return Machine_Prog_new(strings, frameInfo, layoutInfo, classes, IrFile_getList(in, (tyGet) getFun));
+}
+
+#undef B
+#undef F
+#undef I
+#undef J
+#undef M
+#undef O
+#undef P
+#undef R
+#undef S
+#undef T
+#undef W
+#undef D
@@ -0,0 +1,13 @@
+#ifndef MACHINE_FILE_H
+#define MACHINE_FILE_H
+
+#include "../atoms/ir-file.h"
+#include "machine.h"
+
+// write "p" to "fname" in the binary IR format.
+void Machine_Prog_write(String_t fname, Machine_Prog_t p);
+
+// read the program from a file of the machine stage.
+Machine_Prog_t Machine_Prog_read(IrFile_In_t in);
+
+#endif
@@ -6,10 +6,10 @@
 Machine_Prog_t Machine_main(Machine_Prog_t p) {
     Pass_t genFrame, genLayout;
 
-    genFrame = Pass_new("genFrame", VERBOSE_SUBPASS, p, (Poly_tyId) Machine_genFrame);
+    genFrame = Pass_newIr("genFrame", VERBOSE_SUBPASS, p, (Poly_tyId) Machine_genFrame, (Pass_tySize) Machine_Prog_size, (Pass_tySize) Machine_Prog_size);
     p = Pass_doit(&genFrame);
 
-    genLayout = Pass_new("genLayout", VERBOSE_SUBPASS, p, (Poly_tyId) Machine_genLayout);
+    genLayout = Pass_newIr("genLayout", VERBOSE_SUBPASS, p, (Poly_tyId) Machine_genLayout, (Pass_tySize) Machine_Prog_size, (Pass_tySize) Machine_Prog_size);
     p = Pass_doit(&genLayout);
 
     return p;
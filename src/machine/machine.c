@@ -1,5 +1,6 @@
 #include "machine.h"
 #include "../lib/mem.h"
+#include "../lib/triple.h"
 #include <assert.h>
 
 #define B Machine_Block_t
@@ -108,6 +109,39 @@ File_t Machine_Mem_print(File_t file, M m) {
     return file;
 }
 
+static void Machine_Operand_foreachUse(O o, void (*f)(Id_t)) {
+    assert(o);
+    switch (o->kind) {
+        case MACHINE_OP_INT:
+        case MACHINE_OP_GLOBAL:
+            return;
+        case MACHINE_OP_ID:
+            f(o->u.id);
+            return;
+        default:
+            Error_impossible();
+            return;
+    }
+    Error_impossible();
+}
+
+static void Machine_Mem_foreachUse(M m, void (*f)(Id_t)) {
+    assert(m);
+    switch (m->kind) {
+        case MACHINE_MEM_ARRAY:
+            f(m->u.array.name);
+            Machine_Operand_foreachUse(m->u.array.index, f);
+            return;
+        case MACHINE_MEM_CLASS:
+            f(m->u.class.name);
+            return;
+        default:
+            Error_impossible();
+            return;
+    }
+    Error_impossible();
+}
+
 //////////////////////////////////////////////////////
 // statement
 S Machine_Stm_new_move(Id_t dest, O src) {
@@ -226,6 +260,83 @@ S Machine_Stm_Runtime_array(Id_t dest, int isPtr, O size, int scale, Id_t file_n
     return s;
 }
 
+void Machine_Stm_foreachUse(S s, void (*f)(Id_t)) {
+    assert(s);
+    switch (s->kind) {
+        case MACHINE_STM_MOVE:
+            Machine_Operand_foreachUse(s->u.move.src, f);
+            return;
+        case MACHINE_STM_BOP:
+            Machine_Operand_foreachUse(s->u.bop.left, f);
+            Machine_Operand_foreachUse(s->u.bop.right, f);
+            return;
+        case MACHINE_STM_UOP:
+            Machine_Operand_foreachUse(s->u.uop.src, f);
+            return;
+        case MACHINE_STM_STORE:
+            Machine_Mem_foreachUse(s->u.store.m, f);
+            Machine_Operand_foreachUse(s->u.store.src, f);
+            return;
+        case MACHINE_STM_LOAD:
+            Machine_Mem_foreachUse(s->u.load.m, f);
+            return;
+        case MACHINE_STM_NEW_ARRAY:
+            Machine_Operand_foreachUse(s->u.newArray.size, f);
+            return;
+        case MACHINE_STM_RUNTIME_ARRAY:
+            Machine_Operand_foreachUse(s->u.array.size, f);
+            return;
+        case MACHINE_STM_NEW_CLASS:
+        case MACHINE_STM_RUNTIME_CLASS:
+        case MACHINE_STM_TRY:
+        case MACHINE_STM_TRY_END:
+            return;
+        default:
+            // calls are transfers
+            Error_impossible();
+            return;
+    }
+    Error_impossible();
+}
+
+void Machine_Stm_foreachDef(S s, void (*f)(Id_t)) {
+    assert(s);
+    switch (s->kind) {
+        case MACHINE_STM_MOVE:
+            f(s->u.move.dest);
+            return;
+        case MACHINE_STM_BOP:
+            f(s->u.bop.dest);
+            return;
+        case MACHINE_STM_UOP:
+            f(s->u.uop.dest);
+            return;
+        case MACHINE_STM_LOAD:
+            f(s->u.load.dest);
+            return;
+        case MACHINE_STM_NEW_CLASS:
+            f(s->u.newClass.dest);
+            return;
+        case MACHINE_STM_NEW_ARRAY:
+            f(s->u.newArray.dest);
+            return;
+        case MACHINE_STM_RUNTIME_CLASS:
+            f(s->u.class.dest);
+            return;
+        case MACHINE_STM_RUNTIME_ARRAY:
+            f(s->u.array.dest);
+            return;
+        case MACHINE_STM_STORE:
+        case MACHINE_STM_TRY:
+        case MACHINE_STM_TRY_END:
+            return;
+        default:
+            Error_impossible();
+            return;
+    }
+    Error_impossible();
+}
+
 static void spacetab(File_t file) {
     fprintf(file, "%s", "\t");
 }
@@ -386,6 +497,67 @@ T Machine_Transfer_new_callnoassign(Id_t f, List_t args, Label_t leave, Label_t
 }
 
 
+void Machine_Transfer_foreachUse(T t, void (*f)(Id_t)) {
+    assert(t);
+    switch (t->kind) {
+        case MACHINE_TRANS_IF:
+            Machine_Operand_foreachUse(t->u.iff.cond, f);
+            return;
+        case MACHINE_TRANS_RETURN:
+            Machine_Operand_foreachUse(t->u.ret, f);
+            return;
+        case MACHINE_TRANS_CALL:
+        case MACHINE_TRANS_CALL_NOASSIGN: {
+            List_t l = List_getFirst(t->u.call.args);
+
+            while (l) {
+                Machine_Operand_foreachUse(l->data, f);
+                l = l->next;
+            }
+            return;
+        }
+        case MACHINE_TRANS_JUMP:
+        case MACHINE_TRANS_THROW:
+            return;
+        default:
+            Error_impossible();
+            return;
+    }
+    Error_impossible();
+}
+
+void Machine_Transfer_foreachDef(T t, void (*f)(Id_t)) {
+    assert(t);
+    if (t->kind == MACHINE_TRANS_CALL && t->u.call.dest)
+        f(t->u.call.dest);
+}
+
+void Machine_Transfer_foreachSucc(T t, void (*f)(Label_t)) {
+    assert(t);
+    switch (t->kind) {
+        case MACHINE_TRANS_IF:
+            f(t->u.iff.truee);
+            f(t->u.iff.falsee);
+            return;
+        case MACHINE_TRANS_JUMP:
+            f(t->u.jump);
+            return;
+        case MACHINE_TRANS_CALL:
+        case MACHINE_TRANS_CALL_NOASSIGN:
+            if (t->u.call.leave)
+                f(t->u.call.leave);
+            f(t->u.call.normal);
+            return;
+        case MACHINE_TRANS_RETURN:
+        case MACHINE_TRANS_THROW:
+            return;
+        default:
+            Error_impossible();
+            return;
+    }
+    Error_impossible();
+}
+
 File_t Machine_Transfer_print(File_t file, T t) {
     assert(t);
     spacetab(file);
@@ -562,13 +734,15 @@ File_t Machine_ObjInfo_print(File_t file, J m) {
 
 /////////////////////////////////////////////////////
 // frame info
-I Machine_FrameInfo_new(List_t offsets, List_t decOffsets, int size) {
+I Machine_FrameInfo_new(List_t offsets, List_t decOffsets, int size, List_t regs, List_t moves) {
     I p;
 
     Mem_NEW(p);
     p->frameOffsets = offsets;
     p->frameOffsetsDec = decOffsets;
     p->size = size;
+    p->regs = regs;
+    p->moves = moves;
     return p;
 }
 
@@ -596,7 +770,32 @@ File_t Machine_FrameInfo_print(File_t file, I p) {
         fprintf(file, "%ld, ", off);
         tmp = tmp->next;
     }
-    fprintf(file, "%s", "};\n\n");
+    fprintf(file, "%s", "};\n");
+
+    if (p->regs) {
+        fprintf(file, "int[] regs_%d = { ", frameIndex);
+        for (tmp = List_getFirst(p->regs); tmp; tmp = tmp->next) {
+            Triple_t r = tmp->data;
+            fprintf(file, "%s: %ld from %ld, ", Id_toString(Triple_first(r)), (long) Triple_third(r),
+                    (long) Triple_second(r));
+        }
+        fprintf(file, "%s", "};\n");
+    }
+    if (p->moves) {
+        fprintf(file, "int[] moves_%d = { ", frameIndex);
+        for (tmp = List_getFirst(p->moves); tmp; tmp = tmp->next) {
+            Triple_t e = tmp->data;
+
+            fprintf(file, "%s -> %s: ", Label_toString(Triple_first(e)), Label_toString(Triple_second(e)));
+            for (List_t m = List_getFirst(Triple_third(e)); m; m = m->next) {
+                Triple_t r = m->data;
+                fprintf(file, "%s: %ld to %ld, ", Id_toString(Triple_first(r)), (long) Triple_second(r),
+                        (long) Triple_third(r));
+            }
+        }
+        fprintf(file, "%s", "};\n");
+    }
+    fprintf(file, "%s", "\n");
     return file;
 }
 
@@ -614,6 +813,22 @@ P Machine_Prog_new(List_t strings, List_t frameInfo, List_t layoutInfo, List_t c
     return p;
 }
 
+void Machine_Prog_size(P x, long *funcs, long *blocks, long *stms) {
+    List_t f, b;
+
+    assert(x);
+    *funcs = List_size(x->funcs);
+    *blocks = 0;
+    *stms = 0;
+    for (f = List_getFirst(x->funcs); f; f = f->next) {
+        F fun = f->data;
+
+        *blocks += List_size(fun->blocks);
+        for (b = List_getFirst(fun->blocks); b; b = b->next)
+            *stms += List_size(((B) b->data)->stms);
+    }
+}
+
 File_t Machine_Prog_print(File_t file, P x) {
     List_t frame;
     List_t layouts;
@@ -184,6 +184,11 @@ S Machine_Stm_Runtime_class(Id_t dest, long index, long size, Id_t fname);
 
 S Machine_Stm_Runtime_array(Id_t, int isPtr, O size, int scale, Id_t fname);
 
+// apply "f" to each variable that "s" reads
+void Machine_Stm_foreachUse(S, void (*f)(Id_t));
+// apply "f" to the variable that "s" writes, if any
+void Machine_Stm_foreachDef(S, void (*f)(Id_t));
+
 File_t Machine_Stm_print(File_t file, S);
 
 
@@ -232,6 +237,12 @@ T Machine_Transfer_new_call(Id_t dest, Id_t name, List_t args, Label_t leave, La
 
 T Machine_Transfer_new_callnoassign(Id_t name, List_t args, Label_t leave, Label_t normal);
 
+void Machine_Transfer_foreachUse(T, void (*f)(Id_t));
+void Machine_Transfer_foreachDef(T, void (*f)(Id_t));
+// apply "f" to each label that "t" may go to, including
+// the handler a call may leave to
+void Machine_Transfer_foreachSucc(T, void (*f)(Label_t));
+
 File_t Machine_Transfer_print(File_t file, T);
 
 
@@ -312,9 +323,23 @@ struct I {
     // but excluding return address and ... (in unit of
     // bytes)
     int size;
+    // the variables that a target keeps in registers
+    // rather than in their slots, as given by its register
+    // allocator (see "x86/reg-alloc.c"); 0 for none.
+    // List<Triple<Id_t, long, long>>, a variable, the index
+    // in "blocks" of the block from which on it is in the
+    // register, and the register (0 for its slot), by
+    // variable and then by block
+    List_t regs;
+    // the variables that are in different places at the
+    // two ends of an edge, and move on it; 0 for none.
+    // List<Triple<Label_t, Label_t, List<Triple<Id_t, long, long>>>>,
+    // the edge, and a variable and the registers it moves
+    // from and to (0 for its slot)
+    List_t moves;
 };
 
-I Machine_FrameInfo_new(List_t, List_t, int);
+I Machine_FrameInfo_new(List_t, List_t, int, List_t regs, List_t moves);
 
 File_t Machine_FrameInfo_print(File_t file, I);
 
@@ -337,6 +362,9 @@ P Machine_Prog_new(List_t strings, List_t frameInfo, List_t layoutInfo, List_t c
 
 File_t Machine_Prog_print(File_t f, P x);
 
+// the numbers of functions, blocks and statements in "x"
+void Machine_Prog_size(P x, long *funcs, long *blocks, long *stms);
+
 #undef B
 #undef F
 #undef I
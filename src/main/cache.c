@@ -0,0 +1,227 @@
+#include "cache.h"
+#include "../control/control.h"
+#include "../control/version.h"
+#include "../lib/int.h"
+#include "../lib/mem.h"
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utime.h>
+
+#define ONEM (1024 * 1024)
+
+static long hits = 0;
+static long misses = 0;
+static long evictions = 0;
+
+//////////////////////////////////////////////////////
+// keys
+
+// 64-bit FNV-1a
+static unsigned long long hashBytes(unsigned long long h, const char *s, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        h ^= (unsigned char) s[i];
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+static unsigned long long hashString(unsigned long long h, String_t s) {
+    return hashBytes(h, s, strlen(s) + 1);
+}
+
+// what every entry depends on, besides its input
+static unsigned long long seed(String_t kind) {
+    unsigned long long h = 0xcbf29ce484222325ULL;
+
+    h = hashString(h, kind);
+    h = hashString(h, Version_version);
+    h = hashString(h, Control_codeFlagsToString());
+    return h;
+}
+
+static String_t keyToString(unsigned long long h) {
+    char s[17];
+
+    snprintf(s, sizeof(s), "%016llx", h);
+    return String_new(s);
+}
+
+String_t Cache_keyOfHil(Hil_Prog_t p) {
+    unsigned long long h;
+    char *buf = 0;
+    size_t size = 0;
+    FILE *f;
+
+    if (!Control_cache)
+        return 0;
+    // these need the passes to run
+    if (Control_dump_lookup(DUMP_TAC) || Control_dump_lookup(DUMP_MACHINE) || Control_dump_lookup(DUMP_X86) || Control_writeIr != WRITE_IR_NONE)
+        return 0;
+    f = open_memstream(&buf, &size);
+    if (!f)
+        return 0;
+    Hil_Prog_print(f, p);
+    fclose(f);
+    h = hashBytes(seed("hil"), buf, size);
+    free(buf);
+    return keyToString(h);
+}
+
+String_t Cache_keyOfFile(String_t file) {
+    unsigned long long h;
+    char buf[4096];
+    size_t n;
+    FILE *f;
+
+    if (!Control_cache)
+        return 0;
+    f = fopen(file, "rb");
+    if (!f)
+        return 0;
+    h = hashString(seed("object"), Control_headerDirectory);
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+        h = hashBytes(h, buf, n);
+    fclose(f);
+    return keyToString(h);
+}
+
+//////////////////////////////////////////////////////
+// entries
+
+// e.g., "<dir>/<key>.c" for "files-0.c"
+static String_t entryName(String_t key, String_t file) {
+    String_t ext = strrchr(file, '.');
+
+    return String_concat(Control_cache, "/", key, (ext) ? ext : "", 0);
+}
+
+static int copy(String_t from, String_t to) {
+    char buf[4096];
+    size_t n;
+    FILE *in, *out;
+    int ok = 1;
+
+    in = fopen(from, "rb");
+    if (!in)
+        return 0;
+    out = fopen(to, "wb");
+    if (!out) {
+        fclose(in);
+        return 0;
+    }
+    while ((n = fread(buf, 1, sizeof(buf), in)) > 0) {
+        if (fwrite(buf, 1, n, out) != n) {
+            ok = 0;
+            break;
+        }
+    }
+    fclose(in);
+    if (fclose(out))
+        ok = 0;
+    return ok;
+}
+
+String_t Cache_fetch(String_t key, String_t file) {
+    String_t entry;
+
+    if (!key)
+        return 0;
+    entry = entryName(key, file);
+    if (!copy(entry, file)) {
+        misses++;
+        return 0;
+    }
+    // mark it as recently used
+    utime(entry, 0);
+    hits++;
+    return file;
+}
+
+void Cache_store(String_t key, String_t file) {
+    String_t entry, temp;
+
+    if (!key)
+        return;
+    mkdir(Control_cache, 0777);
+    entry = entryName(key, file);
+    // other compilers may share the cache, so an entry is
+    // only visible once it is complete
+    temp = String_concat(entry, ".tmp", Int_toString(getpid()), 0);
+    if (copy(file, temp))
+        rename(temp, entry);
+    else
+        remove(temp);
+}
+
+//////////////////////////////////////////////////////
+// eviction
+typedef struct {
+    String_t name;
+    long size;
+    time_t time;
+} Entry_t;
+
+static int olderFirst(const void *x, const void *y) {
+    const Entry_t *a = x, *b = y;
+
+    return (a->time > b->time) - (a->time < b->time);
+}
+
+void Cache_trim(void) {
+    Entry_t *entries;
+    long num = 0, capacity = 64, total = 0;
+    DIR *dir;
+    struct dirent *e;
+    struct stat st;
+
+    if (!Control_cache)
+        return;
+    dir = opendir(Control_cache);
+    if (!dir)
+        return;
+    Mem_NEW_SIZE(entries, capacity);
+    while ((e = readdir(dir))) {
+        String_t name;
+
+        if (e->d_name[0] == '.' || strstr(e->d_name, ".tmp"))
+            continue;
+        name = String_concat(Control_cache, "/", e->d_name, 0);
+        if (stat(name, &st) || !S_ISREG(st.st_mode))
+            continue;
+        if (num == capacity) {
+            Entry_t *old = entries;
+
+            capacity *= 2;
+            Mem_NEW_SIZE(entries, capacity);
+            memcpy(entries, old, (size_t) num * sizeof(*old));
+        }
+        entries[num].name = name;
+        entries[num].size = (long) st.st_size;
+        entries[num].time = st.st_mtime;
+        total += entries[num].size;
+        num++;
+    }
+    closedir(dir);
+
+    qsort(entries, (size_t) num, sizeof(*entries), olderFirst);
+    for (long i = 0; i < num && total > Control_cacheSize * ONEM; i++) {
+        if (remove(entries[i].name))
+            continue;
+        total -= entries[i].size;
+        evictions++;
+    }
+}
+
+void Cache_status(void) {
+    if (!Control_cache)
+        return;
+    printf("Cache status:\n"
+           "  Num of hits      : %ld\n"
+           "  Num of misses    : %ld\n"
+           "  Num of evictions : %ld\n",
+           hits, misses, evictions);
+}
@@ -0,0 +1,39 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include "../hil/hil.h"
+#include "../lib/string.h"
+
+// A content-addressed cache of compiled files, in the
+// directory given by "-cache". An entry is named by a
+// hash of what it was compiled from, along with the
+// compiler version and the flags, so a stale entry is
+// never hit, but just ages out: once the cache grows
+// over "-cache-size", the least recently used entries
+// are evicted.
+//
+// Two kinds of entries are kept: the C (or assembly)
+// file generated for the HIL of a source file, and the
+// object file gcc generates for such a file.
+
+// the key for the code generated from "p"; 0 if the cache
+// is off, or the ILs in between are to be dumped.
+String_t Cache_keyOfHil(Hil_Prog_t p);
+
+// the key for the object file of the generated "file".
+String_t Cache_keyOfFile(String_t file);
+
+// copy the entry for "key" to "file", and return "file";
+// 0 on a miss.
+String_t Cache_fetch(String_t key, String_t file);
+
+// keep a copy of "file" as the entry for "key".
+void Cache_store(String_t key, String_t file);
+
+// evict entries until the cache fits in its size.
+void Cache_trim(void);
+
+// hits, misses and evictions in this process
+void Cache_status(void);
+
+#endif
@@ -1,59 +1,51 @@
 #include "compile.h"
+#include "cache.h"
 #include "../c-codegen/c-codegen-main.h"
 #include "../control/pass.h"
+#include "../control/profile.h"
 #include "../elaborate/elaborate-main.h"
 #include "../hil/hil-main.h"
 #include "../lib/error.h"
+#include "../lib/mem.h"
+#include "../lib/system.h"
+#include "../lib/thread.h"
+#include "../lib/trace.h"
+#include "../machine/machine-file.h"
 #include "../machine/machine-main.h"
 #include "../parser/parse.h"
+#include "../ssa/ssa-file.h"
 #include "../ssa/ssa-main.h"
 #include "../x86/x86-main.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 static String_t Compile_one(String_t file);
+static String_t Compile_oneTraced(String_t file);
 
 static String_t genFileName(String_t f, String_t a) {
     return String_concat(f, ".", a, 0);
 }
 
-static String_t Compile_one(String_t file) {
-    Pass_t lexAndPass, elaborate,
-            flatten, ssaPass, machinePass, CPass, x86Pass;
-    Ast_Prog_t ast;
-    Hil_Prog_t hil;
-    Ssa_Prog_t ssa;
-    Machine_Prog_t machine;
-    Tuple_t tuple;
-    X86_Prog_t x86;
-
-    lexAndPass = Pass_new("lexAndParse", VERBOSE_SUBPASS, file, (Poly_tyId) Parse_parse);
-    ast = Pass_doit(&lexAndPass);
-    if (Control_dump_lookup(DUMP_AST)) {
-        File_saveToFile(genFileName("gen", "ast"), (Poly_tyPrint) Ast_Prog_print, ast);
-    }
-
-    elaborate = Pass_new("elaboration",
-                         VERBOSE_SUBPASS,
-                         ast,
-                         (Poly_tyId) Elaborate_main);
-    hil = Pass_doit(&elaborate);
-    if (Control_dump_lookup(DUMP_HIL)) {
-        File_saveToFile(genFileName("gen", "hil"), (Poly_tyPrint) Hil_Prog_print, hil);
-    }
-
-    flatten = Pass_new("hil", VERBOSE_SUBPASS, hil, (Poly_tyId) Hil_main);
-    ssa = Pass_doit(&flatten);
-
-    if (Control_dump_lookup(DUMP_TAC)) {
-        File_saveToFile(genFileName("gen", "ssa"), (Poly_tyPrint) Ssa_Prog_print, ssa);
+static String_t outFileName(void) {
+    switch (Control_codegen) {
+        case CODEGEN_C:
+            return C_codegen_fileName();
+        case CODEGEN_X86:
+            return X86_fileName();
+        default:
+            Error_impossible();
+            return 0;
     }
+}
 
-    ssaPass = Pass_new("ssa", VERBOSE_SUBPASS, ssa, (Poly_tyId) Ssa_main);
-    machine = Pass_doit(&ssaPass);
-    if (Control_dump_lookup(DUMP_MACHINE)) {
-        File_saveToFile(genFileName("gen", "machine"), (Poly_tyPrint) Machine_Prog_print, machine);
-    }
+// from machine IR on, in the machine arena
+static String_t fromMachine(String_t file, Machine_Prog_t machine, String_t key) {
+    Pass_t machinePass, CPass, x86Pass;
+    Tuple_t tuple;
+    X86_Prog_t x86;
 
-    machinePass = Pass_new("machine", VERBOSE_SUBPASS, machine, (Poly_tyId) Machine_main);
+    machinePass = Pass_newIr("machine", VERBOSE_SUBPASS, machine, (Poly_tyId) Machine_main, (Pass_tySize) Machine_Prog_size, (Pass_tySize) Machine_Prog_size);
     machine = Pass_doit(&machinePass);
     /* if (Control_dump_lookup (DUMP_MACHINE)){ */
     /*   File_saveToFile (genFileName (file, "machine"), */
@@ -65,13 +57,14 @@ static String_t Compile_one(String_t file) {
         case CODEGEN_C: {
             String_t f;
 
-            CPass = Pass_new("genC", VERBOSE_SUBPASS, machine, (Poly_tyId) C_codegen_main);
+            CPass = Pass_newIr("genC", VERBOSE_SUBPASS, machine, (Poly_tyId) C_codegen_main, (Pass_tySize) Machine_Prog_size, 0);
             f = Pass_doit(&CPass);
             //            machine = 0;
+            Cache_store(key, f);
             return f;
         }
         case CODEGEN_X86: {
-            x86Pass = Pass_new("genX86", VERBOSE_SUBPASS, machine, (Poly_tyId) X86_main);
+            x86Pass = Pass_newIr("genX86", VERBOSE_SUBPASS, machine, (Poly_tyId) X86_main, (Pass_tySize) Machine_Prog_size, 0);
             tuple = Pass_doit(&x86Pass);
             x86 = Tuple_first(tuple);
             if (Control_dump_lookup(DUMP_X86)) {
@@ -80,15 +73,227 @@ static String_t Compile_one(String_t file) {
             }
             //            machine = 0;
             //            x86 = 0;
+            Cache_store(key, Tuple_second(tuple));
             return Tuple_second(tuple);
         }
         default:
             Error_impossible();
+            return 0;
+    }
+}
+
+// from SSA on, in the SSA arena
+static String_t fromSsa(String_t file, Ssa_Prog_t ssa, String_t key) {
+    Pass_t ssaPass;
+    Machine_Prog_t machine;
+
+    if (Control_dump_lookup(DUMP_TAC)) {
+        File_saveToFile(genFileName("gen", "ssa"), (Poly_tyPrint) Ssa_Prog_print, ssa);
+    }
+    if (Control_writeIr == WRITE_IR_SSA)
+        Ssa_Prog_write(genFileName(file, "ssa.ir"), ssa);
+
+    // "Ssa_main" switches to the machine arena before
+    // it translates the program to machine IR.
+    ssaPass = Pass_newIr("ssa", VERBOSE_SUBPASS, ssa, (Poly_tyId) Ssa_main, (Pass_tySize) Ssa_Prog_size, (Pass_tySize) Machine_Prog_size);
+    machine = Pass_doit(&ssaPass);
+    Mem_Arena_release(MEM_ARENA_SSA);
+    if (Control_dump_lookup(DUMP_MACHINE)) {
+        File_saveToFile(genFileName("gen", "machine"), (Poly_tyPrint) Machine_Prog_print, machine);
+    }
+    if (Control_writeIr == WRITE_IR_MACHINE)
+        Machine_Prog_write(genFileName(file, "machine.ir"), machine);
+
+    return fromMachine(file, machine, key);
+}
+
+// resume the pipeline at the stage the file was written at
+static String_t fromIr(String_t file) {
+    Pass_t readPass;
+    IrFile_In_t in;
+    String_t out;
+
+    in = IrFile_open(file);
+    switch (IrFile_stage(in)) {
+        case IR_FILE_SSA: {
+            Ssa_Prog_t ssa;
+
+            Mem_Arena_enter(MEM_ARENA_SSA);
+            readPass = Pass_newIr("readIr", VERBOSE_SUBPASS, in, (Poly_tyId) Ssa_Prog_read, 0, (Pass_tySize) Ssa_Prog_size);
+            ssa = Pass_doit(&readPass);
+            IrFile_close(in);
+            out = fromSsa(file, ssa, 0);
+            break;
+        }
+        case IR_FILE_MACHINE: {
+            Machine_Prog_t machine;
+
+            Mem_Arena_enter(MEM_ARENA_MACHINE);
+            readPass = Pass_newIr("readIr", VERBOSE_SUBPASS, in, (Poly_tyId) Machine_Prog_read, 0, (Pass_tySize) Machine_Prog_size);
+            machine = Pass_doit(&readPass);
+            IrFile_close(in);
+            out = fromMachine(file, machine, 0);
+            break;
+        }
+        default:
+            Error_error2("invalid IR file:", file);
+    }
+    return out;
+}
+
+static String_t Compile_oneTraced(String_t file) {
+    Pass_t lexAndPass, elaborate, flatten;
+    Ast_Prog_t ast;
+    Hil_Prog_t hil;
+    Ssa_Prog_t ssa;
+    String_t key, out;
+
+    if (Control_readIr)
+        return fromIr(file);
+
+    // Each IR generation is allocated in its own arena,
+    // which is released once the next one has been built.
+    Mem_Arena_enter(MEM_ARENA_AST);
+    lexAndPass = Pass_new("lexAndParse", VERBOSE_SUBPASS, file, (Poly_tyId) Parse_parse);
+    ast = Pass_doit(&lexAndPass);
+    if (Control_dump_lookup(DUMP_AST)) {
+        File_saveToFile(genFileName("gen", "ast"), (Poly_tyPrint) Ast_Prog_print, ast);
+    }
+
+    Mem_Arena_enter(MEM_ARENA_HIL);
+    elaborate = Pass_new("elaboration",
+                         VERBOSE_SUBPASS,
+                         ast,
+                         (Poly_tyId) Elaborate_main);
+    hil = Pass_doit(&elaborate);
+    if (Control_dump_lookup(DUMP_HIL)) {
+        File_saveToFile(genFileName("gen", "hil"), (Poly_tyPrint) Hil_Prog_print, hil);
+    }
+
+    Mem_Arena_release(MEM_ARENA_AST);
+
+    // Everything after elaboration depends on the HIL only,
+    // so the output may come from the cache. The key lives
+    // as long as the output does.
+    Mem_Arena_enter(MEM_ARENA_MACHINE);
+    key = Cache_keyOfHil(hil);
+    out = Cache_fetch(key, outFileName());
+    if (out) {
+        Mem_Arena_release(MEM_ARENA_HIL);
+        return out;
+    }
+
+    Mem_Arena_enter(MEM_ARENA_SSA);
+    flatten = Pass_newIr("hil", VERBOSE_SUBPASS, hil, (Poly_tyId) Hil_main, 0, (Pass_tySize) Ssa_Prog_size);
+    ssa = Pass_doit(&flatten);
+    Mem_Arena_release(MEM_ARENA_HIL);
+
+    return fromSsa(file, ssa, key);
+}
+
+static String_t Compile_one(String_t file) {
+    String_t out;
+
+    out = Compile_oneTraced(file);
+
+    // the output file name is needed by the assembler and
+    // the linker, so keep it in the global arena.
+    Mem_Arena_enter(MEM_ARENA_GLOBAL);
+    out = String_new(out);
+    Mem_Arena_release(MEM_ARENA_MACHINE);
+    return out;
+}
+
+// a file to compile in a child process
+typedef struct {
+    String_t file;
+    long index;
+    long threads;
+} *Job_t;
+
+// the output file name, then, under "-profile", the
+// records of the passes on the lines after it
+static String_t Compile_child(Job_t job) {
+    String_t out;
+
+    Profile_clear();
+    Control_fileIndex = job->index;
+    Thread_init(job->threads);
+    out = Compile_one(job->file);
+    if (Control_profile)
+        out = String_concat(out, "\n", Profile_export(), 0);
+    return out;
+}
+
+static void report(Job_t job, double seconds) {
+    if (Control_Verb_order(VERBOSE_DETAIL, Control_verbose)) {
+        Trace_spaces();
+        printf("%s  @time: %.3lf\n", job->file, seconds);
     }
-    Error_impossible();
 }
 
 List_t Compile_compile(List_t files) {
-    return List_map(files,
-                    (Poly_tyId) Compile_one);
+    List_t p, jobs, result;
+    long i, n, threads;
+    Job_t job;
+
+    // traced functions print as they run, so keep them on
+    // one thread
+    threads = List_isEmpty(Trace_allFuncs()) ? Control_threads : 1;
+    if (threads == 0)
+        threads = System_numCores();
+    n = (Control_jobs) ? Control_jobs : System_numCores();
+    if (n == 1 || List_size(files) < 2) {
+        Thread_init(threads);
+        result = List_new();
+        p = List_getFirst(files);
+        for (i = 0; p; i++, p = p->next) {
+            Control_fileIndex = i;
+            List_insertLast(result, Compile_one(p->data));
+        }
+        return result;
+    }
+
+    // The front end shares its arenas and tables among all
+    // the files, so each file is compiled in a child process
+    // of its own, and the threads are split among them. The
+    // children start their own pools, as there is no way to
+    // fork one.
+    threads = threads / n;
+    if (threads < 1)
+        threads = 1;
+    // the children put their objects in the temporary
+    // directory, so it must be made before they are
+    if (C_codegen_piped())
+        System_tempDir();
+    Mem_Arena_enter(MEM_ARENA_GLOBAL);
+    jobs = List_new();
+    p = List_getFirst(files);
+    for (i = 0; p; i++, p = p->next) {
+        Mem_NEW(job);
+        job->file = p->data;
+        job->index = i;
+        job->threads = threads;
+        List_insertLast(jobs, job);
+    }
+    result = System_forkMap(jobs,
+                            (String_t(*)(Poly_t)) Compile_child,
+                            n,
+                            (System_tyReport) report);
+    // a child without a result has reported its error, but
+    // the compile as a whole must still fail
+    p = List_getFirst(result);
+    while (p) {
+        String_t out = p->data, records;
+
+        if (!out)
+            exit(1);
+        records = strchr(out, '\n');
+        if (records) {
+            *records++ = '\0';
+            Profile_import(records);
+        }
+        p = p->next;
+    }
+    return result;
 }
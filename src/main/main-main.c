@@ -1,11 +1,17 @@
 #include "main-main.h"
+#include "../c-codegen/c-codegen-main.h"
 #include "../control/command-line.h"
 #include "../control/pass.h"
+#include "../control/profile.h"
 #include "../control/version.h"
+#include "../lib/file.h"
 #include "../lib/hash.h"
 #include "../lib/int.h"
 #include "../lib/io.h"
 #include "../lib/mem.h"
+#include "../lib/system.h"
+#include "../lib/trace.h"
+#include "../main/cache.h"
 #include "../main/compile.h"
 #include <assert.h>
 #include <stdio.h>
@@ -27,60 +33,122 @@ static void show_banner(void) {
     //return;
 }
 
-static String_t assemble_one(String_t file) {
-    static long i = 0;
-    String_t obj_file = String_concat("/tmp/", "file-o-", Int_toString(i++), ".o", 0);
-    String_t cmd = String_concat("gcc -c -g ", "-I \"", Control_headerDirectory, "\" -o \"", obj_file, "\"", "  \"", file, "\"",
-                                 0);
+static String_t *newCmd(long n) {
+    String_t *cmd;
+
+    Mem_NEW_SIZE(cmd, n + 1);
+    cmd[n] = 0;
+    return cmd;
+}
+
+static void printCmd(String_t *cmd) {
+    printf("%s", *cmd++);
+    for (; *cmd; cmd++)
+        printf(" %s", *cmd);
+    printf("\n");
+}
+
+// gcc -c -g -I <dir> -o <obj> <file>
+static String_t *assemble_one(String_t file, String_t obj_file) {
+    String_t *cmd = newCmd(8);
+
+    cmd[0] = "gcc";
+    cmd[1] = "-c";
+    cmd[2] = "-g";
+    cmd[3] = "-I";
+    cmd[4] = Control_headerDirectory;
+    cmd[5] = "-o";
+    cmd[6] = obj_file;
+    cmd[7] = file;
+    if (Control_Verb_order(VERBOSE_DETAIL, Control_verbose)) {
+        Io_printSpaces(6);
+        printCmd(cmd);
+    }
+    return cmd;
+}
+
+static void assemble_done(String_t *cmd, double seconds) {
     if (Control_Verb_order(VERBOSE_DETAIL, Control_verbose)) {
         Io_printSpaces(6);
-        printf("%s\n", cmd);
+        printf("%s  @time: %.3lf\n", cmd[7], seconds);
     }
-    system(cmd);
-    return obj_file;
 }
 
 static List_t assemble(List_t files) {
+    List_t cmds = List_new();
+    List_t keys = List_new();
     List_t obj_files = List_new();
     List_t first = List_getFirst(files);
+    long i = 0;
+
+    // gcc has made the objects already
+    if (C_codegen_piped())
+        return files;
     while (first) {
-        String_t obj_file = assemble_one(first->data);
+        String_t obj_file = String_concat(System_tempDir(), "/file-o-", Int_toString(i++), ".o", 0);
+        String_t key = Cache_keyOfFile(first->data);
+
         List_insertLast(obj_files, obj_file);
+        if (!Cache_fetch(key, obj_file)) {
+            List_insertLast(cmds, assemble_one(first->data, obj_file));
+            List_insertLast(keys, key);
+        }
         first = first->next;
     }
+    // the objects are independent, so they are assembled
+    // "-j" at a time
+    if (System_spawnAll(cmds,
+                        Control_jobs ? Control_jobs : System_numCores(),
+                        (System_tyReport) assemble_done)) {
+        System_removeTempDir();
+        Error_error("fail to assemble\n");
+    }
+    for (List_t p = List_getFirst(cmds), k = List_getFirst(keys); p; p = p->next, k = k->next)
+        Cache_store(k->data, ((String_t *) p->data)[6]);
     return obj_files;
 }
 
+// the runtime is compiled at each link if it has not been
+// built (see "-runtime")
+static int runtimeBuilt(void) {
+    FILE *f;
+
+    if (!Control_runtime || !(f = fopen(Control_runtime, "r")))
+        return 0;
+    fclose(f);
+    return 1;
+}
+
 static String_t link(List_t files) {
     List_t p;
+    String_t *cmd;
+    long i, failed;
 
     assert(files);
     String_t exe_file_name = Control_out_file_name ? Control_out_file_name : "a.out";
-    String_t lib_files = String_concat(Control_libDirectory,
-                                       "../src/runtime/main.c ../src/runtime/dragon-lib.c",
-                                       0);
-    String_t cmd = String_concat("gcc -g -o ", exe_file_name, 0);
-    if (Control_Verb_order(VERBOSE_DETAIL, Control_verbose)) {
-        Io_printSpaces(6);
-        printf("%s", cmd);
-    }
+    // gcc -g -o <exe> <obj>... {<runtime> | main.c dragon-lib.c}
+    cmd = newCmd(List_size(files) + 6);
+    cmd[0] = "gcc";
+    cmd[1] = "-g";
+    cmd[2] = "-o";
+    cmd[3] = exe_file_name;
+    i = 4;
     p = List_getFirst(files);
     while (p) {
-        String_t s = (String_t) p->data;
-        if (Control_Verb_order(VERBOSE_DETAIL, Control_verbose)) {
-            Io_printSpaces(13);
-            printf("%s", s);
-        }
-        cmd = String_concat(cmd, " ", s, 0);
+        cmd[i++] = p->data;
         p = p->next;
     }
-    if (Control_Verb_order(VERBOSE_DETAIL, Control_verbose)) {
-        Io_printSpaces(13);
-        printf("\"%s\"", lib_files);
+    if (runtimeBuilt())
+        cmd[i] = Control_runtime;
+    else {
+        cmd[i++] = String_concat(Control_libDirectory, "../src/runtime/main.c", 0);
+        cmd[i] = String_concat(Control_libDirectory, "../src/runtime/dragon-lib.c", 0);
     }
-    cmd = String_concat(cmd, " ", lib_files, 0);
-    printf("%s\n", cmd);
-    system(cmd);
+    printCmd(cmd);
+    failed = System_spawnAll(List_list(cmd, 0), 1, 0);
+    System_removeTempDir();
+    if (failed)
+        Error_error("fail to link\n");
     return exe_file_name;
 }
 
@@ -99,6 +167,7 @@ static int Main_main0(List_t files) {
 
     linkPass = Pass_new("link", VERBOSE_PASS, obj_files, (Poly_tyId) link);
     Pass_doit(&linkPass);
+    Cache_trim();
     return 0;
 }
 
@@ -129,6 +198,9 @@ int Main_main(int argc, char **argv) {
     //   dragon -expert true -verbose 2 a.c
     // will return ["a.c"].
     files = CommandLine_doarg(--argc, ++argv);
+    File_init(Control_bufferSize * 1024 * 1024, (int) Control_flushThread);
+    if (Control_profile)
+        Profile_init();
 
     // Change this to only one file???
     if (List_isEmpty(files))
@@ -138,11 +210,13 @@ int Main_main(int argc, char **argv) {
 
     mainp = Pass_new("dragon", VERBOSE_PASS, files, (Poly_tyId) Main_main0);
     Pass_doit(&mainp);
+    Profile_save();
 
     if (Control_Verb_order(VERBOSE_DETAIL,
                            Control_verbose)) {
         Mem_status();
         Hash_statusAll();
+        Cache_status();
     }
     return 0;
 }
@@ -8,7 +8,7 @@
 #include <assert.h>
 
 static Token_t current;
-/* tyTable: String_t -> 1 */
+/* tyTable: Id_t -> 1 */
 static Hash_t tyTable = 0;
 
 //static long lookupType(String_t name) {
@@ -30,8 +30,8 @@ static void error(String_t msg, Region_t r) {
 
 static Region_t region = 0;
 
-static void error_dupTypeName(String_t old, String_t cur) {
-    error(String_concat("type name redefined: ", cur, "the previous one   : ", old, 0), region);
+static void error_dupTypeName(Id_t old, Id_t cur) {
+    error(String_concat("type name redefined: ", Id_toString(cur), "the previous one   : ", Id_toString(old), 0), region);
 }
 
 static void advance(void) {
@@ -57,7 +57,7 @@ static Token_t eatToken(int kind) {
 
 static AstId_t convertToken(Token_t t) {
     assert(t->kind == TOKEN_ID);
-    return AstId_fromString(t->lexeme, t->region);
+    return AstId_fromId(t->id, t->region);
 }
 
 
@@ -67,6 +67,24 @@ static String_t convertOperator(char kind) {
             return "+";
         case '-':
             return "-";
+        case '*':
+            return "*";
+        case '/':
+            return "/";
+        case '%':
+            return "%";
+        case '<':
+            return "<";
+        case '>':
+            return ">";
+        case TOKEN_LE:
+            return "<=";
+        case TOKEN_GE:
+            return ">=";
+        case TOKEN_EQ:
+            return "==";
+        case TOKEN_NEQ:
+            return "!=";
         default:
             Error_impossible();
             return 0;
@@ -530,7 +548,7 @@ static List_t Parse_stmList(void) {
     List_t list = List_new();
     Ast_Stm_t s;
 
-    while (current->kind != '{') {
+    while (current->kind != '}') {
         s = Parse_stm();
         List_insertLast(list, s);
     }
@@ -584,7 +602,7 @@ static List_t Parse_decList(void) {
     E init = 0;
 
     while (current->kind == TOKEN_INT || current->kind == TOKEN_STRING || current->kind == TOKEN_ID) {
-        if (current->kind == TOKEN_ID && !Hash_lookup(tyTable, current->lexeme))
+        if (current->kind == TOKEN_ID && !Hash_lookup(tyTable, current->id))
             return list;
 
         type = Parse_type();
@@ -619,7 +637,7 @@ static List_t Parse_arguments(void) {
     Token_t name;
     AstId_t id;
 
-    if (current->kind == '(')
+    if (current->kind == ')')
         return list;
 
     type = Parse_type();
@@ -683,7 +701,7 @@ static List_t Parse_classList(void) {
     while (current->kind == TOKEN_CLASS) {
         advance();
         className = eatToken(TOKEN_ID);
-        Hash_insert(tyTable, className->lexeme, (Poly_t) 1);
+        Hash_insert(tyTable, className->id, (Poly_t) 1);
         id = convertToken(className);
         eatToken('{');
 
@@ -702,7 +720,7 @@ static Ast_Prog_t Parse_parseTraced(String_t file) {
     Id_init();
     // get the first token
     current = Lex_getToken();
-    tyTable = Hash_new((tyHashCode) String_hashCode, (Poly_tyEquals) String_equals, (tyDup) error_dupTypeName);
+    tyTable = Hash_new((tyHashCode) Id_hashCode, (Poly_tyEquals) Id_equals, (tyDup) error_dupTypeName);
 
     classes = Parse_classList();
     funcs = Parse_functionList();
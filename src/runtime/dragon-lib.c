@@ -1,4 +1,6 @@
+#include <setjmp.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include "dragon-lib.h"
 
 long prints(char *s) {
@@ -8,3 +10,84 @@ long prints(char *s) {
 long printi(long i) {
     return printf("%ld", i);
 }
+
+static void *alloc(long size) {
+    void *p = calloc(1, (size_t) size);
+
+    if (!p) {
+        fprintf(stderr, "Dragon: out of memory\n");
+        exit(1);
+    }
+    return p;
+}
+
+void *Dragon_Runtime_alloc_class(long index, long size) {
+    long *p = alloc((long) sizeof(long) + size);
+
+    p[0] = index;
+    return p + 1;
+}
+
+void *Dragon_Runtime_alloc_array(long isPtr, long length, long scale) {
+    long *p;
+
+    (void) isPtr;
+    if (length < 0) {
+        fprintf(stderr, "Dragon: negative array size\n");
+        exit(1);
+    }
+    p = alloc((long) sizeof(long) + length * scale);
+    p[0] = length;
+    return p + 1;
+}
+
+typedef struct Handler_t Handler_t;
+
+struct Handler_t {
+    Handler_t *prev;
+    void *frame;
+    jmp_buf buf;
+};
+
+static Handler_t *handlers = 0;
+// handlers are kept for reuse, as "try" is frequent
+static Handler_t *freeHandlers = 0;
+
+void *Dragon_Exn_push(void *frame) {
+    Handler_t *h = freeHandlers;
+
+    if (h)
+        freeHandlers = h->prev;
+    else
+        h = alloc((long) sizeof(*h));
+    h->frame = frame;
+    h->prev = handlers;
+    handlers = h;
+    return h->buf;
+}
+
+void Dragon_Exn_pop(void) {
+    Handler_t *h = handlers;
+
+    handlers = h->prev;
+    h->prev = freeHandlers;
+    freeHandlers = h;
+}
+
+void Dragon_Exn_leave(void *frame) {
+    while (handlers && handlers->frame == frame)
+        Dragon_Exn_pop();
+}
+
+void Dragon_Exn_throw(void) {
+    Handler_t *h = handlers;
+
+    if (!h) {
+        fflush(stdout);
+        fprintf(stderr, "Dragon: uncaught exception\n");
+        exit(1);
+    }
+    Dragon_Exn_pop();
+    // "h" is not reused before this
+    longjmp(h->buf, 1);
+}
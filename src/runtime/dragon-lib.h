@@ -4,4 +4,21 @@
 long prints(char *s);
 long printi(long i);
 
+// Objects and arrays are words, from the address given
+// back; the word before it is the layout index of an
+// object, or the length of an array. There is no
+// collector yet, so they are never freed.
+void *Dragon_Runtime_alloc_class(long index, long size);
+void *Dragon_Runtime_alloc_array(long isPtr, long length, long scale);
+
+// Exception handlers, innermost first. "push" gives the
+// "jmp_buf" for a new handler in "frame", to "setjmp";
+// "pop" removes the innermost one, "leave" all those of
+// "frame" (as it returns), and "throw" jumps to the
+// innermost one, which is removed.
+void *Dragon_Exn_push(void *frame);
+void Dragon_Exn_pop(void);
+void Dragon_Exn_leave(void *frame);
+void Dragon_Exn_throw(void);
+
 #endif
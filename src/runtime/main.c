@@ -1,7 +1,13 @@
+#include "dragon-lib.h"
 
-extern int dragon(void);
+extern long dragon(long argc, char **argv);
 
+// "argv" as a Dragon array of strings
 int main(int argc, char **argv) {
-    dragon();
+    char **args = Dragon_Runtime_alloc_array(1, argc, (long) sizeof(char *));
+
+    for (int i = 0; i < argc; i++)
+        args[i] = argv[i];
+    dragon(argc, args);
     return 0;
 }
@@ -1,11 +1,11 @@
 #include "const-and-dead.h"
 #include "../control/log.h"
 #include "../lib/trace.h"
-#include "const-prop.h"
 #include "dead-code.h"
+#include "sccp.h"
 
 static Ssa_Prog_t Ssa_constAndDeadTraced(Ssa_Prog_t p) {
-    p = Ssa_constProp(p);
+    p = Ssa_sccp(p);
     p = Ssa_deadCode(p);
     return p;
 }
@@ -1,9 +1,10 @@
 #ifndef SSA_CONST_AND_DEAD_H
 #define SSA_CONST_AND_DEAD_H
 
-// This pass consists of many passes, which does
-// any constant propagation and constant folding, as well
-// as any dead code (dec) elimination.
+// This pass consists of two passes: sparse conditional
+// constant propagation, which also folds constants and
+// cuts the blocks that never execute, followed by dead
+// code (dec) elimination.
 // This pass should run when any other optimization is
 // done.
 
@@ -116,7 +116,7 @@ static Ssa_Prog_t rewriteProg(Ssa_Prog_t p) {
 ////////////////////////////////////////////////
 // program
 static Ssa_Prog_t Ssa_constFoldTraced2(Ssa_Prog_t p) {
-    constProp = Property_new((Poly_tyPlist) Id_plist);
+    constProp = Property_new((Poly_tyIndex) Id_index);
 
     Log_str("analyzing starting:");
     analyze(p);
@@ -2,6 +2,7 @@
 #include "../control/log.h"
 #include "../lib/error.h"
 #include "../lib/stack.h"
+#include "../lib/thread.h"
 #include "../lib/trace.h"
 #include "../lib/tuple.h"
 #include "../lib/unused.h"
@@ -11,10 +12,11 @@
 static Ssa_Fun_t renameVar(Ssa_Fun_t f, Graph_t g, Tree_t tree);
 
 /////////////////////////////////////////////////////
-// properties:
+// properties (all per thread, as are the other
+// variables here):
 // Ssa_Block_t -> Set<Ssa_Block_t>
 // given a block, return its dominance frontier
-static Property_t dfProp = 0;
+static Thread_local Property_t dfProp = 0;
 //
 //static Set_t dfPropInitFun(Ssa_Block_t b) {
 //    UNUSED(b);
@@ -23,7 +25,7 @@ static Property_t dfProp = 0;
 
 // Ssa_Block_t -> Set<Id_t>
 // given a block, return set of vars defined in phi-stm
-static Property_t phiVarsProp = 0;
+static Thread_local Property_t phiVarsProp = 0;
 
 static Set_t phiVarsPropInitFun(Ssa_Block_t b) {
     UNUSED(b);
@@ -34,7 +36,7 @@ static Set_t phiVarsPropInitFun(Ssa_Block_t b) {
 // Id_t -> Set<Ssa_Block_t>
 // given a var, return a set of blocks that define it
 // By default, the set is empty.
-static Property_t defSitesProp = 0;
+static Thread_local Property_t defSitesProp = 0;
 
 static Set_t defSitesPropInitFun(Id_t id) {
     UNUSED(id);
@@ -45,7 +47,7 @@ static Set_t defSitesPropInitFun(Id_t id) {
 // Block_t -> Set<Id_t>
 // given a block, return its definition var, don't include
 // phi vars.
-static Property_t origVarsProp = 0;
+static Thread_local Property_t origVarsProp = 0;
 
 
 static void markDf(Ssa_Block_t b, Set_t set) {
@@ -226,11 +228,11 @@ static Ssa_Fun_t insertPhiAndRename(Ssa_Fun_t f) {
 
     // map every id to a set of its definition block
     // Id_t -> Set_t<Ssa_Block_t>
-    defSitesProp = Property_newInitFun((Poly_tyPlist) Id_plist, (Poly_tyPropInit) defSitesPropInitFun);
+    Property_clear(defSitesProp);
 
     // a set of vars that originially defined in a block
     // excluding phis
-    origVarsProp = Property_new((Poly_tyPlist) Ssa_Block_plist);
+    Property_clear(origVarsProp);
 
     // two jobs:
     //   1. mark each var for its definition blocks, and
@@ -248,9 +250,9 @@ static Ssa_Fun_t insertPhiAndRename(Ssa_Fun_t f) {
 
     // insert phi
     // this is the phi-vars on every block
-    phiVarsProp = Property_newInitFun((Poly_tyPlist) Ssa_Block_plist, (Poly_tyPropInit) phiVarsPropInitFun);
+    Property_clear(phiVarsProp);
 
-    dfProp = Property_new((Poly_tyPlist) Ssa_Block_plist);
+    Property_clear(dfProp);
 
     g = Ssa_Fun_toGraph(f);
     Graph_df(g, (Poly_t) Ssa_Fun_searchLabel(f, f->entry), (void (*)(Poly_t, Set_t)) markDf);
@@ -277,7 +279,7 @@ static Ssa_Fun_t insertPhiAndRename(Ssa_Fun_t f) {
 
     // check point
     Log_dot((Poly_tyDot) Ssa_Fun_toDot, tempf, "insertphi");
-    File_saveToFile("insertPhi", (Poly_tyPrint) Ssa_Fun_print, tempf);
+    Log_fun(tempf, (Poly_tyPrint) Ssa_Fun_print);
     //Graph_toJpgWithName (g, Ssa_Block_printForDot, "graph");
     //Tree_toJpgWithName (tree, Ssa_Block_printForDot, "tree");
     //
@@ -294,10 +296,6 @@ static Ssa_Fun_t insertPhiAndRename(Ssa_Fun_t f) {
     Property_clear(origVarsProp);
     Property_clear(phiVarsProp);
     Property_clear(dfProp);
-    defSitesProp = 0;
-    origVarsProp = 0;
-    phiVarsProp = 0;
-    dfProp = 0;
 
     return tempf;
 }
@@ -306,7 +304,7 @@ static Ssa_Fun_t insertPhiAndRename(Ssa_Fun_t f) {
 // the following two properties are renaming-related.
 // per-id stack.
 // Id_t -> Stack_t<Id>
-static Property_t stackProp = 0;
+static Thread_local Property_t stackProp = 0;
 
 static Stack_t stackPropInitFun(Id_t id) {
     Stack_t stack = Stack_new();
@@ -318,11 +316,11 @@ static Stack_t stackPropInitFun(Id_t id) {
 // store every block's new block, this is nearly the
 // final result, except for that the arguments in phis
 // should be further elaborated.
-static Property_t substProp = 0;
+static Thread_local Property_t substProp = 0;
 
 // Block_t -> List<Triple<Id_t, Block_t, Id_t>>
 // remember every old phi argument to the new one.
-static Property_t substPhiProp = 0;
+static Thread_local Property_t substPhiProp = 0;
 
 static List_t substPhiPropInitFun(Ssa_Block_t b) {
     UNUSED(b);
@@ -332,7 +330,7 @@ static List_t substPhiPropInitFun(Ssa_Block_t b) {
 
 // Id_t -> List<Id_t>
 // For every id, remember all its new names (versions).
-static Property_t freshNameProp = 0;
+static Thread_local Property_t freshNameProp = 0;
 
 static List_t freshNamePropInitFun(Id_t id) {
     UNUSED(id);
@@ -364,8 +362,8 @@ static void callBackSubstPhiProp(Ssa_Block_t current, Ssa_Block_t pred, Id_t old
     List_insertFirst(l, t);
 }
 
-static Graph_t theg = 0;
-static Tree_t thetree = 0;
+static Thread_local Graph_t theg = 0;
+static Thread_local Tree_t thetree = 0;
 
 static Id_t def(Id_t id) {
     Id_t fresh = Id_newNoName();
@@ -464,7 +462,7 @@ static Ssa_Block_t rewriteBlock(Ssa_Block_t b) {
 }
 
 // whether or not we should copy the old ones
-static int shouldcopy = 0;
+static Thread_local int shouldcopy = 0;
 
 static List_t genNewVarsEach(List_t result, Dec_t dec) {
     Id_t old = dec->id;
@@ -504,11 +502,11 @@ static Ssa_Fun_t renameVarTraced(Ssa_Fun_t f, Graph_t g, Tree_t tree) {
     Ssa_Fun_t newf;
     List_t newDecs;
 
-    stackProp = Property_newInitFun((Poly_tyPlist) Id_plist, (Poly_tyPropInit) stackPropInitFun);
-    substProp = Property_new((Poly_tyPlist) Ssa_Block_plist);
-    substPhiProp = Property_newInitFun((Poly_tyPlist) Ssa_Block_plist, (Poly_tyPropInit) substPhiPropInitFun);
+    Property_clear(stackProp);
+    Property_clear(substProp);
+    Property_clear(substPhiProp);
 
-    freshNameProp = Property_newInitFun((Poly_tyPlist) Id_plist, (Poly_tyPropInit) freshNamePropInitFun);
+    Property_clear(freshNameProp);
 
     Log_str("renameVar starting:");
     theg = g;
@@ -559,13 +557,32 @@ static Ssa_Fun_t renameVar(Ssa_Fun_t f, Graph_t g, Tree_t tree) {
 
 //////////////////////////////////////////////////////
 // functions
+
+// The properties are indexed by the program's ids and
+// labels, so each thread makes them once, and clears them
+// for each function.
+static void init(void) {
+    dfProp = Property_new((Poly_tyIndex) Ssa_Block_index);
+    phiVarsProp = Property_newInitFun((Poly_tyIndex) Ssa_Block_index, (Poly_tyPropInit) phiVarsPropInitFun);
+    defSitesProp = Property_newInitFun((Poly_tyIndex) Id_index, (Poly_tyPropInit) defSitesPropInitFun);
+    origVarsProp = Property_new((Poly_tyIndex) Ssa_Block_index);
+    stackProp = Property_newInitFun((Poly_tyIndex) Id_index, (Poly_tyPropInit) stackPropInitFun);
+    substProp = Property_new((Poly_tyIndex) Ssa_Block_index);
+    substPhiProp = Property_newInitFun((Poly_tyIndex) Ssa_Block_index, (Poly_tyPropInit) substPhiPropInitFun);
+    freshNameProp = Property_newInitFun((Poly_tyIndex) Id_index, (Poly_tyPropInit) freshNamePropInitFun);
+}
+
 static Ssa_Fun_t transFunEach(Ssa_Fun_t f) {
     //    Ssa_Block_t eb;// entry block
+    Id_t oldScope;
 
     assert(f);
     //Log_dot (Ssa_Fun_toDot, f, "raw");
     Log_strs("now ready to translate function: ", Id_toString(f->name), "\n", 0);
+    // name the fresh versions after the function
+    oldScope = Id_enterScope(f->name);
     f = insertPhiAndRename(f);
+    Id_enterScope(oldScope);
     Log_strs("translating function finished: ", Id_toString(f->name), "\n", 0);
     return f;
 }
@@ -577,7 +594,7 @@ static Ssa_Prog_t Ssa_constructSsaTraced(Ssa_Prog_t p) {
     List_t newFuncs;
 
     assert(p);
-    newFuncs = List_map(p->funcs, (Poly_tyId) transFunEach);
+    newFuncs = Thread_map(p->funcs, (Poly_tyId) transFunEach, init);
     return Ssa_Prog_new(p->classes, newFuncs);
 }
 
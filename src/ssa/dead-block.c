@@ -1,9 +1,15 @@
 #include "dead-block.h"
 #include "../lib/error.h"
+#include "../lib/thread.h"
 #include "../lib/trace.h"
 #include <assert.h>
 
-static Property_t visited = 0;
+// per thread
+static Thread_local Property_t visited = 0;
+
+static void init(void) {
+    visited = Property_new((Poly_tyIndex) Ssa_Block_index);
+}
 
 static void visitBlock(Ssa_Block_t b) {
     assert(b);
@@ -50,6 +56,7 @@ static Ssa_Fun_t transFunEach(Ssa_Fun_t f) {
     // now the properties should be properly set
     assert(f != 0);
     newBlocks = transBlocks(f->blocks);
+    Property_clear(visited);
 
     return Ssa_Fun_new(f->type, f->name, f->args, f->decs, newBlocks, f->retId, f->entry, f->exitt);
 }
@@ -62,14 +69,7 @@ static Ssa_Prog_t Ssa_deadBlockTraced(Ssa_Prog_t p) {
 
     assert(p);
 
-    // init the property
-    visited = Property_new((Poly_tyPlist) Ssa_Block_plist);
-
-    newFuncs = List_map(p->funcs, (Poly_tyId) transFunEach);
-
-    // clear property
-    Property_clear(visited);
-
+    newFuncs = Thread_map(p->funcs, (Poly_tyId) transFunEach, init);
     return Ssa_Prog_new(p->classes, newFuncs);
 }
 
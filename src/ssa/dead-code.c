@@ -2,416 +2,376 @@
 #include "../control/log.h"
 #include "../lib/error.h"
 #include "../lib/list.h"
+#include "../lib/mem.h"
+#include "../lib/property.h"
+#include "../lib/thread.h"
 #include "../lib/trace.h"
+#include "def-use.h"
 #include <assert.h>
 
 ///////////////////////////////////////////////////////
 // This module eliminates dead code and dead (local)
-// declarations.
-
-
-// whether we should do dead code elimination.
-static int flag = 0;
-// whether to find more dead code in one pass.
-static int founddead = 0;
-
-static void mark() {
-    Log_str("mark() is called\n");
-    flag = 1;
-    founddead = 1;
+// declarations, by marking from the roots: the statements
+// with effects (stores and "try"s) and the transfers are
+// live, and so is the definition of each variable which a
+// live site uses. All the others are dead, so a cycle of
+// phis feeding only one another goes, as does a call to a
+// function without effects whose result is not used.
+//
+// Marking walks the def-use chains of one function, so each
+// function is processed on its own, and its state is per
+// thread. The functions without effects are found first,
+// for the whole program.
+
+// Id_t -> long: nonzero for the functions without effects;
+// only read while the functions are processed
+static Property_t pureProp = 0;
+
+// Id_t -> long: nonzero for the live variables
+static Thread_local Property_t liveProp = 0;
+// Label_t -> Ssa_Block_t
+static Thread_local Property_t blockProp = 0;
+static Thread_local Ssa_DefUse_t chains = 0;
+// List<Id_t>: the live variables whose definitions are not
+// marked yet
+static Thread_local List_t work = 0;
+
+static void init(void) {
+    liveProp = Property_new((Poly_tyIndex) Id_index);
+    blockProp = Property_new((Poly_tyIndex) Label_index);
 }
 
-//static void clear() {
-//    founddead = 0;
-//}
-
-
-enum Dead_t {
-    UNKNOWN = 0,
-    DEAD = 1,
-    NOTDEAD = 2
-};
-
-
-// Id_t -> int
-// how many times an id is used, return 0 by default
-static Property_t usedProp = 0;
-
-// Id_t -> Dead_t
-// whether or not an id is dead, return UNKNOWN by default
-static Property_t deadProp = 0;
-
-
 //////////////////////////////////////////////////////
-// analyzing used vars
-
-static void incUse(Id_t id) {
-    long r;
-
-    // when this property has not been set on that var, the
-    // "get" will return 0 (rather than the number 0).
-    // We abuse it.
-    r = (long) (Property_get(usedProp, id));
-    r++;
-    Property_set(usedProp, id, (Poly_t) r);
-    Log_strs("\n", Id_toString(id), " ===> ", Int_toString(r), " times", 0);
-    //    return;
-}
+// functions without effects
 
-static void analyzeBlockUsed(Ssa_Block_t b) {
-    Ssa_Block_foreachUse(b, incUse);
-}
+// Label_t -> long: the position of a block in its function,
+// from 1
+static Property_t posProp = 0;
 
-static void analyzeFunUsed(Ssa_Fun_t f) {
-    List_foreach(f->blocks, (Poly_tyVoid) analyzeBlockUsed);
+static int isForward(Ssa_Block_t b, Label_t l) {
+    return (long) Property_get(posProp, l) > (long) Property_get(posProp, b->label);
 }
 
-static void analyzeUsed(Ssa_Prog_t p) {
-    List_foreach(p->funcs, (Poly_tyVoid) analyzeFunUsed);
+// A function has no effects if it stores nothing, neither
+// throws nor handles exceptions, calls only functions
+// without effects, and always returns: for this, its blocks
+// only jump forward, and no call leads back to it. This
+// checks the function itself, and leaves the names it calls
+// in "callees".
+static int hasNoEffect(Ssa_Fun_t f, List_t callees) {
+    long pos = 0;
+
+    Property_clear(posProp);
+    for (List_t p = List_getFirst(f->blocks); p; p = p->next)
+        Property_set(posProp, ((Ssa_Block_t) p->data)->label, (Poly_t) ++pos);
+    for (List_t p = List_getFirst(f->blocks); p; p = p->next) {
+        Ssa_Block_t b = p->data;
+        Ssa_Transfer_t t = b->transfer;
+
+        for (List_t q = List_getFirst(b->stms); q; q = q->next) {
+            Ssa_Stm_t s = q->data;
+
+            if (s->kind == SSA_STM_STORE || s->kind == SSA_STM_TRY || s->kind == SSA_STM_TRY_END)
+                return 0;
+        }
+        switch (t->kind) {
+            case SSA_TRANS_IF:
+                if (!isForward(b, t->u.iff.truee) || !isForward(b, t->u.iff.falsee))
+                    return 0;
+                break;
+            case SSA_TRANS_JUMP:
+                if (!isForward(b, t->u.jump))
+                    return 0;
+                break;
+            case SSA_TRANS_CALL:
+                if (!isForward(b, t->u.call.normal))
+                    return 0;
+                List_insertLast(callees, t->u.call.name);
+                break;
+            case SSA_TRANS_RETURN:
+                break;
+            case SSA_TRANS_THROW:
+                return 0;
+            default:
+                Error_impossible();
+                return 0;
+        }
+    }
+    return 1;
 }
 
-//////////////////////////////////////////////////
-// analyzing dead code
-
-static long isDead(Id_t id) {
-    return (long) (Property_get(deadProp, id)) == DEAD;
-}
+// Id_t -> Ssa_Fun_t
+static Property_t funProp = 0;
+// Id_t -> long: where a function is in the search below
+static Property_t stateProp = 0;
+
+enum {
+    UNSEEN = 0,
+    // on the stack
+    ACTIVE,
+    IMPURE,
+    PURE
+};
 
-static void markDead(Id_t id) {
-    Property_set(deadProp, id, (Poly_t) DEAD);
+typedef struct {
+    Ssa_Fun_t f;
+    // the callees not yet known to be without effects
+    List_t next;
+} *Frame_t;
+
+static void finish(Ssa_Fun_t f, long state) {
+    Property_set(stateProp, f->name, (Poly_t) state);
+    if (state == PURE) {
+        Log_strs("found a function without effects: ", Id_toString(f->name), "\n", 0);
+        Property_set(pureProp, f->name, (Poly_t) 1);
+    }
 }
 
+static void push(List_t stack, Ssa_Fun_t f) {
+    List_t callees = List_new();
+    Frame_t frame;
 
-static int notUsed(Id_t id) {
-    return 0 == Property_get(usedProp, id);
-}
-
-static void decUse(Id_t id) {
-    long r = (long) (Property_get(usedProp, id));
-    if (!r) {
-        Error_impossible();
+    Property_set(stateProp, f->name, (Poly_t) ACTIVE);
+    if (!hasNoEffect(f, callees)) {
+        finish(f, IMPURE);
         return;
     }
-    --r;
-    Property_set(usedProp, id, (Poly_t) r);
-    // to catch bugs
-    if (!r) {
-        if (Property_get(deadProp, id)) {
-            Error_impossible();
-            return;
-        }
-        // found a new dead var
-        mark();
-        Property_set(deadProp, id, (Poly_t) DEAD);
-    }
-    //    return;
+    Mem_NEW(frame);
+    frame->f = f;
+    frame->next = List_getFirst(callees);
+    List_insertFirst(stack, frame);
 }
 
-static void analyzeStm(Ssa_Stm_t s) {
-    assert(s);
-    switch (s->kind) {
-        case SSA_STM_MOVE: {
-            if (isDead(s->u.move.dest))
-                return;
-
-            if (notUsed(s->u.move.dest)) {
-                Log_strs("found a dead var: ", Id_toString(s->u.move.dest), 0);
-
-                mark();
-                markDead(s->u.move.dest);
-
-                // all right-hand side decrement
-                Ssa_Stm_foreachUse(s, decUse);
+// One depth-first search of the call graph, so each
+// function is checked once, after its callees. A callee
+// still on the stack closes a cycle of calls, which may not
+// return, so its caller has effects. The search keeps its
+// own stack, as a chain of calls may be deep.
+static void findPure(List_t funcs) {
+    List_t stack = List_new();
+
+    pureProp = Property_new((Poly_tyIndex) Id_index);
+    posProp = Property_new((Poly_tyIndex) Label_index);
+    funProp = Property_new((Poly_tyIndex) Id_index);
+    stateProp = Property_new((Poly_tyIndex) Id_index);
+    for (List_t p = List_getFirst(funcs); p; p = p->next)
+        Property_set(funProp, ((Ssa_Fun_t) p->data)->name, p->data);
+    for (List_t p = List_getFirst(funcs); p; p = p->next) {
+        if (!Property_get(stateProp, ((Ssa_Fun_t) p->data)->name))
+            push(stack, p->data);
+        while (!List_isEmpty(stack)) {
+            Frame_t top = List_getFirst(stack)->data;
+            Ssa_Fun_t callee;
+            long state;
+
+            if (!top->next) {
+                List_removeHead(stack);
+                finish(top->f, PURE);
+                continue;
             }
-            return;
-        }
-        case SSA_STM_BOP: {
-            if (isDead(s->u.bop.dest))
-                return;
-
-            if (notUsed(s->u.move.dest)) {
-                Log_strs("found a dead var: ", Id_toString(s->u.move.dest), 0);
-
-                mark();
-                markDead(s->u.move.dest);
-
-                Ssa_Stm_foreachUse(s, decUse);
+            // not in this program (e.g., in the runtime)
+            callee = Property_get(funProp, top->next->data);
+            state = (callee) ? (long) Property_get(stateProp, callee->name) : IMPURE;
+            switch (state) {
+                case UNSEEN:
+                    // come back to it once it is done
+                    push(stack, callee);
+                    break;
+                case PURE:
+                    top->next = top->next->next;
+                    break;
+                case ACTIVE:
+                case IMPURE:
+                    List_removeHead(stack);
+                    finish(top->f, IMPURE);
+                    break;
+                default:
+                    Error_impossible();
             }
-            return;
         }
-        case SSA_STM_UOP: {
-            if (isDead(s->u.uop.dest))
-                return;
-
-            if (notUsed(s->u.move.dest)) {
-                Log_strs("found a dead var: ", Id_toString(s->u.move.dest), 0);
-
-                mark();
-                markDead(s->u.move.dest);
-
-                Ssa_Stm_foreachUse(s, decUse);
-            }
-            return;
-        }
-        case SSA_STM_STORE:
-            return;
-        case SSA_STM_LOAD: {
-            if (isDead(s->u.load.dest))
-                return;
-
-            if (notUsed(s->u.move.dest)) {
-                Log_strs("found a dead var: ", Id_toString(s->u.move.dest), 0);
-
-                mark();
-                markDead(s->u.load.dest);
-                Ssa_Stm_foreachUse(s, decUse);
-            }
-            return;
-        }
-        case SSA_STM_NEW_CLASS: {
-            if (isDead(s->u.newClass.dest))
-                return;
-
-            if (notUsed(s->u.newClass.dest)) {
-                Log_strs("found a dead var: ", Id_toString(s->u.move.dest), 0);
-
-                mark();
-                markDead(s->u.newClass.dest);
-            }
-            return;
-        }
-        case SSA_STM_NEW_ARRAY: {
-            if (isDead(s->u.newArray.dest))
-                return;
+    }
+}
 
-            if (notUsed(s->u.newArray.dest)) {
-                Log_strs("found a dead var: ", Id_toString(s->u.move.dest), 0);
+//////////////////////////////////////////////////////
+// marking
+static void markLive(Id_t id) {
+    if (Property_get(liveProp, id))
+        return;
+    Property_set(liveProp, id, (Poly_t) 1);
+    List_insertLast(work, id);
+}
 
-                mark();
-                markDead(s->u.newArray.dest);
-            }
-            return;
-        }
-        case SSA_STM_PHI: {
-            if (isDead(s->u.phi.dest))
-                return;
+static int isRoot(Ssa_Stm_t s) {
+    return s->kind == SSA_STM_STORE || s->kind == SSA_STM_TRY || s->kind == SSA_STM_TRY_END;
+}
 
-            if (notUsed(s->u.phi.dest)) {
-                Log_strs("found a dead var: ", Id_toString(s->u.move.dest), 0);
+// a call to a function without effects is live only when
+// its result is
+static int isPureCall(Ssa_Transfer_t t) {
+    return t->kind == SSA_TRANS_CALL && Property_get(pureProp, t->u.call.name);
+}
 
-                mark();
-                markDead(s->u.phi.dest);
-                Ssa_Stm_foreachUse(s, decUse);
-            }
-            return;
-        }
-            // no interesting information
-        case SSA_STM_TRY:
-        case SSA_STM_TRY_END:
-            return;
-        default:
-            fprintf(stderr, "%d", s->kind);
-            Error_impossible();
-            return;
-    }
-    Error_impossible();
+static int isDeadCall(Ssa_Transfer_t t) {
+    return isPureCall(t) && (!t->u.call.dest || !Property_get(liveProp, t->u.call.dest));
 }
 
-static void analyzeTransfer(Ssa_Transfer_t t) {
-    assert(t);
-    switch (t->kind) {
-        case SSA_TRANS_IF:
-            //            return;
-        case SSA_TRANS_JUMP:
-            //            return;
-        case SSA_TRANS_RETURN:
-            //            return;
-        case SSA_TRANS_THROW:
-            return;
-        case SSA_TRANS_CALL: {
-            if (t->u.call.dest) {
-                if (isDead(t->u.call.dest))
-                    return;
-
-                if (notUsed(t->u.call.dest)) {
-                    Log_strs("found a dead var: ", Id_toString(t->u.call.dest), 0);
-
-                    mark();
-                    markDead(t->u.call.dest);
-                    return;
-                }
-            }
-            return;
-        }
-        default:
-            Error_impossible();
-            return;
+static void markFun(Ssa_Fun_t f) {
+    work = List_new();
+    for (List_t p = List_getFirst(f->blocks); p; p = p->next) {
+        Ssa_Block_t b = p->data;
+
+        Property_set(blockProp, b->label, b);
+        for (List_t q = List_getFirst(b->stms); q; q = q->next)
+            if (isRoot(q->data))
+                Ssa_Stm_foreachUse(q->data, markLive);
+        if (!isPureCall(b->transfer))
+            Ssa_Transfer_foreachUse(b->transfer, markLive);
+    }
+    while (!List_isEmpty(work)) {
+        Ssa_Site_t def = Ssa_DefUse_def(chains, List_removeHead(work));
+
+        // an argument
+        if (!def)
+            continue;
+        if (def->stm)
+            Ssa_Stm_foreachUse(def->stm, markLive);
+        else
+            Ssa_Transfer_foreachUse(((Ssa_Block_t) Property_get(blockProp, def->block))->transfer, markLive);
     }
-    Error_impossible();
+    work = 0;
 }
 
-static void analyzeBlock(Ssa_Block_t b) {
-    List_foreach(b->stms, (Poly_tyVoid) analyzeStm);
-    analyzeTransfer(b->transfer);
+////////////////////////////////////////////////////////
+// rewriting
+static Thread_local int defIsLive = 0;
+
+static void checkDef(Id_t id) {
+    if (Property_get(liveProp, id))
+        defIsLive = 1;
 }
 
-static void analyzeFun(Ssa_Fun_t f) {
-    List_foreach(f->blocks, (Poly_tyVoid) analyzeBlock);
+static int isLive(Ssa_Stm_t s) {
+    if (isRoot(s))
+        return 1;
+    defIsLive = 0;
+    Ssa_Stm_foreachDef(s, checkDef);
+    return defIsLive;
 }
 
-static void analyze(Ssa_Prog_t p) {
+// whether the call ending "pred" goes, and so its edge to
+// the handler "b"
+static int isCutEdge(Ssa_Block_t pred, Ssa_Block_t b) {
+    Ssa_Transfer_t t;
 
-    List_foreach(p->funcs, (Poly_tyVoid) analyzeFun);
+    pred = Property_get(blockProp, pred->label);
+    if (!pred)
+        return 0;
+    t = pred->transfer;
+    return isDeadCall(t) && t->u.call.leave && Label_equals(t->u.call.leave, b->label)
+           && !Label_equals(t->u.call.normal, b->label);
 }
 
-////////////////////////////////////////////////////////
-// rewriting
+static Ssa_Stm_t rewritePhi(Ssa_Stm_t s, Ssa_Block_t b) {
+    List_t args = List_new();
+    Ssa_Stm_t new;
 
-// zero for dead.
-static Ssa_Stm_t doit(Ssa_Stm_t s) {
-    assert(s);
-    switch (s->kind) {
-        case SSA_STM_MOVE:
-            if (isDead(s->u.move.dest))
-                return 0;
-            return s;
-        case SSA_STM_BOP:
-            if (isDead(s->u.bop.dest))
-                return 0;
-            return s;
-        case SSA_STM_UOP:
-            if (isDead(s->u.uop.dest))
-                return 0;
-            return s;
-        case SSA_STM_STORE:
-            return s;
-        case SSA_STM_LOAD:
-            if (isDead(s->u.load.dest))
-                return 0;
-            return s;
-        case SSA_STM_NEW_CLASS:
-            if (isDead(s->u.newClass.dest))
-                return 0;
-            return s;
-        case SSA_STM_NEW_ARRAY:
-            if (isDead(s->u.newArray.dest))
-                return 0;
-            return s;
-        case SSA_STM_PHI:
-            if (isDead(s->u.phi.dest))
-                return 0;
-            return s;
-        case SSA_STM_TRY:
-            //            return s;
-        case SSA_STM_TRY_END:
-            return s;
-        default:
-            fprintf(stderr, "%d", s->kind);
-            Error_impossible();
-            return 0;
+    for (List_t p = List_getFirst(s->u.phi.args); p; p = p->next) {
+        Ssa_Stm_PhiArg_t arg = p->data;
+
+        if (!isCutEdge(arg->pred, b))
+            List_insertLast(args, arg);
     }
-    Error_impossible();
+    if (List_size(args) == List_size(s->u.phi.args))
+        return s;
+    new = Ssa_Stm_new_phi(s->u.phi.dest, args);
+    Ssa_DefUse_deleteStm(chains, b->label, s);
+    Ssa_DefUse_addStm(chains, b->label, new);
+    return new;
 }
 
-static Ssa_Transfer_t rewriteTransfer(Ssa_Transfer_t t) {
-    assert(t);
-    switch (t->kind) {
-        case SSA_TRANS_IF:
-            //            return t;
-        case SSA_TRANS_JUMP:
-            //            return t;
-        case SSA_TRANS_RETURN:
-            //            return t;
-        case SSA_TRANS_THROW:
-            return t;
-        case SSA_TRANS_CALL: {
-            if (t->u.call.dest) {
-                if (isDead(t->u.call.dest)) {
-                    printf("found dead: %s\n", Id_toString(t->u.call.dest));
-                    return Ssa_Transfer_new_call(0, t->u.call.name, t->u.call.args, t->u.call.leave, t->u.call.normal);
-                }
-            }
-            return t;
-        }
-        default:
-            Error_impossible();
-            return 0;
-    }
-    Error_impossible();
+static Ssa_Transfer_t rewriteTransfer(Ssa_Block_t b) {
+    Ssa_Transfer_t t = b->transfer, new;
+
+    if (t->kind != SSA_TRANS_CALL)
+        return t;
+    if (isDeadCall(t)) {
+        Log_strs("found a dead call: ", Id_toString(t->u.call.name), "\n", 0);
+        new = Ssa_Transfer_new_jump(t->u.call.normal);
+    } else if (t->u.call.dest && !Property_get(liveProp, t->u.call.dest)) {
+        Log_strs("found dead: ", Id_toString(t->u.call.dest), "\n", 0);
+        new = Ssa_Transfer_new_call(0, t->u.call.name, t->u.call.args, t->u.call.leave, t->u.call.normal);
+    } else
+        return t;
+    Ssa_DefUse_deleteTransfer(chains, b->label, t);
+    Ssa_DefUse_addTransfer(chains, b->label, new);
+    return new;
 }
 
 static Ssa_Block_t rewriteBlock(Ssa_Block_t b) {
     List_t newStms = List_new();
-    List_t tmp = List_getFirst(b->stms);
-    Ssa_Transfer_t newTrans;
-
-    while (tmp) {
-        Ssa_Stm_t s = doit(tmp->data);
-        if (s)
-            List_insertLast(newStms, s);
-        tmp = tmp->next;
+
+    for (List_t p = List_getFirst(b->stms); p; p = p->next) {
+        Ssa_Stm_t s = p->data;
+
+        if (!isLive(s)) {
+            Log_str("found a dead statement: ");
+            Log_fun(s, (Poly_tyLog) Ssa_Stm_print);
+            Ssa_DefUse_deleteStm(chains, b->label, s);
+            continue;
+        }
+        if (s->kind == SSA_STM_PHI)
+            s = rewritePhi(s, b);
+        List_insertLast(newStms, s);
     }
-    newTrans = rewriteTransfer(b->transfer);
-    return Ssa_Block_new(b->label, newStms, newTrans);
+    return Ssa_Block_new(b->label, newStms, rewriteTransfer(b));
 }
 
 static int decFilter(Dec_t dec) {
-    if (NOTDEAD == (long) (Property_get(deadProp, dec->id))) {
-        Log_strs(Dec_toString(dec), " is NOT dead\n", 0);
+    if (Property_get(liveProp, dec->id))
         return 1;
-    }
-    if ((long) (Property_get(deadProp, dec->id)) == DEAD || (0 == Property_get(usedProp, dec->id))) {
-        Log_strs("found a dead declaration: ", Dec_toString(dec), "\n", 0);
-        return 0;
-    } else {
-        Log_str("what's going on?\n");
-    }
-    return 1;
+    Log_strs("found a dead declaration: ", Dec_toString(dec), "\n", 0);
+    return 0;
 }
 
 static Ssa_Fun_t rewriteFun(Ssa_Fun_t f) {
     List_t newBlocks, newDecs;
+    Ssa_Fun_t newf;
 
     newBlocks = List_map(f->blocks, (Poly_tyId) rewriteBlock);
     newDecs = List_filter(f->decs, (Poly_tyPred) decFilter);
-    return Ssa_Fun_new(f->type, f->name, f->args, newDecs, newBlocks, f->retId, f->entry, f->exitt);
+    newf = Ssa_Fun_new(f->type, f->name, f->args, newDecs, newBlocks, f->retId, f->entry, f->exitt);
+    // kept up to date above
+    newf->chains = chains;
+    return newf;
 }
 
-static Ssa_Prog_t rewriteProg(Ssa_Prog_t p) {
-    List_t newfuncs;
+////////////////////////////////////////////////
+// functions
+static Ssa_Fun_t transFunEach(Ssa_Fun_t f) {
+    chains = Ssa_DefUse_ofFun(f);
+
+    Log_str("marking starting:");
+    markFun(f);
+    Log_str("marking finished:");
 
-    newfuncs = List_map(p->funcs, (Poly_tyId) rewriteFun);
-    return Ssa_Prog_new(p->classes, newfuncs);
+    Log_str("rewriting starting:");
+    f = rewriteFun(f);
+    Log_str("rewriting finished:");
+
+    Property_clear(liveProp);
+    Property_clear(blockProp);
+    chains = 0;
+    return f;
 }
 
 ////////////////////////////////////////////////
 // program
 static Ssa_Prog_t Ssa_deadCodeTraced(Ssa_Prog_t p) {
-    usedProp = Property_new((Poly_tyPlist) Id_plist);
-    deadProp = Property_new((Poly_tyPlist) Id_plist);
-
-
-    Log_str("analyzing used var starting:");
-    analyzeUsed(p);
-    Log_str("analyzing used var finished:");
-
-
-    Log_str("analyzing dead code starting:");
-
-    do {
-        founddead = 0;
-        analyze(p);
-    } while (founddead);
-    Log_str("analyzing dead code finished:");
-
-
-    Log_str("rewriting starting:");
-    p = rewriteProg(p);
-    Log_str("rewriting finished:");
+    List_t newFuncs;
 
-    Property_clear(usedProp);
-    Property_clear(deadProp);
-    return p;
+    findPure(p->funcs);
+    newFuncs = Thread_map(p->funcs, (Poly_tyId) transFunEach, init);
+    return Ssa_Prog_new(p->classes, newFuncs);
 }
 
 static void printArg(Ssa_Prog_t p) {
@@ -0,0 +1,152 @@
+#include "def-use.h"
+#include "../lib/hash.h"
+#include "../lib/mem.h"
+#include "../lib/thread.h"
+#include <assert.h>
+
+#define T Ssa_DefUse_t
+
+struct T {
+    // Id_t -> Var_t
+    Hash_t vars;
+};
+
+typedef struct {
+    Ssa_Site_t def;
+    // List<Ssa_Site_t>
+    List_t uses;
+} *Var_t;
+
+static Var_t Var_new(Id_t id) {
+    Var_t v;
+
+    (void) id;
+    Mem_NEW(v);
+    v->def = 0;
+    v->uses = List_new();
+    return v;
+}
+
+static Var_t lookup(T c, Id_t id) {
+    return Hash_lookupOrInsert(c->vars, id, (tyKV) Var_new);
+}
+
+static Ssa_Site_t Site_new(Label_t block, Ssa_Stm_t stm) {
+    Ssa_Site_t s;
+
+    Mem_NEW(s);
+    s->block = block;
+    s->stm = stm;
+    return s;
+}
+
+static long Site_equals(Ssa_Site_t s1, Ssa_Site_t s2) {
+    return Label_equals(s1->block, s2->block) && s1->stm == s2->stm;
+}
+
+//////////////////////////////////////////////////////
+// the site being added or deleted, as the "foreach"
+// functions take no closure
+static Thread_local T curChains = 0;
+static Thread_local Ssa_Site_t curSite = 0;
+
+static void addDef(Id_t id) {
+    lookup(curChains, id)->def = curSite;
+}
+
+static void addUse(Id_t id) {
+    List_insertLast(lookup(curChains, id)->uses, curSite);
+}
+
+static void deleteDef(Id_t id) {
+    Var_t v = lookup(curChains, id);
+
+    if (v->def && Site_equals(v->def, curSite))
+        v->def = 0;
+}
+
+// a statement using "id" twice comes here twice, and the
+// first time deletes both
+static void deleteUse(Id_t id) {
+    List_delete(lookup(curChains, id)->uses, curSite, (Poly_tyEquals) Site_equals);
+}
+
+void Ssa_DefUse_addStm(T c, Label_t block, Ssa_Stm_t s) {
+    assert(c);
+    assert(s);
+    curChains = c;
+    curSite = Site_new(block, s);
+    Ssa_Stm_foreachDef(s, addDef);
+    Ssa_Stm_foreachUse(s, addUse);
+    curChains = 0;
+    curSite = 0;
+}
+
+void Ssa_DefUse_deleteStm(T c, Label_t block, Ssa_Stm_t s) {
+    struct Ssa_Site_t site = {block, s};
+
+    assert(c);
+    assert(s);
+    curChains = c;
+    curSite = &site;
+    Ssa_Stm_foreachDef(s, deleteDef);
+    Ssa_Stm_foreachUse(s, deleteUse);
+    curChains = 0;
+    curSite = 0;
+}
+
+void Ssa_DefUse_addTransfer(T c, Label_t block, Ssa_Transfer_t t) {
+    assert(c);
+    assert(t);
+    curChains = c;
+    curSite = Site_new(block, 0);
+    Ssa_Transfer_foreachDef(t, addDef);
+    Ssa_Transfer_foreachUse(t, addUse);
+    curChains = 0;
+    curSite = 0;
+}
+
+void Ssa_DefUse_deleteTransfer(T c, Label_t block, Ssa_Transfer_t t) {
+    struct Ssa_Site_t site = {block, 0};
+
+    assert(c);
+    assert(t);
+    curChains = c;
+    curSite = &site;
+    Ssa_Transfer_foreachDef(t, deleteDef);
+    Ssa_Transfer_foreachUse(t, deleteUse);
+    curChains = 0;
+    curSite = 0;
+}
+
+//////////////////////////////////////////////////////
+T Ssa_DefUse_ofFun(Ssa_Fun_t f) {
+    T c;
+
+    assert(f);
+    if (f->chains)
+        return f->chains;
+    Mem_NEW(c);
+    c->vars = Hash_new((tyHashCode) Id_hashCode, (Poly_tyEquals) Id_equals, 0);
+    for (List_t p = List_getFirst(f->blocks); p; p = p->next) {
+        Ssa_Block_t b = p->data;
+
+        for (List_t q = List_getFirst(b->stms); q; q = q->next)
+            Ssa_DefUse_addStm(c, b->label, q->data);
+        Ssa_DefUse_addTransfer(c, b->label, b->transfer);
+    }
+    f->chains = c;
+    return c;
+}
+
+Ssa_Site_t Ssa_DefUse_def(T c, Id_t id) {
+    assert(c);
+    return lookup(c, id)->def;
+}
+
+List_t Ssa_DefUse_uses(T c, Id_t id) {
+    assert(c);
+    return lookup(c, id)->uses;
+}
+
+#undef T
@@ -0,0 +1,42 @@
+#ifndef SSA_DEF_USE_H
+#define SSA_DEF_USE_H
+
+#include "ssa.h"
+
+#define T Ssa_DefUse_t
+
+// The def-use chains of a function in SSA form: for each
+// variable, the one site which defines it, and the sites
+// which use it. A site is a statement of a block, or the
+// transfer of that block. Sites name their blocks by label,
+// so the chains stay valid when a pass rebuilds the blocks
+// around the same statements; a pass which adds or deletes
+// statements keeps them up to date by the calls below, and
+// then hands them to its result ("f->chains").
+typedef struct T *T;
+
+typedef struct Ssa_Site_t {
+    Label_t block;
+    // 0 for the transfer of "block"
+    Ssa_Stm_t stm;
+} *Ssa_Site_t;
+
+// the chains of "f", built at the first call and kept on "f"
+T Ssa_DefUse_ofFun(Ssa_Fun_t f);
+// the site which defines "id", or 0 for an argument and a
+// variable never assigned
+Ssa_Site_t Ssa_DefUse_def(T, Id_t id);
+// List<Ssa_Site_t>: the sites which use "id", once for each
+// use; not to be changed by the caller
+List_t Ssa_DefUse_uses(T, Id_t id);
+// record the definitions and uses of the statement "s" of
+// the block "block", or forget them
+void Ssa_DefUse_addStm(T, Label_t block, Ssa_Stm_t s);
+void Ssa_DefUse_deleteStm(T, Label_t block, Ssa_Stm_t s);
+// the same for the transfer "t" of the block "block"
+void Ssa_DefUse_addTransfer(T, Label_t block, Ssa_Transfer_t t);
+void Ssa_DefUse_deleteTransfer(T, Label_t block, Ssa_Transfer_t t);
+
+#undef T
+
+#endif
@@ -0,0 +1,464 @@
+#include "gvn.h"
+#include "../control/control.h"
+#include "../control/log.h"
+#include "../lib/error.h"
+#include "../lib/hash.h"
+#include "../lib/int.h"
+#include "../lib/mem.h"
+#include "../lib/property.h"
+#include "../lib/thread.h"
+#include "../lib/trace.h"
+#include "../lib/tuple.h"
+#include <assert.h>
+#include <stdio.h>
+
+// This module eliminates redundant computations. It walks
+// the dominator tree of each function, and keeps a table of
+// the expressions available at the current block: those
+// computed in the blocks dominating it. A "move", a "bop" or
+// a "uop" whose expression is in the table is redundant: a
+// "bop" or a "uop" becomes a move from the variable first
+// holding it, which dominates it, whereas a move is kept
+// (a constant is better than a variable to what follows),
+// and only numbered.
+//
+// The value number of a variable is the variable first
+// holding its value, so that
+//     y = x; a = x + 1; b = y + 1;
+// finds "b" redundant. An expression is keyed by its
+// operator and the value numbers of its operands, where the
+// operands of "+", "*", "==" and "!=" are put in one order,
+// and ">" and ">=" are turned into "<" and "<=".
+//
+// The table is scoped: the expressions a block adds are
+// removed once its subtree is done. Phis are not numbered
+// (each holds a value of its own).
+//
+// A load is keyed by the value numbers of its address, but
+// stays in the table only while nothing may have changed
+// what it reads: a store that may alias it (see
+// "Ssa_Mem_mayAlias") removes it, and so does a call. As
+// another path may store into a join, a block keeps the
+// loads of its dominator only if that is its one
+// predecessor and does not end with a call; i.e., loads are
+// numbered in extended basic blocks. The loads a block
+// removes are put back once its subtree is done.
+//
+// Functions are processed in parallel: the state below is
+// per thread.
+
+// the expression key
+typedef struct Exp_t {
+    int kind;
+    Operator_t op;
+    // for loads, the kind of memory
+    int mem;
+    // value numbers in place of the variables; "right" is
+    // unused for moves and "uop"s
+    struct Ssa_Operand_t left;
+    struct Ssa_Operand_t right;
+} *Exp_t;
+
+// Id_t -> Id_t: the value number, if not the variable
+// itself
+static Thread_local Property_t vnProp = 0;
+// Label_t -> Ssa_Block_t: the new blocks
+static Thread_local Property_t substProp = 0;
+// Exp_t -> Id_t: the available expressions
+static Thread_local Hash_t table = 0;
+static Thread_local Graph_t thegraph = 0;
+static Thread_local Tree_t thetree = 0;
+static Thread_local long numElim = 0;
+
+//////////////////////////////////////////////////////
+// expressions
+static long operandHashCode(Ssa_Operand_t o) {
+    switch (o->kind) {
+        case SSA_OP_INT:
+            return o->u.intlit;
+        case SSA_OP_STR:
+            return (long) o->u.strlit;
+        case SSA_OP_ID:
+            return Id_hashCode(o->u.id);
+        default:
+            Error_impossible();
+            return 0;
+    }
+}
+
+static long Exp_hashCode(Exp_t e) {
+    unsigned long h = (unsigned long) e->kind * 31 + (unsigned long) e->op;
+
+    h = h * 31 + (unsigned long) e->mem;
+    h = h * 31 + (unsigned long) operandHashCode(&e->left);
+    h = h * 31 + (unsigned long) operandHashCode(&e->right);
+    return (long) h;
+}
+
+static long Exp_equals(Exp_t e1, Exp_t e2) {
+    return e1->kind == e2->kind && e1->op == e2->op && e1->mem == e2->mem && Ssa_Operand_equals(&e1->left, &e2->left)
+           && Ssa_Operand_equals(&e1->right, &e2->right);
+}
+
+// a total order on the operands, for the commutative
+// operators
+static long operandCompare(Ssa_Operand_t o1, Ssa_Operand_t o2) {
+    if (o1->kind != o2->kind)
+        return (long) o1->kind - (long) o2->kind;
+    switch (o1->kind) {
+        case SSA_OP_INT:
+            return (o1->u.intlit > o2->u.intlit) - (o1->u.intlit < o2->u.intlit);
+        case SSA_OP_STR:
+            return (o1->u.strlit > o2->u.strlit) - (o1->u.strlit < o2->u.strlit);
+        case SSA_OP_ID:
+            return Id_index(o1->u.id) - Id_index(o2->u.id);
+        default:
+            Error_impossible();
+            return 0;
+    }
+}
+
+static Id_t vn(Id_t id) {
+    Id_t n = Property_get(vnProp, id);
+
+    return n ? n : id;
+}
+
+static void numberOperand(Ssa_Operand_t to, Ssa_Operand_t o) {
+    *to = *o;
+    if (o->kind == SSA_OP_ID)
+        to->u.id = vn(o->u.id);
+}
+
+static Exp_t Exp_new(int kind, Operator_t op, Ssa_Operand_t left, Ssa_Operand_t right) {
+    Exp_t e;
+    struct Ssa_Operand_t tmp;
+
+    Mem_NEW(e);
+    e->kind = kind;
+    e->op = op;
+    e->mem = 0;
+    numberOperand(&e->left, left);
+    if (right)
+        numberOperand(&e->right, right);
+    else
+        e->right = (struct Ssa_Operand_t){SSA_OP_INT, {0}};
+    if (kind != SSA_STM_BOP)
+        return e;
+    switch (op) {
+        case OP_GT:
+            e->op = OP_LT;
+            break;
+        case OP_GE:
+            e->op = OP_LE;
+            break;
+        case OP_ADD:
+        case OP_TIMES:
+        case OP_EQ:
+        case OP_NE:
+            if (operandCompare(&e->left, &e->right) <= 0)
+                return e;
+            break;
+        default:
+            return e;
+    }
+    tmp = e->left;
+    e->left = e->right;
+    e->right = tmp;
+    return e;
+}
+
+// a field is not a variable, so numbering leaves it as is
+static Exp_t Exp_newMem(int mem, Ssa_Operand_t name, Ssa_Operand_t offset) {
+    Exp_t e = Exp_new(SSA_STM_LOAD, OP_ADD, name, offset);
+
+    e->mem = mem;
+    return e;
+}
+
+static Exp_t Exp_newLoad(Ssa_Mem_t m) {
+    struct Ssa_Operand_t name = {SSA_OP_ID, {0}};
+    struct Ssa_Operand_t field = {SSA_OP_ID, {0}};
+
+    switch (m->kind) {
+        case SSA_MEM_ARRAY:
+            name.u.id = m->u.array.name;
+            return Exp_newMem(m->kind, &name, m->u.array.index);
+        case SSA_MEM_CLASS:
+            name.u.id = m->u.class.name;
+            field.u.id = m->u.class.field;
+            return Exp_newMem(m->kind, &name, &field);
+        default:
+            Error_impossible();
+            return 0;
+    }
+}
+
+//////////////////////////////////////////////////////
+// the walk
+// the variable first holding "e", or 0 after adding "e",
+// held by "dest", to the table and to "added"
+static Id_t lookupOrAdd(Exp_t e, Id_t dest, List_t added) {
+    Id_t holder = Hash_lookup(table, e);
+
+    if (holder)
+        return holder;
+    Hash_insert(table, e, dest);
+    List_insertLast(added, e);
+    return 0;
+}
+
+//////////////////////////////////////////////////////
+// loads
+typedef struct {
+    Exp_t e;
+    Id_t holder;
+    Ssa_Mem_t m;
+    // the block that made it available
+    Ssa_Block_t owner;
+    // whether it is in the table
+    int isAvail;
+} *Load_t;
+
+// List<Load_t>: the loads in the table, and maybe some
+// that have left it since
+static Thread_local List_t loads = 0;
+
+// remove the loads a store to "m", or a call if "m" is 0,
+// may change, and add them to "killed"
+static void killLoads(Ssa_Mem_t m, List_t killed) {
+    List_t kept = List_new();
+
+    for (List_t p = List_getFirst(loads); p; p = p->next) {
+        Load_t l = p->data;
+
+        if (!l->isAvail)
+            continue;
+        if (m && !Ssa_Mem_mayAlias(m, l->m)) {
+            List_insertLast(kept, l);
+            continue;
+        }
+        Hash_delete(table, l->e);
+        l->isAvail = 0;
+        List_insertLast(killed, l);
+    }
+    loads = kept;
+}
+
+// the variable first holding the load "s" in "b", or 0
+// after making it available
+static Id_t lookupOrAddLoad(Ssa_Block_t b, Ssa_Stm_t s, List_t ownLoads) {
+    Exp_t e = Exp_newLoad(s->u.load.m);
+    Id_t holder = Hash_lookup(table, e);
+    Load_t l;
+
+    if (holder)
+        return holder;
+    Hash_insert(table, e, s->u.load.dest);
+    Mem_NEW(l);
+    l->e = e;
+    l->holder = s->u.load.dest;
+    l->m = s->u.load.m;
+    l->owner = b;
+    l->isAvail = 1;
+    List_insertLast(loads, l);
+    List_insertLast(ownLoads, l);
+    return 0;
+}
+
+// whether "b" starts with the memory its dominator ends with
+static int extendsParent(Ssa_Block_t b) {
+    List_t preds = Graph_predessors(thegraph, b);
+    Ssa_Block_t pred;
+
+    if (List_size(preds) != 1)
+        return 0;
+    pred = List_getFirst(preds)->data;
+    return pred->transfer->kind != SSA_TRANS_CALL;
+}
+
+// after the subtree of "b": drop the loads "b" made
+// available, and put back those it removed
+static void restoreLoads(Ssa_Block_t b, List_t ownLoads, List_t killed) {
+    for (List_t p = List_getFirst(ownLoads); p; p = p->next) {
+        Load_t l = p->data;
+
+        if (!l->isAvail)
+            continue;
+        Hash_delete(table, l->e);
+        l->isAvail = 0;
+    }
+    for (List_t p = List_getFirst(killed); p; p = p->next) {
+        Load_t l = p->data;
+
+        if (l->owner == b)
+            continue;
+        Hash_insert(table, l->e, l->holder);
+        l->isAvail = 1;
+        List_insertLast(loads, l);
+    }
+}
+
+//////////////////////////////////////////////////////
+// statements
+static Id_t destOf(Ssa_Stm_t s) {
+    switch (s->kind) {
+        case SSA_STM_BOP:
+            return s->u.bop.dest;
+        case SSA_STM_UOP:
+            return s->u.uop.dest;
+        case SSA_STM_LOAD:
+            return s->u.load.dest;
+        default:
+            Error_impossible();
+            return 0;
+    }
+}
+
+// "ownLoads" and "killed" are as in "restoreLoads"
+static Ssa_Stm_t numberStm(Ssa_Block_t b, Ssa_Stm_t s, List_t added, List_t ownLoads, List_t killed) {
+    Id_t holder;
+
+    switch (s->kind) {
+        case SSA_STM_MOVE:
+            if (s->u.move.src->kind == SSA_OP_ID) {
+                Property_set(vnProp, s->u.move.dest, vn(s->u.move.src->u.id));
+                return s;
+            }
+            holder = lookupOrAdd(Exp_new(SSA_STM_MOVE, OP_ADD, s->u.move.src, 0), s->u.move.dest, added);
+            if (holder)
+                Property_set(vnProp, s->u.move.dest, holder);
+            return s;
+        case SSA_STM_BOP:
+            holder = lookupOrAdd(Exp_new(SSA_STM_BOP, s->u.bop.op, s->u.bop.left, s->u.bop.right),
+                                 s->u.bop.dest,
+                                 added);
+            if (!holder)
+                return s;
+            Property_set(vnProp, s->u.bop.dest, holder);
+            break;
+        case SSA_STM_UOP:
+            holder = lookupOrAdd(Exp_new(SSA_STM_UOP, s->u.uop.op, s->u.uop.src, 0), s->u.uop.dest, added);
+            if (!holder)
+                return s;
+            Property_set(vnProp, s->u.uop.dest, holder);
+            break;
+        case SSA_STM_LOAD:
+            holder = lookupOrAddLoad(b, s, ownLoads);
+            if (!holder)
+                return s;
+            Property_set(vnProp, s->u.load.dest, holder);
+            break;
+        case SSA_STM_STORE:
+            killLoads(s->u.store.m, killed);
+            return s;
+        case SSA_STM_CALL:
+            killLoads(0, killed);
+            return s;
+        default:
+            return s;
+    }
+    Log_str("found a redundant statement: ");
+    Log_fun(s, (Poly_tyLog) Ssa_Stm_print);
+    numElim++;
+    return Ssa_Stm_new_move(destOf(s), Ssa_Operand_new_id(holder));
+}
+
+static void numberBlock(Ssa_Block_t b) {
+    List_t newStms = List_new();
+    // List<Exp_t>: the expressions this block adds, but loads
+    List_t added = List_new();
+    // List<Load_t>: the loads this block makes available,
+    // and those it removes
+    List_t ownLoads = List_new();
+    List_t killed = List_new();
+
+    if (!extendsParent(b))
+        killLoads(0, killed);
+    for (List_t p = List_getFirst(b->stms); p; p = p->next)
+        List_insertLast(newStms, numberStm(b, p->data, added, ownLoads, killed));
+    Property_set(substProp, b->label, Ssa_Block_new(b->label, newStms, b->transfer));
+
+    for (List_t p = List_getFirst(Tree_children(thetree, b)); p; p = p->next)
+        numberBlock(p->data);
+
+    for (List_t p = List_getFirst(added); p; p = p->next)
+        Hash_delete(table, p->data);
+    restoreLoads(b, ownLoads, killed);
+}
+
+// the blocks not reached from the entry are not in the
+// tree, and are kept
+static Ssa_Block_t rewriteBlock(Ssa_Block_t b) {
+    Ssa_Block_t newb = Property_get(substProp, b->label);
+
+    return newb ? newb : b;
+}
+
+////////////////////////////////////////////////
+// functions
+static void init(void) {
+    vnProp = Property_new((Poly_tyIndex) Id_index);
+    substProp = Property_new((Poly_tyIndex) Label_index);
+    table = Hash_new((tyHashCode) Exp_hashCode, (Poly_tyEquals) Exp_equals, 0);
+}
+
+// Tuple<Ssa_Fun_t, long>: the new function, and the number
+// of statements found redundant
+static Tuple_t transFunEach(Ssa_Fun_t f) {
+    Ssa_Block_t entry = Ssa_Fun_searchLabel(f, f->entry);
+    List_t newBlocks;
+
+    thegraph = Ssa_Fun_toGraph(f);
+    thetree = Graph_domTree(thegraph, entry);
+    numElim = 0;
+    loads = List_new();
+    numberBlock(entry);
+    thegraph = 0;
+    thetree = 0;
+    loads = 0;
+    newBlocks = List_map(f->blocks, (Poly_tyId) rewriteBlock);
+    Log_strs(Id_toString(f->name), ": ", Int_toString(numElim), " redundant statements\n", 0);
+
+    Property_clear(vnProp);
+    Property_clear(substProp);
+    return Tuple_new(Ssa_Fun_new(f->type, f->name, f->args, f->decs, newBlocks, f->retId, f->entry, f->exitt),
+                     (Poly_t) numElim);
+}
+
+////////////////////////////////////////////////
+// program
+static Ssa_Prog_t Ssa_gvnTraced(Ssa_Prog_t p) {
+    List_t newFuncs = List_new();
+    long total = 0;
+
+    for (List_t q = List_getFirst(Thread_map(p->funcs, (Poly_tyId) transFunEach, init)); q; q = q->next) {
+        List_insertLast(newFuncs, Tuple_first(q->data));
+        total += (long) Tuple_second(q->data);
+    }
+    if (Control_Verb_order(VERBOSE_SUBPASS, Control_verbose)) {
+        Trace_spaces();
+        printf("%ld redundant expressions eliminated\n", total);
+    }
+    return Ssa_Prog_new(p->classes, newFuncs);
+}
+
+static void printArg(Ssa_Prog_t p) {
+    File_t file = File_open("ssa_gvn.arg", "w+");
+    Ssa_Prog_print(file, p);
+    File_close(file);
+}
+
+static void printResult(Ssa_Prog_t p) {
+    File_t file = File_open("ssa_gvn.result", "w+");
+    Ssa_Prog_print(file, p);
+    File_close(file);
+}
+
+Ssa_Prog_t Ssa_gvn(Ssa_Prog_t p) {
+    Ssa_Prog_t r;
+
+    Log_POS();
+    Trace_TRACE("Ssa_gvn", Ssa_gvnTraced, (p), printArg, r, printResult);
+    return r;
+}
@@ -0,0 +1,12 @@
+#ifndef SSA_GVN_H
+#define SSA_GVN_H
+
+#include "ssa.h"
+
+// Global value numbering (dominator-based, after Briggs,
+// Cooper and Simpson): a computation whose operator and
+// operands' value numbers match those of one in a
+// dominating block is redundant, and becomes a copy of it.
+Ssa_Prog_t Ssa_gvn(Ssa_Prog_t p);
+
+#endif
@@ -0,0 +1,295 @@
+#include "licm.h"
+#include "../control/control.h"
+#include "../control/log.h"
+#include "../lib/error.h"
+#include "../lib/int.h"
+#include "../lib/property.h"
+#include "../lib/thread.h"
+#include "../lib/trace.h"
+#include "../lib/tuple.h"
+#include "loop.h"
+#include <assert.h>
+#include <stdio.h>
+
+// This module hoists the loop-invariant statements of each
+// function to the preheaders of their loops, inner loops
+// first, so a statement may leave several loops one by one.
+//
+// A "move", a "bop" or a "uop" is invariant if its operands
+// are: constants, or variables defined out of the loop (SSA
+// makes that a single fact). It is pure, so it may move
+// even if it would not run on every iteration, except a
+// division, which traps on 0: it only moves for a constant
+// divisor other than 0 and -1.
+//
+// A load is invariant if, besides, nothing in the loop may
+// change what it reads: there is no call in the loop, and
+// no store that may alias it (see "Ssa_Mem_mayAlias"). As a
+// load traps on a bad pointer, it also has to
+// run whenever the loop does: its block dominates the exits
+// and the latches of the loop.
+//
+// Phis never move, nor does any statement with an effect.
+//
+// Functions are processed in parallel: the state below is
+// per thread.
+
+// Id_t -> Label_t: the block defining a variable, as moved
+static Thread_local Property_t defProp = 0;
+// Label_t -> List<Ssa_Stm_t>: the statements of a block, as
+// moved
+static Thread_local Property_t stmsProp = 0;
+static Thread_local Ssa_Loop_Forest_t forest = 0;
+static Thread_local long numHoisted = 0;
+
+// what the current loop may write
+static Thread_local int writesAll = 0;
+// List<Ssa_Mem_t>: the stores
+static Thread_local List_t writes = 0;
+
+static void init(void) {
+    defProp = Property_new((Poly_tyIndex) Id_index);
+    stmsProp = Property_new((Poly_tyIndex) Label_index);
+}
+
+//////////////////////////////////////////////////////
+// definitions
+static Thread_local Label_t curLabel = 0;
+
+static void markDef(Id_t id) {
+    Property_set(defProp, id, curLabel);
+}
+
+static void markDefs(Ssa_Fun_t f) {
+    for (List_t p = List_getFirst(f->blocks); p; p = p->next) {
+        Ssa_Block_t b = p->data;
+
+        curLabel = b->label;
+        Property_set(stmsProp, b->label, List_copy(b->stms));
+        for (List_t q = List_getFirst(b->stms); q; q = q->next)
+            Ssa_Stm_foreachDef(q->data, markDef);
+        Ssa_Transfer_foreachDef(b->transfer, markDef);
+    }
+    curLabel = 0;
+}
+
+//////////////////////////////////////////////////////
+// memory
+static void summarize(Ssa_Loop_t loop) {
+    writesAll = 0;
+    writes = List_new();
+    for (List_t p = List_getFirst(loop->blocks); p; p = p->next) {
+        Ssa_Block_t b = p->data;
+
+        if (b->transfer->kind == SSA_TRANS_CALL)
+            writesAll = 1;
+        for (List_t q = List_getFirst(Property_get(stmsProp, b->label)); q; q = q->next) {
+            Ssa_Stm_t s = q->data;
+
+            if (s->kind == SSA_STM_STORE)
+                List_insertLast(writes, s->u.store.m);
+        }
+    }
+}
+
+//////////////////////////////////////////////////////
+// invariants
+static int isInvariantId(Ssa_Loop_t loop, Id_t id) {
+    Label_t l = Property_get(defProp, id);
+
+    // an argument
+    if (!l)
+        return 1;
+    return !Ssa_Loop_contains(forest, loop, l);
+}
+
+static int isInvariant(Ssa_Loop_t loop, Ssa_Operand_t o) {
+    return o->kind != SSA_OP_ID || isInvariantId(loop, o->u.id);
+}
+
+static int mayTrap(Ssa_Stm_t s) {
+    Ssa_Operand_t divisor;
+
+    if (s->u.bop.op != OP_DIVIDE && s->u.bop.op != OP_MODUS)
+        return 0;
+    divisor = s->u.bop.right;
+    return divisor->kind != SSA_OP_INT || divisor->u.intlit == 0 || divisor->u.intlit == -1;
+}
+
+// whether "b" runs whenever the loop does
+static int alwaysRuns(Ssa_Loop_t loop, Ssa_Block_t b) {
+    for (List_t p = List_getFirst(loop->latches); p; p = p->next)
+        if (!Ssa_Loop_dominates(forest, b->label, ((Ssa_Block_t) p->data)->label))
+            return 0;
+    for (List_t p = List_getFirst(loop->exits); p; p = p->next)
+        if (!Ssa_Loop_dominates(forest, b->label, ((Ssa_Block_t) p->data)->label))
+            return 0;
+    return 1;
+}
+
+static int isWritten(Ssa_Mem_t m) {
+    if (writesAll)
+        return 1;
+    for (List_t p = List_getFirst(writes); p; p = p->next)
+        if (Ssa_Mem_mayAlias(p->data, m))
+            return 1;
+    return 0;
+}
+
+static int isInvariantLoad(Ssa_Loop_t loop, Ssa_Block_t b, Ssa_Mem_t m) {
+    if (isWritten(m))
+        return 0;
+    switch (m->kind) {
+        case SSA_MEM_ARRAY:
+            if (!isInvariantId(loop, m->u.array.name) || !isInvariant(loop, m->u.array.index))
+                return 0;
+            break;
+        case SSA_MEM_CLASS:
+            if (!isInvariantId(loop, m->u.class.name))
+                return 0;
+            break;
+        default:
+            Error_impossible();
+            return 0;
+    }
+    return alwaysRuns(loop, b);
+}
+
+// the variable "s" defines if it may move, or 0
+static Id_t hoistable(Ssa_Loop_t loop, Ssa_Block_t b, Ssa_Stm_t s) {
+    switch (s->kind) {
+        case SSA_STM_MOVE:
+            if (s->u.move.src->kind == SSA_OP_ID && isInvariant(loop, s->u.move.src))
+                return s->u.move.dest;
+            return 0;
+        case SSA_STM_BOP:
+            if (isInvariant(loop, s->u.bop.left) && isInvariant(loop, s->u.bop.right) && !mayTrap(s))
+                return s->u.bop.dest;
+            return 0;
+        case SSA_STM_UOP:
+            if (isInvariant(loop, s->u.uop.src))
+                return s->u.uop.dest;
+            return 0;
+        case SSA_STM_LOAD:
+            if (isInvariantLoad(loop, b, s->u.load.m))
+                return s->u.load.dest;
+            return 0;
+        default:
+            return 0;
+    }
+}
+
+//////////////////////////////////////////////////////
+// hoisting
+// Moved statements go to the end of the preheader in the
+// order they move, after the definitions of their operands.
+static void hoistLoop(Ssa_Loop_t loop) {
+    Ssa_Block_t pre = loop->preheader;
+    List_t to;
+    int changed = 1;
+
+    if (!pre)
+        return;
+    to = Property_get(stmsProp, pre->label);
+    summarize(loop);
+    while (changed) {
+        changed = 0;
+        for (List_t p = List_getFirst(loop->blocks); p; p = p->next) {
+            Ssa_Block_t b = p->data;
+            List_t kept = List_new();
+
+            for (List_t q = List_getFirst(Property_get(stmsProp, b->label)); q; q = q->next) {
+                Ssa_Stm_t s = q->data;
+                Id_t dest = hoistable(loop, b, s);
+
+                if (!dest) {
+                    List_insertLast(kept, s);
+                    continue;
+                }
+                Log_strs("hoisting to ", Label_toString(pre->label), ": ", 0);
+                Log_fun(s, (Poly_tyLog) Ssa_Stm_print);
+                List_insertLast(to, s);
+                Property_set(defProp, dest, pre->label);
+                numHoisted++;
+                changed = 1;
+            }
+            Property_set(stmsProp, b->label, kept);
+        }
+    }
+    writes = 0;
+}
+
+static Ssa_Block_t rewriteBlock(Ssa_Block_t b) {
+    return Ssa_Block_new(b->label, Property_get(stmsProp, b->label), b->transfer);
+}
+
+////////////////////////////////////////////////
+// functions
+// Tuple<Ssa_Fun_t, long>: the new function, and the number
+// of statements moved
+static Tuple_t transFunEach(Ssa_Fun_t f) {
+    // name the preheaders, and the phis split for them,
+    // after the function
+    Id_t oldScope = Id_enterScope(f->name);
+
+    f = Ssa_Loop_insertPreheaders(f);
+    forest = Ssa_Loop_forest(f);
+    numHoisted = 0;
+    if (!List_isEmpty(forest->loops)) {
+        markDefs(f);
+        List_foreach(forest->loops, (Poly_tyVoid) hoistLoop);
+    }
+    if (numHoisted) {
+        Log_strs(Id_toString(f->name), ": ", Int_toString(numHoisted), " statements hoisted\n", 0);
+        f = Ssa_Fun_new(f->type,
+                        f->name,
+                        f->args,
+                        f->decs,
+                        List_map(f->blocks, (Poly_tyId) rewriteBlock),
+                        f->retId,
+                        f->entry,
+                        f->exitt);
+    }
+    forest = 0;
+    Property_clear(defProp);
+    Property_clear(stmsProp);
+    Id_enterScope(oldScope);
+    return Tuple_new(f, (Poly_t) numHoisted);
+}
+
+////////////////////////////////////////////////
+// program
+static Ssa_Prog_t Ssa_licmTraced(Ssa_Prog_t p) {
+    List_t newFuncs = List_new();
+    long total = 0;
+
+    for (List_t q = List_getFirst(Thread_map(p->funcs, (Poly_tyId) transFunEach, init)); q; q = q->next) {
+        List_insertLast(newFuncs, Tuple_first(q->data));
+        total += (long) Tuple_second(q->data);
+    }
+    if (Control_Verb_order(VERBOSE_SUBPASS, Control_verbose)) {
+        Trace_spaces();
+        printf("%ld loop-invariant statements hoisted\n", total);
+    }
+    return Ssa_Prog_new(p->classes, newFuncs);
+}
+
+static void printArg(Ssa_Prog_t p) {
+    File_t file = File_open("ssa_licm.arg", "w+");
+    Ssa_Prog_print(file, p);
+    File_close(file);
+}
+
+static void printResult(Ssa_Prog_t p) {
+    File_t file = File_open("ssa_licm.result", "w+");
+    Ssa_Prog_print(file, p);
+    File_close(file);
+}
+
+Ssa_Prog_t Ssa_licm(Ssa_Prog_t p) {
+    Ssa_Prog_t r;
+
+    Log_POS();
+    Trace_TRACE("Ssa_licm", Ssa_licmTraced, (p), printArg, r, printResult);
+    return r;
+}
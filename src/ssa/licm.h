@@ -0,0 +1,13 @@
+#ifndef SSA_LICM_H
+#define SSA_LICM_H
+
+#include "ssa.h"
+
+// Loop-invariant code motion: a computation in a loop whose
+// operands are all defined out of the loop moves to its
+// preheader (see "loop.h"), and so does a load which the
+// loop may not change, and which runs whenever the loop
+// does.
+Ssa_Prog_t Ssa_licm(Ssa_Prog_t p);
+
+#endif
@@ -0,0 +1,437 @@
+#include "loop.h"
+#include "../control/log.h"
+#include "../lib/error.h"
+#include "../lib/mem.h"
+#include "../lib/property.h"
+#include "../lib/thread.h"
+#include <assert.h>
+#include <stdlib.h>
+
+#define T Ssa_Loop_t
+
+// The facts of the last forest built on this thread, all
+// keyed by the labels of the blocks:
+// Label_t -> long: the preorder and postorder numbers of a
+// block in the dominator tree, from 1; 0 if unreachable
+static Thread_local Property_t preProp = 0;
+static Thread_local Property_t postProp = 0;
+// Label_t -> T: the innermost loop of a block
+static Thread_local Property_t innerProp = 0;
+// Label_t -> T: the loop of a header
+static Thread_local Property_t headerProp = 0;
+// Label_t -> T: the loop whose body is being collected,
+// for the blocks already in it
+static Thread_local Property_t markProp = 0;
+static Thread_local long counter = 0;
+
+static void initForest(void) {
+    if (preProp) {
+        Property_clear(preProp);
+        Property_clear(postProp);
+        Property_clear(innerProp);
+        Property_clear(headerProp);
+        Property_clear(markProp);
+        return;
+    }
+    preProp = Property_new((Poly_tyIndex) Label_index);
+    postProp = Property_new((Poly_tyIndex) Label_index);
+    innerProp = Property_new((Poly_tyIndex) Label_index);
+    headerProp = Property_new((Poly_tyIndex) Label_index);
+    markProp = Property_new((Poly_tyIndex) Label_index);
+}
+
+static T Ssa_Loop_new(Ssa_Block_t header) {
+    T l;
+
+    Mem_NEW(l);
+    l->header = header;
+    l->blocks = List_new();
+    l->latches = List_new();
+    l->exits = List_new();
+    l->preheader = 0;
+    l->parent = 0;
+    l->children = List_new();
+    l->depth = 0;
+    return l;
+}
+
+//////////////////////////////////////////////////////
+// dominance
+static void number(Tree_t tree, Ssa_Block_t b) {
+    Property_set(preProp, b->label, (Poly_t) ++counter);
+    for (List_t p = List_getFirst(Tree_children(tree, b)); p; p = p->next)
+        number(tree, p->data);
+    Property_set(postProp, b->label, (Poly_t) ++counter);
+}
+
+static long pre(Label_t l) {
+    return (long) Property_get(preProp, l);
+}
+
+static long post(Label_t l) {
+    return (long) Property_get(postProp, l);
+}
+
+int Ssa_Loop_dominates(Ssa_Loop_Forest_t forest, Label_t l1, Label_t l2) {
+    assert(forest);
+    assert(pre(l1) && pre(l2));
+    return pre(l1) <= pre(l2) && post(l2) <= post(l1);
+}
+
+//////////////////////////////////////////////////////
+// loops
+T Ssa_Loop_innermost(Ssa_Loop_Forest_t forest, Label_t l) {
+    assert(forest);
+    return Property_get(innerProp, l);
+}
+
+int Ssa_Loop_contains(Ssa_Loop_Forest_t forest, T loop, Label_t l) {
+    for (T inner = Ssa_Loop_innermost(forest, l); inner; inner = inner->parent)
+        if (inner == loop)
+            return 1;
+    return 0;
+}
+
+static void addToBody(T loop, Ssa_Block_t b, List_t work) {
+    if (Property_get(markProp, b->label) == loop)
+        return;
+    Property_set(markProp, b->label, loop);
+    List_insertLast(loop->blocks, b);
+    List_insertLast(work, b);
+}
+
+// walk back from the latches, and stop at the header
+static void collectBody(Graph_t g, T loop) {
+    List_t work = List_new();
+
+    Property_set(markProp, loop->header->label, loop);
+    List_insertLast(loop->blocks, loop->header);
+    for (List_t p = List_getFirst(loop->latches); p; p = p->next)
+        addToBody(loop, p->data, work);
+    while (!List_isEmpty(work)) {
+        Ssa_Block_t b = List_removeHead(work);
+
+        for (List_t p = List_getFirst(Graph_predessors(g, b)); p; p = p->next) {
+            Ssa_Block_t pred = p->data;
+
+            // unreachable
+            if (!pre(pred->label))
+                continue;
+            addToBody(loop, pred, work);
+        }
+    }
+}
+
+static int compareSize(const void *x, const void *y) {
+    int a = List_size((*(const T *) x)->blocks);
+    int b = List_size((*(const T *) y)->blocks);
+
+    return (a > b) - (a < b);
+}
+
+// smaller loops first, so each block goes to its innermost
+// loop, and the outermost loop found so far in a larger
+// loop is its child
+static void nest(Ssa_Loop_Forest_t forest) {
+    long num = List_size(forest->loops), i = 0;
+    T *all;
+
+    if (!num)
+        return;
+    Mem_NEW_SIZE(all, num);
+    for (List_t p = List_getFirst(forest->loops); p; p = p->next)
+        all[i++] = p->data;
+    qsort(all, (size_t) num, sizeof(all[0]), compareSize);
+
+    forest->loops = List_new();
+    for (i = 0; i < num; i++) {
+        T loop = all[i];
+
+        List_insertLast(forest->loops, loop);
+        for (List_t p = List_getFirst(loop->blocks); p; p = p->next) {
+            Ssa_Block_t b = p->data;
+            T top = Property_get(innerProp, b->label);
+
+            if (!top) {
+                Property_set(innerProp, b->label, loop);
+                continue;
+            }
+            while (top->parent)
+                top = top->parent;
+            if (top == loop)
+                continue;
+            top->parent = loop;
+            List_insertLast(loop->children, top);
+        }
+    }
+    // outer loops first
+    for (i = num - 1; i >= 0; i--) {
+        T loop = all[i];
+
+        loop->depth = loop->parent ? loop->parent->depth + 1 : 1;
+        if (!loop->parent)
+            List_insertFirst(forest->roots, loop);
+    }
+}
+
+static int leaves(Ssa_Loop_Forest_t forest, T loop, Label_t l) {
+    return !Ssa_Loop_contains(forest, loop, l);
+}
+
+static void findExits(Ssa_Loop_Forest_t forest, T loop) {
+    List_t outs = List_new();
+
+    for (List_t p = List_getFirst(loop->blocks); p; p = p->next) {
+        Ssa_Block_t b = p->data;
+        Ssa_Transfer_t t = b->transfer;
+        int isExit = 0;
+
+        switch (t->kind) {
+            case SSA_TRANS_IF:
+                isExit = leaves(forest, loop, t->u.iff.truee) || leaves(forest, loop, t->u.iff.falsee);
+                break;
+            case SSA_TRANS_JUMP:
+                isExit = leaves(forest, loop, t->u.jump);
+                break;
+            case SSA_TRANS_CALL:
+            case SSA_TRANS_RETURN:
+            case SSA_TRANS_THROW:
+                isExit = 1;
+                break;
+            default:
+                Error_impossible();
+        }
+        if (isExit)
+            List_insertLast(loop->exits, b);
+    }
+
+    // the preheader
+    for (List_t p = List_getFirst(Graph_predessors(forest->graph, loop->header)); p; p = p->next) {
+        Ssa_Block_t pred = p->data;
+
+        if (leaves(forest, loop, pred->label))
+            List_insertLast(outs, pred);
+    }
+    if (List_size(outs) == 1) {
+        Ssa_Block_t pred = List_getFirst(outs)->data;
+
+        if (pred->transfer->kind == SSA_TRANS_JUMP)
+            loop->preheader = pred;
+    }
+}
+
+Ssa_Loop_Forest_t Ssa_Loop_forest(Ssa_Fun_t f) {
+    Ssa_Loop_Forest_t forest;
+    Ssa_Block_t entry;
+
+    assert(f);
+    initForest();
+    Mem_NEW(forest);
+    forest->graph = Ssa_Fun_toGraph(f);
+    entry = Ssa_Fun_searchLabel(f, f->entry);
+    forest->domTree = Graph_domTree(forest->graph, entry);
+    forest->roots = List_new();
+    forest->loops = List_new();
+    counter = 0;
+    number(forest->domTree, entry);
+
+    // the back edges
+    for (List_t p = List_getFirst(f->blocks); p; p = p->next) {
+        Ssa_Block_t b = p->data;
+        Ssa_Block_t last = 0;
+
+        if (!pre(b->label))
+            continue;
+        for (List_t q = List_getFirst(Graph_successors(forest->graph, b)); q; q = q->next) {
+            Ssa_Block_t h = q->data;
+            T loop;
+
+            // both edges of an "if"
+            if (h == last || !Ssa_Loop_dominates(forest, h->label, b->label))
+                continue;
+            last = h;
+            loop = Property_get(headerProp, h->label);
+            if (!loop) {
+                loop = Ssa_Loop_new(h);
+                Property_set(headerProp, h->label, loop);
+                List_insertLast(forest->loops, loop);
+            }
+            List_insertLast(loop->latches, b);
+        }
+    }
+    for (List_t p = List_getFirst(forest->loops); p; p = p->next)
+        collectBody(forest->graph, p->data);
+    nest(forest);
+    for (List_t p = List_getFirst(forest->loops); p; p = p->next)
+        findExits(forest, p->data);
+    return forest;
+}
+
+//////////////////////////////////////////////////////
+// preheaders
+// Label_t -> long: nonzero for the handlers
+static Thread_local Property_t handlerProp = 0;
+// Id_t -> Atype_t
+static Thread_local Property_t typeProp = 0;
+// Label_t -> Ssa_Block_t: the block as rewritten so far
+static Thread_local Property_t blockProp = 0;
+// Label_t -> Ssa_Block_t: the preheader of a header
+static Thread_local Property_t preheaderProp = 0;
+
+static void initPreheaders(void) {
+    if (handlerProp)
+        return;
+    handlerProp = Property_new((Poly_tyIndex) Label_index);
+    typeProp = Property_new((Poly_tyIndex) Id_index);
+    blockProp = Property_new((Poly_tyIndex) Label_index);
+    preheaderProp = Property_new((Poly_tyIndex) Label_index);
+}
+
+static void markType(Dec_t dec) {
+    Property_set(typeProp, dec->id, dec->ty);
+}
+
+static Label_t retarget(Label_t l, Label_t from, Label_t to) {
+    return Label_equals(l, from) ? to : l;
+}
+
+static Ssa_Transfer_t retargetTransfer(Ssa_Transfer_t t, Label_t from, Label_t to) {
+    switch (t->kind) {
+        case SSA_TRANS_IF:
+            return Ssa_Transfer_new_if(t->u.iff.cond,
+                                       retarget(t->u.iff.truee, from, to),
+                                       retarget(t->u.iff.falsee, from, to));
+        case SSA_TRANS_JUMP:
+            return Ssa_Transfer_new_jump(retarget(t->u.jump, from, to));
+        case SSA_TRANS_CALL:
+            // the header is not a handler
+            return Ssa_Transfer_new_call(t->u.call.dest,
+                                         t->u.call.name,
+                                         t->u.call.args,
+                                         t->u.call.leave,
+                                         retarget(t->u.call.normal, from, to));
+        default:
+            Error_impossible();
+            return 0;
+    }
+}
+
+// the phis of the header take the arguments from out of
+// the loop from "pre", merged by new phis of "pre"
+static Ssa_Block_t splitPhis(Ssa_Loop_Forest_t forest, T loop, Ssa_Block_t h, Ssa_Block_t pre, List_t newDecs) {
+    List_t newStms = List_new();
+
+    for (List_t p = List_getFirst(h->stms); p; p = p->next) {
+        Ssa_Stm_t s = p->data;
+        List_t inArgs = List_new(), outArgs = List_new();
+        Ssa_Operand_t merged;
+
+        if (s->kind != SSA_STM_PHI) {
+            List_insertLast(newStms, s);
+            continue;
+        }
+        for (List_t q = List_getFirst(s->u.phi.args); q; q = q->next) {
+            Ssa_Stm_PhiArg_t arg = q->data;
+
+            List_insertLast(leaves(forest, loop, arg->pred->label) ? outArgs : inArgs, arg);
+        }
+        if (List_isEmpty(outArgs)) {
+            List_insertLast(newStms, s);
+            continue;
+        }
+        if (List_size(outArgs) == 1)
+            merged = ((Ssa_Stm_PhiArg_t) List_getFirst(outArgs)->data)->arg;
+        else {
+            Id_t fresh = Id_newNoName();
+
+            List_insertLast(newDecs, Dec_new(Property_get(typeProp, s->u.phi.dest), fresh));
+            List_insertLast(pre->stms, Ssa_Stm_new_phi(fresh, outArgs));
+            merged = Ssa_Operand_new_id(fresh);
+        }
+        List_insertLast(inArgs, Ssa_Stm_PhiArg_new(merged, pre));
+        List_insertLast(newStms, Ssa_Stm_new_phi(s->u.phi.dest, inArgs));
+    }
+    return Ssa_Block_new(h->label, newStms, h->transfer);
+}
+
+static int insertPreheader(Ssa_Fun_t f, Ssa_Loop_Forest_t forest, T loop, List_t newDecs) {
+    Label_t h = loop->header->label;
+    List_t outs = List_new();
+    Ssa_Block_t pre;
+
+    if (loop->preheader || Label_equals(h, f->entry) || Property_get(handlerProp, h))
+        return 0;
+    for (List_t p = List_getFirst(Graph_predessors(forest->graph, loop->header)); p; p = p->next) {
+        Ssa_Block_t pred = p->data;
+
+        if (leaves(forest, loop, pred->label))
+            List_insertLast(outs, pred);
+    }
+    if (List_isEmpty(outs))
+        return 0;
+
+    pre = Ssa_Block_new(Label_new(), List_new(), Ssa_Transfer_new_jump(h));
+    Property_set(blockProp, h, splitPhis(forest, loop, Property_get(blockProp, h), pre, newDecs));
+    for (List_t p = List_getFirst(outs); p; p = p->next) {
+        Ssa_Block_t pred = Property_get(blockProp, ((Ssa_Block_t) p->data)->label);
+
+        Property_set(blockProp,
+                     pred->label,
+                     Ssa_Block_new(pred->label, pred->stms, retargetTransfer(pred->transfer, h, pre->label)));
+    }
+    Property_set(preheaderProp, h, pre);
+    Log_strs("preheader ", Label_toString(pre->label), " for the loop at ", Label_toString(h), "\n", 0);
+    return 1;
+}
+
+Ssa_Fun_t Ssa_Loop_insertPreheaders(Ssa_Fun_t f) {
+    Ssa_Loop_Forest_t forest;
+    List_t newDecs, newBlocks;
+    int changed = 0;
+
+    assert(f);
+    forest = Ssa_Loop_forest(f);
+    if (List_isEmpty(forest->loops))
+        return f;
+
+    initPreheaders();
+    List_foreach(f->args, (Poly_tyVoid) markType);
+    List_foreach(f->decs, (Poly_tyVoid) markType);
+    for (List_t p = List_getFirst(f->blocks); p; p = p->next) {
+        Ssa_Block_t b = p->data;
+        Ssa_Transfer_t t = b->transfer;
+
+        Property_set(blockProp, b->label, b);
+        for (List_t q = List_getFirst(b->stms); q; q = q->next) {
+            Ssa_Stm_t s = q->data;
+
+            if (s->kind == SSA_STM_TRY)
+                Property_set(handlerProp, s->u.try, (Poly_t) 1);
+        }
+        if (t->kind == SSA_TRANS_CALL && t->u.call.leave)
+            Property_set(handlerProp, t->u.call.leave, (Poly_t) 1);
+    }
+
+    newDecs = List_copy(f->decs);
+    for (List_t p = List_getFirst(forest->loops); p; p = p->next)
+        changed |= insertPreheader(f, forest, p->data, newDecs);
+
+    newBlocks = List_new();
+    for (List_t p = List_getFirst(f->blocks); p; p = p->next) {
+        Label_t l = ((Ssa_Block_t) p->data)->label;
+        Ssa_Block_t pre = Property_get(preheaderProp, l);
+
+        if (pre)
+            List_insertLast(newBlocks, pre);
+        List_insertLast(newBlocks, Property_get(blockProp, l));
+    }
+    Property_clear(handlerProp);
+    Property_clear(typeProp);
+    Property_clear(blockProp);
+    Property_clear(preheaderProp);
+    if (!changed)
+        return f;
+    return Ssa_Fun_new(f->type, f->name, f->args, newDecs, newBlocks, f->retId, f->entry, f->exitt);
+}
+
+#undef T
@@ -0,0 +1,70 @@
+#ifndef SSA_LOOP_H
+#define SSA_LOOP_H
+
+#include "../lib/graph.h"
+#include "ssa.h"
+
+#define T Ssa_Loop_t
+
+// The natural loops of a function, and how they nest. A
+// back edge goes from a block to one which dominates it, its
+// header; the loop of a header is the header, and all the
+// blocks reaching one of its back edges without passing the
+// header. Two loops are thus either disjoint or nested, and
+// the loops of a function form a forest.
+//
+// The forest keeps the dominator tree it was built on, and
+// some of its facts per thread (see "loop.c"), so it is only
+// good until the next forest is built on the same thread.
+typedef struct T *T;
+
+struct T {
+    Ssa_Block_t header;
+    // List<Ssa_Block_t>: the header first, then the blocks
+    // of the nested loops too
+    List_t blocks;
+    // List<Ssa_Block_t>: the sources of the back edges
+    List_t latches;
+    // List<Ssa_Block_t>: the blocks which may leave the loop,
+    // by an edge out of it, a "return", a "throw", or a call
+    // which throws
+    List_t exits;
+    // the block whose only edge goes to the header, and the
+    // only edge into the header from out of the loop; or 0
+    Ssa_Block_t preheader;
+    // the innermost loop enclosing this one, or 0
+    T parent;
+    // List<T>
+    List_t children;
+    // 1 for an outermost loop
+    long depth;
+};
+
+typedef struct Ssa_Loop_Forest_t {
+    Graph_t graph;
+    Tree_t domTree;
+    // List<T>: the outermost loops
+    List_t roots;
+    // List<T>: all loops, each before those enclosing it
+    List_t loops;
+} *Ssa_Loop_Forest_t;
+
+Ssa_Loop_Forest_t Ssa_Loop_forest(Ssa_Fun_t f);
+// the innermost loop of the block "l", or 0
+T Ssa_Loop_innermost(Ssa_Loop_Forest_t forest, Label_t l);
+// whether the block "l" is in the loop (or nested in it)
+int Ssa_Loop_contains(Ssa_Loop_Forest_t forest, T loop, Label_t l);
+// whether the block "l1" dominates "l2"; both must be
+// reachable
+int Ssa_Loop_dominates(Ssa_Loop_Forest_t forest, Label_t l1, Label_t l2);
+
+// Gives every loop a preheader: a new block takes the edges
+// into the header from out of the loop, and jumps to it; the
+// header's phis take the values from it, which are merged by
+// phis of its own if it has several predecessors. Not done
+// for a header which is the entry, or a handler.
+Ssa_Fun_t Ssa_Loop_insertPreheaders(Ssa_Fun_t f);
+
+#undef T
+
+#endif
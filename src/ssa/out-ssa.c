@@ -1,16 +1,17 @@
 #include "out-ssa.h"
 #include "../control/log.h"
+#include "../lib/thread.h"
 #include "../lib/trace.h"
 #include "../lib/tuple.h"
 #include "../lib/unused.h"
 #include <assert.h>
 
 /////////////////////////////////////////////////////
-// properties:
+// properties (per thread):
 // Ssa_Block_t -> List<Stm_t>
 // given a block, return statements that should append to
 // its head
-static Property_t headProp = 0;
+static Thread_local Property_t headProp = 0;
 
 static List_t headPropInitFun(Ssa_Block_t b) {
     UNUSED(b);
@@ -20,7 +21,7 @@ static List_t headPropInitFun(Ssa_Block_t b) {
 // Ssa_Block_t -> List<Stm_t>
 // given a block, return statements that should append to
 // its tail
-static Property_t tailProp = 0;
+static Thread_local Property_t tailProp = 0;
 
 static List_t tailPropInitFun(Ssa_Block_t b) {
     UNUSED(b);
@@ -30,7 +31,13 @@ static List_t tailPropInitFun(Ssa_Block_t b) {
 // Id_t -> Tuple<Id_t, Id_t>
 // given an id, return the fresh "dest" and "arg"
 // ids generated for it
-static Property_t nameProp = 0;
+static Thread_local Property_t nameProp = 0;
+
+static void init(void) {
+    headProp = Property_newInitFun((Poly_tyIndex) Ssa_Block_index, (Poly_tyId) headPropInitFun);
+    tailProp = Property_newInitFun((Poly_tyIndex) Ssa_Block_index, (Poly_tyId) tailPropInitFun);
+    nameProp = Property_new((Poly_tyIndex) Id_index);
+}
 
 
 //////////////////////////////////////////////////////
@@ -155,14 +162,20 @@ static List_t rewriteDecs(List_t args, List_t decs) {
 static Ssa_Fun_t transFunEach(Ssa_Fun_t f) {
     Ssa_Fun_t newf;
     List_t blocks, decs;
+    Id_t oldScope;
 
     assert(f);
 
     Log_str("analysis starting:");
+    oldScope = Id_enterScope(f->name);
     analyze(f->blocks);
+    Id_enterScope(oldScope);
     Log_str("analysis finished:");
     blocks = rewrite(f->blocks);
     decs = rewriteDecs(f->args, f->decs);
+    Property_clear(headProp);
+    Property_clear(tailProp);
+    Property_clear(nameProp);
     newf = Ssa_Fun_new(f->type,
                        f->name,
                        f->args,
@@ -181,15 +194,7 @@ static Ssa_Prog_t Ssa_outSsaTraced(Ssa_Prog_t p) {
     List_t newFuncs;
 
     assert(p);
-    headProp = Property_newInitFun((Poly_tyPlist) Ssa_Block_plist, (Poly_tyId) headPropInitFun);
-    tailProp = Property_newInitFun((Poly_tyPlist) Ssa_Block_plist, (Poly_tyId) tailPropInitFun);
-    nameProp = Property_new((Poly_tyPlist) Id_plist);
-
-    newFuncs = List_map(p->funcs, (Poly_tyId) transFunEach);
-
-    Property_clear(headProp);
-    Property_clear(tailProp);
-    Property_clear(nameProp);
+    newFuncs = Thread_map(p->funcs, (Poly_tyId) transFunEach, init);
     return Ssa_Prog_new(p->classes, newFuncs);
 }
 
@@ -0,0 +1,449 @@
+#include "sccp.h"
+#include "../control/log.h"
+#include "../lib/error.h"
+#include "../lib/property.h"
+#include "../lib/thread.h"
+#include "../lib/trace.h"
+#include "../lib/tuple.h"
+#include "def-use.h"
+#include <assert.h>
+#include <limits.h>
+
+// This module replaces the old pair of passes which ran
+// const propagation and dead code elimination in turn, each
+// rescanning the whole function until nothing changed.
+//
+// The value of a variable is one of:
+//   0        (top) no executable definition is seen yet
+//   operand  an integer or string constant
+//   &bottom  not a constant
+// and it only goes down, so the uses of a variable are
+// visited at most twice, and an edge is found executable
+// at most twice: the analysis is linear in the size of the
+// function. It runs on two worklists, over the def-use
+// chains of the function:
+//   * the flow worklist holds the edges found executable:
+//     the first edge into a block visits all of it, and
+//     the later ones only its phis;
+//   * the SSA worklist holds the uses of the variables
+//     whose values have gone down.
+// Only the edges out of an "if" are ever cut: a call, a
+// "try" or a jump always goes on.
+//
+// Constants never flow across functions, so functions are
+// processed in parallel: the state below is per thread.
+
+static struct Ssa_Operand_t bottom;
+
+// Id_t -> Ssa_Operand_t: the value, as above
+static Thread_local Property_t valueProp = 0;
+static Thread_local Ssa_DefUse_t chains = 0;
+// Label_t -> Ssa_Block_t
+static Thread_local Property_t blockProp = 0;
+// Label_t -> long: nonzero for the executable blocks
+static Thread_local Property_t execProp = 0;
+
+// List<Tuple<Ssa_Block_t, Label_t>>: the edges from a block
+// (0 for the entry edge) to a label
+static Thread_local List_t flowWork = 0;
+// List<Ssa_Site_t>
+static Thread_local List_t ssaWork = 0;
+
+static void init(void) {
+    valueProp = Property_new((Poly_tyIndex) Id_index);
+    blockProp = Property_new((Poly_tyIndex) Label_index);
+    execProp = Property_new((Poly_tyIndex) Label_index);
+}
+
+//////////////////////////////////////////////////////
+// blocks
+static void mapBlocks(Ssa_Fun_t f) {
+    for (List_t p = List_getFirst(f->blocks); p; p = p->next) {
+        Ssa_Block_t b = p->data;
+
+        Property_set(blockProp, b->label, b);
+    }
+}
+
+//////////////////////////////////////////////////////
+// the lattice
+static Ssa_Operand_t valueOf(Ssa_Operand_t o) {
+    if (o->kind != SSA_OP_ID)
+        return o;
+    // the arguments, say
+    if (!Ssa_DefUse_def(chains, o->u.id))
+        return &bottom;
+    return Property_get(valueProp, o->u.id);
+}
+
+// lower the value of "id" to "v", or to bottom if it holds
+// another constant
+static void lower(Id_t id, Ssa_Operand_t v) {
+    Ssa_Operand_t old = Property_get(valueProp, id);
+    List_t uses;
+
+    if (!v || old == &bottom)
+        return;
+    if (old) {
+        if (v != &bottom && Ssa_Operand_equals(old, v))
+            return;
+        v = &bottom;
+    }
+    Property_set(valueProp, id, v);
+    uses = Ssa_DefUse_uses(chains, id);
+    for (List_t p = List_getFirst(uses); p; p = p->next)
+        List_insertLast(ssaWork, p->data);
+}
+
+static Ssa_Operand_t evalBop(Ssa_Operand_t left, Operator_t op, Ssa_Operand_t right) {
+    long l, r;
+
+    if (left == &bottom || right == &bottom)
+        return &bottom;
+    if (!left || !right)
+        return 0;
+    if (left->kind != SSA_OP_INT || right->kind != SSA_OP_INT)
+        return &bottom;
+    l = left->u.intlit;
+    r = right->u.intlit;
+    // leave the traps to run time
+    if ((op == OP_DIVIDE || op == OP_MODUS) && (r == 0 || (r == -1 && l == LONG_MIN)))
+        return &bottom;
+    return Ssa_Operand_new_int(Operator_binary(l, op, r));
+}
+
+static Ssa_Operand_t evalUop(Operator_t op, Ssa_Operand_t src) {
+    if (!src || src == &bottom)
+        return src;
+    if (src->kind != SSA_OP_INT)
+        return &bottom;
+    return Ssa_Operand_new_int(Operator_unary(op, src->u.intlit));
+}
+
+//////////////////////////////////////////////////////
+// edges
+static int isExec(Ssa_Block_t b) {
+    return 0 != Property_get(execProp, b->label);
+}
+
+static void addEdge(Ssa_Block_t from, Label_t to) {
+    List_insertLast(flowWork, Tuple_new(from, to));
+}
+
+// whether the edge from "pred" to "b" may execute
+static int edgeIsExec(Ssa_Block_t pred, Ssa_Block_t b) {
+    Ssa_Transfer_t t;
+    Ssa_Operand_t v;
+
+    // the phis keep the blocks of the time they were made
+    pred = Property_get(blockProp, pred->label);
+    if (!pred || !isExec(pred))
+        return 0;
+    t = pred->transfer;
+    if (t->kind != SSA_TRANS_IF)
+        return 1;
+    v = valueOf(t->u.iff.cond);
+    if (!v)
+        return 0;
+    if (v == &bottom || v->kind != SSA_OP_INT)
+        return 1;
+    return Label_equals(b->label, v->u.intlit ? t->u.iff.truee : t->u.iff.falsee);
+}
+
+//////////////////////////////////////////////////////
+// visiting
+static void visitPhi(Ssa_Stm_t s, Ssa_Block_t b) {
+    Ssa_Operand_t v = 0;
+
+    for (List_t p = List_getFirst(s->u.phi.args); p; p = p->next) {
+        Ssa_Stm_PhiArg_t arg = p->data;
+        Ssa_Operand_t av;
+
+        if (!edgeIsExec(arg->pred, b))
+            continue;
+        av = valueOf(arg->arg);
+        if (!av)
+            continue;
+        if (av == &bottom || (v && !Ssa_Operand_equals(v, av))) {
+            v = &bottom;
+            break;
+        }
+        v = av;
+    }
+    lower(s->u.phi.dest, v);
+}
+
+static void visitStm(Ssa_Stm_t s, Ssa_Block_t b) {
+    switch (s->kind) {
+        case SSA_STM_MOVE:
+            lower(s->u.move.dest, valueOf(s->u.move.src));
+            return;
+        case SSA_STM_BOP:
+            lower(s->u.bop.dest, evalBop(valueOf(s->u.bop.left), s->u.bop.op, valueOf(s->u.bop.right)));
+            return;
+        case SSA_STM_UOP:
+            lower(s->u.uop.dest, evalUop(s->u.uop.op, valueOf(s->u.uop.src)));
+            return;
+        case SSA_STM_LOAD:
+            lower(s->u.load.dest, &bottom);
+            return;
+        case SSA_STM_NEW_CLASS:
+            lower(s->u.newClass.dest, &bottom);
+            return;
+        case SSA_STM_NEW_ARRAY:
+            lower(s->u.newArray.dest, &bottom);
+            return;
+        case SSA_STM_STORE:
+            return;
+        case SSA_STM_PHI:
+            visitPhi(s, b);
+            return;
+            // the handler of a "try" may execute from here on
+        case SSA_STM_TRY:
+            addEdge(b, s->u.try);
+            return;
+        case SSA_STM_TRY_END:
+            addEdge(b, s->u.tryEnd);
+            return;
+        default:
+            Error_impossible();
+            return;
+    }
+    Error_impossible();
+}
+
+static void visitTransfer(Ssa_Block_t b) {
+    Ssa_Transfer_t t = b->transfer;
+
+    switch (t->kind) {
+        case SSA_TRANS_IF: {
+            Ssa_Operand_t v = valueOf(t->u.iff.cond);
+
+            if (!v)
+                return;
+            if (v != &bottom && v->kind == SSA_OP_INT) {
+                addEdge(b, v->u.intlit ? t->u.iff.truee : t->u.iff.falsee);
+                return;
+            }
+            addEdge(b, t->u.iff.truee);
+            addEdge(b, t->u.iff.falsee);
+            return;
+        }
+        case SSA_TRANS_JUMP:
+            addEdge(b, t->u.jump);
+            return;
+        case SSA_TRANS_CALL:
+            if (t->u.call.dest)
+                lower(t->u.call.dest, &bottom);
+            if (t->u.call.leave)
+                addEdge(b, t->u.call.leave);
+            addEdge(b, t->u.call.normal);
+            return;
+        case SSA_TRANS_RETURN:
+        case SSA_TRANS_THROW:
+            return;
+        default:
+            Error_impossible();
+            return;
+    }
+    Error_impossible();
+}
+
+static void visitEdge(Tuple_t e) {
+    Ssa_Block_t b = Property_get(blockProp, Tuple_second(e));
+
+    // a handler which has been cut
+    if (!b)
+        return;
+    if (isExec(b)) {
+        // only the phis may see the new edge
+        for (List_t p = List_getFirst(b->stms); p; p = p->next) {
+            Ssa_Stm_t s = p->data;
+
+            if (s->kind == SSA_STM_PHI)
+                visitPhi(s, b);
+        }
+        return;
+    }
+    Property_set(execProp, b->label, (Poly_t) 1);
+    for (List_t p = List_getFirst(b->stms); p; p = p->next)
+        visitStm(p->data, b);
+    visitTransfer(b);
+}
+
+static void visitSite(Ssa_Site_t s) {
+    Ssa_Block_t b = Property_get(blockProp, s->block);
+
+    if (!isExec(b))
+        return;
+    if (s->stm)
+        visitStm(s->stm, b);
+    // among the transfers, only an "if" decides on a value
+    else if (b->transfer->kind == SSA_TRANS_IF)
+        visitTransfer(b);
+}
+
+// In SSA, a definition dominates its uses, so the condition
+// of an executable "if" has a value by now. Should one not
+// (say, a phi of nothing but itself), both ways are taken.
+static int takeUndecided(Ssa_Fun_t f) {
+    int changed = 0;
+
+    for (List_t p = List_getFirst(f->blocks); p; p = p->next) {
+        Ssa_Block_t b = p->data;
+        Ssa_Transfer_t t = b->transfer;
+
+        if (isExec(b) && t->kind == SSA_TRANS_IF && !valueOf(t->u.iff.cond)) {
+            lower(t->u.iff.cond->u.id, &bottom);
+            changed = 1;
+        }
+    }
+    return changed;
+}
+
+static void analyzeFun(Ssa_Fun_t f) {
+    flowWork = List_new();
+    ssaWork = List_new();
+    chains = Ssa_DefUse_ofFun(f);
+    mapBlocks(f);
+    addEdge(0, f->entry);
+    do {
+        while (!List_isEmpty(flowWork) || !List_isEmpty(ssaWork)) {
+            while (!List_isEmpty(flowWork))
+                visitEdge(List_removeHead(flowWork));
+            while (!List_isEmpty(ssaWork))
+                visitSite(List_removeHead(ssaWork));
+        }
+    } while (takeUndecided(f));
+    flowWork = 0;
+    ssaWork = 0;
+}
+
+////////////////////////////////////////////////////////
+// rewriting
+
+// zero for non-const.
+static Ssa_Operand_t constOf(Id_t id) {
+    Ssa_Operand_t v = Property_get(valueProp, id);
+
+    if (v == &bottom)
+        return 0;
+    return v;
+}
+
+static Ssa_Operand_t rewriteOperand(Ssa_Operand_t o) {
+    Ssa_Operand_t v;
+
+    if (o->kind != SSA_OP_ID)
+        return o;
+    v = constOf(o->u.id);
+    return v ? v : o;
+}
+
+// drop the arguments on edges which never execute
+static Ssa_Stm_t rewritePhi(Ssa_Stm_t s, Ssa_Block_t b) {
+    List_t args = List_new();
+
+    if (constOf(s->u.phi.dest))
+        return 0;
+    for (List_t p = List_getFirst(s->u.phi.args); p; p = p->next) {
+        Ssa_Stm_PhiArg_t arg = p->data;
+
+        if (edgeIsExec(arg->pred, b))
+            List_insertLast(args, Ssa_Stm_PhiArg_new(rewriteOperand(arg->arg), arg->pred));
+    }
+    if (List_size(args) == 1) {
+        Ssa_Stm_PhiArg_t arg = List_getFirst(args)->data;
+
+        Log_strs("phi with a single input: ", Id_toString(s->u.phi.dest), "\n", 0);
+        return Ssa_Stm_new_move(s->u.phi.dest, arg->arg);
+    }
+    return Ssa_Stm_new_phi(s->u.phi.dest, args);
+}
+
+static Ssa_Transfer_t rewriteTransfer(Ssa_Block_t b) {
+    Ssa_Transfer_t t = b->transfer;
+
+    if (t->kind == SSA_TRANS_IF) {
+        Ssa_Operand_t v = rewriteOperand(t->u.iff.cond);
+
+        if (v->kind == SSA_OP_INT) {
+            Log_strs("folded the branch of: ", Label_toString(b->label), "\n", 0);
+            return Ssa_Transfer_new_jump(v->u.intlit ? t->u.iff.truee : t->u.iff.falsee);
+        }
+    }
+    return Ssa_Transfer_renameUse2Op(t, constOf);
+}
+
+static Ssa_Block_t rewriteBlock(Ssa_Block_t b) {
+    List_t newStms = List_new();
+
+    for (List_t p = List_getFirst(b->stms); p; p = p->next) {
+        Ssa_Stm_t s = p->data, new;
+
+        // the definitions of constants are gone with their
+        // uses
+        if (s->kind == SSA_STM_PHI)
+            new = rewritePhi(s, b);
+        else
+            new = Ssa_Stm_renameUse2Op(s, constOf);
+        if (new)
+            List_insertLast(newStms, new);
+    }
+    return Ssa_Block_new(b->label, newStms, rewriteTransfer(b));
+}
+
+static Ssa_Fun_t rewriteFun(Ssa_Fun_t f) {
+    List_t newBlocks = List_new();
+
+    for (List_t p = List_getFirst(f->blocks); p; p = p->next) {
+        Ssa_Block_t b = p->data;
+
+        if (isExec(b))
+            List_insertLast(newBlocks, rewriteBlock(b));
+        else
+            Log_strs("deleted the dead block: ", Label_toString(b->label), "\n", 0);
+    }
+    return Ssa_Fun_new(f->type, f->name, f->args, f->decs, newBlocks, f->retId, f->entry, f->exitt);
+}
+
+////////////////////////////////////////////////
+// functions
+static Ssa_Fun_t transFunEach(Ssa_Fun_t f) {
+    assert(f);
+
+    analyzeFun(f);
+    f = rewriteFun(f);
+
+    Property_clear(valueProp);
+    Property_clear(blockProp);
+    Property_clear(execProp);
+    chains = 0;
+    return f;
+}
+
+////////////////////////////////////////////////
+// program
+static Ssa_Prog_t Ssa_sccpTraced(Ssa_Prog_t p) {
+    List_t newFuncs;
+
+    newFuncs = Thread_map(p->funcs, (Poly_tyId) transFunEach, init);
+    return Ssa_Prog_new(p->classes, newFuncs);
+}
+
+static void printArg(Ssa_Prog_t p) {
+    File_saveToFile("sccp.arg", (Poly_tyPrint) Ssa_Prog_print, p);
+}
+
+static void printResult(Ssa_Prog_t p) {
+    File_saveToFile("sccp.result", (Poly_tyPrint) Ssa_Prog_print, p);
+}
+
+Ssa_Prog_t Ssa_sccp(Ssa_Prog_t p) {
+    Ssa_Prog_t r;
+
+    Log_POS();
+
+    Trace_TRACE("Ssa_sccp", Ssa_sccpTraced, (p), printArg, r, printResult);
+    return r;
+}
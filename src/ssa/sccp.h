@@ -0,0 +1,13 @@
+#ifndef SSA_SCCP_H
+#define SSA_SCCP_H
+
+#include "ssa.h"
+
+// Sparse conditional constant propagation (Wegman and
+// Zadeck): constants are propagated only along the edges
+// that may execute, so an "if" on a known condition
+// becomes a jump, the blocks it cuts off are deleted, and a
+// phi with a single executable input becomes a move.
+Ssa_Prog_t Ssa_sccp(Ssa_Prog_t p);
+
+#endif
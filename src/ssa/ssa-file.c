@@ -0,0 +1,346 @@
+#include "ssa-file.h"
+#include "../lib/error.h"
+#include "../lib/mem.h"
+#include "../lib/tuple.h"
+#include <assert.h>
+
+#define B Ssa_Block_t
+#define F Ssa_Fun_t
+#define M Ssa_Mem_t
+#define O Ssa_Operand_t
+#define P Ssa_Prog_t
+#define S Ssa_Stm_t
+#define T Ssa_Transfer_t
+
+#define W IrFile_Out_t
+#define R IrFile_In_t
+
+typedef void (*tyPut)(W, Poly_t);
+typedef Poly_t (*tyGet)(R);
+
+///////////////////////////////////////////////////////
+// writer
+static void putOperand(W out, O o) {
+    IrFile_putNat(out, o->kind);
+    switch (o->kind) {
+        case SSA_OP_INT:
+            IrFile_putInt(out, o->u.intlit);
+            return;
+        case SSA_OP_STR:
+            IrFile_putString(out, o->u.strlit);
+            return;
+        case SSA_OP_ID:
+            IrFile_putId(out, o->u.id);
+            return;
+        default:
+            Error_impossible();
+    }
+}
+
+static void putMem(W out, M m) {
+    IrFile_putNat(out, m->kind);
+    switch (m->kind) {
+        case SSA_MEM_ARRAY:
+            IrFile_putId(out, m->u.array.name);
+            putOperand(out, m->u.array.index);
+            return;
+        case SSA_MEM_CLASS:
+            IrFile_putId(out, m->u.class.name);
+            IrFile_putId(out, m->u.class.field);
+            return;
+        default:
+            Error_impossible();
+    }
+}
+
+// the predecessor goes by its label
+static void putPhiArg(W out, Ssa_Stm_PhiArg_t a) {
+    putOperand(out, a->arg);
+    IrFile_putLabel(out, a->pred->label);
+}
+
+static void putStm(W out, S s) {
+    IrFile_putNat(out, s->kind);
+    switch (s->kind) {
+        case SSA_STM_MOVE:
+            IrFile_putId(out, s->u.move.dest);
+            putOperand(out, s->u.move.src);
+            return;
+        case SSA_STM_BOP:
+            IrFile_putId(out, s->u.bop.dest);
+            putOperand(out, s->u.bop.left);
+            IrFile_putNat(out, s->u.bop.op);
+            putOperand(out, s->u.bop.right);
+            return;
+        case SSA_STM_UOP:
+            IrFile_putId(out, s->u.uop.dest);
+            IrFile_putNat(out, s->u.uop.op);
+            putOperand(out, s->u.uop.src);
+            return;
+        case SSA_STM_STORE:
+            putMem(out, s->u.store.m);
+            putOperand(out, s->u.store.src);
+            return;
+        case SSA_STM_LOAD:
+            IrFile_putId(out, s->u.load.dest);
+            putMem(out, s->u.load.m);
+            return;
+        case SSA_STM_NEW_CLASS:
+            IrFile_putId(out, s->u.newClass.dest);
+            IrFile_putId(out, s->u.newClass.cname);
+            return;
+        case SSA_STM_NEW_ARRAY:
+            IrFile_putId(out, s->u.newArray.dest);
+            IrFile_putAtype(out, s->u.newArray.ty);
+            putOperand(out, s->u.newArray.size);
+            return;
+        case SSA_STM_TRY:
+            IrFile_putLabel(out, s->u.try);
+            return;
+        case SSA_STM_TRY_END:
+            IrFile_putLabel(out, s->u.tryEnd);
+            return;
+        case SSA_STM_PHI:
+            IrFile_putId(out, s->u.phi.dest);
+            IrFile_putList(out, s->u.phi.args, (tyPut) putPhiArg);
+            return;
+        default:
+            Error_impossible();
+    }
+}
+
+static void putTransfer(W out, T t) {
+    IrFile_putNat(out, t->kind);
+    switch (t->kind) {
+        case SSA_TRANS_IF:
+            putOperand(out, t->u.iff.cond);
+            IrFile_putLabel(out, t->u.iff.truee);
+            IrFile_putLabel(out, t->u.iff.falsee);
+            return;
+        case SSA_TRANS_JUMP:
+            IrFile_putLabel(out, t->u.jump);
+            return;
+        case SSA_TRANS_RETURN:
+            putOperand(out, t->u.ret);
+            return;
+        case SSA_TRANS_CALL:
+            IrFile_putId(out, t->u.call.dest);
+            IrFile_putId(out, t->u.call.name);
+            IrFile_putList(out, t->u.call.args, (tyPut) putOperand);
+            IrFile_putLabel(out, t->u.call.leave);
+            IrFile_putLabel(out, t->u.call.normal);
+            return;
+        case SSA_TRANS_THROW:
+            return;
+        default:
+            Error_impossible();
+    }
+}
+
+static void putBlock(W out, B b) {
+    IrFile_putLabel(out, b->label);
+    IrFile_putList(out, b->stms, (tyPut) putStm);
+    putTransfer(out, b->transfer);
+}
+
+static void putFun(W out, F f) {
+    IrFile_putAtype(out, f->type);
+    IrFile_putId(out, f->name);
+    IrFile_putList(out, f->args, (tyPut) IrFile_putDec);
+    IrFile_putList(out, f->decs, (tyPut) IrFile_putDec);
+    IrFile_putList(out, f->blocks, (tyPut) putBlock);
+    IrFile_putId(out, f->retId);
+    IrFile_putLabel(out, f->entry);
+    IrFile_putLabel(out, f->exitt);
+}
+
+void Ssa_Prog_write(String_t fname, P p) {
+    W out = IrFile_Out_new();
+
+    IrFile_putList(out, p->classes, (tyPut) IrFile_putClass);
+    IrFile_putList(out, p->funcs, (tyPut) putFun);
+    IrFile_save(out, fname, IR_FILE_SSA);
+}
+
+///////////////////////////////////////////////////////
+// reader
+
+// phi arguments of the function being read, whose
+// predecessors are yet to be found by their labels.
+// List<Tuple<Ssa_Stm_PhiArg_t, Label_t>>
+static List_t phiArgs = 0;
+
+static O getOperand(R in) {
+    switch (IrFile_getNat(in)) {
+        case SSA_OP_INT:
+            return Ssa_Operand_new_int(IrFile_getInt(in));
+        case SSA_OP_STR:
+            return Ssa_Operand_new_string(IrFile_getString(in));
+        case SSA_OP_ID:
+            return Ssa_Operand_new_id(IrFile_getId(in));
+        default:
+            Error_error("invalid IR file\n");
+    }
+    return 0;
+}
+
+static M getMem(R in) {
+    Id_t name;
+
+    switch (IrFile_getNat(in)) {
+        case SSA_MEM_ARRAY:
+            name = IrFile_getId(in);
+            return Ssa_Mem_new_array(name, getOperand(in));
+        case SSA_MEM_CLASS:
+            name = IrFile_getId(in);
+            return Ssa_Mem_new_class(name, IrFile_getId(in));
+        default:
+            Error_error("invalid IR file\n");
+    }
+    return 0;
+}
+
+static Ssa_Stm_PhiArg_t getPhiArg(R in) {
+    Ssa_Stm_PhiArg_t a = Ssa_Stm_PhiArg_new(getOperand(in), 0);
+
+    List_insertLast(phiArgs, Tuple_new(a, IrFile_getLabel(in)));
+    return a;
+}
+
+static S getStm(R in) {
+    Id_t dest;
+    O o;
+    Operator_t op;
+    M m;
+
+    switch (IrFile_getNat(in)) {
+        case SSA_STM_MOVE:
+            dest = IrFile_getId(in);
+            return Ssa_Stm_new_move(dest, getOperand(in));
+        case SSA_STM_BOP:
+            dest = IrFile_getId(in);
+            o = getOperand(in);
+            op = (Operator_t) IrFile_getNat(in);
+            return Ssa_Stm_new_bop(dest, o, op, getOperand(in));
+        case SSA_STM_UOP:
+            dest = IrFile_getId(in);
+            op = (Operator_t) IrFile_getNat(in);
+            return Ssa_Stm_new_uop(dest, op, getOperand(in));
+        case SSA_STM_STORE:
+            m = getMem(in);
+            return Ssa_Stm_new_store(m, getOperand(in));
+        case SSA_STM_LOAD:
+            dest = IrFile_getId(in);
+            return Ssa_Stm_new_load(dest, getMem(in));
+        case SSA_STM_NEW_CLASS:
+            dest = IrFile_getId(in);
+            return Ssa_Stm_new_newClass(dest, IrFile_getId(in));
+        case SSA_STM_NEW_ARRAY: {
+            Atype_t ty;
+
+            dest = IrFile_getId(in);
+            ty = IrFile_getAtype(in);
+            return Ssa_Stm_new_newArray(dest, ty, getOperand(in));
+        }
+        case SSA_STM_TRY:
+            return Ssa_Stm_new_try(IrFile_getLabel(in));
+        case SSA_STM_TRY_END:
+            return Ssa_Stm_new_try_end(IrFile_getLabel(in));
+        case SSA_STM_PHI: {
+            S s;
+
+            Mem_NEW(s);
+            s->kind = SSA_STM_PHI;
+            s->u.phi.dest = IrFile_getId(in);
+            s->u.phi.args = IrFile_getList(in, (tyGet) getPhiArg);
+            return s;
+        }
+        default:
+            Error_error("invalid IR file\n");
+    }
+    return 0;
+}
+
+static T getTransfer(R in) {
+    switch (IrFile_getNat(in)) {
+        case SSA_TRANS_IF: {
+            O cond = getOperand(in);
+            Label_t truee = IrFile_getLabel(in);
+
+            return Ssa_Transfer_new_if(cond, truee, IrFile_getLabel(in));
+        }
+        case SSA_TRANS_JUMP:
+            return Ssa_Transfer_new_jump(IrFile_getLabel(in));
+        case SSA_TRANS_RETURN:
+            return Ssa_Transfer_new_return(getOperand(in));
+        case SSA_TRANS_CALL: {
+            Id_t dest = IrFile_getId(in);
+            Id_t name = IrFile_getId(in);
+            List_t args = IrFile_getList(in, (tyGet) getOperand);
+            Label_t leave = IrFile_getLabel(in);
+
+            return Ssa_Transfer_new_call(dest, name, args, leave, IrFile_getLabel(in));
+        }
+        case SSA_TRANS_THROW:
+            return Ssa_Transfer_new_throw();
+        default:
+            Error_error("invalid IR file\n");
+    }
+    return 0;
+}
+
+static B getBlock(R in) {
+    Label_t label = IrFile_getLabel(in);
+    List_t stms = IrFile_getList(in, (tyGet) getStm);
+
+    return Ssa_Block_new(label, stms, getTransfer(in));
+}
+
+static F getFun(R in) {
+    Atype_t type = IrFile_getAtype(in);
+    Id_t name = IrFile_getId(in);
+    List_t args = IrFile_getList(in, (tyGet) IrFile_getDec);
+    List_t decs = IrFile_getList(in, (tyGet) IrFile_getDec);
+    List_t blocks, p;
+    Id_t retId;
+    Label_t entry;
+    F f;
+
+    phiArgs = List_new();
+    blocks = IrFile_getList(in, (tyGet) getBlock);
+    retId = IrFile_getId(in);
+    entry = IrFile_getLabel(in);
+    f = Ssa_Fun_new(type, name, args, decs, blocks, retId, entry, IrFile_getLabel(in));
+
+    p = List_getFirst(phiArgs);
+    while (p) {
+        Tuple_t t = p->data;
+        Ssa_Stm_PhiArg_t a = Tuple_first(t);
+
+        a->pred = Ssa_Fun_searchLabel(f, Tuple_second(t));
+        if (!a->pred)
+            Error_error("invalid IR file\n");
+        p = p->next;
+    }
+    phiArgs = 0;
+    return f;
+}
+
+P Ssa_Prog_read(R in) {
+    List_t classes, funcs;
+
+    assert(IrFile_stage(in) == IR_FILE_SSA);
+    classes = IrFile_getList(in, (tyGet) IrFile_getClass);
+    funcs = IrFile_getList(in, (tyGet) getFun);
+    return Ssa_Prog_new(classes, funcs);
+}
+
+#undef B
+#undef F
+#undef M
+#undef O
+#undef P
+#undef S
+#undef T
+#undef W
+#undef R
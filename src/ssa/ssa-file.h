@@ -0,0 +1,13 @@
+#ifndef SSA_FILE_H
+#define SSA_FILE_H
+
+#include "../atoms/ir-file.h"
+#include "ssa.h"
+
+// write "p" to "fname" in the binary IR format.
+void Ssa_Prog_write(String_t fname, Ssa_Prog_t p);
+
+// read the program from a file of the SSA stage.
+Ssa_Prog_t Ssa_Prog_read(IrFile_In_t in);
+
+#endif
@@ -1,10 +1,13 @@
 #include "../control/pass.h"
+#include "../lib/mem.h"
 #include "type-check.h"
 #include "dead-block.h"
 #include "trans-ssa.h"
 #include "trivial-block.h"
 #include "union-block.h"
 #include "construct-ssa.h"
+#include "gvn.h"
+#include "licm.h"
 #include "const-and-dead.h"
 #include "out-ssa.h"
 #include "ssa-main.h"
@@ -15,35 +18,45 @@ Machine_Prog_t Ssa_main(Ssa_Prog_t p) {
     , trivialBlock
     , unionBlock
     , makeSsa
+    , gvn
     , constAndDead
+    , licm
     , outSsa
     , trans;
     Machine_Prog_t q;
 
-    typeCheck = Pass_new("type-check", VERBOSE_SUBPASS, p, (Poly_tyId) Ssa_typeCheck);
+    typeCheck = Pass_newIr("type-check", VERBOSE_SUBPASS, p, (Poly_tyId) Ssa_typeCheck, (Pass_tySize) Ssa_Prog_size, (Pass_tySize) Ssa_Prog_size);
     p = Pass_doit(&typeCheck);
 
     // want to run this first for it simplifies
     // many later phases by cutting dead blocks
-    deadBlock = Pass_new("deadBlock", VERBOSE_SUBPASS, p, (Poly_tyId) Ssa_deadBlock);
+    deadBlock = Pass_newIr("deadBlock", VERBOSE_SUBPASS, p, (Poly_tyId) Ssa_deadBlock, (Pass_tySize) Ssa_Prog_size, (Pass_tySize) Ssa_Prog_size);
     p = Pass_doit(&deadBlock);
 
-    trivialBlock = Pass_new("trivialBlock", VERBOSE_SUBPASS, p, (Poly_tyId) Ssa_trivialBlock);
+    trivialBlock = Pass_newIr("trivialBlock", VERBOSE_SUBPASS, p, (Poly_tyId) Ssa_trivialBlock, (Pass_tySize) Ssa_Prog_size, (Pass_tySize) Ssa_Prog_size);
     p = Pass_doit(&trivialBlock);
 
-    unionBlock = Pass_new("unionBlock", VERBOSE_SUBPASS, p, (Poly_tyId) Ssa_unionBlock);
+    unionBlock = Pass_newIr("unionBlock", VERBOSE_SUBPASS, p, (Poly_tyId) Ssa_unionBlock, (Pass_tySize) Ssa_Prog_size, (Pass_tySize) Ssa_Prog_size);
     p = Pass_doit(&unionBlock);
 
-    makeSsa = Pass_new("consSsa", VERBOSE_SUBPASS, p, (Poly_tyId) Ssa_constructSsa);
+    makeSsa = Pass_newIr("consSsa", VERBOSE_SUBPASS, p, (Poly_tyId) Ssa_constructSsa, (Pass_tySize) Ssa_Prog_size, (Pass_tySize) Ssa_Prog_size);
     p = Pass_doit(&makeSsa);
 
-    constAndDead = Pass_new("constAndDead", VERBOSE_SUBPASS, p, (Poly_tyId) Ssa_constAndDead);
+    gvn = Pass_newIr("gvn", VERBOSE_SUBPASS, p, (Poly_tyId) Ssa_gvn, (Pass_tySize) Ssa_Prog_size, (Pass_tySize) Ssa_Prog_size);
+    p = Pass_doit(&gvn);
+
+    constAndDead = Pass_newIr("constAndDead", VERBOSE_SUBPASS, p, (Poly_tyId) Ssa_constAndDead, (Pass_tySize) Ssa_Prog_size, (Pass_tySize) Ssa_Prog_size);
     p = Pass_doit(&constAndDead);
 
-    outSsa = Pass_new("outSsa", VERBOSE_SUBPASS, p, (Poly_tyId) Ssa_outSsa);
+    licm = Pass_newIr("licm", VERBOSE_SUBPASS, p, (Poly_tyId) Ssa_licm, (Pass_tySize) Ssa_Prog_size, (Pass_tySize) Ssa_Prog_size);
+    p = Pass_doit(&licm);
+
+    outSsa = Pass_newIr("outSsa", VERBOSE_SUBPASS, p, (Poly_tyId) Ssa_outSsa, (Pass_tySize) Ssa_Prog_size, (Pass_tySize) Ssa_Prog_size);
     p = Pass_doit(&outSsa);
 
-    trans = Pass_new("consMachine", VERBOSE_SUBPASS, p, (Poly_tyId) Trans_ssa);
+    // the machine program outlives the SSA one
+    Mem_Arena_enter(MEM_ARENA_MACHINE);
+    trans = Pass_newIr("consMachine", VERBOSE_SUBPASS, p, (Poly_tyId) Trans_ssa, (Pass_tySize) Ssa_Prog_size, (Pass_tySize) Machine_Prog_size);
     q = Pass_doit(&trans);
 
     return q;
@@ -1,7 +1,9 @@
 #include "ssa.h"
 #include "../lib/hash-set.h"
+#include "../lib/hash.h"
 #include "../lib/int.h"
 #include "../lib/mem.h"
+#include "../lib/thread.h"
 #include "../lib/trace.h"
 #include "../lib/tuple.h"
 #include "../lib/unused.h"
@@ -17,21 +19,22 @@
 
 ///////////////////////////////////////////////////////
 static String_t dotname = "none";
-static int semi = 1;
+static Thread_local int semi = 1;
 
 
 ///////////////////////////////////////////////////////
-// to build a closure
+// to build a closure (per thread, as passes run on
+// many functions at once)
 struct GlobalUd_t {
     Id_t (*use)(Id_t);
 
     Id_t (*def)(Id_t);
 };
 
-struct GlobalUd_t gud = {0, 0};
+static Thread_local struct GlobalUd_t gud = {0, 0};
 
 /////////////////////////////////////////////////////
-static List_t globalSubstPhi = 0;
+static Thread_local List_t globalSubstPhi = 0;
 
 static Id_t newsubstPhiLookup(Ssa_Stm_PhiArg_t a) {
     List_t s = List_getFirst(globalSubstPhi);
@@ -136,7 +139,7 @@ static void Ssa_Operand_foreachUse(O o, void (*f)(Id_t)) {
     //    return;
 }
 
-static O (*globalf)(Id_t) = 0;
+static Thread_local O (*globalf)(Id_t) = 0;
 
 static O Ssa_Operand_renameUse2OpList(O o) {
     assert(o);
@@ -303,6 +306,22 @@ M Ssa_Mem_new_class(Id_t name, Id_t field) {
     return m;
 }
 
+int Ssa_Mem_mayAlias(M m1, M m2) {
+    assert(m1);
+    assert(m2);
+    if (m1->kind != m2->kind)
+        return 0;
+    switch (m1->kind) {
+        case SSA_MEM_ARRAY:
+            return 1;
+        case SSA_MEM_CLASS:
+            return Id_equals(m1->u.class.field, m2->u.class.field) != 0;
+        default:
+            Error_impossible();
+            return 0;
+    }
+}
+
 static M Ssa_Mem_renameUse(M m, Id_t (*use)(Id_t)) {
     assert(m);
     switch (m->kind) {
@@ -533,7 +552,7 @@ S Ssa_Stm_new_try_end(Label_t tryEnd) {
 }
 
 // args: List<Arg>
-static S Ssa_Stm_new_phi(Id_t dest, List_t args) {
+S Ssa_Stm_new_phi(Id_t dest, List_t args) {
     S s;
 
     Mem_NEW(s);
@@ -640,17 +659,8 @@ void Ssa_Stm_foreachUse(S s, void (*f)(Id_t)) {
 static S Ssa_Stm_renameUseDefNoPhiUse(S s) {
     assert(s);
     switch (s->kind) {
-        case SSA_STM_MOVE: {
-            S new;
-
-            printf("move starts\n");
-            new =
-                    Ssa_Stm_new_move(gud.def(s->u.move.dest), Ssa_Operand_renameUse(s->u.move.src, gud.use));
-            printf("the id is: %s\n", Id_toString(s->u.move.dest));
-
-            printf("move finished\n");
-            return new;
-        }
+        case SSA_STM_MOVE:
+            return Ssa_Stm_new_move(gud.def(s->u.move.dest), Ssa_Operand_renameUse(s->u.move.src, gud.use));
         case SSA_STM_BOP:
             return Ssa_Stm_new_bop(gud.def(s->u.bop.dest), Ssa_Operand_renameUse(s->u.bop.left, gud.use), s->u.bop.op,
                                    Ssa_Operand_renameUse(s->u.bop.right, gud.use));
@@ -766,7 +776,7 @@ static S Ssa_Stm_renamePhiArgs(S s) {
     return Ssa_Stm_new_phi(s->u.phi.dest, newArgs);
 }
 
-static void Ssa_Stm_foreachDef(S s, void (*f)(Id_t)) {
+void Ssa_Stm_foreachDef(S s, void (*f)(Id_t)) {
     assert(s);
     switch (s->kind) {
         case SSA_STM_MOVE:
@@ -1071,15 +1081,8 @@ static T Ssa_Transfer_renameUseDefNoPhiUse(T t) {
             return Ssa_Transfer_new_if(Ssa_Operand_renameUse(t->u.iff.cond, gud.use), t->u.iff.truee, t->u.iff.falsee);
         case SSA_TRANS_JUMP:
             return t;
-        case SSA_TRANS_RETURN: {
-            T new;
-            printf("return starting\n");
-
-            Ssa_Operand_print(stdout, t->u.ret);
-            new = Ssa_Transfer_new_return(Ssa_Operand_renameUse(t->u.ret, gud.use));
-            printf("return finished\n");
-            return new;
-        }
+        case SSA_TRANS_RETURN:
+            return Ssa_Transfer_new_return(Ssa_Operand_renameUse(t->u.ret, gud.use));
         case SSA_TRANS_THROW:
             return t;
         case SSA_TRANS_CALL: {
@@ -1102,7 +1105,7 @@ static T Ssa_Transfer_renameUseDefNoPhiUse(T t) {
     Error_impossible();
 }
 
-static void Ssa_Transfer_foreachUse(T t, void (*f)(Id_t)) {
+void Ssa_Transfer_foreachUse(T t, void (*f)(Id_t)) {
     assert(t);
     switch (t->kind) {
         case SSA_TRANS_IF:
@@ -1268,17 +1271,13 @@ B Ssa_Block_renameUseDefNoPhiUse(B b, Id_t (*use)(Id_t), Id_t (*def)(Id_t)) {
     gud.use = use;
     gud.def = def;
 
-    printf("to here?\n");
     newStms = List_map(b->stms, (Poly_tyId) Ssa_Stm_renameUseDefNoPhiUse);
     //newStms = b->stms;
     /* printf ("debug:\n"); */
     /* file = stdout; */
     /* List_foreach (newStms, Ssa_Stm_print); */
     // there are only uses in any transfers.
-    printf("2?\n");
-
     newTransfer = Ssa_Transfer_renameUseDefNoPhiUse(b->transfer);
-    printf("block returns\n");
     gud.use = 0;
     gud.def = 0;
     return Ssa_Block_new(b->label, newStms, newTransfer);
@@ -1343,9 +1342,9 @@ B Ssa_Block_renamePhiArgs(B b, List_t subst) {
 }
 
 
-Plist_t Ssa_Block_plist(B b) {
+long Ssa_Block_index(B b) {
     assert(b);
-    return (Label_plist(b->label));
+    return (Label_index(b->label));
 }
 
 static Set_t Ssa_Block_getDefIdsTraced(B b) {
@@ -1432,6 +1431,7 @@ F Ssa_Fun_new(Atype_t type, Id_t name, List_t args,
     f->retId = retId;
     f->entry = entry;
     f->exitt = exitt;
+    f->chains = 0;
     return f;
 }
 
@@ -1467,10 +1467,15 @@ void Ssa_Fun_toDot(F f, String_t name) {
 Graph_t Ssa_Fun_toGraph(F f) {
     Graph_t g;
     List_t blocks;
+    // Label_t -> B, as "Ssa_Fun_searchLabel" is a linear
+    // search; a hash, as a property would be as large as
+    // the program's labels
+    Hash_t labels;
 
     assert(f);
 
-    g = Graph_newWithName((Poly_tyEquals) Ssa_Block_equals, Id_toString(f->name));
+    g = Graph_newWithName((Poly_tyEquals) Ssa_Block_equals, (Poly_tyIndex) Ssa_Block_index, Id_toString(f->name));
+    labels = Hash_new((tyHashCode) Label_index, (Poly_tyEquals) Label_equals, 0);
 
     // insert all vertex
     blocks = List_getFirst(f->blocks);
@@ -1478,6 +1483,7 @@ Graph_t Ssa_Fun_toGraph(F f) {
         B b = (B) blocks->data;
 
         Graph_insertVertex(g, b);
+        Hash_insert(labels, b->label, b);
         blocks = blocks->next;
     }
 
@@ -1491,8 +1497,8 @@ Graph_t Ssa_Fun_toGraph(F f) {
             case SSA_TRANS_IF: {
                 B tb, fb;
 
-                tb = Ssa_Fun_searchLabel(f, trans->u.iff.truee);
-                fb = Ssa_Fun_searchLabel(f, trans->u.iff.falsee);
+                tb = Hash_lookup(labels, trans->u.iff.truee);
+                fb = Hash_lookup(labels, trans->u.iff.falsee);
                 if (tb)
                     Graph_insertEdge(g, b, tb);
                 if (fb)
@@ -1502,7 +1508,7 @@ Graph_t Ssa_Fun_toGraph(F f) {
             case SSA_TRANS_JUMP: {
                 B jmp;
 
-                jmp = Ssa_Fun_searchLabel(f, trans->u.jump);
+                jmp = Hash_lookup(labels, trans->u.jump);
                 if (jmp)
                     Graph_insertEdge(g, b, jmp);
                 break;
@@ -1514,8 +1520,9 @@ Graph_t Ssa_Fun_toGraph(F f) {
             case SSA_TRANS_CALL: {
                 B leaveB, normalB;
 
-                leaveB = Ssa_Fun_searchLabel(f, trans->u.call.leave);
-                normalB = Ssa_Fun_searchLabel(f, trans->u.call.normal);
+                // a call outside of any "try" leaves to nowhere
+                leaveB = (trans->u.call.leave) ? Hash_lookup(labels, trans->u.call.leave) : 0;
+                normalB = (trans->u.call.normal) ? Hash_lookup(labels, trans->u.call.normal) : 0;
                 if (leaveB)
                     Graph_insertEdge(g, b, leaveB);
                 if (normalB)
@@ -1588,6 +1595,22 @@ File_t Ssa_Prog_print(File_t file, P x) {
     return file;
 }
 
+void Ssa_Prog_size(P x, long *funcs, long *blocks, long *stms) {
+    List_t f, b;
+
+    assert(x);
+    *funcs = List_size(x->funcs);
+    *blocks = 0;
+    *stms = 0;
+    for (f = List_getFirst(x->funcs); f; f = f->next) {
+        F fun = f->data;
+
+        *blocks += List_size(fun->blocks);
+        for (b = List_getFirst(fun->blocks); b; b = b->next)
+            *stms += List_size(((B) b->data)->stms);
+    }
+}
+
 static String_t gfname = 0;
 
 static void progToDotEach(F f) {
@@ -70,6 +70,10 @@ struct M {
 
 M Ssa_Mem_new_array(Id_t, O);
 M Ssa_Mem_new_class(Id_t, Id_t);
+// whether a store to "m1" may change what a load from "m2"
+// reads: a store to an array element may write any array,
+// and one to a field that field of any object.
+int Ssa_Mem_mayAlias(M m1, M m2);
 File_t Ssa_Mem_print(File_t file, M m);
 
 ///////////////////////////////////////////////////////
@@ -180,6 +184,8 @@ S Ssa_Stm_new_newClass(Id_t, Id_t);
 S Ssa_Stm_new_newArray(Id_t, Atype_t, O size);
 S Ssa_Stm_new_try(Label_t label);
 S Ssa_Stm_new_try_end(Label_t label);
+// args: List<Ssa_Stm_PhiArg_t>
+S Ssa_Stm_new_phi(Id_t dest, List_t args);
 // preds: List<Block_t>, a list of predessors
 //S Ssa_Stm_new_phi_preds(Id_t, List_t preds);
 // for every use of "id" in s, apply "f" to "id", if the
@@ -189,6 +195,7 @@ int Ssa_Stm_PhiArg_isSameConst(List_t);
 S Ssa_Stm_new_phi_predsBlock(Id_t var, List_t preds);
 // including phi
 void Ssa_Stm_foreachUse(S, void (*f)(Id_t));
+void Ssa_Stm_foreachDef(S, void (*f)(Id_t));
 File_t Ssa_Stm_print(File_t file, S);
 
 ///////////////////////////////////////////////////////
@@ -244,6 +251,7 @@ T Ssa_Transfer_renameLabels_jump(T, Label_t l);
 T Ssa_Transfer_renameUse2Op(T, O (*f)(Id_t));
 Set_t Ssa_Transfer_getDefIds(T);
 void Ssa_Transfer_foreachDef(T, void (*f)(Id_t));
+void Ssa_Transfer_foreachUse(T, void (*f)(Id_t));
 File_t Ssa_Transfer_print(File_t file, T);
 
 ///////////////////////////////////////////////////////
@@ -273,8 +281,8 @@ void Ssa_Block_foreachDef(B b, void (*f)(Id_t));
 void Ssa_Block_foreachUse(B b, void (*f)(Id_t));
 // get all identifiers which are defined in the block "b"
 Set_t Ssa_Block_getDefIds(B b);
-// get the property list from label in this block
-Plist_t Ssa_Block_plist(B b);
+// the index of the label of this block
+long Ssa_Block_index(B b);
 int Ssa_Block_equals(B b1, B b2);
 //int Ssa_Block_numSuccs(B b);
 File_t Ssa_Block_print(File_t f, B);
@@ -294,6 +302,10 @@ struct F {
     Id_t retId;
     Label_t entry;
     Label_t exitt;
+    // the def-use chains, built on demand (see
+    // "def-use.h"), and not carried to a new function
+    // unless its pass keeps them up to date
+    struct Ssa_DefUse_t *chains;
 };
 
 F Ssa_Fun_new(Atype_t,
@@ -321,6 +333,8 @@ struct P {
 
 P Ssa_Prog_new(List_t classes, List_t funcs);
 File_t Ssa_Prog_print(File_t f, P x);
+// the numbers of functions, blocks and statements in "x"
+void Ssa_Prog_size(P x, long *funcs, long *blocks, long *stms);
 void Ssa_Prog_toDot(P x, String_t file_name);
 
 #undef B
@@ -1,11 +1,14 @@
 #include "trans-ssa.h"
 #include "../lib/error.h"
+#include "../lib/thread.h"
 #include "../lib/trace.h"
+#include "../lib/tuple.h"
 #include <assert.h>
 
-//
+// Functions are translated in parallel, each with the
+// strings it uses collected in its own list.
 /* List <Machine_Str_t> */
-static List_t strings = 0;
+static Thread_local List_t strings = 0;
 
 static Id_t genStr(String_t s) {
     Id_t id = Id_newNoName();
@@ -147,29 +150,46 @@ static Machine_Block_t Trans_blockEach(Ssa_Block_t b) {
 
 /////////////////////////////////////////////////////
 // functions
-static Machine_Fun_t Trans_funcEach(Ssa_Fun_t f) {
+// return <Machine_Fun_t, List<Machine_Str_t>>
+static Tuple_t Trans_funcEach(Ssa_Fun_t f) {
     List_t newBlocks;
+    Machine_Fun_t newf;
+    Id_t oldScope;
 
     assert(f);
+    strings = List_new();
+    oldScope = Id_enterScope(f->name);
     newBlocks = List_map(f->blocks,
                          (Poly_tyId) Trans_blockEach);
+    Id_enterScope(oldScope);
 
-    return Machine_Fun_new(f->type, f->name, f->args, f->decs, newBlocks, f->retId, f->entry, f->exitt, -1);
+    // copy the declaration lists, as the SSA arena will be
+    // released once the machine program has been built.
+    newf = Machine_Fun_new(f->type, f->name, List_copy(f->args), List_copy(f->decs), newBlocks, f->retId, f->entry,
+                           f->exitt, -1);
+    return Tuple_new(newf, getStrings());
 }
 
 //////////////////////////////////////////////////////
 // program
 static Machine_Prog_t Trans_ssaTraced(Ssa_Prog_t p) {
-    List_t funcs;
+    List_t results, funcs, allStrings;
 
     assert(p);
 
-    // clear string caches
-    strings = List_new();
+    results = Thread_map(p->funcs, (Poly_tyId) Trans_funcEach, 0);
 
-    funcs = List_map(p->funcs, (Poly_tyId) Trans_funcEach);
+    funcs = List_new();
+    allStrings = List_new();
+    results = List_getFirst(results);
+    while (results) {
+        Tuple_t t = (Tuple_t) results->data;
 
-    return Machine_Prog_new(getStrings(), List_new(), List_new(), p->classes, funcs);
+        List_insertLast(funcs, Tuple_first(t));
+        List_append(allStrings, Tuple_second(t));
+        results = results->next;
+    }
+    return Machine_Prog_new(allStrings, List_new(), List_new(), List_copy(p->classes), funcs);
 }
 
 static void outArg(Ssa_Prog_t p) {
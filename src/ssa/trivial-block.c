@@ -1,11 +1,16 @@
 #include "trivial-block.h"
 #include "../lib/error.h"
+#include "../lib/thread.h"
 #include "../lib/trace.h"
 #include "dead-block.h"
 #include <assert.h>
 
-// on <Label_t>
-static Property_t jumpto = 0;
+// on <Label_t>, per thread
+static Thread_local Property_t jumpto = 0;
+
+static void init(void) {
+    jumpto = Property_new((Poly_tyIndex) Label_index);
+}
 
 /////////////////////////////////////////////////////
 // analyze
@@ -79,6 +84,7 @@ static Ssa_Fun_t transFunEach(Ssa_Fun_t f) {
     newExitt = Property_get(jumpto, f->exitt);
     if (!newExitt)
         newExitt = f->exitt;
+    Property_clear(jumpto);
 
     return Ssa_Fun_new(f->type, f->name, f->args, f->decs, newBlocks, f->retId, f->entry, newExitt);
 }
@@ -91,14 +97,7 @@ static Ssa_Prog_t Ssa_trivialBlockTraced(Ssa_Prog_t p) {
 
     assert(p);
 
-    // init the property
-    jumpto = Property_new((Poly_tyPlist) Label_plist);
-
-    newFuncs = List_map(p->funcs, (Poly_tyId) transFunEach);
-
-    // clear property
-    Property_clear(jumpto);
-
+    newFuncs = Thread_map(p->funcs, (Poly_tyId) transFunEach, init);
     return Ssa_Prog_new(p->classes, newFuncs);
 }
 
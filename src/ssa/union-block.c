@@ -1,58 +1,77 @@
 #include "union-block.h"
 #include "../lib/error.h"
+#include "../lib/thread.h"
 #include "../lib/trace.h"
 #include <assert.h>
 
+// The state of this pass is per thread, as functions are
+// processed on many threads.
+
 // Label_t -> int
-static Property_t numPreds = 0;
+static Thread_local Property_t numPreds = 0;
 // Label_t -> {0|1}:
 // whether this label should be unioned in
-static Property_t victim = 0;
+static Thread_local Property_t victim = 0;
+
+static Thread_local Ssa_Fun_t fun = 0;
+static Thread_local Label_t funentry = 0;
+static Thread_local Label_t funexitt = 0;
+static Thread_local List_t globalBlocks = 0;
 
-static Ssa_Fun_t fun = 0;
-static Label_t funentry = 0;
-static Label_t funexitt = 0;
-static List_t globalBlocks = 0;
+static void init(void) {
+    numPreds = Property_new((Poly_tyIndex) Label_index);
+    victim = Property_new((Poly_tyIndex) Label_index);
+}
 
 static void emit(Ssa_Block_t b) {
     List_insertLast(globalBlocks, b);
 }
 
-static int unioned = 0;
+static Thread_local int unioned = 0;
 
 /////////////////////////////////////////////////////
 // analyze
 
+static void addPred(Label_t l) {
+    long n = (long) (Property_get(numPreds, l));
+
+    Property_set(numPreds, l, (Poly_t) ++n);
+}
+
+static void analyzeOneStm(Ssa_Stm_t s) {
+    // a handler is entered from its "try" (by "longjmp"),
+    // so it must keep its label
+    if (s->kind == SSA_STM_TRY)
+        addPred(s->u.try);
+}
+
 static void analyzeOneBlock(Ssa_Block_t b) {
     assert(b);
     assert(b->stms);
     assert(b->transfer);
 
+    List_foreach(b->stms, (Poly_tyVoid) analyzeOneStm);
     switch (b->transfer->kind) {
         case SSA_TRANS_IF: {
-            Label_t tt = b->transfer->u.iff.truee;
-            Label_t tf = b->transfer->u.iff.falsee;
-            long tn = (long) (Property_get(numPreds, tt));
-            long fn = (long) (Property_get(numPreds, tf));
-
-            Property_set(numPreds, tt, (Poly_t) ++tn);
-            Property_set(numPreds, tf, (Poly_t) ++fn);
+            addPred(b->transfer->u.iff.truee);
+            addPred(b->transfer->u.iff.falsee);
             return;
         }
         case SSA_TRANS_JUMP: {
-            Label_t l = b->transfer->u.jump;
-            long ln = (long) (Property_get(numPreds, l));
-
-            Property_set(numPreds, l, (Poly_t) ++ln);
+            addPred(b->transfer->u.jump);
             return;
         }
         case SSA_TRANS_RETURN: {
             return;
         }
         case SSA_TRANS_THROW:
-            //            return;
-        case SSA_TRANS_CALL:
             return;
+        case SSA_TRANS_CALL: {
+            if (b->transfer->u.call.leave)
+                addPred(b->transfer->u.call.leave);
+            addPred(b->transfer->u.call.normal);
+            return;
+        }
         default:
             Error_impossible();
             return;
@@ -84,9 +103,13 @@ static void markVictim(Ssa_Block_t b) {
         case SSA_TRANS_RETURN:
             //            return;
         case SSA_TRANS_THROW:
-            //            return;
-        case SSA_TRANS_CALL:
             return;
+        case SSA_TRANS_CALL: {
+            if (b->transfer->u.call.leave)
+                addPred(b->transfer->u.call.leave);
+            addPred(b->transfer->u.call.normal);
+            return;
+        }
         default:
             Error_impossible();
             return;
@@ -183,6 +206,9 @@ static Ssa_Fun_t transFunEach(Ssa_Fun_t f) {
         newBlocks = globalBlocks;
         globalBlocks = List_new();
     } while (unioned);
+    Property_clear(numPreds);
+    Property_clear(victim);
+    fun = 0;
 
     return Ssa_Fun_new(f->type, f->name, f->args, f->decs, newBlocks, f->retId, f->entry, funexitt);
 }
@@ -195,17 +221,7 @@ static Ssa_Prog_t Ssa_unionBlockTraced(Ssa_Prog_t p) {
 
     assert(p);
 
-    // init the property
-    numPreds = Property_new((Poly_tyPlist) Label_plist);
-    victim = Property_new((Poly_tyPlist) Label_plist);
-
-
-    newFuncs = List_map(p->funcs, (Poly_tyId) transFunEach);
-
-    // clear the property
-    Property_clear(numPreds);
-    Property_clear(victim);
-
+    newFuncs = Thread_map(p->funcs, (Poly_tyId) transFunEach, init);
     return Ssa_Prog_new(p->classes, newFuncs);
 }
 
@@ -15,7 +15,14 @@ static List_t getBeforeClear(void) {
 /* Match these patterns:
  *   1. store stack[i], r
  *      load  r, stack[i] (<==== eliminate)
+ *   2. store stack[i], r
+ *      load  r', stack[i] (<==== move r', r)
+ *   3. move  r', r
+ *      move  r, r' or r', r (<==== eliminate)
  * Must be careful to stay in basic block.
+ * The nodes of "stms" are relinked into "allStms" or
+ * spliced out, so "stms" (its count and tail included)
+ * is dead afterwards.
  */
 static void Trans_stms(List_t stms) {
     List_t first = List_getFirst(stms);
@@ -37,16 +44,27 @@ static void Trans_stms(List_t stms) {
                           loadSrc = s2->u.load.src;
             X86_Register_t storeSrc = s1->u.store.src,
                            loadDest = s2->u.load.dest;
-            if (X86_Register_equals(storeSrc, loadDest) && X86_Operand_sameStackSlot(storeDest,
-                                                                                     loadSrc)) {
+            if (X86_Operand_sameStackSlot(storeDest, loadSrc)) {
                 first = second->next;
                 emitNode(p);
+                if (!X86_Register_equals(storeSrc, loadDest))
+                    List_insertLast(allStms, X86_Stm_new_moverr(loadDest, storeSrc));
                 continue;
             }
             first = q;
             emitNode(p);
             continue;
         }
+        if (s1->kind == X86_STM_MOVERR && s2->kind == X86_STM_MOVERR
+            && ((X86_Register_equals(s1->u.moverr.dest, s2->u.moverr.src)
+                 && X86_Register_equals(s1->u.moverr.src, s2->u.moverr.dest))
+                || (X86_Register_equals(s1->u.moverr.dest, s2->u.moverr.dest)
+                    && X86_Register_equals(s1->u.moverr.src, s2->u.moverr.src)))) {
+            // "p" stays the first, to match again with the one
+            // after "second"
+            p->next = second->next;
+            continue;
+        }
         first = q;
         emitNode(p);
     }
@@ -57,14 +75,9 @@ static X86_Fun_t Trans_func(X86_Fun_t f) {
     allStms = List_new();
     Trans_stms(f->stms);
     stms = getBeforeClear();
-    return X86_Fun_new(f->type,
-                       f->name,
-                       f->args,
-                       f->decs,
-                       stms,
-                       f->retId,
-                       f->entry,
-                       f->exitt);
+    return X86_Fun_new(f->name,
+                       f->frameSize,
+                       stms);
 }
 
 
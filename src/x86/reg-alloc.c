@@ -0,0 +1,713 @@
+#include "reg-alloc.h"
+#include "../control/log.h"
+#include "../lib/error.h"
+#include "../lib/int.h"
+#include "../lib/mem.h"
+#include "../lib/property.h"
+#include "../lib/thread.h"
+#include "../lib/trace.h"
+#include "../lib/triple.h"
+#include "../lib/tuple.h"
+#include "../machine/liveness.h"
+#include "x86.h"
+#include <assert.h>
+
+// Linear scan (Poletto and Sarkar), over intervals with
+// holes (Wimmer and Mossenbock).
+//
+// The blocks are numbered in the order they are emitted,
+// and a statement (or a transfer) at "p" reads its operands
+// at "p" and writes its result at "p+1". The interval of a
+// variable is the sorted list of ranges where it is live:
+// it is split at the boundaries of the blocks it is dead
+// in, so two variables may share a register when their
+// ranges are disjoint.
+//
+// The intervals are taken in the order they start. Each
+// gets a register that no interval overlapping it has, or
+// else the one of the interval, holding a register, that
+// ends last. That interval is split at the boundaries of
+// the block the new one starts in: it keeps its register
+// before the block, is in its slot in the block, and what
+// is left of it after the block is taken again like a new
+// interval. When the new one ends last, it is split in the
+// same way instead. So a variable is in one place all
+// through a block, and the places of the variables live
+// on an edge whose ends differ are moved on the edge.
+//
+// %rbx and %r12-%r15 survive calls, but %r10 and %r11 do
+// not, so these only go to variables that are not live
+// across a call (including those into the runtime). The
+// other registers belong to the instruction selection.
+//
+// A handler is entered by "longjmp", which only restores
+// the registers "setjmp" saw, so the variables live into
+// a handler stay in their slots.
+
+static const X86_Register_t savedRegs[] = {X86_RBX, X86_R12, X86_R13, X86_R14, X86_R15};
+static const X86_Register_t scratchRegs[] = {X86_R10, X86_R11};
+
+#define NUM_SAVED ((int) (sizeof(savedRegs) / sizeof(savedRegs[0])))
+#define NUM_SCRATCH ((int) (sizeof(scratchRegs) / sizeof(scratchRegs[0])))
+
+// [from, to)
+typedef struct Range_t *Range_t;
+
+struct Range_t {
+    long from;
+    long to;
+    Range_t next;
+};
+
+typedef struct Interval_t *Interval_t;
+
+// the interval of a variable is a list of pieces, one
+// after another
+struct Interval_t {
+    Id_t id;
+    // sorted and disjoint
+    Range_t ranges;
+    long start;
+    long end;
+    // whether it is live across a call
+    int crossesCall;
+    // whether it is live into a handler
+    int pinned;
+    // 0 for none
+    X86_Register_t reg;
+    // the block from which on the variable is in "reg",
+    // until the next piece
+    long fromBlock;
+    Interval_t next;
+};
+
+// The state of this pass is per thread, as functions are
+// processed on many threads.
+
+// Id_t -> Interval_t
+static Thread_local Property_t intervalProp = 0;
+// Label_t -> long, the index of a block, plus 1
+static Thread_local Property_t blockIndexProp = 0;
+
+static void init(void) {
+    Machine_Liveness_init();
+    intervalProp = Property_new((Poly_tyIndex) Id_index);
+    blockIndexProp = Property_new((Poly_tyIndex) Label_index);
+}
+
+static Interval_t intervalOf(Id_t id) {
+    Interval_t iv = Property_get(intervalProp, id);
+
+    if (!iv)
+        Error_bug(String_concat("no interval for: ", Id_toString(id), 0));
+    return iv;
+}
+
+static void newInterval(Dec_t dec) {
+    Interval_t iv;
+
+    Mem_NEW(iv);
+    iv->id = dec->id;
+    iv->ranges = 0;
+    iv->crossesCall = 0;
+    iv->pinned = 0;
+    iv->reg = 0;
+    iv->fromBlock = 0;
+    iv->next = 0;
+    Property_set(intervalProp, dec->id, iv);
+}
+
+// ranges are added backwards, so a new one is before all
+// but the first, which it may overlap or touch
+static void addRange(Interval_t iv, long from, long to) {
+    Range_t r = iv->ranges;
+
+    if (r && r->from <= to) {
+        if (from < r->from)
+            r->from = from;
+        if (to > r->to)
+            r->to = to;
+        return;
+    }
+    Mem_NEW(r);
+    r->from = from;
+    r->to = to;
+    r->next = iv->ranges;
+    iv->ranges = r;
+}
+
+//////////////////////////////////////////////////////
+// building the intervals, block by block, backwards
+
+// the variables live at the current position
+static Thread_local Set_t live = 0;
+static Thread_local long blockFrom = 0;
+static Thread_local long blockTo = 0;
+static Thread_local long pos = 0;
+
+static void liveThrough(Id_t id) {
+    addRange(intervalOf(id), blockFrom, blockTo);
+    Set_insert(live, id);
+}
+
+static void useAt(Id_t id) {
+    addRange(intervalOf(id), blockFrom, pos + 1);
+    Set_insert(live, id);
+}
+
+// the value a "return" reads after the runtime drops the
+// handlers of its frame
+static void useAfterCall(Id_t id) {
+    addRange(intervalOf(id), blockFrom, pos + 2);
+    Set_insert(live, id);
+}
+
+static void defAt(Id_t id) {
+    Interval_t iv = intervalOf(id);
+
+    // a value nobody reads still needs a place
+    if (!Set_exists(live, id)) {
+        addRange(iv, pos + 1, pos + 2);
+        return;
+    }
+    iv->ranges->from = pos + 1;
+    Set_delete(live, id);
+}
+
+static void pin(Id_t id) {
+    intervalOf(id)->pinned = 1;
+}
+
+static int isCall(Machine_Stm_t s) {
+    switch (s->kind) {
+        case MACHINE_STM_TRY:
+        case MACHINE_STM_TRY_END:
+        case MACHINE_STM_RUNTIME_CLASS:
+        case MACHINE_STM_RUNTIME_ARRAY:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+static long blockSize(Machine_Block_t b) {
+    return 2 * (List_size(b->stms) + 1);
+}
+
+// the intervals of the variables of "f", from the
+// liveness of its blocks; "callAt[p]" is whether there is
+// a call at "p"
+static void buildIntervals(Machine_Fun_t f, Set_Universe_t u, char *callAt, int hasTry) {
+    Machine_Block_t *blocks;
+    long num = List_size(f->blocks), i = 0, from = 0;
+
+    Mem_NEW_SIZE(blocks, num + 1);
+    for (List_t p = List_getFirst(f->blocks); p; p = p->next)
+        blocks[i++] = p->data;
+    for (i = 0; i < num; i++)
+        from += blockSize(blocks[i]);
+
+    for (i = num - 1; i >= 0; i--) {
+        Machine_Block_t b = blocks[i];
+        Machine_Transfer_t t = b->transfer;
+        Machine_Stm_t *stms;
+        long n = List_size(b->stms), k = 0;
+
+        blockTo = from;
+        from -= blockSize(b);
+        blockFrom = from;
+        live = Set_newBits(u);
+        Set_foreach(Machine_Liveness_out(b->label), (Poly_tyVoid) liveThrough);
+
+        pos = blockTo - 2;
+        Machine_Transfer_foreachDef(t, defAt);
+        if (t->kind == MACHINE_TRANS_RETURN && hasTry) {
+            Machine_Transfer_foreachUse(t, useAfterCall);
+            callAt[pos] = 1;
+        } else
+            Machine_Transfer_foreachUse(t, useAt);
+        if (t->kind == MACHINE_TRANS_CALL || t->kind == MACHINE_TRANS_CALL_NOASSIGN ||
+            t->kind == MACHINE_TRANS_THROW)
+            callAt[pos] = 1;
+
+        Mem_NEW_SIZE(stms, n + 1);
+        for (List_t p = List_getFirst(b->stms); p; p = p->next)
+            stms[k++] = p->data;
+        for (k = n - 1; k >= 0; k--) {
+            pos -= 2;
+            Machine_Stm_foreachDef(stms[k], defAt);
+            Machine_Stm_foreachUse(stms[k], useAt);
+            if (isCall(stms[k]))
+                callAt[pos] = 1;
+            if (stms[k]->kind == MACHINE_STM_TRY)
+                Set_foreach(Machine_Liveness_in(stms[k]->u.try), (Poly_tyVoid) pin);
+        }
+        assert(pos == blockFrom);
+        live = 0;
+    }
+}
+
+// the number of calls before each position
+static Thread_local long *calls = 0;
+// where each block starts, and the end of the last
+static Thread_local long *blockStart = 0;
+static Thread_local long numBlocks = 0;
+
+// whether "iv" is live both before and after a call
+static int crossesCall(Interval_t iv) {
+    for (Range_t r = iv->ranges; r; r = r->next)
+        if (r->to - 1 > r->from && calls[r->to - 1] > calls[r->from])
+            return 1;
+    return 0;
+}
+
+// "start", "end" and "crossesCall" of "iv", from its
+// ranges
+static void setBounds(Interval_t iv) {
+    Range_t r;
+
+    iv->start = iv->ranges->from;
+    for (r = iv->ranges; r->next; r = r->next)
+        ;
+    iv->end = r->to;
+    iv->crossesCall = crossesCall(iv);
+}
+
+// the index of the block "p" is in
+static long blockOf(long p) {
+    long lo = 0, hi = numBlocks - 1;
+
+    while (lo < hi) {
+        long mid = (lo + hi + 1) / 2;
+
+        if (blockStart[mid] <= p)
+            lo = mid;
+        else
+            hi = mid - 1;
+    }
+    return lo;
+}
+
+// cut the ranges of "iv" from "p" on off into a piece of
+// their own, next to "iv", which starts at block "k"; 0
+// if "iv" is dead from "p" on. "iv" is live before "p".
+static Interval_t splitOff(Interval_t iv, long p, long k) {
+    Range_t *link = &iv->ranges;
+    Interval_t rest;
+
+    assert(iv->start < p);
+    while (*link && (*link)->to <= p)
+        link = &(*link)->next;
+    if (!*link)
+        return 0;
+    if ((*link)->from < p) {
+        Range_t r;
+
+        Mem_NEW(r);
+        r->from = p;
+        r->to = (*link)->to;
+        r->next = (*link)->next;
+        (*link)->to = p;
+        (*link)->next = r;
+        link = &(*link)->next;
+    }
+    Mem_NEW(rest);
+    rest->id = iv->id;
+    rest->ranges = *link;
+    rest->pinned = 0;
+    rest->reg = 0;
+    rest->fromBlock = k;
+    rest->next = iv->next;
+    iv->next = rest;
+    *link = 0;
+    setBounds(iv);
+    setBounds(rest);
+    return rest;
+}
+
+// where the variable, whose first piece is "iv", is in
+// block "k"
+static long placeAt(Interval_t iv, long k) {
+    long r = 0;
+
+    for (; iv && iv->fromBlock <= k; iv = iv->next)
+        r = iv->reg;
+    return r;
+}
+
+//////////////////////////////////////////////////////
+// the scan
+static int covers(Interval_t iv, long p) {
+    for (Range_t r = iv->ranges; r && r->from <= p; r = r->next)
+        if (p < r->to)
+            return 1;
+    return 0;
+}
+
+static int intersects(Interval_t x, Interval_t y) {
+    Range_t a = x->ranges, b = y->ranges;
+
+    while (a && b) {
+        if (a->to <= b->from)
+            a = a->next;
+        else if (b->to <= a->from)
+            b = b->next;
+        else
+            return 1;
+    }
+    return 0;
+}
+
+static int compareStart(const void *x, const void *y) {
+    Interval_t a = *(Interval_t const *) x, b = *(Interval_t const *) y;
+
+    if (a->start != b->start)
+        return (a->start < b->start) ? -1 : 1;
+    return (Id_index(a->id) < Id_index(b->id)) ? -1 : 1;
+}
+
+// the intervals not taken yet, a heap by "compareStart";
+// it has one piece of a variable at most
+static Thread_local Interval_t *unhandled = 0;
+static Thread_local long numUnhandled = 0;
+
+static void push(Interval_t iv) {
+    long i = numUnhandled++;
+
+    while (i > 0 && compareStart(&iv, &unhandled[(i - 1) / 2]) < 0) {
+        unhandled[i] = unhandled[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    unhandled[i] = iv;
+}
+
+static Interval_t pop(void) {
+    Interval_t top = unhandled[0], last = unhandled[--numUnhandled];
+    long i = 0, c;
+
+    while ((c = 2 * i + 1) < numUnhandled) {
+        if (c + 1 < numUnhandled && compareStart(&unhandled[c + 1], &unhandled[c]) < 0)
+            c++;
+        if (compareStart(&unhandled[c], &last) >= 0)
+            break;
+        unhandled[i] = unhandled[c];
+        i = c;
+    }
+    unhandled[i] = last;
+    return top;
+}
+
+// the intervals holding a register, which do, and do not,
+// cover the current position
+static Thread_local Interval_t *active = 0;
+static Thread_local long numActive = 0;
+static Thread_local Interval_t *inactive = 0;
+static Thread_local long numInactive = 0;
+// those moving from "inactive" to "active"
+static Thread_local Interval_t *moved = 0;
+
+// whether "r" is held by an interval overlapping "cur"
+static int isTaken(X86_Register_t r, Interval_t cur) {
+    for (long i = 0; i < numActive; i++)
+        if (active[i]->reg == r)
+            return 1;
+    for (long i = 0; i < numInactive; i++)
+        if (inactive[i]->reg == r && intersects(inactive[i], cur))
+            return 1;
+    return 0;
+}
+
+static X86_Register_t freeReg(Interval_t cur) {
+    // keep the saved registers for the values that need
+    // them
+    if (!cur->crossesCall)
+        for (int i = 0; i < NUM_SCRATCH; i++)
+            if (!isTaken(scratchRegs[i], cur))
+                return scratchRegs[i];
+    for (int i = 0; i < NUM_SAVED; i++)
+        if (!isTaken(savedRegs[i], cur))
+            return savedRegs[i];
+    return 0;
+}
+
+// move the intervals that are over, or that enter or leave
+// a hole, at "p"
+static void advance(long p) {
+    long n = 0, m = 0;
+
+    for (long i = 0; i < numInactive; i++) {
+        Interval_t iv = inactive[i];
+
+        if (iv->end <= p)
+            continue;
+        if (covers(iv, p))
+            moved[m++] = iv;
+        else
+            inactive[n++] = iv;
+    }
+    numInactive = n;
+    n = 0;
+    for (long i = 0; i < numActive; i++) {
+        Interval_t iv = active[i];
+
+        if (iv->end <= p)
+            continue;
+        if (covers(iv, p))
+            active[n++] = iv;
+        else
+            inactive[numInactive++] = iv;
+    }
+    numActive = n;
+    for (long i = 0; i < m; i++)
+        active[numActive++] = moved[i];
+}
+
+static void scan(Interval_t *all, long num) {
+    Mem_NEW_SIZE(unhandled, num + 1);
+    Mem_NEW_SIZE(active, num + 1);
+    Mem_NEW_SIZE(inactive, num + 1);
+    Mem_NEW_SIZE(moved, num + 1);
+    numUnhandled = 0;
+    numActive = 0;
+    numInactive = 0;
+    for (long i = 0; i < num; i++)
+        push(all[i]);
+
+    while (numUnhandled > 0) {
+        Interval_t cur = pop();
+        Interval_t victim = 0, spilled, rest;
+        long v = 0, k;
+
+        advance(cur->start);
+        cur->reg = freeReg(cur);
+        if (cur->reg) {
+            active[numActive++] = cur;
+            continue;
+        }
+        // split the interval that ends last, which may be
+        // "cur" itself
+        for (long j = 0; j < numActive; j++) {
+            Interval_t iv = active[j];
+            int blocked = 0;
+
+            if (iv->end <= cur->end || (victim && iv->end <= victim->end))
+                continue;
+            if (cur->crossesCall && !X86_Register_isCalleeSaved(iv->reg))
+                continue;
+            for (long k = 0; k < numInactive; k++)
+                if (inactive[k]->reg == iv->reg && intersects(inactive[k], cur))
+                    blocked = 1;
+            if (blocked)
+                continue;
+            victim = iv;
+            v = j;
+        }
+        k = blockOf(cur->start);
+        if (!victim)
+            spilled = cur;
+        else {
+            cur->reg = victim->reg;
+            active[v] = cur;
+            if (victim->start < blockStart[k])
+                spilled = splitOff(victim, blockStart[k], k);
+            else {
+                victim->reg = 0;
+                spilled = victim;
+            }
+        }
+        // in the slot in block "k", and taken again after it
+        rest = splitOff(spilled, blockStart[k + 1], k + 1);
+        if (rest)
+            push(rest);
+    }
+    unhandled = 0;
+    active = 0;
+    inactive = 0;
+    moved = 0;
+}
+
+//////////////////////////////////////////////////////
+// the moves on the edges
+
+static Thread_local long edgeFrom = 0;
+static Thread_local long edgeTo = 0;
+// List<Triple<Id_t, long, long>>
+static Thread_local List_t edgeMoves = 0;
+
+static void moveOn(Id_t id) {
+    Interval_t iv = intervalOf(id);
+    long from, to;
+
+    if (!iv->next)
+        return;
+    from = placeAt(iv, edgeFrom);
+    to = placeAt(iv, edgeTo);
+    if (from != to)
+        List_insertLast(edgeMoves, Triple_new(id, (Poly_t) from, (Poly_t) to));
+}
+
+// the moves on the edge from the block "k" to "to", into
+// "moves"
+static void movesOn(List_t moves, Machine_Block_t b, long k, Label_t to) {
+    edgeFrom = k;
+    edgeTo = (long) Property_get(blockIndexProp, to) - 1;
+    assert(edgeTo >= 0);
+    edgeMoves = List_new();
+    Set_foreach(Machine_Liveness_in(to), (Poly_tyVoid) moveOn);
+    if (!List_isEmpty(edgeMoves))
+        List_insertLast(moves, Triple_new(b->label, to, edgeMoves));
+    edgeMoves = 0;
+}
+
+// A handler is not an edge here, as the variables live
+// into it are in their slots everywhere.
+static List_t genMoves(Machine_Fun_t f) {
+    List_t moves = List_new();
+    long k = 0;
+
+    for (List_t p = List_getFirst(f->blocks); p; p = p->next, k++) {
+        Machine_Block_t b = p->data;
+        Machine_Transfer_t t = b->transfer;
+
+        switch (t->kind) {
+            case MACHINE_TRANS_IF:
+                movesOn(moves, b, k, t->u.iff.truee);
+                movesOn(moves, b, k, t->u.iff.falsee);
+                break;
+            case MACHINE_TRANS_JUMP:
+                movesOn(moves, b, k, t->u.jump);
+                break;
+            case MACHINE_TRANS_CALL:
+            case MACHINE_TRANS_CALL_NOASSIGN:
+                movesOn(moves, b, k, t->u.call.normal);
+                break;
+            default:
+                break;
+        }
+    }
+    return moves;
+}
+
+//////////////////////////////////////////////////////
+// functions
+static Tuple_t allocFun(Machine_Fun_t f) {
+    Set_Universe_t u;
+    Interval_t *all;
+    char *callAt;
+    long size = 0, num = 0, numVars = 0, numPinned = 0, numInRegs = 0, numSplit = 0, numSpilled = 0;
+    int hasTry = 0;
+    List_t regs = List_new();
+
+    assert(f);
+    Property_clear(intervalProp);
+    Property_clear(blockIndexProp);
+    u = Machine_liveness(f);
+    List_foreach(f->args, (Poly_tyVoid) newInterval);
+    List_foreach(f->decs, (Poly_tyVoid) newInterval);
+
+    numBlocks = List_size(f->blocks);
+    Mem_NEW_SIZE(blockStart, numBlocks + 1);
+    for (List_t p = List_getFirst(f->blocks); p; p = p->next) {
+        Machine_Block_t b = p->data;
+
+        Property_set(blockIndexProp, b->label, (Poly_t) (num + 1));
+        blockStart[num++] = size;
+        size += blockSize(b);
+        for (List_t s = List_getFirst(b->stms); s; s = s->next)
+            if (((Machine_Stm_t) s->data)->kind == MACHINE_STM_TRY)
+                hasTry = 1;
+    }
+    blockStart[num] = size;
+    num = 0;
+    Mem_NEW_SIZE(callAt, size + 1);
+    Mem_NEW_SIZE(calls, size + 1);
+    buildIntervals(f, u, callAt, hasTry);
+    for (long p = 0; p < size; p++)
+        calls[p + 1] = calls[p] + callAt[p];
+
+    Mem_NEW_SIZE(all, List_size(f->args) + List_size(f->decs) + 1);
+    for (List_t p = List_getFirst(List_concat(f->args, f->decs)); p; p = p->next) {
+        Interval_t iv = intervalOf(((Dec_t) p->data)->id);
+
+        // never used
+        if (!iv->ranges)
+            continue;
+        numVars++;
+        if (iv->pinned) {
+            numPinned++;
+            continue;
+        }
+        setBounds(iv);
+        all[num++] = iv;
+    }
+    scan(all, num);
+
+    for (long i = 0; i < num; i++) {
+        List_t steps = List_new();
+        int inReg = 0, inSlot = 0;
+        long at = -1;
+
+        for (Interval_t iv = all[i]; iv; iv = iv->next) {
+            if (iv->reg)
+                inReg = 1;
+            else
+                inSlot = 1;
+            if ((long) iv->reg == at)
+                continue;
+            at = (long) iv->reg;
+            List_insertLast(steps, Triple_new(all[i]->id, (Poly_t) iv->fromBlock, (Poly_t) at));
+        }
+        if (!inReg) {
+            numSpilled++;
+            continue;
+        }
+        if (inSlot)
+            numSplit++;
+        else
+            numInRegs++;
+        List_append(regs, steps);
+    }
+    Log_strs(Id_toString(f->name), ": ",
+             Int_toString(numVars), " variables, ",
+             Int_toString(numInRegs), " in registers, ",
+             Int_toString(numSplit), " split, ",
+             Int_toString(numSpilled), " spilled, ",
+             Int_toString(numPinned), " kept for handlers\n", 0);
+    calls = 0;
+    blockStart = 0;
+    return Tuple_new(regs, genMoves(f));
+}
+
+static Machine_Prog_t X86_regAllocTraced(Machine_Prog_t p) {
+    List_t allRegs, frames = List_new();
+
+    assert(p);
+    allRegs = Thread_map(p->funcs, (Poly_tyId) allocFun, init);
+    // the frames are in the order of the functions
+    for (List_t i = List_getFirst(p->frameInfo), r = List_getFirst(allRegs); i; i = i->next, r = r->next) {
+        Machine_FrameInfo_t frame = i->data;
+
+        List_insertLast(frames, Machine_FrameInfo_new(frame->frameOffsets, frame->frameOffsetsDec, frame->size,
+                                                      Tuple_first(r->data), Tuple_second(r->data)));
+    }
+    return Machine_Prog_new(p->strings, frames, p->layoutInfo, p->classes, p->funcs);
+}
+
+static void printArg(Machine_Prog_t p) {
+    File_t file = File_open("regAlloc.arg", "w+");
+    Machine_Prog_print(file, p);
+    File_close(file);
+}
+
+static void printResult(Machine_Prog_t p) {
+    File_t file = File_open("regAlloc.result", "w+");
+    Machine_Prog_print(file, p);
+    File_close(file);
+}
+
+Machine_Prog_t X86_regAlloc(Machine_Prog_t p) {
+    Machine_Prog_t r;
+
+    Trace_TRACE("regAlloc", X86_regAllocTraced, (p), printArg, r, printResult);
+    return r;
+}
@@ -0,0 +1,13 @@
+#ifndef X86_REG_ALLOC_H
+#define X86_REG_ALLOC_H
+
+#include "../machine/machine.h"
+
+// Linear-scan register allocation, for each function:
+// the variables that get a register are put into the
+// "regs" of its frame, and the others stay in their slots.
+// Logging this pass reports, for each function, how many
+// variables are spilled.
+Machine_Prog_t X86_regAlloc(Machine_Prog_t p);
+
+#endif
@@ -1,552 +1,671 @@
 #include "x86-codegen.h"
+#include "../control/control.h"
+#include "../lib/error.h"
+#include "../lib/property.h"
 #include "../lib/trace.h"
+#include "../lib/triple.h"
+#include "../lib/tuple.h"
 #include "../lib/unused.h"
 #include <assert.h>
 
-//static List_t allStms = 0;
-
-//static void emit(X86_Stm_t s) {
-//    List_insertLast(allStms, s);
-//    return;
-//}
-
-#if 0
-static List_t getBeforeClearStms ()
-{
-  List_t t = allStms;
-  allStms = 0;
-  return t;
-}
-
-typedef enum{
-  POS_INT,
-  POS_GLOBAL,
-  POS_STACK,
-  POS_MEM
-} Pos_t;
-
-typedef struct
-{
-  Pos_t pos;
-  X86_Operand_t op;
-} Operand_Result_t;
-
-/* may occupy register ecx, edx.
- * Invariant: ecx: base, edx: offset
- * final: ecx is occupied.
- */
-static X86_Operand_t Trans_operand (Machine_Operand_t o)
-{
-  assert(o);
-  switch (o->kind){
-  case MACHINE_OP_INT:
-    return X86_Operand_new_int (o->u.intlit);
-  case MACHINE_OP_GLOBAL:
-    return X86_Operand_new_global (o->u.global);
-  case MACHINE_OP_INSTACK:{
-    if (o->u.index>0)
-      return X86_Operand_new_inStack (-4*(o->u.index));
-    else if (o->u.index<0){
-      return X86_Operand_new_inStack (-4*(o->u.index-1));
+// Instruction selection for x86-64, under the System V
+// calling convention. Every argument and declaration of a
+// function has a slot of its own in the frame (see
+// "genFrame"), or a register (see "regAlloc") in some
+// blocks, and each statement is done in %rax, %rcx and
+// %rdx, loading its operands and storing its result back.
+// A variable that is in different places at the two ends
+// of an edge moves at the end of the block, or in a block
+// of its own after the function for an "if".
+//
+// A frame is:
+//     16(%rbp)   arguments after the 6th, from the caller
+//      8(%rbp)   return address
+//      0(%rbp)   old %rbp
+//     -8(%rbp)   the slots, arguments first
+//        ...
+//                the callee-saved registers it uses
+// It is 16-byte aligned, so that %rsp is at each call.
+//
+// Objects and arrays come from the runtime, and their
+// fields and elements are words, from offset 0. For a
+// "try", the runtime gives a "jmp_buf", which is "setjmp"
+// here and "longjmp"-ed to by "Dragon_Exn_throw"; the
+// values a handler reads are in the frame, so nothing is
+// lost by it.
+
+static List_t allStms = 0;
+
+static void emit(X86_Stm_t s) {
+    List_insertLast(allStms, s);
+}
+
+static List_t getBeforeClearStms(void) {
+    List_t t = allStms;
+    allStms = 0;
+    return t;
+}
+
+// Id_t -> long, the slot of a variable, from %rbp
+static Property_t slotProp = 0;
+// Id_t -> List<Tuple<long, X86_Register_t>>, for
+// variables in registers: the index of the block from
+// which on a variable is in a register (0 for its slot)
+static Property_t regProp = 0;
+// Label_t -> List<Tuple<Label_t, List_t>>, the moves on
+// the edges from a block (see "Machine_FrameInfo_t")
+static Property_t moveProp = 0;
+// List<Triple<Label_t, Label_t, List_t>>, the blocks for
+// the moves on the edges of "if"s: the label, where to
+// go, and the moves
+static List_t edgeBlocks = 0;
+// the callee-saved registers the function uses, and where
+// it keeps them for its caller
+static X86_Register_t savedRegs[X86_R15 + 1];
+static long savedSlots[X86_R15 + 1];
+static int numSaved = 0;
+
+// whether the function being translated has a "try"
+static int hasTry = 0;
+
+// the current block, and its index
+static Label_t curLabel = 0;
+static long curBlock = 0;
+// the label of the block after the current one, to fall
+// through to
+static Label_t nextLabel = 0;
+
+static Id_t exnPush = 0;
+static Id_t exnPop = 0;
+static Id_t exnLeave = 0;
+static Id_t exnThrow = 0;
+static Id_t setJmp = 0;
+
+static X86_Operand_t slotOf(Id_t id) {
+    long offset = (long) Property_get(slotProp, id);
+
+    if (!offset)
+        Error_bug(String_concat("no slot for: ", Id_toString(id), 0));
+    return X86_Operand_new_inStack(offset);
+}
+
+// the register of "id" in the current block, or 0
+static X86_Register_t regOf(Id_t id) {
+    List_t steps = Property_get(regProp, id);
+    long r = 0;
+
+    if (!steps)
+        return 0;
+    for (List_t p = List_getFirst(steps); p && (long) Tuple_first(p->data) <= curBlock; p = p->next)
+        r = (long) Tuple_second(p->data);
+    return (X86_Register_t) r;
+}
+
+// where the variable "id" is
+static X86_Operand_t Trans_id(Id_t id) {
+    X86_Register_t r = regOf(id);
+
+    if (r)
+        return X86_Operand_new_reg(r);
+    return slotOf(id);
+}
+
+static X86_Operand_t Trans_operand(Machine_Operand_t o) {
+    assert(o);
+    switch (o->kind) {
+        case MACHINE_OP_INT:
+            return X86_Operand_new_int(o->u.int_lit);
+        case MACHINE_OP_GLOBAL:
+            return X86_Operand_new_global(o->u.id);
+        case MACHINE_OP_ID:
+            return Trans_id(o->u.id);
+        default:
+            Error_impossible();
+            return 0;
     }
-    Error_impossible ();
-    return 0;
-  }
-  case MACHINE_OP_VAR:
-    Error_impossible ();
+    Error_impossible();
     return 0;
-  case MACHINE_OP_STRUCT:{
-    emit (X86_Stm_new_moveri
-          (X86_EDX,
-           o->u.structt.scale 
-           * o->u.structt.index));
-    if (o->u.structt.base>0)
-      emit (X86_Stm_new_load (X86_ECX,
-                              X86_Operand_new_inStack
-                              ((-4)*o->u.structt.base)));
-    else if (o->u.structt.base<0)
-      emit (X86_Stm_new_load (X86_ECX,
-                              X86_Operand_new_inStack
-                              ((-4)*(o->u.structt.base-1))));
-    else Error_impossible ();
-      
-    emit (X86_Stm_new_bop (X86_ECX,
-                           OP_ADD,
-                           X86_EDX));
-    return X86_Operand_new_mem (X86_ECX, 0);
-  }
-  case MACHINE_OP_ARRAY:{
-    emit (X86_Stm_new_load (X86_EDX,
-                            X86_Operand_new_inStack
-                            ((-4)*o->u.array.offset)));
-    /* this should go to machine */
-    emit (X86_Stm_new_inc (X86_EDX));
-    emit (X86_Stm_new_load (X86_ECX,
-                            X86_Operand_new_int 
-                            (o->u.array.scale)));
-    emit (X86_Stm_new_bop (X86_EDX,
-                           OP_TIMES,
-                           X86_ECX));
-    if (o->u.structt.base>0)
-      emit (X86_Stm_new_load (X86_ECX,
-                              X86_Operand_new_inStack
-                              ((-4)*o->u.structt.base)));
-    else if (o->u.structt.base<0)
-      emit (X86_Stm_new_load (X86_ECX,
-                              X86_Operand_new_inStack
-                              ((-4)*(o->u.structt.base-1))));
-    else Error_impossible ();
-      
-    emit (X86_Stm_new_bop (X86_ECX,
-                           OP_ADD,
-                           X86_EDX));
-    return X86_Operand_new_mem (X86_ECX, 0);
-  }
-  default:
-    printf ("%d\n", o->kind);
-    Error_impossible ();
+}
+
+static void load(X86_Register_t r, Machine_Operand_t o) {
+    X86_Operand_t x = Trans_operand(o);
+
+    if (x->kind != X86_OP_REG)
+        emit(X86_Stm_new_load(r, x));
+    else if (x->u.reg != r)
+        emit(X86_Stm_new_moverr(r, x->u.reg));
+}
+
+static void store(Id_t dest, X86_Register_t r) {
+    X86_Register_t d = regOf(dest);
+
+    if (!d)
+        emit(X86_Stm_new_store(slotOf(dest), r));
+    else if (d != r)
+        emit(X86_Stm_new_moverr(d, r));
+}
+
+// "o" as the source of an instruction, in "r" if it can
+// not be used as it is
+static X86_Operand_t source(X86_Register_t r, Machine_Operand_t o) {
+    X86_Operand_t x = Trans_operand(o);
+
+    if (X86_Operand_isDirect(x))
+        return x;
+    emit(X86_Stm_new_load(r, x));
+    return X86_Operand_new_reg(r);
+}
+
+// "id" in a register, which is "r" if it is in its slot
+static X86_Register_t inReg(X86_Register_t r, Id_t id) {
+    X86_Register_t x = regOf(id);
+
+    if (x)
+        return x;
+    emit(X86_Stm_new_load(r, slotOf(id)));
+    return r;
+}
+
+// the address of "m", with %rcx (and %rdx) for its base
+// (and index) if they are in their slots
+static X86_Operand_t Trans_mem(Machine_Mem_t m) {
+    assert(m);
+    switch (m->kind) {
+        case MACHINE_MEM_ARRAY: {
+            Machine_Operand_t index = m->u.array.index;
+            X86_Register_t base = inReg(X86_RCX, m->u.array.name);
+
+            if (index->kind == MACHINE_OP_INT)
+                return X86_Operand_new_mem(base, index->u.int_lit * Control_Target_size);
+            return X86_Operand_new_index(base, inReg(X86_RDX, index->u.id), Control_Target_size);
+        }
+        case MACHINE_MEM_CLASS:
+            return X86_Operand_new_mem(inReg(X86_RCX, m->u.class.name), m->u.class.index * Control_Target_size);
+        default:
+            Error_impossible();
+            return 0;
+    }
+    Error_impossible();
     return 0;
-  }
-  Error_impossible ();
-  return 0;
-}
-
-static void genBop (Machine_Operand_t left, 
-                    Operator_t op,
-                    Machine_Operand_t right,
-                    Machine_Operand_t dest)
-{
-  switch (op){
-  case OP_ADD:
-  case OP_SUB:
-  case OP_TIMES:{
-    X86_Operand_t newLeft;
-    X86_Operand_t newRight;
-    X86_Operand_t newDest;
-
-    newLeft = Trans_operand (left);
-    emit (X86_Stm_new_load (X86_EAX,
-                            newLeft));
-    newRight = Trans_operand(right);
-    emit (X86_Stm_new_load (X86_EDX,
-                            newRight));
-    emit (X86_Stm_new_bop (X86_EAX,
-                           op,
-                           X86_EDX));
-    newDest = Trans_operand (dest);
-    emit (X86_Stm_new_store (newDest,
-                            X86_EAX));
-    return;
-  }
-  case OP_DIVIDE:{
-    X86_Operand_t newLeft;
-    X86_Operand_t newRight;
-    X86_Operand_t newDest;
-
-    newLeft = Trans_operand (left);
-    emit (X86_Stm_new_load (X86_EAX,
-                            newLeft));
-    newRight = Trans_operand(right);
-    emit (X86_Stm_new_load (X86_ECX,
-                            newRight));
-    emit (X86_Stm_new_cltd ());
-    emit (X86_Stm_new_uop (X86_ECX,
-                           OP_DIVIDE,
-                           X86_ECX));
-    newDest = Trans_operand(dest);
-    emit (X86_Stm_new_store (newDest,
-                             X86_EAX));
-    return;
-  }
-  case OP_MODUS:{
-    X86_Operand_t newLeft;
-    X86_Operand_t newRight;
-    X86_Operand_t newDest;
-
-    newLeft = Trans_operand (left);
-    emit (X86_Stm_new_load (X86_EAX,
-                            newLeft));
-    newRight = Trans_operand(right);
-    emit (X86_Stm_new_load (X86_ECX,
-                            newRight));
-    emit (X86_Stm_new_cltd ());    
-    emit (X86_Stm_new_uop (X86_ECX,
-                           OP_DIVIDE,
-                           X86_ECX));
-    emit (X86_Stm_new_moverr (X86_EAX, X86_EDX));
-    newDest = Trans_operand(dest);
-    emit (X86_Stm_new_store (newDest,
-                             X86_EAX));
-    return;
-  }
-  case OP_LT:{
-    X86_Operand_t newLeft;
-    X86_Operand_t newRight;
-    X86_Operand_t newDest;
-
-    newLeft = Trans_operand (left);
-    emit (X86_Stm_new_load (X86_EAX,
-                            newLeft));
-    newRight = Trans_operand(right);
-    emit (X86_Stm_new_load (X86_EDX,
-                            newRight));
-    emit (X86_Stm_new_cmp (X86_EAX,
-                           X86_EDX));
-    emit (X86_Stm_new_setl (X86_AL));
-    emit (X86_Stm_new_extendAl ());
-    newDest = Trans_operand(dest);
-    emit (X86_Stm_new_store (newDest,
-                             X86_EAX));
-    return;
-  }
-  case OP_LE:{
-    X86_Operand_t newLeft;
-    X86_Operand_t newRight;
-    X86_Operand_t newDest;
-
-    newLeft = Trans_operand (left);
-    emit (X86_Stm_new_load (X86_EAX,
-                            newLeft));
-    newRight = Trans_operand (right);
-    emit (X86_Stm_new_load (X86_EDX,
-                            newRight));
-    emit (X86_Stm_new_cmp (X86_EAX,
-                           X86_EDX));
-    emit (X86_Stm_new_setle (X86_AL));
-    emit (X86_Stm_new_extendAl ());
-    newDest = Trans_operand(dest);
-    emit (X86_Stm_new_store (newDest,
-                             X86_EAX));
-    return;
-  }
-  case OP_GT:{
-    X86_Operand_t newLeft;
-    X86_Operand_t newRight;
-    X86_Operand_t newDest;
-
-    newLeft = Trans_operand (left);
-    emit (X86_Stm_new_load (X86_EAX,
-                            newLeft));
-    newRight = Trans_operand(right);
-    emit (X86_Stm_new_load (X86_EDX,
-                            newRight));
-    emit (X86_Stm_new_cmp (X86_EAX,
-                           X86_EDX));
-    emit (X86_Stm_new_setg (X86_AL));
-    emit (X86_Stm_new_extendAl ());
-    newDest = Trans_operand(dest);
-    emit (X86_Stm_new_store (newDest,
-                             X86_EAX));
-    return;
-  }
-  case OP_GE:{
-    X86_Operand_t newLeft;
-    X86_Operand_t newRight;
-    X86_Operand_t newDest;
-
-    newLeft = Trans_operand (left);
-    emit (X86_Stm_new_load (X86_EAX,
-                            newLeft));
-    newRight = Trans_operand(right);
-    emit (X86_Stm_new_load (X86_EDX,
-                            newRight));
-    emit (X86_Stm_new_cmp (X86_EAX,
-                           X86_EDX));
-    emit (X86_Stm_new_setge (X86_AL));
-    emit (X86_Stm_new_extendAl ());
-    newDest = Trans_operand(dest);
-    emit (X86_Stm_new_store (newDest,
-                             X86_EAX));
-    return;
-  }
-  case OP_EQ:{
-    X86_Operand_t newLeft;
-    X86_Operand_t newRight;
-    X86_Operand_t newDest;
-
-    newLeft = Trans_operand (left);
-    emit (X86_Stm_new_load (X86_EAX,
-                            newLeft));
-    newRight = Trans_operand(right);
-    emit (X86_Stm_new_load (X86_EDX,
-                            newRight));
-    emit (X86_Stm_new_cmp (X86_EAX,
-                           X86_EDX));
-    emit (X86_Stm_new_sete (X86_AL));
-    emit (X86_Stm_new_extendAl ());
-    newDest = Trans_operand(dest);
-    emit (X86_Stm_new_store (newDest,
-                             X86_EAX));
-    return;
-  }
-  case OP_NE:{
-    X86_Operand_t newLeft;
-    X86_Operand_t newRight;
-    X86_Operand_t newDest;
-
-    newLeft = Trans_operand (left);    
-    emit (X86_Stm_new_load (X86_EAX,
-                            newLeft));
-    newRight = Trans_operand(right);    
-    emit (X86_Stm_new_load (X86_EDX,
-                            newRight));
-    emit (X86_Stm_new_cmp (X86_EAX,
-                           X86_EDX));
-    emit (X86_Stm_new_setne (X86_AL));
-    emit (X86_Stm_new_extendAl ());
-    newDest = Trans_operand(dest);
-    emit (X86_Stm_new_store (newDest,
-                             X86_EAX));
-    return;
-  }
-  default:
-    Error_impossible ();
-    return;
-  }
-  Error_impossible ();
-  return;
-}
-
-static void genUop (Machine_Operand_t src,
-                    Operator_t op,
-                    Machine_Operand_t dest)
-{
-  switch (op){
-  case OP_NEG:{
-    X86_Operand_t newSrc, newDest;      
-
-    newSrc = Trans_operand(src);
-    emit (X86_Stm_new_load (X86_EAX,
-                            newSrc));
-    emit (X86_Stm_new_neg (X86_EAX));
-    newDest = Trans_operand(dest);
-    emit (X86_Stm_new_store (newDest,
-                             X86_EAX));
-    return;
-  }
-  default:
-    Error_impossible ();
-    return;
-  }
-  Error_impossible ();
-  return;
+}
+
+// %rax = (%rax != 0)
+static void genTruth(void) {
+    emit(X86_Stm_new_cmp(X86_RAX, X86_Operand_new_int(0)));
+    emit(X86_Stm_new_setne(X86_AL));
+    emit(X86_Stm_new_extendAl());
 }
 
 /* Convention for binary operation:
  *   x   bop y
  *   |       |
  *   \/      \/
- *  eax     edx
- * For some operation, this has the advantage of 
- * simplifying the generated instructions.
+ *  rax     rcx (if not direct)
+ * and the result is in rax.
  */
-static void Trans_stm (Machine_Stm_t s)
-{
-  assert(s);
-  switch (s->kind){
-  case MACHINE_STM_MOVE:{
-    X86_Stm_t s1, s2;
-    X86_Operand_t newSrc, newDest;
-    newSrc = Trans_operand (s->u.move.src);
-    s1 = X86_Stm_new_load (X86_EAX, newSrc);
-    emit (s1);
-    newDest = Trans_operand (s->u.move.dest);
-    s2 = X86_Stm_new_store (newDest, X86_EAX);
-    emit (s2);
-    return;
-  }
-  case MACHINE_STM_BOP:{
-    genBop (s->u.bop.left, 
-            s->u.bop.op,
-            s->u.bop.right,
-            s->u.bop.dest);
-    return;
-  }    
-  case MACHINE_STM_UOP:{
-    genUop (s->u.uop.src,
-            s->u.uop.op,
-            s->u.uop.dest);
-    return;
-  }
-  case MACHINE_STM_CALL:{
-    int n = 0;
-    List_t args = List_getFirst 
-      (List_rev (s->u.call.args));
-    X86_Operand_t newDest = Trans_operand (s->u.call.dest);
-    while (args){
-      Machine_Operand_t src = 
-        (Machine_Operand_t)args->data;
-      X86_Operand_t newSrc = Trans_operand (src);
-      emit (X86_Stm_new_load (X86_EAX, newSrc));
-      emit (X86_Stm_new_push (X86_EAX));
-      n++;
-      args = args->next;
+static void genBop(Id_t dest, Machine_Operand_t left, Operator_t op, Machine_Operand_t right) {
+    switch (op) {
+        case OP_ADD:
+        case OP_SUB:
+        case OP_TIMES: {
+            load(X86_RAX, left);
+            emit(X86_Stm_new_bop(X86_RAX, op, source(X86_RCX, right)));
+            break;
+        }
+        case OP_DIVIDE:
+        case OP_MODUS: {
+            load(X86_RAX, left);
+            load(X86_RCX, right);
+            emit(X86_Stm_new_cltd());
+            emit(X86_Stm_new_uop(X86_RAX, OP_DIVIDE, X86_RCX));
+            if (op == OP_MODUS)
+                emit(X86_Stm_new_moverr(X86_RAX, X86_RDX));
+            break;
+        }
+        case OP_AND:
+        case OP_OR: {
+            load(X86_RAX, right);
+            genTruth();
+            emit(X86_Stm_new_moverr(X86_RCX, X86_RAX));
+            load(X86_RAX, left);
+            genTruth();
+            emit(X86_Stm_new_bop(X86_RAX, op, X86_Operand_new_reg(X86_RCX)));
+            break;
+        }
+        case OP_EQ:
+        case OP_NE:
+        case OP_LT:
+        case OP_LE:
+        case OP_GT:
+        case OP_GE: {
+            load(X86_RAX, left);
+            emit(X86_Stm_new_cmp(X86_RAX, source(X86_RCX, right)));
+            switch (op) {
+                case OP_EQ:
+                    emit(X86_Stm_new_sete(X86_AL));
+                    break;
+                case OP_NE:
+                    emit(X86_Stm_new_setne(X86_AL));
+                    break;
+                case OP_LT:
+                    emit(X86_Stm_new_setl(X86_AL));
+                    break;
+                case OP_LE:
+                    emit(X86_Stm_new_setle(X86_AL));
+                    break;
+                case OP_GT:
+                    emit(X86_Stm_new_setg(X86_AL));
+                    break;
+                default:
+                    emit(X86_Stm_new_setge(X86_AL));
+                    break;
+            }
+            emit(X86_Stm_new_extendAl());
+            break;
+        }
+        default:
+            Error_impossible();
+            return;
     }
-    emit (X86_Stm_new_call 
-          (Id_fromString 
-           (String_concat ("_",
-                           Id_toString (s->u.call.name),
-                           0))));
-    emit (X86_Stm_new_load (X86_EDX, 
-                            X86_Operand_new_int (4*n)));
-    emit (X86_Stm_new_bop (X86_ESP,
-                           OP_ADD,
-                           X86_EDX));
-    emit (X86_Stm_new_store (newDest, X86_EAX));
-    return;
-  }
-  case MACHINE_STM_IF:{
-    X86_Operand_t newSrc = Trans_operand(s->u.iff.src);
-    emit (X86_Stm_new_load (X86_EAX, newSrc));
-    emit (X86_Stm_new_load (X86_EDX, 
-                            X86_Operand_new_int (0)));
-    emit (X86_Stm_new_cmp (X86_EAX, X86_EDX));
-    emit (X86_Stm_new_je (s->u.iff.falsee));
-    emit (X86_Stm_new_jump (s->u.iff.truee));
-    return;
-  }
-  case MACHINE_STM_LABEL:
-    emit (X86_Stm_new_label (s->u.label));
-    return;
-  case MACHINE_STM_JUMP:
-    emit (X86_Stm_new_jump (s->u.jump));
-    return;
-  case MACHINE_STM_RETURN:{
-    X86_Operand_t newSrc
-      = Trans_operand (s->u.returnn);
-
-    emit (X86_Stm_new_load (X86_EAX, newSrc));
-    emit (X86_Stm_new_return ());
-    return;
-  }
-  case MACHINE_STM_NEW_STRUCT:{
+    store(dest, X86_RAX);
+}
+
+static void genUop(Id_t dest, Operator_t op, Machine_Operand_t src) {
+    load(X86_RAX, src);
+    switch (op) {
+        case OP_NEG:
+            emit(X86_Stm_new_neg(X86_RAX));
+            break;
+        case OP_NOT:
+            emit(X86_Stm_new_cmp(X86_RAX, X86_Operand_new_int(0)));
+            emit(X86_Stm_new_sete(X86_AL));
+            emit(X86_Stm_new_extendAl());
+            break;
+        default:
+            Error_impossible();
+            return;
+    }
+    store(dest, X86_RAX);
+}
+
+// Arguments go in the 6 argument registers, and the rest
+// on the stack, the last pushed first; the stack stays
+// 16-byte aligned.
+static void genCall(Id_t name, List_t args) {
+    long n = List_size(args), onStack = (n > X86_NUM_ARG_REGS) ? n - X86_NUM_ARG_REGS : 0;
+    long i;
+    List_t p;
+
+    if (onStack % 2)
+        emit(X86_Stm_new_bop(X86_RSP, OP_SUB, X86_Operand_new_int(Control_Target_size)));
+    for (i = n - 1; i >= X86_NUM_ARG_REGS; i--) {
+        load(X86_RAX, List_nth(args, (int) i));
+        emit(X86_Stm_new_push(X86_RAX));
+    }
+    for (i = 0, p = List_getFirst(args); p && i < X86_NUM_ARG_REGS; i++, p = p->next)
+        load(X86_argRegs[i], p->data);
+    emit(X86_Stm_new_call(name));
+    if (onStack)
+        emit(X86_Stm_new_bop(X86_RSP, OP_ADD, X86_Operand_new_int((onStack + onStack % 2) * Control_Target_size)));
+}
+
+static void Trans_stm(Machine_Stm_t s) {
+    assert(s);
+    switch (s->kind) {
+        case MACHINE_STM_MOVE:
+            load(X86_RAX, s->u.move.src);
+            store(s->u.move.dest, X86_RAX);
+            return;
+        case MACHINE_STM_BOP:
+            genBop(s->u.bop.dest, s->u.bop.left, s->u.bop.op, s->u.bop.right);
+            return;
+        case MACHINE_STM_UOP:
+            genUop(s->u.uop.dest, s->u.uop.op, s->u.uop.src);
+            return;
+        case MACHINE_STM_STORE: {
+            X86_Operand_t m;
+
+            load(X86_RAX, s->u.store.src);
+            m = Trans_mem(s->u.store.m);
+            emit(X86_Stm_new_store(m, X86_RAX));
+            return;
+        }
+        case MACHINE_STM_LOAD: {
+            X86_Operand_t m = Trans_mem(s->u.load.m);
+
+            emit(X86_Stm_new_load(X86_RAX, m));
+            store(s->u.load.dest, X86_RAX);
+            return;
+        }
+        // the runtime keeps the handler for this frame, and
+        // "setjmp" comes back with 1 when it is thrown to
+        case MACHINE_STM_TRY:
+            emit(X86_Stm_new_moverr(X86_RDI, X86_RBP));
+            emit(X86_Stm_new_call(exnPush));
+            emit(X86_Stm_new_moverr(X86_RDI, X86_RAX));
+            emit(X86_Stm_new_call(setJmp));
+            // an "int"
+            emit(X86_Stm_new_cltq());
+            emit(X86_Stm_new_cmp(X86_RAX, X86_Operand_new_int(0)));
+            emit(X86_Stm_new_jne(s->u.try));
+            return;
+        // leaving the innermost "try", either at its end or
+        // by a "throw" right in it
+        case MACHINE_STM_TRY_END:
+            emit(X86_Stm_new_call(exnPop));
+            return;
+        case MACHINE_STM_RUNTIME_CLASS:
+            emit(X86_Stm_new_moveri(X86_RDI, s->u.class.index));
+            emit(X86_Stm_new_moveri(X86_RSI, s->u.class.size));
+            emit(X86_Stm_new_call(s->u.class.fname));
+            store(s->u.class.dest, X86_RAX);
+            return;
+        case MACHINE_STM_RUNTIME_ARRAY:
+            emit(X86_Stm_new_moveri(X86_RDI, s->u.array.isPtr));
+            load(X86_RSI, s->u.array.size);
+            emit(X86_Stm_new_moveri(X86_RDX, s->u.array.scale));
+            emit(X86_Stm_new_call(s->u.array.fname));
+            store(s->u.array.dest, X86_RAX);
+            return;
+        default:
+            // "new" is lowered by "genLayout", and calls are
+            // transfers
+            Error_impossible();
+            return;
+    }
+    Error_impossible();
+}
+
+static void genJump(Label_t l) {
+    if (!nextLabel || !Label_equals(l, nextLabel))
+        emit(X86_Stm_new_jump(l));
+}
+
+// the moves from registers "from" to "to", all at once: a
+// move goes when no other still reads its target, and a
+// cycle is broken through %rax
+static void genShuffle(X86_Register_t *from, X86_Register_t *to, int n) {
+    while (n > 0) {
+        int i, j;
+
+        for (i = 0; i < n; i++) {
+            for (j = 0; j < n; j++)
+                if (j != i && from[j] == to[i])
+                    break;
+            if (j == n)
+                break;
+        }
+        if (i == n) {
+            emit(X86_Stm_new_moverr(X86_RAX, from[0]));
+            from[0] = X86_RAX;
+            continue;
+        }
+        if (from[i] != to[i])
+            emit(X86_Stm_new_moverr(to[i], from[i]));
+        n--;
+        from[i] = from[n];
+        to[i] = to[n];
+    }
+}
+
+// the moves of an edge, List<Triple<Id_t, long, long>>,
+// or 0: the stores, then those between registers, and the
+// loads last
+static void genMoves(List_t moves) {
+    X86_Register_t from[X86_R15 + 1], to[X86_R15 + 1];
     int n = 0;
-    X86_Operand_t newDest;
-    List_t args = 
-      List_getFirst 
-      (List_rev(s->u.newStruct.args));
-    while (args){
-      Machine_Operand_t src = 
-        (Machine_Operand_t)args->data;
-      X86_Operand_t newSrc = Trans_operand (src);
-      emit (X86_Stm_new_load (X86_EAX, newSrc));
-      emit (X86_Stm_new_push (X86_EAX));
-      n++;
-      args = args->next;
+
+    if (!moves)
+        return;
+
+    for (List_t p = List_getFirst(moves); p; p = p->next) {
+        Triple_t m = p->data;
+
+        if (!Triple_third(m))
+            emit(X86_Stm_new_store(slotOf(Triple_first(m)), (X86_Register_t) (long) Triple_second(m)));
+        else if (Triple_second(m)) {
+            from[n] = (X86_Register_t) (long) Triple_second(m);
+            to[n++] = (X86_Register_t) (long) Triple_third(m);
+        }
+    }
+    genShuffle(from, to, n);
+    for (List_t p = List_getFirst(moves); p; p = p->next) {
+        Triple_t m = p->data;
+
+        if (!Triple_second(m))
+            emit(X86_Stm_new_load((X86_Register_t) (long) Triple_third(m), slotOf(Triple_first(m))));
+    }
+}
+
+// the moves on the edge from the current block to "l", or
+// 0
+static List_t movesTo(Label_t l) {
+    List_t edges = Property_get(moveProp, curLabel);
+
+    if (!edges)
+        return 0;
+    for (List_t p = List_getFirst(edges); p; p = p->next)
+        if (Label_equals(Tuple_first(p->data), l))
+            return Tuple_second(p->data);
+    return 0;
+}
+
+// where an "if" goes for "l": a block of the moves on the
+// edge, if there are any
+static Label_t edgeTo(Label_t l) {
+    List_t moves = movesTo(l);
+    Label_t b;
+
+    if (!moves)
+        return l;
+    b = Label_new();
+    List_insertLast(edgeBlocks, Triple_new(b, l, moves));
+    return b;
+}
+
+// Calls leave to their handlers through "longjmp", so
+// "leave" needs nothing here.
+static void Trans_transfer(Machine_Transfer_t t) {
+    assert(t);
+    switch (t->kind) {
+        case MACHINE_TRANS_IF: {
+            Label_t truee = edgeTo(t->u.iff.truee), falsee = edgeTo(t->u.iff.falsee);
+
+            load(X86_RAX, t->u.iff.cond);
+            emit(X86_Stm_new_cmp(X86_RAX, X86_Operand_new_int(0)));
+            if (nextLabel && Label_equals(truee, nextLabel)) {
+                emit(X86_Stm_new_je(falsee));
+                return;
+            }
+            emit(X86_Stm_new_jne(truee));
+            genJump(falsee);
+            return;
+        }
+        case MACHINE_TRANS_JUMP:
+            genMoves(movesTo(t->u.jump));
+            genJump(t->u.jump);
+            return;
+        case MACHINE_TRANS_RETURN:
+            // a "return" may be in a "try"
+            if (hasTry) {
+                emit(X86_Stm_new_moverr(X86_RDI, X86_RBP));
+                emit(X86_Stm_new_call(exnLeave));
+            }
+            load(X86_RAX, t->u.ret);
+            for (int i = 0; i < numSaved; i++)
+                emit(X86_Stm_new_load(savedRegs[i], X86_Operand_new_inStack(savedSlots[i])));
+            emit(X86_Stm_new_return());
+            return;
+        case MACHINE_TRANS_CALL:
+        case MACHINE_TRANS_CALL_NOASSIGN:
+            genCall(t->u.call.name, t->u.call.args);
+            if (t->kind == MACHINE_TRANS_CALL && t->u.call.dest)
+                store(t->u.call.dest, X86_RAX);
+            genMoves(movesTo(t->u.call.normal));
+            genJump(t->u.call.normal);
+            return;
+        case MACHINE_TRANS_THROW:
+            emit(X86_Stm_new_call(exnThrow));
+            return;
+        default:
+            Error_impossible();
+            return;
     }
-    emit (X86_Stm_new_load (X86_EAX, 
-                            X86_Operand_new_int (n)));
-    emit (X86_Stm_new_push (X86_EAX));
-    emit (X86_Stm_new_load (X86_EAX, 
-                            X86_Operand_new_global 
-                            (s->u.newStruct.type)));
-    emit (X86_Stm_new_push (X86_EAX));
-    emit (X86_Stm_new_call 
-          (Id_fromString ("_Dragon_alloc_struct")));
-    emit (X86_Stm_new_load (X86_EDX, 
-                            X86_Operand_new_int (8+4*n)));
-    emit (X86_Stm_new_bop (X86_ESP,
-                           OP_ADD,
-                           X86_EDX));
-    newDest = Trans_operand (s->u.newStruct.dest);
-    emit (X86_Stm_new_store (newDest, X86_EAX));
-    return;
-  }
-  case MACHINE_STM_NEW_ARRAY:{
-    X86_Operand_t newDest, newSize, newInit;
-
-    newInit = Trans_operand (s->u.newArray.init);
-    emit (X86_Stm_new_load (X86_EAX,
-                            newInit));
-    emit (X86_Stm_new_push (X86_EAX));
-    newSize = Trans_operand (s->u.newArray.size);
-    emit (X86_Stm_new_load (X86_EAX,
-                            newSize));
-    emit (X86_Stm_new_push (X86_EAX));
-    emit (X86_Stm_new_load 
-          (X86_EAX,                      
-           X86_Operand_new_int (s->u.newArray.isPtr)));
-    emit (X86_Stm_new_push (X86_EAX));     
-    emit (X86_Stm_new_call 
-          (Id_fromString ("_Dragon_alloc_array")));
-    emit (X86_Stm_new_load (X86_EDX,
-                            X86_Operand_new_int (12)));
-    emit (X86_Stm_new_bop (X86_ESP,
-                           OP_ADD,
-                           X86_EDX)); 
-    newDest = Trans_operand (s->u.newArray.dest); 
-    emit (X86_Stm_new_store (newDest, X86_EAX));
-    return;
-  }
-  default:
-    Error_impossible ();
-    return;
-  }
-  Error_impossible ();
-  return;
-}
-
-static List_t Trans_stms (List_t stms)
-{
-  List_t newStms;
-  assert(stms);
-  allStms = List_new ();
-  List_foreach (stms,
-                      (Poly_tyVoid)Trans_stm);
-  newStms = getBeforeClearStms ();
-  return newStms;
-}
-
-static X86_Struct_t Trans_struct (Machine_Struct_t str)
-{
-  assert(str);
-  return X86_Struct_new (str->type,
-                         str->var);
-}
-
-static X86_Fun_t Trans_func (Machine_Fun_t f)
-{
-  List_t stms;
-
-  assert(f);
-  stms = Trans_stms (f->stms);
-  return X86_Fun_new 
-    (f->type,
-     f->name,
-     List_map (f->args,
-                     (Poly_tyId)Trans_struct),
-     List_map (f->decs,
-                     (Poly_tyId)Trans_struct),
-     stms,
-     f->retId,
-     f->entry,
-     f->exitt);
-}
-
-static X86_Str_t Trans_str (Machine_Str_t s)
-{
-  assert(s);
-  return X86_Str_new (s->name,
-                      s->value);
-}
-
-static X86_Mask_t Trans_mask (Machine_Mask_t m)
-{
-  assert(m);
-  return X86_Mask_new (m->name,
-                       m->size,
-                       m->index);
-}
-
-#endif// 0
+    Error_impossible();
+}
+
+static void Trans_block(Machine_Block_t b, Label_t next) {
+    curLabel = b->label;
+    nextLabel = next;
+    emit(X86_Stm_new_label(b->label));
+    List_foreach(b->stms, (Poly_tyVoid) Trans_stm);
+    Trans_transfer(b->transfer);
+}
+
+static int funHasTry(Machine_Fun_t f) {
+    for (List_t b = List_getFirst(f->blocks); b; b = b->next)
+        for (List_t s = List_getFirst(((Machine_Block_t) b->data)->stms); s; s = s->next)
+            if (((Machine_Stm_t) s->data)->kind == MACHINE_STM_TRY)
+                return 1;
+    return 0;
+}
+
+static long giveSlots(List_t decs, long offset) {
+    for (List_t p = List_getFirst(decs); p; p = p->next) {
+        Dec_t dec = p->data;
+
+        offset -= Control_Target_size;
+        Property_set(slotProp, dec->id, (Poly_t) offset);
+    }
+    return offset;
+}
+
+// put the registers of "frame" in "regProp", and its
+// moves in "moveProp", and give the callee-saved registers
+// it uses a slot below "offset"
+static long giveRegs(Machine_FrameInfo_t frame, long offset) {
+    int used[X86_R15 + 1] = {0};
+
+    numSaved = 0;
+    // no "regs" when "regAlloc" is dropped
+    if (!frame->regs)
+        return offset;
+    for (List_t p = List_getFirst(frame->regs); p; p = p->next) {
+        Triple_t t = p->data;
+        X86_Register_t r = (X86_Register_t) (long) Triple_third(t);
+        List_t steps = Property_get(regProp, Triple_first(t));
+
+        if (!steps) {
+            steps = List_new();
+            Property_set(regProp, Triple_first(t), steps);
+        }
+        List_insertLast(steps, Tuple_new(Triple_second(t), (Poly_t) (long) r));
+        if (r && X86_Register_isCalleeSaved(r) && !used[r]) {
+            used[r] = 1;
+            offset -= Control_Target_size;
+            savedRegs[numSaved] = r;
+            savedSlots[numSaved++] = offset;
+        }
+    }
+    for (List_t p = List_getFirst(frame->moves); p; p = p->next) {
+        Triple_t e = p->data;
+        List_t edges = Property_get(moveProp, Triple_first(e));
+
+        if (!edges) {
+            edges = List_new();
+            Property_set(moveProp, Triple_first(e), edges);
+        }
+        List_insertLast(edges, Tuple_new(Triple_second(e), Triple_third(e)));
+    }
+    return offset;
+}
+
+static X86_Fun_t Trans_func(Machine_Fun_t f, Machine_FrameInfo_t frame) {
+    long frameSize, offset;
+    List_t p;
+    int i;
+
+    assert(f);
+    assert(frame);
+    offset = giveSlots(f->decs, giveSlots(f->args, 0));
+    assert(-offset == frame->size);
+    offset = giveRegs(frame, offset);
+    frameSize = (-offset + 15) / 16 * 16;
+    hasTry = funHasTry(f);
+
+    allStms = List_new();
+    edgeBlocks = List_new();
+    // the arguments go to where they are in the entry
+    // block
+    curBlock = 0;
+    for (p = List_getFirst(f->blocks); !Label_equals(((Machine_Block_t) p->data)->label, f->entry); p = p->next)
+        curBlock++;
+    for (i = 0; i < numSaved; i++)
+        emit(X86_Stm_new_store(X86_Operand_new_inStack(savedSlots[i]), savedRegs[i]));
+    // the arguments to their slots
+    for (i = 0, p = List_getFirst(f->args); p; i++, p = p->next) {
+        Dec_t dec = p->data;
+
+        if (i < X86_NUM_ARG_REGS)
+            store(dec->id, X86_argRegs[i]);
+        else {
+            long above = 2 * Control_Target_size + (i - X86_NUM_ARG_REGS) * Control_Target_size;
+
+            emit(X86_Stm_new_load(X86_RAX, X86_Operand_new_inStack(above)));
+            store(dec->id, X86_RAX);
+        }
+    }
+    // the entry block may not be the first
+    {
+        Machine_Block_t first = List_nth(f->blocks, 0);
+
+        if (!Label_equals(first->label, f->entry))
+            emit(X86_Stm_new_jump(f->entry));
+    }
+    for (curBlock = 0, p = List_getFirst(f->blocks); p; curBlock++, p = p->next)
+        Trans_block(p->data, (p->next) ? ((Machine_Block_t) p->next->data)->label : 0);
+    nextLabel = 0;
+    for (p = List_getFirst(edgeBlocks); p; p = p->next) {
+        Triple_t b = p->data;
+
+        emit(X86_Stm_new_label(Triple_first(b)));
+        genMoves(Triple_third(b));
+        emit(X86_Stm_new_jump(Triple_second(b)));
+    }
+    edgeBlocks = 0;
+    return X86_Fun_new(f->name, frameSize, getBeforeClearStms());
+}
+
+static X86_Str_t Trans_str(Machine_Str_t s) {
+    assert(s);
+    return X86_Str_new(s->name, s->value);
+}
 
 static X86_Prog_t X86_codegenTraced(Machine_Prog_t p) {
     List_t strs, masks, funcs;
 
     assert(p);
-    strs = List_new();
+    exnPush = Id_fromString("Dragon_Exn_push");
+    exnPop = Id_fromString("Dragon_Exn_pop");
+    exnLeave = Id_fromString("Dragon_Exn_leave");
+    exnThrow = Id_fromString("Dragon_Exn_throw");
+    setJmp = Id_fromString("_setjmp");
+    slotProp = Property_new((Poly_tyIndex) Id_index);
+    regProp = Property_new((Poly_tyIndex) Id_index);
+    moveProp = Property_new((Poly_tyIndex) Label_index);
+
+    strs = List_map(p->strings, (Poly_tyId) Trans_str);
+    // no collector yet to read the layouts
     masks = List_new();
     funcs = List_new();
+    // the frames are in the order of the functions
+    for (List_t f = List_getFirst(p->funcs), i = List_getFirst(p->frameInfo); f; f = f->next, i = i->next) {
+        List_insertLast(funcs, Trans_func(f->data, i->data));
+        Property_clear(regProp);
+        Property_clear(moveProp);
+    }
+
+    Property_clear(slotProp);
     return X86_Prog_new(strs, masks, funcs);
 }
 
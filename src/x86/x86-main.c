@@ -3,16 +3,15 @@
 #include "../control/pass.h"
 #include "../lib/int.h"
 #include "peep-hole.h"
+#include "reg-alloc.h"
 #include "x86-codegen.h"
 #include "x86.h"
 
-static int counter = 0;
-
-static String_t genFileName(void) {
+String_t X86_fileName(void) {
     String_t f = String_concat("",
                                Control_asmDirectory,
                                "files-",
-                               Int_toString(counter++),
+                               Int_toString(Control_fileIndex),
                                ".s",
                                0);
     return f;
@@ -21,18 +20,27 @@ static String_t genFileName(void) {
 static String_t outputX86(X86_Prog_t p) {
     String_t f;
 
-    f = genFileName();
+    f = X86_fileName();
     File_saveToFile(f, (Poly_tyPrint) X86_Prog_print, p);
     return f;
 }
 
 Tuple_t X86_main(Machine_Prog_t p) {
-    Pass_t codeGen,
+    Pass_t regAlloc,
+            codeGen,
             peepHole,
             output;
     X86_Prog_t p1, p2;
     String_t f;
 
+    regAlloc = Pass_newIr("regAlloc",
+                          VERBOSE_SUBPASS,
+                          p,
+                          (Poly_tyId) X86_regAlloc,
+                          (Pass_tySize) Machine_Prog_size,
+                          (Pass_tySize) Machine_Prog_size);
+    p = Pass_doit(&regAlloc);
+
     codeGen = Pass_new("codegen",
                        VERBOSE_SUBPASS,
                        p,
@@ -8,4 +8,7 @@
 /* a tuple <IR, asm> of the IR and its assembly */
 Tuple_t X86_main(Machine_Prog_t p);
 
+// the name of the assembly file for the file being compiled
+String_t X86_fileName(void);
+
 #endif
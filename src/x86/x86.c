@@ -1,6 +1,5 @@
 #include "x86.h"
 #include "../lib/char-buffer.h"
-#include "../lib/int.h"
 #include "../lib/mem.h"
 #include "../lib/todo.h"
 #include <assert.h>
@@ -11,79 +10,94 @@
 #define F X86_Fun_t
 #define S X86_Stm_t
 #define O X86_Operand_t
-#define D X86_Dec_t
-#define Stt X86_Struct_t
 #define M X86_Mask_t
 #define R X86_Register_t
 
 
-#define ONEM (1024 * 1024)
-#define NUM 16
-
-static char buffer[16 * ONEM];
-
-static int writeNums = 0;
+// the output is buffered by "File_open" and
+// "File_saveToFile" (see "-buffer")
+static File_t file = 0;
 
-static void buffer_init(void) {
-    /* int n = (Control_bufferSize>0) */
-    /*   ? (Control_bufferSize): NUM; */
-    /* n *= ONEM; */
-    /* Mem_NEW_SIZE (buffer, n); */
+static void print(String_t s) {
+    File_write(file, s);
 }
 
-static void buffer_final(void) {
-    /* buffer = 0; */
+static void printLong(long n) {
+    File_writeLong(file, n);
 }
 
-/* try to speed up this operation on rather large files */
-static File_t file = 0;
+const X86_Register_t X86_argRegs[X86_NUM_ARG_REGS] = {X86_RDI, X86_RSI, X86_RDX, X86_RCX, X86_R8, X86_R9};
 
-static void file_init(File_t f) {
-    file = f;
-    setbuf(file, buffer);
+int X86_Register_equals(R r1, R r2) {
+    return r1 == r2;
 }
 
-static void print(String_t s) {
-    writeNums++;
-    fprintf(file, "%s", s);
-    if (writeNums > 1000) {
-        fflush(file);
-        writeNums = 0;
+int X86_Register_isCalleeSaved(R r) {
+    switch (r) {
+        case X86_RBX:
+        case X86_RBP:
+        case X86_R12:
+        case X86_R13:
+        case X86_R14:
+        case X86_R15:
+            return 1;
+        default:
+            return 0;
     }
 }
 
-int X86_Register_equals(R r1, R r2) {
-    return r1 == r2;
-}
-
 void X86_Register_print(R r) {
     switch (r) {
         case X86_AL:
             print("%al");
             return;
-        case X86_EAX:
-            print("%eax");
+        case X86_RAX:
+            print("%rax");
+            return;
+        case X86_RBX:
+            print("%rbx");
+            return;
+        case X86_RCX:
+            print("%rcx");
+            return;
+        case X86_RDX:
+            print("%rdx");
+            return;
+        case X86_RSI:
+            print("%rsi");
+            return;
+        case X86_RDI:
+            print("%rdi");
+            return;
+        case X86_RBP:
+            print("%rbp");
             return;
-        case X86_EBX:
-            print("%ebx");
+        case X86_RSP:
+            print("%rsp");
             return;
-        case X86_ECX:
-            print("%ecx");
+        case X86_R8:
+            print("%r8");
             return;
-        case X86_EDX:
-            print("%edx");
+        case X86_R9:
+            print("%r9");
             return;
-        case X86_EDI:
-            print("%edi");
+        case X86_R10:
+            print("%r10");
             return;
-        case X86_ESI:
-            print("%esi");
+        case X86_R11:
+            print("%r11");
             return;
-        case X86_EBP:
-            print("%ebp");
+        case X86_R12:
+            print("%r12");
             return;
-        case X86_ESP:
-            print("%esp");
+        case X86_R13:
+            print("%r13");
+            return;
+        case X86_R14:
+            print("%r14");
+            return;
+        case X86_R15:
+            print("%r15");
             return;
         default:
             Error_impossible();
@@ -92,7 +106,13 @@ void X86_Register_print(R r) {
     Error_impossible();
 }
 
-O X86_Operand_new_int(int i) {
+// labels are local to the file
+static void printLabel(Label_t l) {
+    print(".");
+    print(Label_toString(l));
+}
+
+O X86_Operand_new_int(long i) {
     O e;
     Mem_NEW(e);
     e->kind = X86_OP_INT;
@@ -108,11 +128,19 @@ O X86_Operand_new_global(Id_t id) {
     return e;
 }
 
-O X86_Operand_new_inStack(int index) {
+O X86_Operand_new_label(Label_t label) {
+    O e;
+    Mem_NEW(e);
+    e->kind = X86_OP_LABEL;
+    e->u.label = label;
+    return e;
+}
+
+O X86_Operand_new_inStack(long offset) {
     O e;
     Mem_NEW(e);
     e->kind = X86_OP_INSTACK;
-    e->u.index = index;
+    e->u.index = offset;
     return e;
 }
 
@@ -124,7 +152,7 @@ O X86_Operand_new_reg(R r) {
     return e;
 }
 
-O X86_Operand_new_mem(R base, int offset) {
+O X86_Operand_new_mem(R base, long offset) {
     O e;
     Mem_NEW(e);
     e->kind = X86_OP_MEM;
@@ -133,36 +161,78 @@ O X86_Operand_new_mem(R base, int offset) {
     return e;
 }
 
+O X86_Operand_new_index(R base, R index, int scale) {
+    O e;
+    Mem_NEW(e);
+    e->kind = X86_OP_INDEX;
+    e->u.indexed.base = base;
+    e->u.indexed.index = index;
+    e->u.indexed.scale = scale;
+    return e;
+}
+
 int X86_Operand_sameStackSlot(O x, O y) {
     if (x->kind != X86_OP_INSTACK || y->kind != X86_OP_INSTACK)
         return 0;
     return x->u.index == y->u.index;
 }
 
+// immediates are sign-extended from 32 bits
+static int fitsImm32(long i) {
+    return i >= -2147483648L && i <= 2147483647L;
+}
+
+int X86_Operand_isDirect(O o) {
+    switch (o->kind) {
+        case X86_OP_INT:
+            return fitsImm32(o->u.intlit);
+        case X86_OP_GLOBAL:
+        case X86_OP_LABEL:
+            return 0;
+        default:
+            return 1;
+    }
+}
+
 void X86_Operand_print(O o) {
     assert(o);
     switch (o->kind) {
         case X86_OP_INT:
             print("$");
-            print(Int_toString(o->u.intlit));
+            printLong(o->u.intlit);
             return;
+        // as a memory operand, for "lea"
         case X86_OP_GLOBAL:
-            print("$");
             print(Id_toString(o->u.global));
+            print("(%rip)");
+            return;
+        case X86_OP_LABEL:
+            printLabel(o->u.label);
+            print("(%rip)");
             return;
         case X86_OP_INSTACK:
-            print(Int_toString(o->u.index));
-            print("(%ebp)");
+            printLong(o->u.index);
+            print("(%rbp)");
             return;
         case X86_OP_REG:
             X86_Register_print(o->u.reg);
             return;
         case X86_OP_MEM:
-            print(Int_toString(4 * (o->u.mem.offset)));
+            if (o->u.mem.offset)
+                printLong(o->u.mem.offset);
             print("(");
             X86_Register_print(o->u.mem.base);
             print(")");
             return;
+        case X86_OP_INDEX:
+            print("(");
+            X86_Register_print(o->u.indexed.base);
+            print(", ");
+            X86_Register_print(o->u.indexed.index);
+            print(", ");
+            printLong(o->u.indexed.scale);
+            print(")");
+            return;
         default:
             Error_impossible();
             return;
@@ -179,7 +249,7 @@ S X86_Stm_new_moverr(R dest, R src) {
     return s;
 }
 
-S X86_Stm_new_moveri(R dest, int src) {
+S X86_Stm_new_moveri(R dest, long src) {
     S s;
     Mem_NEW(s);
     s->kind = X86_STM_MOVERI;
@@ -207,7 +277,7 @@ S X86_Stm_new_store(O dest, R src) {
 }
 
 S X86_Stm_new_bop(R dest, Operator_t opr,
-                  R src) {
+                  O src) {
     S s;
     Mem_NEW(s);
     s->kind = X86_STM_BOP;
@@ -235,7 +305,7 @@ S X86_Stm_new_call(Id_t f) {
     return s;
 }
 
-S X86_Stm_new_cmp(R dest, R src) {
+S X86_Stm_new_cmp(R dest, O src) {
     S s;
     Mem_NEW(s);
     s->kind = X86_STM_CMP;
@@ -260,6 +330,14 @@ S X86_Stm_new_je(Label_t label) {
     return s;
 }
 
+S X86_Stm_new_jne(Label_t label) {
+    S s;
+    Mem_NEW(s);
+    s->kind = X86_STM_JNE;
+    s->u.jne = label;
+    return s;
+}
+
 S X86_Stm_new_jl(Label_t label) {
     S s;
     Mem_NEW(s);
@@ -361,6 +439,13 @@ S X86_Stm_new_cltd(void) {
     return s;
 }
 
+S X86_Stm_new_cltq(void) {
+    S s;
+    Mem_NEW(s);
+    s->kind = X86_STM_CLTQ;
+    return s;
+}
+
 S X86_Stm_new_xor(R dest, R src) {
     S s;
     Mem_NEW(s);
@@ -389,16 +474,23 @@ S X86_Stm_new_inc(R r) {
 static void X86_Operator_print(Operator_t o) {
     switch (o) {
         case OP_ADD:
-            print("addl ");
+            print("addq ");
             return;
         case OP_SUB:
-            print("subl ");
+            print("subq ");
             return;
         case OP_TIMES:
-            print("imull ");
+            print("imulq ");
             return;
         case OP_DIVIDE:
-            print("idivl ");
+            print("idivq ");
+            return;
+        // bitwise, on 0s and 1s
+        case OP_AND:
+            print("andq ");
+            return;
+        case OP_OR:
+            print("orq ");
             return;
         default:
             TODO;
@@ -416,28 +508,36 @@ void X86_Stm_print(S s) {
     switch (s->kind) {
         case X86_STM_MOVERR:
             space4();
-            print("movl ");
+            print("movq ");
             X86_Register_print(s->u.moverr.src);
             print(", ");
             X86_Register_print(s->u.moverr.dest);
             break;
         case X86_STM_MOVERI:
             space4();
-            print("movl $");
-            print(Int_toString(s->u.moveri.src));
+            print(fitsImm32(s->u.moveri.src) ? "movq $" : "movabsq $");
+            printLong(s->u.moveri.src);
             print(", ");
             X86_Register_print(s->u.moveri.dest);
             break;
-        case X86_STM_LOAD:
+        case X86_STM_LOAD: {
+            O src = s->u.load.src;
+
             space4();
-            print("movl ");
-            X86_Operand_print(s->u.load.src);
+            if (src->kind == X86_OP_GLOBAL || src->kind == X86_OP_LABEL)
+                print("leaq ");
+            else if (src->kind == X86_OP_INT && !fitsImm32(src->u.intlit))
+                print("movabsq ");
+            else
+                print("movq ");
+            X86_Operand_print(src);
             print(", ");
             X86_Register_print(s->u.load.dest);
             break;
+        }
         case X86_STM_STORE:
             space4();
-            print("movl ");
+            print("movq ");
             X86_Register_print(s->u.store.src);
             print(", ");
             X86_Operand_print(s->u.store.dest);
@@ -445,54 +545,60 @@ void X86_Stm_print(S s) {
         case X86_STM_BOP:
             space4();
             X86_Operator_print(s->u.bop.op);
-            X86_Register_print(s->u.bop.src);
+            X86_Operand_print(s->u.bop.src);
             print(", ");
             X86_Register_print(s->u.bop.dest);
             break;
         case X86_STM_UOP:
             space4();
             X86_Operator_print(s->u.uop.op);
-            X86_Register_print(s->u.uop.dest);
+            X86_Register_print(s->u.uop.src);
             break;
         case X86_STM_CALL:
             space4();
             print("call ");
             print(Id_toString(s->u.call.name));
+            print("@PLT");
             break;
         case X86_STM_CMP:
             space4();
-            print("cmpl ");
-            X86_Register_print(s->u.cmp.src);
+            print("cmpq ");
+            X86_Operand_print(s->u.cmp.src);
             print(", ");
             X86_Register_print(s->u.cmp.dest);
             break;
         case X86_STM_LABEL:
-            print(Label_toString(s->u.label));
+            printLabel(s->u.label);
             print(":");
             break;
         case X86_STM_JE:
             space4();
             print("je ");
-            print(Label_toString(s->u.je));
+            printLabel(s->u.je);
+            break;
+        case X86_STM_JNE:
+            space4();
+            print("jne ");
+            printLabel(s->u.jne);
             break;
         case X86_STM_JL:
             space4();
             print("jl ");
-            print(Label_toString(s->u.je));
+            printLabel(s->u.jl);
             break;
         case X86_STM_JUMP:
             space4();
             print("jmp ");
-            print(Label_toString(s->u.jump));
+            printLabel(s->u.jump);
             break;
         case X86_STM_PUSH:
             space4();
-            print("pushl ");
+            print("pushq ");
             X86_Register_print(s->u.push);
             break;
         case X86_STM_NEG:
             space4();
-            print("negl ");
+            print("negq ");
             X86_Register_print(s->u.neg);
             break;
         case X86_STM_SETL:
@@ -527,20 +633,18 @@ void X86_Stm_print(S s) {
             break;
         case X86_STM_XOR:
             space4();
-            print("xorl ");
+            print("xorq ");
             X86_Register_print(s->u.xor.src);
             print(", ");
             X86_Register_print(s->u.xor.dest);
             break;
         case X86_STM_EXTENDAL:
             space4();
-            print("cbtw\n");
-            space4();
-            print("cwtl");
+            print("movzbq %al, %rax");
             break;
         case X86_STM_NOT: {
             space4();
-            print("notl ");
+            print("notq ");
             X86_Register_print(s->u.not );
             break;
         }
@@ -550,11 +654,15 @@ void X86_Stm_print(S s) {
             break;
         case X86_STM_CLTD:
             space4();
-            print("cltd");
+            print("cqto");
+            break;
+        case X86_STM_CLTQ:
+            space4();
+            print("cltq");
             break;
         case X86_STM_INC:
             space4();
-            print("incl ");
+            print("incq ");
             X86_Register_print(s->u.inc);
             break;
         default:
@@ -564,76 +672,46 @@ void X86_Stm_print(S s) {
     print("\n");
 }
 
-F X86_Fun_new(Id_t type, Id_t name, List_t args,
-              List_t decs, List_t stms,
-              Id_t retId,
-              Label_t entry, Label_t exitt) {
+F X86_Fun_new(Id_t name, long frameSize, List_t stms) {
     F f;
     Mem_NEW(f);
-    f->type = type;
     f->name = name;
-    f->args = args;
-    f->decs = decs;
+    f->frameSize = frameSize;
     f->stms = stms;
-    f->retId = retId;
-    f->entry = entry;
-    f->exitt = exitt;
     return f;
 }
 
+File_t X86_Fun_print(File_t file_, F f) {
+    String_t name;
 
-//static void X86_Dec_print(X86_Struct_t);
-
-void X86_Fun_print(F f) {
     assert(f);
+    file = file_;
+    name = Id_toString(f->name);
     print("\t.text\n");
-    print("\t.globl _");
-    print(Id_toString(f->name));
-    print("\n_");
-    print(Id_toString(f->name));
+    print("\t.globl ");
+    print(name);
+    print("\n\t.type ");
+    print(name);
+    print(", @function\n");
+    print(name);
     print(":\n");
-    print("\tpushl %ebp\n");
-    print("\tmovl %esp, %ebp\n");
-    {
-        int i = List_size(f->decs);
-        if (i) {
-            print("\tsubl $");
-            print(Int_toString(4 * i));
-            print(", %esp\n");
-        }
+    print("\tpushq %rbp\n");
+    print("\tmovq %rsp, %rbp\n");
+    if (f->frameSize) {
+        print("\tsubq $");
+        printLong(f->frameSize);
+        print(", %rsp\n");
     }
     List_foreach(f->stms,
                  (Poly_tyVoid) X86_Stm_print);
+    print("\t.size ");
+    print(name);
+    print(", .-");
+    print(name);
     print("\n\n");
+    return file_;
 }
 
-
-Stt X86_Struct_new(Id_t type, Id_t var) {
-    Stt x;
-    Mem_NEW(x);
-    x->type = type;
-    x->var = var;
-    return x;
-}
-
-void X86_Struct_print(Stt x) {
-    assert(x);
-    print(Id_toString(x->type));
-    print(" ");
-    print(Id_toString(x->var));
-    print(";\n");
-}
-
-//static void X86_Dec_print(Stt x) {
-//    assert(x);
-//    print("\t");
-//    print(Id_toString(x->type));
-//    print(" ");
-//    print(Id_toString(x->var));
-//    print(";\n");
-//}
-
-
 Str X86_Str_new(Id_t name, String_t value) {
     Str d;
     Mem_NEW(d);
@@ -683,7 +761,7 @@ void X86_Str_print(Str s) {
 static void printStrs(List_t strings) {
     if (List_isEmpty(strings))
         return;
-    print("\t.data\n");
+    print("\t.section .rodata\n");
     List_foreach(strings,
                  (Poly_tyVoid) X86_Str_print);
 }
@@ -702,8 +780,8 @@ File_t X86_Mask_print(File_t file_, M m) {
 
     assert(m);
     fprintf(file_, "%s", Id_toString(m->name));
-    fprintf(file_, ":\n\t.int ");
-    fprintf(file_, "%s", Int_toString(m->size));
+    fprintf(file_, ":\n\t.quad ");
+    File_writeLong(file_, m->size);
     if (List_isEmpty(m->index)) {
         fprintf(file_, "\n");
         return file_;
@@ -711,7 +789,7 @@ File_t X86_Mask_print(File_t file_, M m) {
     fprintf(file_, ", ");
     p = List_getFirst(m->index);
     while (p) {
-        fprintf(file_, "%s", Int_toString((long) p->data));
+        File_writeLong(file_, (long) p->data);
         if (p->next)
             fprintf(file_, ", ");
         p = p->next;
@@ -724,7 +802,7 @@ static void printMask(File_t file_, List_t ms) {
     if (List_isEmpty(ms))
         return;
 
-    fprintf(file_, "\t.data\n"
+    fprintf(file_, "\t.section .rodata\n"
                    "\t.align 8\n");
     List_foldl(ms, file_, (Poly_tyFold) X86_Mask_print);
 }
@@ -743,8 +821,7 @@ File_t X86_Prog_print(File_t file_, P p) {
     assert(file_);
     assert(p);
 
-    file_init(file_);
-    buffer_init();
+    file = file_;
 
     printStrs(p->strings);
 
@@ -753,7 +830,8 @@ File_t X86_Prog_print(File_t file_, P p) {
 
     fprintf(file_, "%s", "\n");
     List_foldl(p->funcs, file_, (Poly_tyFold) X86_Fun_print);
-    buffer_final();
+    // no executable stack
+    fprintf(file_, "%s", "\t.section .note.GNU-stack,\"\",@progbits\n");
     return file_;
 }
 
@@ -763,6 +841,4 @@ File_t X86_Prog_print(File_t file_, P p) {
 #undef S
 #undef O
 #undef M
-#undef D
-#undef Stt
-#undef List_t
+#undef R
@@ -6,77 +6,97 @@
 #include "../lib/list.h"
 #include "../lib/string.h"
 
+// x86-64, in AT&T syntax, for the System V ABI.
+
 #define P X86_Prog_t
 #define Str X86_Str_t
 #define F X86_Fun_t
 #define S X86_Stm_t
 #define O X86_Operand_t
-#define D X86_Dec_t
-#define Stt X86_Struct_t
 #define M X86_Mask_t
 #define R X86_Register_t
 
 typedef struct O *O;
 typedef struct S *S;
-typedef struct Stt *Stt;
 typedef struct M *M;
 typedef struct F *F;
 typedef struct Str *Str;
-typedef struct D *D;
 typedef struct P *P;
 
 typedef enum {
     /* only to deal with set* instructions */
     X86_AL,
-    X86_EAX,
-    X86_EBX,
-    X86_ECX,
-    X86_EDX,
-    X86_EDI,
-    X86_ESI,
-    X86_EBP,
-    X86_ESP
+    X86_RAX,
+    X86_RBX,
+    X86_RCX,
+    X86_RDX,
+    X86_RSI,
+    X86_RDI,
+    X86_RBP,
+    X86_RSP,
+    X86_R8,
+    X86_R9,
+    X86_R10,
+    X86_R11,
+    X86_R12,
+    X86_R13,
+    X86_R14,
+    X86_R15
 } R;
 
+// the registers for the first arguments, in order
+#define X86_NUM_ARG_REGS 6
+extern const R X86_argRegs[X86_NUM_ARG_REGS];
+
 int X86_Register_equals(R, R);
+// whether a callee must keep "r" for its caller
+int X86_Register_isCalleeSaved(R r);
 void X86_Register_print(R);
 
 struct O {
     enum {
         X86_OP_INT,
+        // the address of a global symbol, or of a label
         X86_OP_GLOBAL,
+        X86_OP_LABEL,
+        // in bytes, from %rbp
         X86_OP_INSTACK,
         X86_OP_REG,
-        X86_OP_MEM
+        // offset(base)
+        X86_OP_MEM,
+        // (base, index, scale)
+        X86_OP_INDEX
     } kind;
     union {
-        int intlit;
+        long intlit;
         Id_t global;
-        int index;
+        Label_t label;
+        long index;
         R reg;
         struct {
             R base;
-            int offset;
+            long offset;
         } mem;
+        struct {
+            R base;
+            R index;
+            int scale;
+        } indexed;
     } u;
 };
 
-O X86_Operand_new_int(int i);
+O X86_Operand_new_int(long i);
 O X86_Operand_new_global(Id_t id);
-O X86_Operand_new_inStack(int index);
+O X86_Operand_new_label(Label_t label);
+O X86_Operand_new_inStack(long offset);
 O X86_Operand_new_reg(R r);
-O X86_Operand_new_mem(R r, int offset);
+O X86_Operand_new_mem(R r, long offset);
+O X86_Operand_new_index(R base, R index, int scale);
 int X86_Operand_sameStackSlot(O x, O y);
+// whether "o" can be an instruction's source as it is
+int X86_Operand_isDirect(O o);
 void X86_Operand_print(O);
 
-typedef enum {
-    X86_OPR_ADD,
-    X86_OPR_SUB,
-    X86_OPR_TIMES,
-    X86_OPR_DIVIDE,
-    X86_OPR_MODUS
-} Opr;
-
 struct S {
     enum {
         X86_STM_MOVERR,
@@ -89,11 +109,13 @@ struct S {
         X86_STM_CMP,
         X86_STM_LABEL,
         X86_STM_JE,
+        X86_STM_JNE,
         X86_STM_JL,
         X86_STM_JUMP,
         X86_STM_PUSH,
         X86_STM_RETURN,
         X86_STM_CLTD,
+        X86_STM_CLTQ,
         X86_STM_NEG,
         X86_STM_SETL,
         X86_STM_SETLE,
@@ -112,7 +134,7 @@ struct S {
             R dest;
         } moverr;
         struct {
-            int src;
+            long src;
             R dest;
         } moveri;
         struct {
@@ -123,11 +145,13 @@ struct S {
             R src;
             O dest;
         } store;
+        // dest = dest op src, where "src" is direct
         struct {
             R dest;
             Operator_t op;
-            R src;
+            O src;
         } bop;
+        // only "idiv" for now
         struct {
             R src;
             Operator_t op;
@@ -138,12 +162,13 @@ struct S {
         } call;
         struct {
             R dest;
-            R src;
+            O src;
         } cmp;
         R neg;
         R setAny;
         Label_t label;
         Label_t je;
+        Label_t jne;
         Label_t jl;
         Label_t jump;
         R push;
@@ -157,25 +182,27 @@ struct S {
 };
 
 S X86_Stm_new_moverr(R dest, R src);
-S X86_Stm_new_moveri(R dest, int i);
+S X86_Stm_new_moveri(R dest, long i);
 S X86_Stm_new_load(R dest, O src);
 S X86_Stm_new_store(O dest, R src);
 S X86_Stm_new_bop(R dest,
                   Operator_t op,
-                  R src);
+                  O src);
 S X86_Stm_new_uop(R dest,
                   Operator_t opr,
                   R src);
 S X86_Stm_new_call(Id_t name);
 S X86_Stm_new_cmp(R dest,
-                  R src);
+                  O src);
 S X86_Stm_new_push(R r);
 S X86_Stm_new_label(Label_t label);
 S X86_Stm_new_je(Label_t label);
+S X86_Stm_new_jne(Label_t label);
 S X86_Stm_new_jl(Label_t label);
 S X86_Stm_new_jump(Label_t label);
 S X86_Stm_new_return(void);
 S X86_Stm_new_cltd(void);
+S X86_Stm_new_cltq(void);
 S X86_Stm_new_neg(R r);
 S X86_Stm_new_setl(R r);
 S X86_Stm_new_setle(R r);
@@ -191,32 +218,15 @@ void X86_Stm_print(S);
 
 /* function */
 struct F {
-    Id_t type;
     Id_t name;
-    /* List<Stt> */
-    List_t args;
-    /* List<Struct_t> */
-    List_t decs;
+    // bytes below %rbp, a multiple of 16
+    long frameSize;
     /* List<Stm_t> */
     List_t stms;
-    Id_t retId;
-    Label_t entry;
-    Label_t exitt;
-};
-
-F X86_Fun_new(Id_t, Id_t, List_t, List_t, List_t,
-              Id_t, Label_t, Label_t);
-void X86_Fun_print(F);
-
-/* struct fields & function parameters */
-/* this should be rewritten into two different types */
-struct Stt {
-    Id_t type;
-    Id_t var;
 };
 
-Stt X86_Struct_new(Id_t, Id_t);
-void X86_Struct_print(Stt);
+F X86_Fun_new(Id_t name, long frameSize, List_t stms);
+File_t X86_Fun_print(File_t file_, F);
 
 struct Str {
     Id_t name;
@@ -255,8 +265,6 @@ File_t X86_Prog_print(File_t file_, P p);
 #undef S
 #undef O
 #undef M
-#undef D
-#undef Stt
 #undef R
 
 #endif